@@ -0,0 +1,198 @@
+#include "audio_dsp.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define JBOY_DSP_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define JBOY_DSP_SSE 1
+#endif
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+// One stereo frame as a two-lane vector.
+#if JBOY_DSP_NEON
+using Frame = float32x2_t;
+inline Frame frameSet(float l, float r) { const float v[2] = {l, r}; return vld1_f32(v); }
+inline Frame frameDup(float v) { return vdup_n_f32(v); }
+inline Frame frameLoad(const float* p) { return vld1_f32(p); }
+inline void frameStore(float* p, Frame v) { vst1_f32(p, v); }
+inline Frame frameAdd(Frame a, Frame b) { return vadd_f32(a, b); }
+inline Frame frameSub(Frame a, Frame b) { return vsub_f32(a, b); }
+inline Frame frameMul(Frame a, Frame b) { return vmul_f32(a, b); }
+inline Frame frameMulAdd(Frame acc, Frame a, Frame b) { return vmla_f32(acc, a, b); }
+inline Frame frameLoadPcm(const int16_t* p) { return frameSet(p[0], p[1]); }
+inline void frameStorePcm(int16_t* p, Frame v) {
+    const int32x2_t rounded = vcvt_s32_f32(vadd_f32(v, vbsl_f32(vcge_f32(v, vdup_n_f32(0.0f)),
+                                                                vdup_n_f32(0.5f), vdup_n_f32(-0.5f))));
+    const int16x4_t packed = vqmovn_s32(vcombine_s32(rounded, rounded));
+    vst1_lane_s32(reinterpret_cast<int32_t*>(p), vreinterpret_s32_s16(packed), 0);
+}
+#elif JBOY_DSP_SSE
+using Frame = __m128; // lanes 0 and 1 used
+inline Frame frameSet(float l, float r) { return _mm_setr_ps(l, r, 0.0f, 0.0f); }
+inline Frame frameDup(float v) { return _mm_set1_ps(v); }
+inline Frame frameLoad(const float* p) { return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p))); }
+inline void frameStore(float* p, Frame v) { _mm_store_sd(reinterpret_cast<double*>(p), _mm_castps_pd(v)); }
+inline Frame frameAdd(Frame a, Frame b) { return _mm_add_ps(a, b); }
+inline Frame frameSub(Frame a, Frame b) { return _mm_sub_ps(a, b); }
+inline Frame frameMul(Frame a, Frame b) { return _mm_mul_ps(a, b); }
+inline Frame frameMulAdd(Frame acc, Frame a, Frame b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+inline Frame frameLoadPcm(const int16_t* p) { return frameSet(p[0], p[1]); }
+inline void frameStorePcm(int16_t* p, Frame v) {
+    // cvtps rounds to nearest; packs saturates to int16.
+    const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(v), _mm_setzero_si128());
+    const int32_t pair = _mm_cvtsi128_si32(packed);
+    memcpy(p, &pair, sizeof(pair));
+}
+#else
+struct Frame {
+    float l;
+    float r;
+};
+inline Frame frameSet(float l, float r) { return {l, r}; }
+inline Frame frameDup(float v) { return {v, v}; }
+inline Frame frameLoad(const float* p) { return {p[0], p[1]}; }
+inline void frameStore(float* p, Frame v) { p[0] = v.l; p[1] = v.r; }
+inline Frame frameAdd(Frame a, Frame b) { return {a.l + b.l, a.r + b.r}; }
+inline Frame frameSub(Frame a, Frame b) { return {a.l - b.l, a.r - b.r}; }
+inline Frame frameMul(Frame a, Frame b) { return {a.l * b.l, a.r * b.r}; }
+inline Frame frameMulAdd(Frame acc, Frame a, Frame b) { return {acc.l + a.l * b.l, acc.r + a.r * b.r}; }
+inline Frame frameLoadPcm(const int16_t* p) { return {static_cast<float>(p[0]), static_cast<float>(p[1])}; }
+inline int16_t saturate(float v) {
+    const float clamped = v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v);
+    return static_cast<int16_t>(lrintf(clamped));
+}
+inline void frameStorePcm(int16_t* p, Frame v) { p[0] = saturate(v.l); p[1] = saturate(v.r); }
+#endif
+
+} // namespace
+
+AudioDsp::AudioDsp() {
+    reset();
+}
+
+void AudioDsp::configure(float gain, bool lowPass, int filterLevel) {
+    m_gain = gain < 0.0f ? 0.0f : (gain > 1.0f ? 1.0f : gain);
+    filterLevel = filterLevel < 0 ? 0 : (filterLevel > 100 ? 100 : filterLevel);
+    if (lowPass != m_lowPass || filterLevel != m_filterLevel) {
+        m_coefficientsDirty = true;
+    }
+    if (lowPass && !m_lowPass) {
+        memset(m_z1, 0, sizeof(m_z1));
+        memset(m_z2, 0, sizeof(m_z2));
+    }
+    m_lowPass = lowPass;
+    m_filterLevel = filterLevel;
+    m_enabled = true;
+}
+
+void AudioDsp::reset() {
+    memset(m_z1, 0, sizeof(m_z1));
+    memset(m_z2, 0, sizeof(m_z2));
+    memset(m_dcIn, 0, sizeof(m_dcIn));
+    memset(m_dcOut, 0, sizeof(m_dcOut));
+    memset(m_last, 0, sizeof(m_last));
+    m_hasLast = false;
+    m_discontinuity = false;
+}
+
+void AudioDsp::updateCoefficients(int sampleRate) {
+    m_sampleRate = sampleRate;
+    m_coefficientsDirty = false;
+    const float fs = static_cast<float>(sampleRate);
+    m_dcPole = 1.0f - 2.0f * kPi * DC_CUTOFF_HZ / fs;
+    if (!m_lowPass) {
+        m_b0 = 1.0f;
+        m_b1 = m_b2 = m_a1 = m_a2 = 0.0f;
+        return;
+    }
+    // Same cutoff the one-pole Kotlin filter had at this level, now with a
+    // 12 dB/octave Butterworth slope.
+    const float strength = m_filterLevel / 100.0f;
+    float alpha = 0.86f - strength * 0.62f;
+    alpha = alpha < 0.08f ? 0.08f : (alpha > 0.9f ? 0.9f : alpha);
+    float cutoff = -logf(1.0f - alpha) * fs / (2.0f * kPi);
+    if (cutoff > fs * 0.45f) {
+        cutoff = fs * 0.45f;
+    }
+    const float w0 = 2.0f * kPi * cutoff / fs;
+    const float cosW0 = cosf(w0);
+    const float q = sinf(w0) / (2.0f * 0.70710678f);
+    const float a0 = 1.0f + q;
+    m_b0 = (1.0f - cosW0) * 0.5f / a0;
+    m_b1 = (1.0f - cosW0) / a0;
+    m_b2 = m_b0;
+    m_a1 = -2.0f * cosW0 / a0;
+    m_a2 = (1.0f - q) / a0;
+}
+
+void AudioDsp::process(int16_t* samples, int count, int sampleRate) {
+    if (!m_enabled || !samples || count < 2 || sampleRate <= 0) {
+        return;
+    }
+    if (m_coefficientsDirty || sampleRate != m_sampleRate) {
+        updateCoefficients(sampleRate);
+    }
+    const int frames = count / 2;
+
+    const Frame gain = frameDup(m_gain);
+    const Frame b0 = frameDup(m_b0);
+    const Frame b1 = frameDup(m_b1);
+    const Frame b2 = frameDup(m_b2);
+    const Frame negA1 = frameDup(-m_a1);
+    const Frame negA2 = frameDup(-m_a2);
+    const Frame dcPole = frameDup(m_dcPole);
+    Frame z1 = frameLoad(m_z1);
+    Frame z2 = frameLoad(m_z2);
+    Frame dcIn = frameLoad(m_dcIn);
+    Frame dcOut = frameLoad(m_dcOut);
+    const bool lowPass = m_lowPass;
+
+    // Crossfade from the last emitted frame when the stream jumped.
+    int smoothFrames = 0;
+    Frame last = frameLoad(m_last);
+    if (m_discontinuity && m_hasLast) {
+        const float startL = samples[0] * m_gain;
+        const float startR = samples[1] * m_gain;
+        if (fabsf(startL - m_last[0]) >= EDGE_SMOOTH_THRESHOLD || fabsf(startR - m_last[1]) >= EDGE_SMOOTH_THRESHOLD) {
+            smoothFrames = frames < EDGE_SMOOTH_FRAMES ? frames : EDGE_SMOOTH_FRAMES;
+        }
+    }
+    m_discontinuity = false;
+
+    for (int i = 0; i < frames; ++i) {
+        int16_t* pcm = samples + i * 2;
+        Frame x = frameMul(frameLoadPcm(pcm), gain);
+        if (lowPass) {
+            const Frame y = frameMulAdd(z1, b0, x);
+            z1 = frameMulAdd(frameMulAdd(z2, b1, x), negA1, y);
+            z2 = frameMulAdd(frameMul(b2, x), negA2, y);
+            x = y;
+        }
+        // y[n] = x[n] - x[n-1] + R * y[n-1]
+        dcOut = frameMulAdd(frameSub(x, dcIn), dcPole, dcOut);
+        dcIn = x;
+        Frame out = dcOut;
+        if (i < smoothFrames) {
+            const Frame t = frameDup(static_cast<float>(i + 1) / smoothFrames);
+            out = frameAdd(last, frameMul(frameSub(out, last), t));
+        }
+        frameStorePcm(pcm, out);
+        if (i + 1 == frames) {
+            last = out;
+        }
+    }
+
+    frameStore(m_z1, z1);
+    frameStore(m_z2, z2);
+    frameStore(m_dcIn, dcIn);
+    frameStore(m_dcOut, dcOut);
+    frameStore(m_last, last);
+    m_hasLast = true;
+}
@@ -1,12 +1,13 @@
 #include <SLES/OpenSLES.h>
 #include <SLES/OpenSLES_Android.h>
-#include <android/log.h>
 #include <cstring>
 #include <cstdint>
 
+#include "jboy_log.h"
+
 #define LOG_TAG "JBOY_Audio"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
 
 // GB音频参数
 const int GB_AUDIO_SAMPLE_RATE = 44100;
@@ -0,0 +1,182 @@
+#include "audio_pacer.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// Wall-clock pacing lets at most this much audio queue up before trimming.
+constexpr uint64_t WALL_CLOCK_BACKLOG_MS = 65;
+
+} // namespace
+
+AudioPacer::AudioPacer() {
+    memset(m_buffer, 0, sizeof(m_buffer));
+}
+
+void AudioPacer::setOutputRate(unsigned sampleRate) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_outputRate = sampleRate;
+}
+
+bool AudioPacer::setAudioClock(bool enabled) {
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        changed = m_audioClock != enabled;
+        m_audioClock = enabled;
+    }
+    m_cond.notify_all();
+    return changed;
+}
+
+void AudioPacer::setGameState(bool loaded, bool paused) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loaded = loaded;
+        m_paused = paused;
+    }
+    m_cond.notify_all();
+}
+
+void AudioPacer::configureDsp(float gain, bool lowPass, int filterLevel) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dsp.configure(gain, lowPass, filterLevel);
+}
+
+void AudioPacer::reset() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_readIndex = 0;
+        m_writeIndex = 0;
+        m_count = 0;
+        m_dsp.reset();
+    }
+    m_cond.notify_all();
+}
+
+void AudioPacer::append(const int16_t* samples, int count, int sampleRate) {
+    if (!samples || count <= 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sampleRate = sampleRate;
+        for (int i = 0; i < count; ++i) {
+            m_buffer[m_writeIndex] = samples[i];
+            m_writeIndex = (m_writeIndex + 1) % CAPACITY;
+            if (m_count < CAPACITY) {
+                ++m_count;
+            } else {
+                m_readIndex = (m_readIndex + 1) % CAPACITY;
+                ++m_droppedSamples;
+                m_dsp.markDiscontinuity();
+            }
+        }
+    }
+    m_cond.notify_all();
+}
+
+int AudioPacer::highWaterLocked() const {
+    const int samples = static_cast<int>((static_cast<uint64_t>(m_outputRate) * 2ULL * CLOCK_LATENCY_MS) / 1000ULL);
+    return samples < CAPACITY / 2 ? samples : CAPACITY / 2;
+}
+
+void AudioPacer::waitForSpace(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {
+        return !m_audioClock || !m_loaded || m_paused || m_count < highWaterLocked();
+    });
+}
+
+void AudioPacer::dropLocked(int count) {
+    m_readIndex = (m_readIndex + count) % CAPACITY;
+    m_count -= count;
+    m_droppedSamples += count;
+    m_dsp.markDiscontinuity();
+}
+
+int AudioPacer::takeLocked(int16_t* out, int count) {
+    for (int i = 0; i < count; ++i) {
+        out[i] = m_buffer[m_readIndex];
+        m_readIndex = (m_readIndex + 1) % CAPACITY;
+    }
+    m_count -= count;
+    m_dsp.process(out, count, m_sampleRate);
+    return count;
+}
+
+int AudioPacer::consume(int16_t* out, int maxSamples) {
+    if (!out || maxSamples <= 0) {
+        return 0;
+    }
+    int count;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        int preferredBacklog = static_cast<int>((static_cast<uint64_t>(m_outputRate) * 2ULL * WALL_CLOCK_BACKLOG_MS) / 1000ULL);
+        const int minBacklog = maxSamples * 2;
+        int maxBacklog = CAPACITY - maxSamples;
+        if (maxBacklog < minBacklog) {
+            maxBacklog = minBacklog;
+        }
+        if (preferredBacklog < minBacklog) {
+            preferredBacklog = minBacklog;
+        } else if (preferredBacklog > maxBacklog) {
+            preferredBacklog = maxBacklog;
+        }
+        // Only the wall clock can run ahead of the sink; with audio-clock pacing the
+        // backlog is bounded by waitForSpace() instead.
+        if (m_count > preferredBacklog && !m_audioClock) {
+            const int drop = (m_count - preferredBacklog) & ~1;
+            if (drop > 0) {
+                dropLocked(drop);
+            }
+        }
+
+        count = (m_count < maxSamples ? m_count : maxSamples) & ~1;
+        if (count <= 0) {
+            return 0;
+        }
+        takeLocked(out, count);
+    }
+    m_cond.notify_all();
+    return count;
+}
+
+int AudioPacer::read(int16_t* out, int maxSamples, int timeoutMs) {
+    if (!out || maxSamples < 2) {
+        return 0;
+    }
+    int count;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const bool ready = m_cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {
+            return m_count >= 2 || !m_loaded;
+        });
+        if (!ready || m_count < 2) {
+            if (m_loaded && !m_paused) {
+                ++m_underruns;
+            }
+            return 0;
+        }
+        count = (m_count < maxSamples ? m_count : maxSamples) & ~1;
+        takeLocked(out, count);
+    }
+    m_cond.notify_all();
+    return count;
+}
+
+int AudioPacer::getFill() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
+
+int64_t AudioPacer::getDroppedSamples() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_droppedSamples;
+}
+
+int64_t AudioPacer::getUnderruns() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_underruns;
+}
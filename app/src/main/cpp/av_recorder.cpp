@@ -0,0 +1,235 @@
+#include "av_recorder.h"
+
+#include <cstring>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#define LOG_TAG "JBOY_Recorder"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+// GBA refresh rate, 16777216 / 280896 Hz reduced.
+constexpr int FRAME_RATE_NUM = 262144;
+constexpr int FRAME_RATE_DEN = 4389;
+constexpr size_t LINE_BYTES = AvRecorder::FRAME_WIDTH * 2;
+
+} // namespace
+
+AvRecorder::AvRecorder() = default;
+
+AvRecorder::~AvRecorder() {
+    stop();
+}
+
+bool AvRecorder::start(const std::string& basePath, int sampleRate) {
+    stop();
+    if (basePath.empty() || sampleRate <= 0) {
+        return false;
+    }
+    const std::string videoPath = basePath + ".y4m";
+    const std::string audioPath = basePath + ".wav";
+    m_videoFile = fopen(videoPath.c_str(), "wb");
+    m_audioFile = fopen(audioPath.c_str(), "wb");
+    if (!m_videoFile || !m_audioFile) {
+        LOGE("Failed to open recording files at %s", basePath.c_str());
+        finishFiles();
+        return false;
+    }
+    setvbuf(m_videoFile, nullptr, _IOFBF, 1 << 20);
+    fprintf(m_videoFile, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C444 XCOLORRANGE=FULL\n",
+            FRAME_WIDTH, FRAME_HEIGHT, FRAME_RATE_NUM, FRAME_RATE_DEN);
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(header, sampleRate, 2, 0);
+    fwrite(header, 1, sizeof(header), m_audioFile);
+    m_audioBytes = 0;
+    m_audioSampleRate = sampleRate;
+
+    if (!m_pool) {
+        m_pool.reset(new Slot[POOL_SIZE]);
+    }
+    m_freeSlots.clear();
+    m_filledSlots.clear();
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        m_freeSlots.push(&m_pool[i]);
+    }
+    m_current = nullptr;
+    m_resync = true;
+    m_writtenFrames.store(0, std::memory_order_relaxed);
+    m_droppedFrames = 0;
+    m_lastEnqueueUs = 0;
+    m_stopRequested.store(false);
+    m_encoder = std::thread(&AvRecorder::encoderLoop, this);
+    m_recording = true;
+    LOGD("Recording to %s (%d Hz)", basePath.c_str(), sampleRate);
+    return true;
+}
+
+void AvRecorder::stop() {
+    if (!m_recording) {
+        return;
+    }
+    m_recording = false;
+    m_stopRequested.store(true);
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_one();
+    if (m_encoder.joinable()) {
+        m_encoder.join();
+    }
+    // The slot of a frame that never completed is dropped; start() refills the pool.
+    m_current = nullptr;
+    finishFiles();
+    LOGD("Recording stopped: %lld frames written, %lld dropped",
+         static_cast<long long>(getWrittenFrames()), static_cast<long long>(m_droppedFrames));
+}
+
+AvRecorder::Slot* AvRecorder::acquireSlot() {
+    if (!m_current && m_freeSlots.pop(m_current)) {
+        memset(m_current->dirtyLines, 0, sizeof(m_current->dirtyLines));
+        m_current->videoWritten = false;
+        m_current->audioCount = 0;
+    }
+    return m_current;
+}
+
+void AvRecorder::copyLines(Slot* slot, const uint8_t* rgb565, const uint32_t* lines) {
+    for (int y = 0; y < FRAME_HEIGHT; ++y) {
+        if (lines[y >> 5] & (1u << (y & 31))) {
+            memcpy(slot->video + y * LINE_BYTES, rgb565 + y * LINE_BYTES, LINE_BYTES);
+        }
+    }
+}
+
+void AvRecorder::appendAudio(const int16_t* samples, int count) {
+    if (!m_recording || count <= 0) {
+        return;
+    }
+    Slot* slot = acquireSlot();
+    if (!slot) {
+        return;
+    }
+    const int space = MAX_AUDIO_SAMPLES - slot->audioCount;
+    const int copy = count < space ? count : space;
+    memcpy(slot->audio + slot->audioCount, samples, copy * sizeof(int16_t));
+    slot->audioCount += copy;
+}
+
+uint8_t* AvRecorder::frameBuffer() {
+    if (!m_recording) {
+        return nullptr;
+    }
+    Slot* slot = acquireSlot();
+    if (!slot) {
+        return nullptr;
+    }
+    slot->videoWritten = true;
+    return slot->video;
+}
+
+void AvRecorder::commitFrame(const uint8_t* rgb565, const uint32_t* dirtyLines) {
+    if (!m_recording) {
+        return;
+    }
+    const int64_t startNs = nowNanos();
+    Slot* slot = acquireSlot();
+    if (!slot) {
+        ++m_droppedFrames;
+        m_resync = true;
+        return;
+    }
+    if (m_resync) {
+        // First frame, or frames were dropped: fill in every line.
+        uint32_t missing[DIRTY_WORDS];
+        for (int i = 0; i < DIRTY_WORDS; ++i) {
+            missing[i] = slot->videoWritten ? ~dirtyLines[i] : ~0u;
+            slot->dirtyLines[i] = ~0u;
+        }
+        copyLines(slot, rgb565, missing);
+        m_resync = false;
+    } else {
+        if (!slot->videoWritten) {
+            // Rendered without frameBuffer(); a skipped frame has no dirty lines.
+            copyLines(slot, rgb565, dirtyLines);
+        }
+        memcpy(slot->dirtyLines, dirtyLines, sizeof(slot->dirtyLines));
+    }
+    m_current = nullptr;
+    // Cannot fail: both rings are larger than the pool.
+    m_filledSlots.push(slot);
+    {
+        // Taken so the notify cannot slip between the encoder's check and its wait.
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_one();
+    m_lastEnqueueUs = (nowNanos() - startNs) / 1000;
+}
+
+void AvRecorder::encoderLoop() {
+    for (;;) {
+        Slot* slot = nullptr;
+        if (m_filledSlots.pop(slot)) {
+            writeSlot(slot);
+            m_freeSlots.push(slot);
+            continue;
+        }
+        if (m_stopRequested.load()) {
+            break;
+        }
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait(lock, [this] { return !m_filledSlots.empty() || m_stopRequested.load(); });
+    }
+}
+
+void AvRecorder::writeSlot(const Slot* slot) {
+    // RGB565 -> BT.601 full-range YUV 4:4:4, one plane after another. Lines
+    // that did not change keep the previous frame's values.
+    const int pixels = FRAME_WIDTH * FRAME_HEIGHT;
+    uint8_t* yPlane = m_yuv;
+    uint8_t* uPlane = m_yuv + pixels;
+    uint8_t* vPlane = m_yuv + pixels * 2;
+    for (int y = 0; y < FRAME_HEIGHT; ++y) {
+        if (!(slot->dirtyLines[y >> 5] & (1u << (y & 31)))) {
+            continue;
+        }
+        for (int i = y * FRAME_WIDTH; i < (y + 1) * FRAME_WIDTH; ++i) {
+            const uint16_t c = static_cast<uint16_t>(slot->video[i * 2] | (slot->video[i * 2 + 1] << 8));
+            const int r5 = c >> 11;
+            const int g6 = (c >> 5) & 0x3F;
+            const int b5 = c & 0x1F;
+            const int r = (r5 << 3) | (r5 >> 2);
+            const int g = (g6 << 2) | (g6 >> 4);
+            const int b = (b5 << 3) | (b5 >> 2);
+            yPlane[i] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+            uPlane[i] = static_cast<uint8_t>((-43 * r - 85 * g + 128 * b + 32896) >> 8);
+            vPlane[i] = static_cast<uint8_t>((128 * r - 107 * g - 21 * b + 32896) >> 8);
+        }
+    }
+    fwrite("FRAME\n", 1, 6, m_videoFile);
+    fwrite(m_yuv, 1, sizeof(m_yuv), m_videoFile);
+    if (slot->audioCount > 0) {
+        const size_t bytes = slot->audioCount * sizeof(int16_t);
+        // WAV is little-endian, as is every Android ABI.
+        fwrite(slot->audio, 1, bytes, m_audioFile);
+        m_audioBytes += static_cast<uint32_t>(bytes);
+    }
+    m_writtenFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AvRecorder::finishFiles() {
+    if (m_videoFile) {
+        fclose(m_videoFile);
+        m_videoFile = nullptr;
+    }
+    if (m_audioFile) {
+        uint8_t header[WAV_HEADER_SIZE];
+        buildWavHeader(header, m_audioSampleRate, 2, m_audioBytes);
+        fseek(m_audioFile, 0, SEEK_SET);
+        fwrite(header, 1, sizeof(header), m_audioFile);
+        fclose(m_audioFile);
+        m_audioFile = nullptr;
+    }
+}
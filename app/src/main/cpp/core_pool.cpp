@@ -0,0 +1,106 @@
+#include "core_pool.h"
+
+
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#define LOG_TAG "JBOY_CorePool"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+CorePool::~CorePool() {
+    clear();
+}
+
+void CorePool::prewarm() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_spare || m_warmer.joinable()) {
+        return;
+    }
+    m_warmer = std::thread(&CorePool::warmLoop, this);
+}
+
+struct mCore* CorePool::take(Timings* timings) {
+    // A warm-up in flight finishes sooner than a fresh build would.
+    joinWarmer();
+    struct mCore* core = nullptr;
+    Timings taken;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        core = m_spare;
+        taken = m_spareTimings;
+        m_spare = nullptr;
+    }
+    if (core) {
+        taken.prewarmed = true;
+    } else {
+        core = build(taken);
+    }
+    if (timings) {
+        *timings = taken;
+    }
+    return core;
+}
+
+void CorePool::clear() {
+    joinWarmer();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    destroy(m_spare);
+    m_spare = nullptr;
+}
+
+struct mCore* CorePool::build(Timings& timings) {
+    const int64_t startNs = nowNanos();
+    struct mCore* core = mCoreCreate(mPLATFORM_GBA);
+    if (!core) {
+        LOGE("Failed to create mCore");
+        return nullptr;
+    }
+    core->init(core);
+    const int64_t configNs = nowNanos();
+    mCoreInitConfig(core, "jboy");
+    mCoreLoadConfig(core);
+    timings.createUs = (configNs - startNs) / 1000;
+    timings.configUs = (nowNanos() - configNs) / 1000;
+    timings.prewarmed = false;
+    return core;
+}
+
+void CorePool::destroy(struct mCore* core) {
+    if (core) {
+        mCoreConfigDeinit(&core->config);
+        core->deinit(core);
+    }
+}
+
+void CorePool::warmLoop() {
+    Timings timings;
+    struct mCore* core = build(timings);
+    if (!core) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_spare) {
+        // A second warm-up raced a take(); one spare is enough.
+        destroy(core);
+        return;
+    }
+    m_spare = core;
+    m_spareTimings = timings;
+    LOGD("Core pre-warmed: create %lld us, config %lld us", static_cast<long long>(timings.createUs),
+         static_cast<long long>(timings.configUs));
+}
+
+void CorePool::joinWarmer() {
+    std::thread warmer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        warmer = std::move(m_warmer);
+    }
+    if (warmer.joinable()) {
+        warmer.join();
+    }
+}
@@ -1,4 +1,3 @@
-#include <android/log.h>
 #include <jni.h>
 #include <cstring>
 #include <cstdint>
@@ -7,23 +6,48 @@
 #include <cctype>
 #include <mutex>
 #include <fcntl.h>
+#include <unistd.h>
 #include <vector>
+#include <zlib.h>
 
 #include <mgba/core/core.h>
 #include <mgba/core/cheats.h>
 #include <mgba/core/config.h>
 #include <mgba/core/interface.h>
 #include <mgba/core/serialize.h>
+#include <mgba/feature/video-logger.h>
+#include <mgba/internal/gba/gba.h>
 #include <mgba-util/audio-buffer.h>
 #include <mgba-util/image.h>
 #include <mgba-util/vfs.h>
 
+#include "audio_pacer.h"
+#include "av_recorder.h"
+#include "core_pool.h"
+#include "frame_skip_controller.h"
+#include "guest_profiler.h"
+#include "input_latency.h"
+#include "jboy_log.h"
+#include "native_util.h"
+#include "ram_search.h"
+#include "replay_buffer.h"
+#include "rom_patcher.h"
+#include "save_ram_manager.h"
+#include "slot_index.h"
+#include "state_cache.h"
+#include "state_export.h"
+#include "thread_placement.h"
+#include "thumbnail_generator.h"
+#include "tuning_database.h"
+
 #define LOG_TAG "JBOY_Core"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
 
 const uint16_t GBA_SCREEN_WIDTH = 240;
 const uint16_t GBA_SCREEN_HEIGHT = 160;
+// One bit per scanline; keep in sync with EmulatorCore.DIRTY_LINE_WORDS.
+const int DIRTY_LINE_WORDS = (GBA_SCREEN_HEIGHT + 31) / 32;
 
 enum GBAButton {
     GBA_BUTTON_A      = 0x001,
@@ -38,6 +62,83 @@ enum GBAButton {
     GBA_BUTTON_L      = 0x200
 };
 
+// Slots of the stats array returned by nativeGetStats; keep in sync with CoreStats.kt.
+enum CoreStat {
+    CORE_STAT_HIBERNATE_WRITE_US = 0,
+    CORE_STAT_HIBERNATE_RESTORE_US,
+    CORE_STAT_RESET_US,
+    CORE_STAT_ROM_LOAD_US,
+    CORE_STAT_SAVE_FLUSH_COUNT,
+    CORE_STAT_SAVE_FLUSH_US,
+    CORE_STAT_SAVE_FLUSH_FAILURES,
+    CORE_STAT_FRAME_SKIP_LEVEL,
+    CORE_STAT_FRAMES_SKIPPED,
+    CORE_STAT_FRAME_RENDER_US,
+    CORE_STAT_FRAME_SKIP_US,
+    CORE_STAT_PRESENT_US,
+    CORE_STAT_AUDIO_RING_FILL,
+    CORE_STAT_AUDIO_DROPPED_SAMPLES,
+    CORE_STAT_AUDIO_UNDERRUNS,
+    CORE_STAT_RECORD_FRAMES,
+    CORE_STAT_RECORD_DROPPED_FRAMES,
+    CORE_STAT_RECORD_ENQUEUE_US,
+    CORE_STAT_REPLAY_FRAMES,
+    CORE_STAT_REPLAY_BYTES,
+    CORE_STAT_REPLAY_CAPACITY_BYTES,
+    CORE_STAT_REPLAY_ENCODE_US,
+    CORE_STAT_CORE_CREATE_US,
+    CORE_STAT_CORE_CONFIG_US,
+    CORE_STAT_CORE_PREWARMED,
+    CORE_STAT_CORE_ACQUIRE_US,
+    CORE_STAT_FIRST_FRAME_US,
+    CORE_STAT_PERFORMANCE_CORES,
+    CORE_STAT_EMU_THREAD_PINNED,
+    CORE_STAT_EMU_THREAD_CPU,
+    CORE_STAT_EMU_OFF_PERFORMANCE_FRAMES,
+    CORE_STAT_AUDIO_THREAD_POLICY,
+    CORE_STAT_RAM_SEARCH_CANDIDATES,
+    CORE_STAT_RAM_SEARCH_PASS_US,
+    CORE_STAT_STATE_EXPORT_US,
+    CORE_STAT_SAVE_RESTORES,
+    CORE_STAT_COUNT
+};
+
+// How emulation is paced; keep in sync with EmulatorCore.PacingMode.
+enum PacingMode {
+    // The frame loop paces from the wall clock; the audio backlog is trimmed to bound latency.
+    PACING_WALL_CLOCK = 0,
+    // The audio sink is the master clock: it pulls samples with readAudioSamples()
+    // and emulation waits for ring space before each step.
+    PACING_AUDIO_CLOCK
+};
+
+// Slots of the stats buffer filled by nativeStep; keep in sync with StepStats.kt.
+enum StepStat {
+    STEP_STAT_FRAMES_RUN = 0,
+    STEP_STAT_VIDEO_CHANGED,
+    STEP_STAT_AUDIO_SAMPLES,
+    STEP_STAT_AUDIO_RATE,
+    STEP_STAT_EMULATION_US,
+    STEP_STAT_DIRTY_LINES,
+    STEP_STAT_COUNT = STEP_STAT_DIRTY_LINES + DIRTY_LINE_WORDS
+};
+
+// <rom>.hibernate layout: header, raw RGB565 frame, zlib-compressed core state.
+// The frame sits uncompressed up front so it can be shown before the core exists.
+struct HibernationHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t romCrc32;
+    uint32_t romSize;
+    uint32_t frameSize;
+    uint32_t stateSize;
+    uint32_t packedSize;
+    uint32_t stateCrc32;
+};
+
+static constexpr uint32_t HIBERNATION_MAGIC = 0x42484A42; // "BJHB"
+static constexpr uint32_t HIBERNATION_VERSION = 1;
+
 class JboyCore {
 public:
     JboyCore();
@@ -46,7 +147,9 @@ public:
     bool init();
     void cleanup();
 
-    bool loadRom(const char* romPath);
+    // With a patch, the patched image is loaded and saves, states and
+    // hibernation are keyed by the patch file: a hack is a different game.
+    bool loadRom(const char* romPath, const char* patchPath = nullptr);
     void unloadRom();
     bool isRomLoaded() const { return m_core != nullptr && m_romLoaded; }
 
@@ -57,40 +160,96 @@ public:
     bool saveState(int slot);
     bool loadState(int slot);
     bool hasSaveState(int slot) const;
+    std::vector<SlotIndex::Entry> getSaveSlots() const { return m_slots.entries(); }
+    bool readSlotThumbnail(int slot, std::vector<uint8_t>& out) const { return m_slots.readThumbnail(slot, out); }
 
     const uint8_t* getFrameBuffer() const { return m_frameBuffer; }
     int getFrameBufferSize() const { return GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 2; }
 
     void pause();
     void resume();
-    void reset();
+    bool reset();
     bool isPaused() const { return m_paused; }
+    void flushSaveData();
+    void setEmulationSpeed(int speed);
 
     const char* getRomTitle() const { return m_romTitle.c_str(); }
     void setAudioConfig(int sampleRate, int bufferSize);
     void setGameOptions(bool frameSkipEnabled, int frameSkipThrottlePercent, int frameSkipInterval,
-                        bool interframeBlending, int idleLoopMode, bool gbControllerRumble);
+                        bool interframeBlending, int idleLoopMode, bool gbControllerRumble, bool threadedVideo);
     int getAudioRate() const;
     int consumeAudioSamples(int16_t* out, int maxSamples);
+    void setPacingMode(int mode);
+    void setAudioDsp(float gain, bool lowPass, int filterLevel);
+    // Audio-clock pacing: blocks up to timeoutMs for samples, never trims the backlog.
+    int readAudioSamples(int16_t* out, int maxSamples, int timeoutMs);
     bool clearCheats();
     bool addCheatCode(const char* code);
+    bool startRamSearch(int width);
+    bool filterRamSearch(int relation, uint32_t value);
+    // False while a filter pass is still running.
+    bool getRamSearchResults(int max, std::vector<RamSearch::Result>& out);
+    bool setStateExport(bool enabled);
+    void setLatencyMode(int mode, int probeButtons);
+    void getLatencyReport(int64_t* out, int count) const;
+    // A new fd for the shared state region, or -1 while the export is off.
+    int duplicateStateExportFd() const;
     uint8_t* getVideoBuffer() { return m_videoBuffer; }
+    bool consumeVideoFrame(uint8_t* outFrame, uint32_t* outDirtyLines);
     void appendAudioFrame(int16_t left, int16_t right);
+    // Runs up to `frames` frames and collects video, audio and stats in one locked pass.
+    // buttons < 0 keeps the current input; a null outVideo leaves dirty lines pending.
+    int step(int frames, int buttons, uint8_t* outVideo, int16_t* outAudio, int audioCapacity, int64_t* outStats);
+
+    bool hibernate();
+    bool restoreHibernation();
+    static std::string getHibernationPath(const std::string& romPath) { return romPath + ".hibernate"; }
+    static bool readHibernationFrame(const std::string& romPath, uint8_t* outFrame, size_t frameSize);
+    void getStats(int64_t* out, int count) const;
+    void startProfiler(int intervalCycles);
+    void stopProfiler();
+    std::string getProfileReport() const;
+    void setDataDirectory(const std::string& dir);
+    bool startRecording(const std::string& basePath);
+    void stopRecording();
+    void setReplayConfig(int seconds, int memoryKb);
+    bool exportReplay(const std::string& basePath);
 
 private:
-    static constexpr int AUDIO_BUFFER_CAPACITY = 16384;
+    // step() drains audio in chunks of this size so the backlog trimming in
+    // consumeAudioSamples behaves as it does for nativeGetAudioFrame.
+    static constexpr int AUDIO_STEP_CHUNK = 2048;
+    // Upper bound on a step waiting for ring space, so a stalled sink degrades
+    // to roughly real-time pacing instead of freezing emulation.
+    static constexpr int AUDIO_CLOCK_WAIT_MS = 34;
 
     std::string getStatePath(int slot) const;
     std::string getSavePath() const;
-    void appendAudioSamples(const int16_t* samples, int sampleCount);
+    void applyCoreOptionsLocked();
     bool createCoreLocked();
+    // Tears down everything tied to the loaded ROM; the mCore itself stays.
+    void releaseRomLocked();
     bool performCoreResetLocked();
+    uint32_t getRomCrc32Locked() const;
+    void updateVideoBufferLocked();
+    void markAllLinesDirtyLocked();
+    void skipFrameRenderLocked();
+    void syncVideoThreadLocked();
+    // JBOY button mask to mGBA's GBA key bits.
+    static uint32_t toCoreKeys(int buttons);
 
     struct mCore* m_core = nullptr;
     int m_buttons = 0;
     bool m_paused = false;
     bool m_romLoaded = false;
     bool m_coreReady = false;
+    // Bumped whenever emulated state changes; hibernate() skips the write when the
+    // image on disk already matches.
+    uint64_t m_stateGeneration = 0;
+    uint64_t m_hibernatedGeneration = UINT64_MAX;
+    // Held for a whole hibernate(): the write runs without m_coreMutex, and two
+    // writers would share the same temp file.
+    std::mutex m_hibernateMutex;
     unsigned m_targetSampleRate = 44100;
     size_t m_targetAudioBufferSize = 8192;
     bool m_frameSkipEnabled = false;
@@ -99,21 +258,49 @@ private:
     bool m_interframeBlending = false;
     int m_idleLoopMode = 0;
     bool m_gbControllerRumble = false;
+    // Render scanlines on mGBA's video thread proxy; applied on the next reset.
+    bool m_threadedVideo = false;
     std::string m_romTitle;
     std::string m_romPath;
+    // Set by loadRom; cleared when the first frame of the session is done.
+    int64_t m_launchStartNs = 0;
 
     mColor m_coreVideoBuffer[GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT];
     uint8_t m_videoBuffer[GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 2];
-    int16_t m_audioBuffer[AUDIO_BUFFER_CAPACITY];
-    int m_audioReadIndex = 0;
-    int m_audioWriteIndex = 0;
-    int m_audioCount = 0;
+    // Lines that changed since the frame was last consumed; OR-accumulated so
+    // frames skipped by the presenter are not lost.
+    uint32_t m_dirtyLines[DIRTY_LINE_WORDS] = {};
+    // Lines changed by the most recent runFrame only.
+    uint32_t m_frameDirtyLines[DIRTY_LINE_WORDS] = {};
+    // Audio ring, backlog limits and audio-clock waits; has its own lock.
+    AudioPacer m_audioPacer;
     uint8_t m_frameBuffer[GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT];
     struct mAVStream m_avStream{};
+    int64_t m_stats[CORE_STAT_COUNT] = {};
+    SaveRamManager m_saveRam;
+    FrameSkipController m_frameSkip;
+    GuestProfiler m_profiler;
+    ThreadPlacement m_threadPlacement;
+    InputLatency m_inputLatency;
+    TuningDatabase m_tuning;
+    // Owns the patched image the core reads from; released after unloadROM.
+    RomPatcher m_patcher;
+    // Has its own lock; slot queries never wait for the emulation thread.
+    mutable SlotIndex m_slots;
+    // Declared after m_slots: its prefetch thread reads the index.
+    StateCache m_stateCache;
+    AvRecorder m_recorder;
+    ReplayBuffer m_replay;
+    RamSearch m_ramSearch;
+    StateExport m_stateExport;
     mutable std::recursive_mutex m_coreMutex;
 };
 
 static JboyCore* g_jboyCore = nullptr;
+// Independent of the playing core; usable before nativeInit.
+static ThumbnailGenerator g_thumbnails;
+// Outlives JboyCore instances so a core warmed on the game list survives nativeInit.
+static CorePool g_corePool;
 
 static void onAudioRateChanged(struct mAVStream* stream, unsigned rate) {
     (void) stream;
@@ -130,12 +317,11 @@ static void onPostAudioFrame(struct mAVStream* stream, int16_t left, int16_t rig
 JboyCore::JboyCore() {
     memset(m_coreVideoBuffer, 0, sizeof(m_coreVideoBuffer));
     memset(m_videoBuffer, 0, sizeof(m_videoBuffer));
-    memset(m_audioBuffer, 0, sizeof(m_audioBuffer));
     memset(m_frameBuffer, 0, sizeof(m_frameBuffer));
 }
 
 std::string JboyCore::getStatePath(int slot) const {
-    return m_romPath + ".slot" + std::to_string(slot) + ".ss";
+    return SlotIndex::statePath(m_romPath, slot);
 }
 
 std::string JboyCore::getSavePath() const {
@@ -166,24 +352,9 @@ static std::string trimCheatLine(const std::string& input) {
     return input.substr(start, end - start);
 }
 
-void JboyCore::appendAudioSamples(const int16_t* samples, int sampleCount) {
-    if (!samples || sampleCount <= 0) {
-        return;
-    }
-    for (int i = 0; i < sampleCount; ++i) {
-        m_audioBuffer[m_audioWriteIndex] = samples[i];
-        m_audioWriteIndex = (m_audioWriteIndex + 1) % AUDIO_BUFFER_CAPACITY;
-        if (m_audioCount < AUDIO_BUFFER_CAPACITY) {
-            ++m_audioCount;
-        } else {
-            m_audioReadIndex = (m_audioReadIndex + 1) % AUDIO_BUFFER_CAPACITY;
-        }
-    }
-}
-
 void JboyCore::appendAudioFrame(int16_t left, int16_t right) {
     const int16_t pair[2] = { left, right };
-    appendAudioSamples(pair, 2);
+    m_audioPacer.append(pair, 2, getAudioRate());
 }
 
 void JboyCore::setAudioConfig(int sampleRate, int bufferSize) {
@@ -192,6 +363,7 @@ void JboyCore::setAudioConfig(int sampleRate, int bufferSize) {
     const int clampedBuffer = bufferSize < 1024 ? 1024 : (bufferSize > 65536 ? 65536 : bufferSize);
     m_targetSampleRate = static_cast<unsigned>(clampedRate);
     m_targetAudioBufferSize = static_cast<size_t>(clampedBuffer);
+    m_audioPacer.setOutputRate(m_targetSampleRate);
 
     if (m_core) {
         m_core->opts.sampleRate = m_targetSampleRate;
@@ -205,7 +377,7 @@ void JboyCore::setAudioConfig(int sampleRate, int bufferSize) {
 }
 
 void JboyCore::setGameOptions(bool frameSkipEnabled, int frameSkipThrottlePercent, int frameSkipInterval,
-                              bool interframeBlending, int idleLoopMode, bool gbControllerRumble) {
+                              bool interframeBlending, int idleLoopMode, bool gbControllerRumble, bool threadedVideo) {
     std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
     m_frameSkipEnabled = frameSkipEnabled;
     m_frameSkipThrottlePercent = frameSkipThrottlePercent < 0 ? 0 : (frameSkipThrottlePercent > 100 ? 100 : frameSkipThrottlePercent);
@@ -213,36 +385,24 @@ void JboyCore::setGameOptions(bool frameSkipEnabled, int frameSkipThrottlePercen
     m_interframeBlending = interframeBlending;
     m_idleLoopMode = idleLoopMode;
     m_gbControllerRumble = gbControllerRumble;
+    // mGBA only installs or removes the render thread on reset, so a change
+    // takes effect with the next ROM load or reset.
+    m_threadedVideo = threadedVideo;
+    // Enabled without a fixed interval means automatic: the controller decides per frame.
+    m_frameSkip.setEnabled(m_frameSkipEnabled && m_frameSkipInterval == 0);
 
     if (m_core) {
-        m_core->opts.frameskip = (m_frameSkipEnabled && m_frameSkipInterval > 0) ? m_frameSkipInterval : 0;
-        m_core->opts.interframeBlending = m_interframeBlending;
-
-        const char* idleOption = "remove";
-        if (m_idleLoopMode == 1) {
-            idleOption = "detect";
-        } else if (m_idleLoopMode == 2) {
-            idleOption = "ignore";
-        }
-
-        mCoreConfigSetValue(&m_core->config, "idleOptimization", idleOption);
-        mCoreConfigSetIntValue(&m_core->config, "frameskip", m_core->opts.frameskip);
-        mCoreConfigSetIntValue(&m_core->config, "interframeBlending", m_interframeBlending ? 1 : 0);
-        mCoreConfigSetIntValue(&m_core->config, "frameskipThrottlePercent", m_frameSkipThrottlePercent);
-        mCoreConfigSetIntValue(&m_core->config, "gbControllerRumble", m_gbControllerRumble ? 1 : 0);
-
-        if (m_core->reloadConfigOption) {
-            m_core->reloadConfigOption(m_core, nullptr, &m_core->config);
-        }
+        applyCoreOptionsLocked();
     }
 
-    LOGD("Game options updated fs=%d throttle=%d interval=%d blend=%d idleMode=%d gbRumble=%d",
+    LOGD("Game options updated fs=%d throttle=%d interval=%d blend=%d idleMode=%d gbRumble=%d threadedVideo=%d",
          m_frameSkipEnabled ? 1 : 0,
          m_frameSkipThrottlePercent,
          m_frameSkipInterval,
          m_interframeBlending ? 1 : 0,
          m_idleLoopMode,
-         m_gbControllerRumble ? 1 : 0);
+         m_gbControllerRumble ? 1 : 0,
+         m_threadedVideo ? 1 : 0);
 }
 
 int JboyCore::getAudioRate() const {
@@ -253,46 +413,67 @@ int JboyCore::getAudioRate() const {
 }
 
 int JboyCore::consumeAudioSamples(int16_t* out, int maxSamples) {
-    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
-    if (!out || maxSamples <= 0) {
-        return 0;
+    return m_audioPacer.consume(out, maxSamples);
+}
+
+void JboyCore::setPacingMode(int mode) {
+    const bool audioClock = mode == PACING_AUDIO_CLOCK;
+    if (m_audioPacer.setAudioClock(audioClock)) {
+        LOGD("Pacing mode: %s", audioClock ? "audio clock" : "wall clock");
     }
+}
+
+void JboyCore::setAudioDsp(float gain, bool lowPass, int filterLevel) {
+    m_audioPacer.configureDsp(gain, lowPass, filterLevel);
+}
+
+int JboyCore::readAudioSamples(int16_t* out, int maxSamples, int timeoutMs) {
+    // No core lock: the sink must not wait behind an emulated frame.
+    return m_audioPacer.read(out, maxSamples, timeoutMs);
+}
 
-    int preferredBacklog = static_cast<int>((static_cast<uint64_t>(m_targetSampleRate) * 2ULL * 65ULL) / 1000ULL);
-    const int minBacklog = maxSamples * 2;
-    int maxBacklog = AUDIO_BUFFER_CAPACITY - maxSamples;
-    if (maxBacklog < minBacklog) {
-        maxBacklog = minBacklog;
+bool JboyCore::startRamSearch(int width) {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    if (!m_core || !m_romLoaded) {
+        return false;
     }
-    if (preferredBacklog < minBacklog) {
-        preferredBacklog = minBacklog;
-    } else if (preferredBacklog > maxBacklog) {
-        preferredBacklog = maxBacklog;
+    return m_ramSearch.start(m_core, width);
+}
+
+bool JboyCore::filterRamSearch(int relation, uint32_t value) {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    if (!m_core || !m_romLoaded) {
+        return false;
     }
-    if (m_audioCount > preferredBacklog) {
-        int drop = m_audioCount - preferredBacklog;
-        if (drop & 1) {
-            --drop;
-        }
-        if (drop > 0) {
-            m_audioReadIndex = (m_audioReadIndex + drop) % AUDIO_BUFFER_CAPACITY;
-            m_audioCount -= drop;
+    // Without running frames nothing would carry the pass; finish it here.
+    return m_ramSearch.filter(m_core, relation, value, m_paused || !m_coreReady);
+}
+
+bool JboyCore::getRamSearchResults(int max, std::vector<RamSearch::Result>& out) {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    if (m_ramSearch.isFiltering()) {
+        // Paused mid-pass: no frame will carry it further.
+        if (!m_paused && m_coreReady) {
+            return false;
         }
+        m_ramSearch.finish();
     }
+    out = m_ramSearch.results(max);
+    return true;
+}
 
-    int count = m_audioCount < maxSamples ? m_audioCount : maxSamples;
-    if (count & 1) {
-        --count;
-    }
-    if (count <= 0) {
-        return 0;
-    }
-    for (int i = 0; i < count; ++i) {
-        out[i] = m_audioBuffer[m_audioReadIndex];
-        m_audioReadIndex = (m_audioReadIndex + 1) % AUDIO_BUFFER_CAPACITY;
+bool JboyCore::setStateExport(bool enabled) {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    if (!enabled) {
+        m_stateExport.disable();
+        return true;
     }
-    m_audioCount -= count;
-    return count;
+    return m_stateExport.enable();
+}
+
+int JboyCore::duplicateStateExportFd() const {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    return m_stateExport.duplicateFd();
 }
 
 bool JboyCore::clearCheats() {
@@ -367,31 +548,9 @@ bool JboyCore::addCheatCode(const char* code) {
     return true;
 }
 
-bool JboyCore::createCoreLocked() {
-    if (m_core) {
-        m_core->deinit(m_core);
-        m_core = nullptr;
-    }
-
-    m_core = mCoreCreate(mPLATFORM_GBA);
-    if (!m_core) {
-        LOGE("Failed to create mCore");
-        return false;
-    }
-
-    m_core->init(m_core);
-    mCoreInitConfig(m_core, "jboy");
-
-    // Set sane defaults before loading user config.
-    m_core->opts.volume = 0x100;
-    m_core->opts.mute = false;
-    m_core->opts.frameskip = (m_frameSkipEnabled && m_frameSkipInterval > 0) ? m_frameSkipInterval : 0;
-    m_core->opts.interframeBlending = m_interframeBlending;
-    m_core->opts.sampleRate = m_targetSampleRate;
-    m_core->opts.audioBuffers = m_targetAudioBufferSize;
-
-    mCoreLoadConfig(m_core);
-
+// Session options override whatever the config file holds; shared by core
+// creation, reset and setGameOptions so the three never disagree.
+void JboyCore::applyCoreOptionsLocked() {
     m_core->opts.useBios = false;
     m_core->opts.skipBios = true;
     m_core->opts.sampleRate = m_targetSampleRate;
@@ -416,17 +575,40 @@ bool JboyCore::createCoreLocked() {
     mCoreConfigSetIntValue(&m_core->config, "interframeBlending", m_interframeBlending ? 1 : 0);
     mCoreConfigSetIntValue(&m_core->config, "frameskipThrottlePercent", m_frameSkipThrottlePercent);
     mCoreConfigSetIntValue(&m_core->config, "gbControllerRumble", m_gbControllerRumble ? 1 : 0);
+    mCoreConfigSetIntValue(&m_core->config, "threadedVideo", m_threadedVideo ? 1 : 0);
 
-    // Apply current opts (volume/mute/frameskip) to running GBA core.
     if (m_core->reloadConfigOption) {
         m_core->reloadConfigOption(m_core, nullptr, &m_core->config);
     }
+}
+
+bool JboyCore::createCoreLocked() {
+    if (m_core) {
+        m_recorder.stop();
+        m_profiler.stop(m_core);
+        m_core->deinit(m_core);
+        m_core = nullptr;
+    }
+
+    // Created, initialised and with the user config loaded; usually pre-warmed.
+    const int64_t startNs = nowNanos();
+    CorePool::Timings timings;
+    m_core = g_corePool.take(&timings);
+    if (!m_core) {
+        return false;
+    }
+    m_stats[CORE_STAT_CORE_CREATE_US] = timings.createUs;
+    m_stats[CORE_STAT_CORE_CONFIG_US] = timings.configUs;
+    m_stats[CORE_STAT_CORE_PREWARMED] = timings.prewarmed ? 1 : 0;
+
+    applyCoreOptionsLocked();
 
     memset(&m_avStream, 0, sizeof(m_avStream));
     m_avStream.audioRateChanged = onAudioRateChanged;
     // Prefer pulling from mCore audio buffer in runFrame.
     m_avStream.postAudioFrame = nullptr;
     m_core->setAVStream(m_core, &m_avStream);
+    m_inputLatency.attach(m_core);
 
     m_core->setVideoBuffer(m_core, m_coreVideoBuffer, GBA_SCREEN_WIDTH);
     m_core->setAudioBufferSize(m_core, m_targetAudioBufferSize);
@@ -434,9 +616,11 @@ bool JboyCore::createCoreLocked() {
     m_romLoaded = false;
     m_coreReady = false;
     m_paused = false;
-    m_audioReadIndex = 0;
-    m_audioWriteIndex = 0;
-    m_audioCount = 0;
+    m_audioPacer.setGameState(false, false);
+    m_audioPacer.reset();
+    m_stats[CORE_STAT_CORE_ACQUIRE_US] = (nowNanos() - startNs) / 1000;
+    LOGD("Core ready in %lld us (%s)", static_cast<long long>(m_stats[CORE_STAT_CORE_ACQUIRE_US]),
+         timings.prewarmed ? "pre-warmed" : "cold");
     return true;
 }
 
@@ -451,44 +635,28 @@ bool JboyCore::performCoreResetLocked() {
         return false;
     }
 
-    m_core->opts.useBios = false;
-    m_core->opts.skipBios = true;
-    m_core->opts.sampleRate = m_targetSampleRate;
-    m_core->opts.mute = false;
-    if (m_core->opts.volume <= 0) {
-        m_core->opts.volume = 0x100;
-    }
-    if (m_core->opts.audioBuffers == 0) {
-        m_core->opts.audioBuffers = m_targetAudioBufferSize;
-    }
-    m_core->opts.frameskip = (m_frameSkipEnabled && m_frameSkipInterval > 0) ? m_frameSkipInterval : 0;
-    m_core->opts.interframeBlending = m_interframeBlending;
-
-    const char* idleOption = "remove";
-    if (m_idleLoopMode == 1) {
-        idleOption = "detect";
-    } else if (m_idleLoopMode == 2) {
-        idleOption = "ignore";
-    }
-    mCoreConfigSetValue(&m_core->config, "idleOptimization", idleOption);
-    mCoreConfigSetIntValue(&m_core->config, "frameskip", m_core->opts.frameskip);
-    mCoreConfigSetIntValue(&m_core->config, "interframeBlending", m_interframeBlending ? 1 : 0);
-    mCoreConfigSetIntValue(&m_core->config, "frameskipThrottlePercent", m_frameSkipThrottlePercent);
-    mCoreConfigSetIntValue(&m_core->config, "gbControllerRumble", m_gbControllerRumble ? 1 : 0);
-
-    if (m_core->reloadConfigOption) {
-        m_core->reloadConfigOption(m_core, nullptr, &m_core->config);
+    applyCoreOptionsLocked();
+    // The render thread may still be writing the old output buffer.
+    syncVideoThreadLocked();
+    if (!m_threadedVideo) {
+        // Reset installs the thread proxy when threadedVideo is set but never
+        // removes it; dropping the logger makes reset swap the plain renderer back.
+        m_core->videoLogger = nullptr;
     }
     m_core->setVideoBuffer(m_core, m_coreVideoBuffer, GBA_SCREEN_WIDTH);
     m_core->setAudioBufferSize(m_core, m_targetAudioBufferSize);
     m_core->setAVStream(m_core, &m_avStream);
     m_core->reset(m_core);
+    // Reset reapplies mGBA's overrides; per-ROM tuning goes on top of them.
+    m_tuning.apply(m_core, getRomCrc32Locked(), m_idleLoopMode);
+    ++m_stateGeneration;
+    LOGD("Core reset, threaded video %s", m_core->videoLogger ? "on" : "off");
 
-    m_audioReadIndex = 0;
-    m_audioWriteIndex = 0;
-    m_audioCount = 0;
+    m_audioPacer.reset();
+    m_frameSkip.reset();
     m_coreReady = true;
     m_paused = false;
+    m_audioPacer.setGameState(m_romLoaded, false);
     return true;
 }
 
@@ -509,33 +677,32 @@ bool JboyCore::init() {
 void JboyCore::cleanup() {
     std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
     LOGD("Cleaning up JBOY core");
+    releaseRomLocked();
     if (m_core) {
-        if (m_romLoaded && m_core->unloadROM) {
-            m_core->unloadROM(m_core);
-        }
         m_core->deinit(m_core);
         m_core = nullptr;
     }
-    m_romLoaded = false;
-    m_coreReady = false;
-    m_audioReadIndex = 0;
-    m_audioWriteIndex = 0;
-    m_audioCount = 0;
+    m_stateExport.disable();
+    jboyLogFlush();
 }
 
-bool JboyCore::loadRom(const char* romPath) {
+bool JboyCore::loadRom(const char* romPath, const char* patchPath) {
     std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
-    LOGD("Loading ROM: %s", romPath);
-    if (!m_core || m_romLoaded) {
+    LOGD("Loading ROM: %s%s%s", romPath, patchPath ? " + " : "", patchPath ? patchPath : "");
+    const int64_t startNs = nowNanos();
+    if (!m_core) {
         if (!createCoreLocked()) {
             LOGE("Core reinitialization failed");
             return false;
         }
+    } else if (m_romLoaded) {
+        // Hot swap: keep mCore, its config, buffers and AV stream; only the ROM
+        // mapping and save file are replaced. unloadROM also drops the cheat device.
+        releaseRomLocked();
     }
     m_coreReady = false;
-    m_romPath = romPath;
     
-    struct VFile* vf = VFileOpen(romPath, O_RDONLY);
+    struct VFile* vf = patchPath ? m_patcher.open(romPath, patchPath) : VFileOpen(romPath, O_RDONLY);
     if (!vf) {
         LOGE("Failed to open ROM file: %s", romPath);
         return false;
@@ -544,19 +711,15 @@ bool JboyCore::loadRom(const char* romPath) {
     if (!m_core->loadROM(m_core, vf)) {
         LOGE("Failed to load ROM: %s", romPath);
         vf->close(vf);
+        m_patcher.release();
         return false;
     }
     // IMPORTANT: mGBA core takes ownership of vf after loadROM succeeds.
     // Do not close here; it will be handled by core unload/deinit.
+    m_romPath = patchPath ? patchPath : romPath;
 
-    const std::string savePath = getSavePath();
-    if (!savePath.empty()) {
-        if (mCoreLoadSaveFile(m_core, savePath.c_str(), false)) {
-            LOGD("Save data attached: %s", savePath.c_str());
-        } else {
-            LOGE("Failed to attach save data file: %s", savePath.c_str());
-        }
-    }
+    // Save RAM stays in memory; m_saveRam writes it back off the emulation thread.
+    m_saveRam.attach(m_core, getSavePath());
     
     struct mGameInfo info;
     memset(&info, 0, sizeof(info));
@@ -579,23 +742,50 @@ bool JboyCore::loadRom(const char* romPath) {
     if (!performCoreResetLocked()) {
         LOGE("Core reset failed after loading ROM");
         m_core->unloadROM(m_core);
+        m_patcher.release();
         m_romLoaded = false;
+        m_audioPacer.setGameState(false, m_paused);
+        m_romPath.clear();
         return false;
     }
+    const size_t stateSize = m_core->stateSize ? m_core->stateSize(m_core) : 0;
+    m_slots.attach(m_romPath, stateSize);
+    m_stateCache.reset(m_romPath, stateSize, &m_slots);
+    // A new session may be presented by a fresh renderer; send the whole frame.
+    markAllLinesDirtyLocked();
+    m_stats[CORE_STAT_ROM_LOAD_US] = (nowNanos() - startNs) / 1000;
+    m_stats[CORE_STAT_FIRST_FRAME_US] = 0;
+    m_launchStartNs = startNs;
+    m_stateExport.resetFrames();
     return true;
 }
 
 void JboyCore::unloadRom() {
     std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    releaseRomLocked();
+}
+
+void JboyCore::releaseRomLocked() {
+    if (m_core && m_romLoaded) {
+        m_saveRam.detach(m_core);
+        m_tuning.capture(m_core, getRomCrc32Locked());
+    }
+    m_recorder.stop();
+    m_replay.clear();
+    m_ramSearch.reset();
+    m_stateCache.clear();
+    m_slots.detach();
+    m_profiler.stop(m_core);
     if (m_core && m_romLoaded && m_core->unloadROM) {
         m_core->unloadROM(m_core);
     }
+    m_patcher.release();
     m_romLoaded = false;
     m_coreReady = false;
-    m_audioReadIndex = 0;
-    m_audioWriteIndex = 0;
-    m_audioCount = 0;
+    m_audioPacer.setGameState(false, m_paused);
+    m_audioPacer.reset();
     m_romTitle.clear();
+    m_romPath.clear();
 }
 
 void JboyCore::runFrame() {
@@ -607,28 +797,52 @@ void JboyCore::runFrame() {
         LOGE("runFrame callback is null");
         return;
     }
+    m_threadPlacement.onEmulationFrame();
+    const int probeButtons = m_inputLatency.beginFrame();
+    if (probeButtons >= 0) {
+        m_core->setKeys(m_core, toCoreKeys(probeButtons));
+    }
+    // The latency probe detects responses from changed lines, so it needs every frame drawn.
+    const bool render = m_inputLatency.isProbing() || m_frameSkip.shouldRender();
+    if (!render) {
+        skipFrameRenderLocked();
+    }
+    if (m_profiler.isRunning()) {
+        // Reset and state loads drop the sampling event from the timing queue.
+        m_profiler.ensureScheduled(m_core);
+    }
+    const int64_t startNs = nowNanos();
     m_core->runFrame(m_core);
-
-    const size_t pixelCount = GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT;
-    if (sizeof(mColor) == 2) {
-        memcpy(m_videoBuffer, m_coreVideoBuffer, pixelCount * 2);
+    if (render) {
+        // Scanlines render on the proxy thread while the CPU runs; only the tail
+        // of the frame is waited for here.
+        syncVideoThreadLocked();
+        updateVideoBufferLocked();
     } else {
-        for (size_t i = 0; i < pixelCount; ++i) {
-            const uint32_t c = static_cast<uint32_t>(m_coreVideoBuffer[i]);
-            // mGBA native 32-bit color is XBGR8 by default:
-            // bits 0-7: R, 8-15: G, 16-23: B.
-            const uint8_t r = c & 0xFF;
-            const uint8_t g = (c >> 8) & 0xFF;
-            const uint8_t b = (c >> 16) & 0xFF;
-            const uint16_t rgb565 = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-            m_videoBuffer[i * 2] = static_cast<uint8_t>(rgb565 & 0xFF);
-            m_videoBuffer[i * 2 + 1] = static_cast<uint8_t>((rgb565 >> 8) & 0xFF);
-        }
+        memset(m_frameDirtyLines, 0, sizeof(m_frameDirtyLines));
+    }
+    m_frameSkip.onFrameFinished(render, nowNanos() - startNs);
+    uint32_t frameChanged = 0;
+    for (int i = 0; i < DIRTY_LINE_WORDS; ++i) {
+        frameChanged |= m_frameDirtyLines[i];
+    }
+    m_inputLatency.endFrame(render, frameChanged != 0);
+    if (m_launchStartNs) {
+        m_stats[CORE_STAT_FIRST_FRAME_US] = (nowNanos() - m_launchStartNs) / 1000;
+        m_launchStartNs = 0;
+    }
+    ++m_stateGeneration;
+    m_saveRam.onFrame(m_core, nowNanos());
+    m_ramSearch.onFrame();
+    if (m_stateExport.isEnabled()) {
+        // Skipped frames republish the last rendered picture with fresh memory.
+        m_stateExport.publish(m_core, m_videoBuffer, GBA_SCREEN_WIDTH, GBA_SCREEN_HEIGHT);
     }
 
     if (m_core->getAudioBuffer) {
         struct mAudioBuffer* audioBuffer = m_core->getAudioBuffer(m_core);
         if (audioBuffer) {
+            const int audioRate = getAudioRate();
             size_t loops = 0;
             while (loops < 8) {
                 const size_t availableFrames = mAudioBufferAvailable(audioBuffer);
@@ -642,17 +856,182 @@ void JboyCore::runFrame() {
                 if (!readFrames) {
                     break;
                 }
-                appendAudioSamples(temp, static_cast<int>(readFrames * 2));
+                m_audioPacer.append(temp, static_cast<int>(readFrames * 2), audioRate);
+                m_recorder.appendAudio(temp, static_cast<int>(readFrames * 2));
+                m_replay.appendAudio(temp, static_cast<int>(readFrames * 2));
                 ++loops;
             }
         }
     }
+    if (m_recorder.isRecording()) {
+        // Skipped frames repeat the last rendered picture.
+        m_recorder.commitFrame(m_videoBuffer, m_frameDirtyLines);
+    }
+    if (m_replay.isEnabled()) {
+        m_replay.onFrame(m_videoBuffer, m_frameDirtyLines, getAudioRate());
+    }
+}
+
+void JboyCore::skipFrameRenderLocked() {
+    // The core is always created as mPLATFORM_GBA. mGBA skips scanline rendering
+    // and finishFrame while the counter is positive and decrements it at VBlank,
+    // so only the upcoming frame is affected.
+    struct GBA* gba = static_cast<struct GBA*>(m_core->board);
+    if (gba->video.frameskipCounter <= 0) {
+        gba->video.frameskipCounter = 1;
+    }
+}
+
+void JboyCore::syncVideoThreadLocked() {
+    // Same handshake mGBA's proxy getPixels uses: wait until the render thread has
+    // drained every queued command. No-op without threadedVideo.
+    struct mVideoLogger* logger = m_core ? m_core->videoLogger : nullptr;
+    if (!logger || !logger->wait || !logger->lock || !logger->unlock) {
+        return;
+    }
+    logger->lock(logger);
+    logger->wait(logger);
+    logger->unlock(logger);
+}
+
+void JboyCore::updateVideoBufferLocked() {
+    // Compare each line against the previous frame and copy only what changed;
+    // the presenter uploads just the dirty lines.
+    const size_t lineBytes = GBA_SCREEN_WIDTH * 2;
+    memset(m_frameDirtyLines, 0, sizeof(m_frameDirtyLines));
+    // While recording, changed lines also go straight into the recorder's slot.
+    uint8_t* record = m_recorder.isRecording() ? m_recorder.frameBuffer() : nullptr;
+    for (int y = 0; y < GBA_SCREEN_HEIGHT; ++y) {
+        const mColor* src = m_coreVideoBuffer + y * GBA_SCREEN_WIDTH;
+        uint8_t* dst = m_videoBuffer + y * lineBytes;
+        if (sizeof(mColor) == 2) {
+            if (memcmp(dst, src, lineBytes) == 0) {
+                continue;
+            }
+            memcpy(dst, src, lineBytes);
+        } else {
+            uint8_t line[GBA_SCREEN_WIDTH * 2];
+            for (int x = 0; x < GBA_SCREEN_WIDTH; ++x) {
+                const uint32_t c = static_cast<uint32_t>(src[x]);
+                // mGBA native 32-bit color is XBGR8 by default:
+                // bits 0-7: R, 8-15: G, 16-23: B.
+                const uint8_t r = c & 0xFF;
+                const uint8_t g = (c >> 8) & 0xFF;
+                const uint8_t b = (c >> 16) & 0xFF;
+                const uint16_t rgb565 = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+                line[x * 2] = static_cast<uint8_t>(rgb565 & 0xFF);
+                line[x * 2 + 1] = static_cast<uint8_t>((rgb565 >> 8) & 0xFF);
+            }
+            if (memcmp(dst, line, lineBytes) == 0) {
+                continue;
+            }
+            memcpy(dst, line, lineBytes);
+        }
+        if (record) {
+            memcpy(record + y * lineBytes, dst, lineBytes);
+        }
+        m_dirtyLines[y >> 5] |= 1u << (y & 31);
+        m_frameDirtyLines[y >> 5] |= 1u << (y & 31);
+    }
+}
+
+void JboyCore::markAllLinesDirtyLocked() {
+    for (int i = 0; i < DIRTY_LINE_WORDS; ++i) {
+        m_dirtyLines[i] = ~0u;
+    }
+    m_dirtyLines[DIRTY_LINE_WORDS - 1] = GBA_SCREEN_HEIGHT % 32 ? (1u << (GBA_SCREEN_HEIGHT % 32)) - 1 : ~0u;
+}
+
+bool JboyCore::consumeVideoFrame(uint8_t* outFrame, uint32_t* outDirtyLines) {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    uint32_t any = 0;
+    for (int i = 0; i < DIRTY_LINE_WORDS; ++i) {
+        outDirtyLines[i] = m_dirtyLines[i];
+        any |= m_dirtyLines[i];
+        m_dirtyLines[i] = 0;
+    }
+    if (!any) {
+        return false;
+    }
+    memcpy(outFrame, m_videoBuffer, sizeof(m_videoBuffer));
+    m_inputLatency.onHandoff(nowNanos());
+    return true;
+}
+
+int JboyCore::step(int frames, int buttons, uint8_t* outVideo, int16_t* outAudio, int audioCapacity, int64_t* outStats) {
+    if (frames > 0) {
+        // Returns at once unless audio-clock pacing has a full backlog queued.
+        // Taken before the core lock so getters are not held up meanwhile.
+        m_audioPacer.waitForSpace(AUDIO_CLOCK_WAIT_MS);
+    }
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    if (buttons >= 0) {
+        setInput(buttons);
+    }
+
+    const int64_t startNs = nowNanos();
+    int framesRun = 0;
+    if (m_core && m_romLoaded && m_coreReady && !m_paused && m_core->runFrame) {
+        for (; framesRun < frames; ++framesRun) {
+            runFrame();
+        }
+    }
+    const int64_t emulationUs = (nowNanos() - startNs) / 1000;
+
+    uint32_t dirtyLines[DIRTY_LINE_WORDS] = {};
+    const bool videoChanged = outVideo && consumeVideoFrame(outVideo, dirtyLines);
+
+    int audioSamples = 0;
+    if (outAudio) {
+        while (audioCapacity - audioSamples >= AUDIO_STEP_CHUNK) {
+            const int count = consumeAudioSamples(outAudio + audioSamples, AUDIO_STEP_CHUNK);
+            if (count <= 0) {
+                break;
+            }
+            audioSamples += count;
+        }
+    }
+
+    outStats[STEP_STAT_FRAMES_RUN] = framesRun;
+    outStats[STEP_STAT_VIDEO_CHANGED] = videoChanged ? 1 : 0;
+    outStats[STEP_STAT_AUDIO_SAMPLES] = audioSamples;
+    outStats[STEP_STAT_AUDIO_RATE] = getAudioRate();
+    outStats[STEP_STAT_EMULATION_US] = emulationUs;
+    for (int i = 0; i < DIRTY_LINE_WORDS; ++i) {
+        outStats[STEP_STAT_DIRTY_LINES + i] = dirtyLines[i];
+    }
+    return framesRun;
 }
 
 void JboyCore::setInput(int buttons) {
+    // Stamped before the lock: waiting out a running frame is part of the latency.
+    const int64_t inputNs = nowNanos();
     std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    const bool changed = buttons != m_buttons;
     m_buttons = buttons;
     if (!m_core) return;
+    if (changed) {
+        m_inputLatency.onInputChanged(inputNs);
+    }
+    // The latency probe owns the keys until it is switched off.
+    if (m_inputLatency.isProbing()) return;
+    m_core->setKeys(m_core, toCoreKeys(buttons));
+}
+
+void JboyCore::setLatencyMode(int mode, int probeButtons) {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    m_inputLatency.setMode(mode, probeButtons);
+    if (m_core && !m_inputLatency.isProbing()) {
+        m_core->setKeys(m_core, toCoreKeys(m_buttons));
+    }
+}
+
+void JboyCore::getLatencyReport(int64_t* out, int count) const {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    m_inputLatency.report(out, count);
+}
+
+uint32_t JboyCore::toCoreKeys(int buttons) {
     uint32_t keys = 0;
     if (buttons & GBA_BUTTON_A) keys |= 1 << 0;
     if (buttons & GBA_BUTTON_B) keys |= 1 << 1;
@@ -664,7 +1043,7 @@ void JboyCore::setInput(int buttons) {
     if (buttons & GBA_BUTTON_DOWN) keys |= 1 << 7;
     if (buttons & GBA_BUTTON_R) keys |= 1 << 8;
     if (buttons & GBA_BUTTON_L) keys |= 1 << 9;
-    m_core->setKeys(m_core, keys);
+    return keys;
 }
 
 bool JboyCore::saveState(int slot) {
@@ -684,10 +1063,15 @@ bool JboyCore::saveState(int slot) {
     }
 
     std::vector<uint8_t> stateData(stateSize);
+    syncVideoThreadLocked();
     bool ok = m_core->saveState(m_core, stateData.data());
     if (!ok) {
         LOGE("Core saveState callback failed, trying mCoreSaveState fallback");
         ok = mCoreSaveState(m_core, slot, 0);
+        if (ok) {
+            m_slots.recordSave(slot, 0, -1);
+        }
+        m_stateCache.erase(slot);
         return ok;
     }
 
@@ -698,15 +1082,29 @@ bool JboyCore::saveState(int slot) {
         LOGE("Failed to fopen state file for writing: %s", statePath.c_str());
         const bool fallbackOk = mCoreSaveState(m_core, slot, 0);
         LOGD("Save state fallback result slot %d: %d", slot, fallbackOk ? 1 : 0);
+        if (fallbackOk) {
+            m_slots.recordSave(slot, 0, -1);
+        }
+        m_stateCache.erase(slot);
         return fallbackOk;
     }
 
-    const size_t written = fwrite(stateData.data(), 1, stateSize, fp);
-    fclose(fp);
-    ok = written == stateSize;
-    if (!ok) {
+    // The slot preview goes after the state data; loadState reads only stateSize bytes.
+    uint8_t thumbnail[SlotIndex::THUMB_BYTES];
+    SlotIndex::buildThumbnail(m_videoBuffer, thumbnail);
+    size_t written = fwrite(stateData.data(), 1, stateSize, fp);
+    written += fwrite(thumbnail, 1, sizeof(thumbnail), fp);
+    ok = (fclose(fp) == 0) && written == stateSize + sizeof(thumbnail);
+    if (ok) {
+        m_slots.recordSave(slot, static_cast<int64_t>(written), static_cast<int64_t>(stateSize));
+        m_stateCache.put(slot, std::move(stateData));
+    } else {
         LOGE("State file write failed, trying mCoreSaveState fallback");
         ok = mCoreSaveState(m_core, slot, 0);
+        if (ok) {
+            m_slots.recordSave(slot, 0, -1);
+        }
+        m_stateCache.erase(slot);
     }
     LOGD("Save state result slot %d: %d", slot, ok ? 1 : 0);
     return ok;
@@ -736,11 +1134,27 @@ bool JboyCore::loadState(int slot) {
         return fallbackOk;
     }
 
+    // Quick-load: recent slots are already in memory, no storage access needed.
+    if (StateCache::Buffer cached = m_stateCache.get(slot)) {
+        if (cached->size() == stateSize) {
+            syncVideoThreadLocked();
+            if (m_core->loadState(m_core, cached->data())) {
+                LOGD("Load state result slot %d: 1 (cached)", slot);
+                m_coreReady = true;
+                ++m_stateGeneration;
+                return true;
+            }
+        }
+        LOGE("Cached state for slot %d rejected, reading the file", slot);
+        m_stateCache.erase(slot);
+    }
+
     const std::string statePath = getStatePath(slot);
     LOGD("Load state path: %s", statePath.c_str());
     FILE* fp = fopen(statePath.c_str(), "rb");
     if (!fp) {
         LOGE("Failed to fopen state file for reading: %s", statePath.c_str());
+        m_slots.markStale();
         const bool fallbackOk = mCoreLoadState(m_core, slot, 0);
         if (fallbackOk) {
             m_coreReady = true;
@@ -760,71 +1174,339 @@ bool JboyCore::loadState(int slot) {
         return fallbackOk;
     }
 
+    syncVideoThreadLocked();
     bool ok = m_core->loadState(m_core, stateData.data());
-    if (!ok) {
+    if (ok) {
+        m_stateCache.put(slot, std::move(stateData));
+    } else {
         LOGE("Core loadState callback failed, trying mCoreLoadState fallback");
         ok = mCoreLoadState(m_core, slot, 0);
     }
     LOGD("Load state result slot %d: %d", slot, ok ? 1 : 0);
     if (ok) {
         m_coreReady = true;
+        ++m_stateGeneration;
     }
     return ok;
 }
 
 bool JboyCore::hasSaveState(int slot) const {
-    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
-    if (!m_core || slot < 0) return false;
-
-    const std::string statePath = getStatePath(slot);
-    FILE* fp = fopen(statePath.c_str(), "rb");
-    if (fp) {
-        fclose(fp);
-        return true;
-    }
-
-    struct VFile* vf = mCoreGetState(m_core, slot, false);
-    if (vf) {
-        vf->close(vf);
-        return true;
-    }
-    return false;
+    // Answered from the slot index; no core lock and, once loaded, no I/O.
+    return slot >= 0 && m_slots.has(slot);
 }
 
 void JboyCore::pause() {
     std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
     m_paused = true;
+    m_audioPacer.setGameState(m_romLoaded, true);
+    if (m_core && m_romLoaded) {
+        m_saveRam.flush(m_core);
+        m_tuning.capture(m_core, getRomCrc32Locked());
+    }
     LOGD("JBOY paused");
 }
 
 void JboyCore::resume() {
     std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
     m_paused = false;
+    m_audioPacer.setGameState(m_romLoaded, false);
     LOGD("JBOY resumed");
 }
 
-void JboyCore::reset() {
+void JboyCore::setEmulationSpeed(int speed) {
     std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
-    if (m_romPath.empty()) {
-        LOGE("JBOY reset failed: rom path empty");
-        return;
+    m_frameSkip.setSpeed(speed);
+}
+
+void JboyCore::flushSaveData() {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    if (m_core && m_romLoaded) {
+        m_saveRam.flush(m_core);
+    }
+}
+
+bool JboyCore::reset() {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    if (!m_core || !m_romLoaded) {
+        LOGE("JBOY reset failed: no ROM loaded");
+        return false;
     }
-    const std::string currentPath = m_romPath;
-    if (!loadRom(currentPath.c_str())) {
+    const int64_t startNs = nowNanos();
+    if (!performCoreResetLocked()) {
         LOGE("JBOY reset failed");
+        return false;
+    }
+    m_stats[CORE_STAT_RESET_US] = (nowNanos() - startNs) / 1000;
+    LOGD("JBOY soft reset done in %lld us", static_cast<long long>(m_stats[CORE_STAT_RESET_US]));
+    return true;
+}
+
+void JboyCore::startProfiler(int intervalCycles) {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    if (!m_core || !m_romLoaded) {
+        LOGE("Profiler start failed: no ROM loaded");
         return;
     }
-    LOGD("JBOY reset done by reloading ROM");
+    m_profiler.start(m_core, intervalCycles > 0 ? static_cast<uint32_t>(intervalCycles) : 0);
+}
+
+void JboyCore::stopProfiler() {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    m_profiler.stop(m_core);
+}
+
+std::string JboyCore::getProfileReport() const {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    return m_profiler.buildReport(m_romLoaded ? m_core : nullptr, m_romTitle, getRomCrc32Locked());
+}
+
+bool JboyCore::startRecording(const std::string& basePath) {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    if (!m_core || !m_romLoaded) {
+        LOGE("Recording failed: no ROM loaded");
+        return false;
+    }
+    const int rate = getAudioRate();
+    return m_recorder.start(basePath, rate > 0 ? rate : static_cast<int>(m_targetSampleRate));
+}
+
+void JboyCore::stopRecording() {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    m_recorder.stop();
+}
+
+void JboyCore::setReplayConfig(int seconds, int memoryKb) {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    m_replay.configure(seconds, memoryKb);
+}
+
+bool JboyCore::exportReplay(const std::string& basePath) {
+    ReplayBuffer::Snapshot snapshot;
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+        if (!m_replay.snapshot(snapshot)) {
+            LOGE("Replay export: nothing recorded");
+            return false;
+        }
+    }
+    // Decoding and PNG compression take a while; keep the frame loop running.
+    return ReplayBuffer::exportSnapshot(snapshot, basePath);
+}
+
+void JboyCore::setDataDirectory(const std::string& dir) {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    m_tuning.open(dir.empty() ? std::string() : dir + "/tuning.txt");
+    m_patcher.setCachePath(dir.empty() ? std::string() : dir + "/patches.txt");
+}
+
+uint32_t JboyCore::getRomCrc32Locked() const {
+    uint32_t crc = 0;
+    if (m_core && m_romLoaded && m_core->checksum) {
+        m_core->checksum(m_core, &crc, mCHECKSUM_CRC32);
+    }
+    return crc;
+}
+
+bool JboyCore::hibernate() {
+    // Taken before the core lock; a second caller waits and then finds the image current.
+    std::lock_guard<std::mutex> hibernateLock(m_hibernateMutex);
+    std::unique_lock<std::recursive_mutex> lock(m_coreMutex);
+    if (!m_core || !m_romLoaded || !m_coreReady || !m_core->stateSize || !m_core->saveState) {
+        return false;
+    }
+    const std::string path = getHibernationPath(m_romPath);
+    if (m_stateGeneration == m_hibernatedGeneration && access(path.c_str(), F_OK) == 0) {
+        return true;
+    }
+    const int64_t startNs = nowNanos();
+
+    const size_t stateSize = m_core->stateSize(m_core);
+    if (!stateSize) {
+        return false;
+    }
+    std::vector<uint8_t> stateData(stateSize);
+    syncVideoThreadLocked();
+    if (!m_core->saveState(m_core, stateData.data())) {
+        LOGE("Hibernate: core saveState failed");
+        return false;
+    }
+    std::vector<uint8_t> frame(m_videoBuffer, m_videoBuffer + sizeof(m_videoBuffer));
+    HibernationHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = HIBERNATION_MAGIC;
+    header.version = HIBERNATION_VERSION;
+    header.romCrc32 = getRomCrc32Locked();
+    header.romSize = m_core->romSize ? static_cast<uint32_t>(m_core->romSize(m_core)) : 0;
+    header.frameSize = static_cast<uint32_t>(frame.size());
+    header.stateSize = static_cast<uint32_t>(stateSize);
+    const uint64_t snapshotGeneration = m_stateGeneration;
+    // Compression and fsync run without the core lock so the frame loop keeps going.
+    lock.unlock();
+
+    uLongf packedSize = compressBound(static_cast<uLong>(stateSize));
+    std::vector<uint8_t> packed(packedSize);
+    if (compress2(packed.data(), &packedSize, stateData.data(), static_cast<uLong>(stateSize), Z_BEST_SPEED) != Z_OK) {
+        LOGE("Hibernate: state compression failed");
+        return false;
+    }
+    header.packedSize = static_cast<uint32_t>(packedSize);
+    header.stateCrc32 = static_cast<uint32_t>(crc32(0L, stateData.data(), static_cast<uInt>(stateSize)));
+
+    const FileChunk chunks[] = {
+        { &header, sizeof(header) },
+        { frame.data(), frame.size() },
+        { packed.data(), packedSize }
+    };
+    if (!writeFileAtomic(path, chunks, 3)) {
+        LOGE("Hibernate: failed to write %s", path.c_str());
+        return false;
+    }
+
+    lock.lock();
+    m_hibernatedGeneration = snapshotGeneration;
+    m_stats[CORE_STAT_HIBERNATE_WRITE_US] = (nowNanos() - startNs) / 1000;
+    LOGD("Hibernated %zu -> %lu bytes in %lld us", stateSize, static_cast<unsigned long>(packedSize),
+         static_cast<long long>(m_stats[CORE_STAT_HIBERNATE_WRITE_US]));
+    return true;
+}
+
+bool JboyCore::readHibernationFrame(const std::string& romPath, uint8_t* outFrame, size_t frameSize) {
+    FILE* fp = fopen(getHibernationPath(romPath).c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    HibernationHeader header;
+    bool ok = fread(&header, 1, sizeof(header), fp) == sizeof(header) &&
+              header.magic == HIBERNATION_MAGIC &&
+              header.version == HIBERNATION_VERSION &&
+              header.frameSize == frameSize &&
+              fread(outFrame, 1, frameSize, fp) == frameSize;
+    fclose(fp);
+    return ok;
+}
+
+bool JboyCore::restoreHibernation() {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    if (!m_core || !m_romLoaded || !m_core->stateSize || !m_core->loadState) {
+        return false;
+    }
+    const int64_t startNs = nowNanos();
+    const std::string path = getHibernationPath(m_romPath);
+    std::vector<uint8_t> file;
+    if (!readWholeFile(path, file) || file.size() < sizeof(HibernationHeader)) {
+        return false;
+    }
+
+    HibernationHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    const size_t stateSize = m_core->stateSize(m_core);
+    const uint32_t romSize = m_core->romSize ? static_cast<uint32_t>(m_core->romSize(m_core)) : 0;
+    if (header.magic != HIBERNATION_MAGIC || header.version != HIBERNATION_VERSION ||
+        header.frameSize != sizeof(m_videoBuffer) || header.stateSize != stateSize ||
+        header.romSize != romSize || header.romCrc32 != getRomCrc32Locked() ||
+        file.size() != sizeof(header) + header.frameSize + header.packedSize) {
+        LOGE("Hibernation image does not match the loaded ROM, ignoring");
+        return false;
+    }
+
+    const uint8_t* frame = file.data() + sizeof(header);
+    const uint8_t* packed = frame + header.frameSize;
+    std::vector<uint8_t> stateData(stateSize);
+    uLongf unpackedSize = static_cast<uLongf>(stateSize);
+    if (uncompress(stateData.data(), &unpackedSize, packed, header.packedSize) != Z_OK ||
+        unpackedSize != stateSize ||
+        static_cast<uint32_t>(crc32(0L, stateData.data(), static_cast<uInt>(stateSize))) != header.stateCrc32) {
+        LOGE("Hibernation image is corrupt, ignoring");
+        return false;
+    }
+    syncVideoThreadLocked();
+    if (!m_core->loadState(m_core, stateData.data())) {
+        LOGE("Hibernation restore: core loadState failed");
+        return false;
+    }
+
+    memcpy(m_videoBuffer, frame, header.frameSize);
+    markAllLinesDirtyLocked();
+    // Replay deltas are against the pre-restore picture.
+    m_replay.clear();
+    m_audioPacer.reset();
+    m_hibernatedGeneration = ++m_stateGeneration;
+    m_coreReady = true;
+    m_stats[CORE_STAT_HIBERNATE_RESTORE_US] = (nowNanos() - startNs) / 1000;
+    LOGD("Hibernation restored in %lld us", static_cast<long long>(m_stats[CORE_STAT_HIBERNATE_RESTORE_US]));
+    return true;
+}
+
+void JboyCore::getStats(int64_t* out, int count) const {
+    std::lock_guard<std::recursive_mutex> lock(m_coreMutex);
+    int64_t stats[CORE_STAT_COUNT];
+    memcpy(stats, m_stats, sizeof(stats));
+    stats[CORE_STAT_SAVE_FLUSH_COUNT] = m_saveRam.getFlushCount();
+    stats[CORE_STAT_SAVE_FLUSH_US] = m_saveRam.getLastFlushUs();
+    stats[CORE_STAT_SAVE_FLUSH_FAILURES] = m_saveRam.getFailureCount();
+    stats[CORE_STAT_FRAME_SKIP_LEVEL] = m_frameSkip.getSkipLevel();
+    stats[CORE_STAT_FRAMES_SKIPPED] = m_frameSkip.getSkippedFrames();
+    stats[CORE_STAT_FRAME_RENDER_US] = m_frameSkip.getRenderCostUs();
+    stats[CORE_STAT_FRAME_SKIP_US] = m_frameSkip.getSkipCostUs();
+    stats[CORE_STAT_PRESENT_US] = FrameSkipController::getPresentCostUs();
+    stats[CORE_STAT_AUDIO_RING_FILL] = m_audioPacer.getFill();
+    stats[CORE_STAT_AUDIO_DROPPED_SAMPLES] = m_audioPacer.getDroppedSamples();
+    stats[CORE_STAT_AUDIO_UNDERRUNS] = m_audioPacer.getUnderruns();
+    stats[CORE_STAT_RECORD_FRAMES] = m_recorder.getWrittenFrames();
+    stats[CORE_STAT_RECORD_DROPPED_FRAMES] = m_recorder.getDroppedFrames();
+    stats[CORE_STAT_RECORD_ENQUEUE_US] = m_recorder.getLastEnqueueUs();
+    stats[CORE_STAT_REPLAY_FRAMES] = m_replay.getFrameCount();
+    stats[CORE_STAT_REPLAY_BYTES] = m_replay.getUsedBytes();
+    stats[CORE_STAT_REPLAY_CAPACITY_BYTES] = m_replay.getCapacityBytes();
+    stats[CORE_STAT_REPLAY_ENCODE_US] = m_replay.getLastEncodeUs();
+    stats[CORE_STAT_PERFORMANCE_CORES] = ThreadPlacement::getPerformanceCoreCount();
+    stats[CORE_STAT_EMU_THREAD_PINNED] = m_threadPlacement.isPinned() ? 1 : 0;
+    stats[CORE_STAT_EMU_THREAD_CPU] = m_threadPlacement.getLastCpu();
+    stats[CORE_STAT_EMU_OFF_PERFORMANCE_FRAMES] = m_threadPlacement.getOffPerformanceFrames();
+    stats[CORE_STAT_AUDIO_THREAD_POLICY] = ThreadPlacement::getAudioPolicy();
+    stats[CORE_STAT_RAM_SEARCH_CANDIDATES] = m_ramSearch.getCandidateCount();
+    stats[CORE_STAT_RAM_SEARCH_PASS_US] = m_ramSearch.getLastPassUs();
+    stats[CORE_STAT_STATE_EXPORT_US] = m_stateExport.getLastPublishUs();
+    stats[CORE_STAT_SAVE_RESTORES] = m_saveRam.getRestoreCount();
+    for (int i = 0; i < count && i < CORE_STAT_COUNT; ++i) {
+        out[i] = stats[i];
+    }
 }
 
 extern "C" {
 
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeSetThreadPlacement(JNIEnv* env, jobject thiz, jboolean enabled) {
+    (void) env;
+    (void) thiz;
+    ThreadPlacement::setEnabled(enabled == JNI_TRUE);
+}
+
+JNIEXPORT jint JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativePromoteAudioThread(JNIEnv* env, jobject thiz) {
+    (void) env;
+    (void) thiz;
+    return ThreadPlacement::promoteAudioThread();
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativePrewarmCore(JNIEnv* env, jobject thiz) {
+    (void) env;
+    (void) thiz;
+    g_corePool.prewarm();
+}
+
 JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeInit(JNIEnv* env, jobject thiz) {
     if (g_jboyCore) delete g_jboyCore;
     g_jboyCore = new JboyCore();
     return g_jboyCore->init() ? JNI_TRUE : JNI_FALSE;
 }
 
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeSetDataDirectory(JNIEnv* env, jobject thiz, jstring dir) {
+    (void) thiz;
+    if (!g_jboyCore || !dir) return;
+    const char* path = env->GetStringUTFChars(dir, nullptr);
+    g_jboyCore->setDataDirectory(path);
+    env->ReleaseStringUTFChars(dir, path);
+}
+
 JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeLoadRom(JNIEnv* env, jobject thiz, jstring romPath) {
     if (!g_jboyCore) return JNI_FALSE;
     const char* path = env->GetStringUTFChars(romPath, nullptr);
@@ -833,6 +1515,16 @@ JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeLoadRo
     return loaded ? JNI_TRUE : JNI_FALSE;
 }
 
+JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeLoadPatchedRom(JNIEnv* env, jobject thiz, jstring romPath, jstring patchPath) {
+    if (!g_jboyCore || !romPath || !patchPath) return JNI_FALSE;
+    const char* path = env->GetStringUTFChars(romPath, nullptr);
+    const char* patch = env->GetStringUTFChars(patchPath, nullptr);
+    const bool loaded = g_jboyCore->loadRom(path, patch);
+    env->ReleaseStringUTFChars(patchPath, patch);
+    env->ReleaseStringUTFChars(romPath, path);
+    return loaded ? JNI_TRUE : JNI_FALSE;
+}
+
 JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeRunFrame(JNIEnv* env, jobject thiz) {
     if (g_jboyCore) g_jboyCore->runFrame();
 }
@@ -857,7 +1549,8 @@ JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeSetGameOpt
     jint frameSkipInterval,
     jboolean interframeBlending,
     jstring idleLoopRemoval,
-    jboolean gbControllerRumble
+    jboolean gbControllerRumble,
+    jboolean threadedVideo
 ) {
     (void) env;
     (void) thiz;
@@ -884,7 +1577,8 @@ JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeSetGameOpt
         static_cast<int>(frameSkipInterval),
         interframeBlending == JNI_TRUE,
         idleLoopMode,
-        gbControllerRumble == JNI_TRUE
+        gbControllerRumble == JNI_TRUE,
+        threadedVideo == JNI_TRUE
     );
 }
 
@@ -903,6 +1597,102 @@ JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeHasSav
     return g_jboyCore->hasSaveState(slot) ? JNI_TRUE : JNI_FALSE;
 }
 
+JNIEXPORT jlongArray JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGetSaveSlots(JNIEnv* env, jobject thiz) {
+    (void) thiz;
+    if (!g_jboyCore) return env->NewLongArray(0);
+    // Four values per slot: slot, size, savedAtMs, thumbOffset.
+    const std::vector<SlotIndex::Entry> entries = g_jboyCore->getSaveSlots();
+    std::vector<jlong> packed;
+    packed.reserve(entries.size() * 4);
+    for (const SlotIndex::Entry& entry : entries) {
+        packed.push_back(entry.slot);
+        packed.push_back(entry.size);
+        packed.push_back(entry.savedAtMs);
+        packed.push_back(entry.thumbOffset);
+    }
+    jlongArray out = env->NewLongArray(static_cast<jsize>(packed.size()));
+    if (out && !packed.empty()) {
+        env->SetLongArrayRegion(out, 0, static_cast<jsize>(packed.size()), packed.data());
+    }
+    return out;
+}
+
+JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeStartRamSearch(JNIEnv* env, jobject thiz, jint width) {
+    (void) env;
+    (void) thiz;
+    return g_jboyCore && g_jboyCore->startRamSearch(width) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeFilterRamSearch(JNIEnv* env, jobject thiz, jint relation, jint value) {
+    (void) env;
+    (void) thiz;
+    return g_jboyCore && g_jboyCore->filterRamSearch(relation, static_cast<uint32_t>(value)) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGetRamSearchResults(JNIEnv* env, jobject thiz, jint max) {
+    (void) thiz;
+    // Null while the pass runs; otherwise three values per candidate: address, value, previous value.
+    std::vector<RamSearch::Result> results;
+    if (!g_jboyCore || !g_jboyCore->getRamSearchResults(max, results)) return nullptr;
+    std::vector<jlong> packed;
+    packed.reserve(results.size() * 3);
+    for (const RamSearch::Result& result : results) {
+        packed.push_back(result.address);
+        packed.push_back(result.value);
+        packed.push_back(result.previous);
+    }
+    jlongArray out = env->NewLongArray(static_cast<jsize>(packed.size()));
+    if (out && !packed.empty()) {
+        env->SetLongArrayRegion(out, 0, static_cast<jsize>(packed.size()), packed.data());
+    }
+    return out;
+}
+
+JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeSetStateExport(JNIEnv* env, jobject thiz, jboolean enabled) {
+    (void) env;
+    (void) thiz;
+    return g_jboyCore && g_jboyCore->setStateExport(enabled == JNI_TRUE) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeDupStateExportFd(JNIEnv* env, jobject thiz) {
+    (void) env;
+    (void) thiz;
+    return g_jboyCore ? g_jboyCore->duplicateStateExportFd() : -1;
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeSetLatencyMode(JNIEnv* env, jobject thiz, jint mode, jint probeButtons) {
+    (void) env;
+    (void) thiz;
+    if (g_jboyCore) {
+        g_jboyCore->setLatencyMode(mode, probeButtons);
+    }
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGetLatencyReport(JNIEnv* env, jobject thiz) {
+    (void) thiz;
+    // Counters, then the read and present histograms (1 ms buckets) and the probe histogram (frames).
+    int64_t report[InputLatency::REPORT_SIZE] = {};
+    if (g_jboyCore) {
+        g_jboyCore->getLatencyReport(report, InputLatency::REPORT_SIZE);
+    }
+    jlongArray out = env->NewLongArray(InputLatency::REPORT_SIZE);
+    if (out) {
+        env->SetLongArrayRegion(out, 0, InputLatency::REPORT_SIZE, reinterpret_cast<const jlong*>(report));
+    }
+    return out;
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGetSlotThumbnail(JNIEnv* env, jobject thiz, jint slot) {
+    (void) thiz;
+    std::vector<uint8_t> pixels;
+    if (!g_jboyCore || !g_jboyCore->readSlotThumbnail(slot, pixels)) return nullptr;
+    jbyteArray out = env->NewByteArray(static_cast<jsize>(pixels.size()));
+    if (out) {
+        env->SetByteArrayRegion(out, 0, static_cast<jsize>(pixels.size()), reinterpret_cast<const jbyte*>(pixels.data()));
+    }
+    return out;
+}
+
 JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeCleanup(JNIEnv* env, jobject thiz) {
     if (g_jboyCore) {
         g_jboyCore->cleanup();
@@ -924,8 +1714,13 @@ JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeResume(JNI
     if (g_jboyCore) g_jboyCore->resume();
 }
 
-JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeReset(JNIEnv* env, jobject thiz) {
-    if (g_jboyCore) g_jboyCore->reset();
+JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeReset(JNIEnv* env, jobject thiz) {
+    if (!g_jboyCore) return JNI_FALSE;
+    return g_jboyCore->reset() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeUnloadRom(JNIEnv* env, jobject thiz) {
+    if (g_jboyCore) g_jboyCore->unloadRom();
 }
 
 JNIEXPORT jstring JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGetRomTitle(JNIEnv* env, jobject thiz) {
@@ -983,6 +1778,27 @@ JNIEXPORT jbyteArray JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGetV
     return out;
 }
 
+JNIEXPORT jbyteArray JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGetChangedVideoFrame(JNIEnv* env, jobject thiz, jintArray dirtyLinesOut) {
+    (void) thiz;
+    if (!g_jboyCore || !g_jboyCore->isRomLoaded() || !dirtyLinesOut) {
+        return nullptr;
+    }
+    uint8_t frame[GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 2];
+    uint32_t dirtyLines[DIRTY_LINE_WORDS];
+    if (!g_jboyCore->consumeVideoFrame(frame, dirtyLines)) {
+        return nullptr;
+    }
+    const jsize length = env->GetArrayLength(dirtyLinesOut);
+    env->SetIntArrayRegion(dirtyLinesOut, 0, length < DIRTY_LINE_WORDS ? length : DIRTY_LINE_WORDS,
+                           reinterpret_cast<const jint*>(dirtyLines));
+    jbyteArray out = env->NewByteArray(sizeof(frame));
+    if (!out) {
+        return nullptr;
+    }
+    env->SetByteArrayRegion(out, 0, sizeof(frame), reinterpret_cast<const jbyte*>(frame));
+    return out;
+}
+
 JNIEXPORT jshortArray JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGetAudioFrame(JNIEnv* env, jobject thiz) {
     if (!g_jboyCore || !g_jboyCore->isRomLoaded()) {
         return nullptr;
@@ -1002,4 +1818,220 @@ JNIEXPORT jshortArray JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGet
     return out;
 }
 
+JNIEXPORT jint JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeStep(
+    JNIEnv* env,
+    jobject thiz,
+    jint frames,
+    jint inputMask,
+    jobject outVideo,
+    jobject outAudio,
+    jobject outStats
+) {
+    (void) thiz;
+    if (!g_jboyCore || !g_jboyCore->isRomLoaded() || !outStats) {
+        return -1;
+    }
+    // All three buffers are direct and owned by the caller, so a step allocates nothing.
+    int64_t* stats = static_cast<int64_t*>(env->GetDirectBufferAddress(outStats));
+    if (!stats || env->GetDirectBufferCapacity(outStats) < static_cast<jlong>(STEP_STAT_COUNT * sizeof(int64_t))) {
+        return -1;
+    }
+    uint8_t* video = nullptr;
+    if (outVideo) {
+        video = static_cast<uint8_t*>(env->GetDirectBufferAddress(outVideo));
+        if (video && env->GetDirectBufferCapacity(outVideo) < GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 2) {
+            video = nullptr;
+        }
+    }
+    int16_t* audio = nullptr;
+    int audioCapacity = 0;
+    if (outAudio) {
+        audio = static_cast<int16_t*>(env->GetDirectBufferAddress(outAudio));
+        audioCapacity = audio ? static_cast<int>(env->GetDirectBufferCapacity(outAudio) / sizeof(int16_t)) : 0;
+    }
+    return g_jboyCore->step(frames, inputMask, video, audio, audioCapacity, stats);
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeSetEmulationSpeed(JNIEnv* env, jobject thiz, jint speed) {
+    (void) env;
+    (void) thiz;
+    if (g_jboyCore) g_jboyCore->setEmulationSpeed(speed);
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeSetPacingMode(JNIEnv* env, jobject thiz, jint mode) {
+    (void) env;
+    (void) thiz;
+    if (g_jboyCore) g_jboyCore->setPacingMode(mode);
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeSetAudioDsp(JNIEnv* env, jobject thiz, jfloat gain, jboolean lowPass, jint filterLevel) {
+    (void) env;
+    (void) thiz;
+    if (g_jboyCore) g_jboyCore->setAudioDsp(gain, lowPass == JNI_TRUE, filterLevel);
+}
+
+JNIEXPORT jint JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeReadAudio(JNIEnv* env, jobject thiz, jshortArray out, jint timeoutMs) {
+    (void) thiz;
+    if (!g_jboyCore || !out) {
+        return 0;
+    }
+    int16_t localBuffer[2048];
+    const jsize length = env->GetArrayLength(out);
+    const int maxSamples = length < 2048 ? length : 2048;
+    const int count = g_jboyCore->readAudioSamples(localBuffer, maxSamples, timeoutMs);
+    if (count > 0) {
+        env->SetShortArrayRegion(out, 0, count, reinterpret_cast<const jshort*>(localBuffer));
+    }
+    return count;
+}
+
+JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeStartRecording(JNIEnv* env, jobject thiz, jstring basePath) {
+    (void) thiz;
+    if (!g_jboyCore || !basePath) return JNI_FALSE;
+    const char* path = env->GetStringUTFChars(basePath, nullptr);
+    const bool started = g_jboyCore->startRecording(path);
+    env->ReleaseStringUTFChars(basePath, path);
+    return started ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeStopRecording(JNIEnv* env, jobject thiz) {
+    (void) env;
+    (void) thiz;
+    if (g_jboyCore) g_jboyCore->stopRecording();
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeSetReplayConfig(JNIEnv* env, jobject thiz, jint seconds, jint memoryKb) {
+    (void) env;
+    (void) thiz;
+    if (g_jboyCore) g_jboyCore->setReplayConfig(seconds, memoryKb);
+}
+
+JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeExportReplay(JNIEnv* env, jobject thiz, jstring basePath) {
+    (void) thiz;
+    if (!g_jboyCore || !basePath) return JNI_FALSE;
+    const char* path = env->GetStringUTFChars(basePath, nullptr);
+    const bool exported = g_jboyCore->exportReplay(path);
+    env->ReleaseStringUTFChars(basePath, path);
+    return exported ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeStartProfiler(JNIEnv* env, jobject thiz, jint intervalCycles) {
+    (void) env;
+    (void) thiz;
+    if (g_jboyCore) g_jboyCore->startProfiler(intervalCycles);
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeStopProfiler(JNIEnv* env, jobject thiz) {
+    (void) env;
+    (void) thiz;
+    if (g_jboyCore) g_jboyCore->stopProfiler();
+}
+
+JNIEXPORT jstring JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGetProfileReport(JNIEnv* env, jobject thiz) {
+    (void) thiz;
+    if (!g_jboyCore) return env->NewStringUTF("");
+    return env->NewStringUTF(g_jboyCore->getProfileReport().c_str());
+}
+
+JNIEXPORT jint JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGenerateThumbnails(JNIEnv* env, jobject thiz, jobjectArray romPaths, jobjectArray outPaths, jint frames, jint halvings) {
+    (void) thiz;
+    if (!romPaths || !outPaths) return 0;
+    const jsize romCount = env->GetArrayLength(romPaths);
+    const jsize outCount = env->GetArrayLength(outPaths);
+    const jsize count = romCount < outCount ? romCount : outCount;
+    std::vector<ThumbnailGenerator::Job> jobs;
+    jobs.reserve(count);
+    for (jsize i = 0; i < count; ++i) {
+        jstring rom = static_cast<jstring>(env->GetObjectArrayElement(romPaths, i));
+        jstring out = static_cast<jstring>(env->GetObjectArrayElement(outPaths, i));
+        if (rom && out) {
+            const char* romChars = env->GetStringUTFChars(rom, nullptr);
+            const char* outChars = env->GetStringUTFChars(out, nullptr);
+            if (romChars && outChars) {
+                jobs.push_back({romChars, outChars});
+            }
+            if (romChars) env->ReleaseStringUTFChars(rom, romChars);
+            if (outChars) env->ReleaseStringUTFChars(out, outChars);
+        }
+        if (rom) env->DeleteLocalRef(rom);
+        if (out) env->DeleteLocalRef(out);
+    }
+    return g_thumbnails.run(jobs, frames, halvings, 0);
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeCancelThumbnails(JNIEnv* env, jobject thiz) {
+    (void) env;
+    (void) thiz;
+    g_thumbnails.cancel();
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeFlushSaveData(JNIEnv* env, jobject thiz) {
+    (void) env;
+    (void) thiz;
+    if (g_jboyCore) g_jboyCore->flushSaveData();
+}
+
+JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeHibernate(JNIEnv* env, jobject thiz) {
+    (void) env;
+    (void) thiz;
+    if (!g_jboyCore) return JNI_FALSE;
+    return g_jboyCore->hibernate() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeRestoreHibernation(JNIEnv* env, jobject thiz) {
+    (void) env;
+    (void) thiz;
+    if (!g_jboyCore) return JNI_FALSE;
+    return g_jboyCore->restoreHibernation() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativePeekHibernationFrame(JNIEnv* env, jobject thiz, jstring romPath) {
+    (void) thiz;
+    if (!romPath) {
+        return nullptr;
+    }
+    const char* path = env->GetStringUTFChars(romPath, nullptr);
+    if (!path) {
+        return nullptr;
+    }
+    const int size = GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 2;
+    std::vector<uint8_t> frame(size);
+    const bool ok = JboyCore::readHibernationFrame(path, frame.data(), frame.size());
+    env->ReleaseStringUTFChars(romPath, path);
+    if (!ok) {
+        return nullptr;
+    }
+    jbyteArray out = env->NewByteArray(size);
+    if (!out) {
+        return nullptr;
+    }
+    env->SetByteArrayRegion(out, 0, size, reinterpret_cast<const jbyte*>(frame.data()));
+    return out;
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeDiscardHibernation(JNIEnv* env, jobject thiz, jstring romPath) {
+    (void) thiz;
+    if (!romPath) {
+        return;
+    }
+    const char* path = env->GetStringUTFChars(romPath, nullptr);
+    if (!path) {
+        return;
+    }
+    unlink(JboyCore::getHibernationPath(path).c_str());
+    env->ReleaseStringUTFChars(romPath, path);
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_EmulatorCore_nativeGetStats(JNIEnv* env, jobject thiz, jlongArray out) {
+    (void) thiz;
+    if (!g_jboyCore || !out) {
+        return;
+    }
+    int64_t stats[CORE_STAT_COUNT] = {};
+    g_jboyCore->getStats(stats, CORE_STAT_COUNT);
+    const jsize length = env->GetArrayLength(out);
+    const jsize count = length < CORE_STAT_COUNT ? length : CORE_STAT_COUNT;
+    env->SetLongArrayRegion(out, 0, count, reinterpret_cast<const jlong*>(stats));
+}
+
 } // extern "C"
@@ -0,0 +1,97 @@
+#include "frame_skip_controller.h"
+
+#include "jboy_log.h"
+
+#define LOG_TAG "JBOY_FrameSkip"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+
+std::atomic<int64_t> FrameSkipController::s_presentCostNs{0};
+
+void FrameSkipController::setEnabled(bool enabled) {
+    if (m_enabled == enabled) {
+        return;
+    }
+    m_enabled = enabled;
+    reset();
+}
+
+void FrameSkipController::setSpeed(int speed) {
+    m_budgetNs = GBA_FRAME_NS / (speed < 1 ? 1 : speed);
+}
+
+void FrameSkipController::reset() {
+    m_renderCostNs = 0;
+    m_skipCostNs = 0;
+    m_skipLevel = 0;
+    m_framesUntilRender = 0;
+}
+
+bool FrameSkipController::shouldRender() {
+    if (!m_enabled) {
+        return true;
+    }
+    if (m_framesUntilRender > 0) {
+        --m_framesUntilRender;
+        ++m_skippedFrames;
+        return false;
+    }
+    m_framesUntilRender = m_skipLevel;
+    return true;
+}
+
+void FrameSkipController::onFrameFinished(bool rendered, int64_t costNs) {
+    if (!m_enabled || costNs <= 0) {
+        return;
+    }
+    if (rendered) {
+        m_renderCostNs = updateAverage(m_renderCostNs, costNs);
+        // Only re-plan on rendered frames so a level runs at least one full cycle.
+        chooseSkipLevel();
+    } else {
+        m_skipCostNs = updateAverage(m_skipCostNs, costNs);
+    }
+}
+
+void FrameSkipController::reportPresentCost(int64_t costNs) {
+    if (costNs <= 0) {
+        return;
+    }
+    const int64_t previous = s_presentCostNs.load(std::memory_order_relaxed);
+    s_presentCostNs.store(updateAverage(previous, costNs), std::memory_order_relaxed);
+}
+
+int64_t FrameSkipController::updateAverage(int64_t average, int64_t sample) {
+    if (average <= 0) {
+        return sample;
+    }
+    return average + (sample - average) * EWMA_WEIGHT / 16;
+}
+
+int64_t FrameSkipController::projectedCost(int level) const {
+    // Until a skipped frame has been measured, assume rendering is half the cost.
+    const int64_t skipCost = m_skipCostNs > 0 ? m_skipCostNs : m_renderCostNs / 2;
+    const int64_t presentCost = s_presentCostNs.load(std::memory_order_relaxed);
+    return (m_renderCostNs + presentCost + skipCost * level) / (level + 1);
+}
+
+void FrameSkipController::chooseSkipLevel() {
+    int level = MAX_SKIP;
+    for (int candidate = 0; candidate < MAX_SKIP; ++candidate) {
+        const int64_t percent = candidate < m_skipLevel ? LOWER_PERCENT : RAISE_PERCENT;
+        if (projectedCost(candidate) * 100 <= m_budgetNs * percent) {
+            level = candidate;
+            break;
+        }
+    }
+    if (level != m_skipLevel) {
+        LOGD("Frame skip level %d -> %d (render %lld us, present %lld us, budget %lld us)",
+             m_skipLevel, level,
+             static_cast<long long>(m_renderCostNs / 1000),
+             static_cast<long long>(getPresentCostUs()),
+             static_cast<long long>(m_budgetNs / 1000));
+        m_skipLevel = level;
+        if (m_framesUntilRender > level) {
+            m_framesUntilRender = level;
+        }
+    }
+}
@@ -0,0 +1,213 @@
+#include "guest_profiler.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <mgba/core/core.h>
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/gba/gba.h>
+
+#include "jboy_log.h"
+
+#define LOG_TAG "JBOY_Profiler"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+uint32_t hashPc(uint32_t pc) {
+    // Instructions are at least halfword aligned; drop the always-zero bit.
+    return ((pc >> 1) * 2654435761u) >> 20;
+}
+
+void appendf(std::string& out, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+void appendf(std::string& out, const char* fmt, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    if (len > 0) {
+        out.append(buffer, std::min<size_t>(static_cast<size_t>(len), sizeof(buffer) - 1));
+    }
+}
+
+void appendJsonString(std::string& out, const char* value) {
+    out.push_back('"');
+    for (const char* p = value; *p; ++p) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(static_cast<char>(c));
+        } else if (c < 0x20) {
+            appendf(out, "\\u%04x", c);
+        } else {
+            out.push_back(static_cast<char>(c));
+        }
+    }
+    out.push_back('"');
+}
+
+double percentOf(uint64_t part, uint64_t total) {
+    return total ? static_cast<double>(part) * 100.0 / static_cast<double>(total) : 0.0;
+}
+
+} // namespace
+
+GuestProfiler::GuestProfiler() {
+    memset(&m_event, 0, sizeof(m_event));
+    m_event.context = this;
+    m_event.callback = onSample;
+    m_event.name = "JBoy Profiler";
+    m_event.priority = 0x80;
+    clear();
+}
+
+void GuestProfiler::clear() {
+    memset(m_slots, 0, sizeof(m_slots));
+    m_samples = 0;
+    m_haltedSamples = 0;
+    m_droppedSamples = 0;
+}
+
+void GuestProfiler::start(struct mCore* core, uint32_t intervalCycles) {
+    stop(core);
+    clear();
+    m_intervalCycles = intervalCycles ? intervalCycles : DEFAULT_INTERVAL_CYCLES;
+    m_running = true;
+    ensureScheduled(core);
+    LOGD("Profiler started, interval %u cycles", m_intervalCycles);
+}
+
+void GuestProfiler::stop(struct mCore* core) {
+    if (!m_running) {
+        return;
+    }
+    if (m_core && m_core == core && core->timing && mTimingIsScheduled(core->timing, &m_event)) {
+        mTimingDeschedule(core->timing, &m_event);
+    }
+    m_running = false;
+    m_core = nullptr;
+    LOGD("Profiler stopped after %llu samples", static_cast<unsigned long long>(m_samples));
+}
+
+void GuestProfiler::ensureScheduled(struct mCore* core) {
+    if (!m_running || !core || !core->timing || core->platform(core) != mPLATFORM_GBA) {
+        return;
+    }
+    m_core = core;
+    if (!mTimingIsScheduled(core->timing, &m_event)) {
+        mTimingSchedule(core->timing, &m_event, static_cast<int32_t>(m_intervalCycles));
+    }
+}
+
+void GuestProfiler::onSample(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+    auto* self = static_cast<GuestProfiler*>(context);
+    if (!self->m_running || !self->m_core) {
+        return;
+    }
+    const auto* gba = static_cast<const struct GBA*>(self->m_core->board);
+    const struct ARMCore* cpu = gba->cpu;
+    ++self->m_samples;
+    if (cpu->halted) {
+        ++self->m_haltedSamples;
+    } else {
+        // gprs[ARM_PC] runs two instructions ahead because of the prefetch.
+        const uint32_t instructionSize = cpu->executionMode == MODE_THUMB ? 2 : 4;
+        self->record(static_cast<uint32_t>(cpu->gprs[ARM_PC]) - instructionSize * 2);
+    }
+    const int32_t next = static_cast<int32_t>(self->m_intervalCycles) - static_cast<int32_t>(cyclesLate);
+    mTimingSchedule(timing, &self->m_event, next > 0 ? next : 1);
+}
+
+void GuestProfiler::record(uint32_t pc) {
+    uint32_t index = hashPc(pc) & (HISTOGRAM_SLOTS - 1);
+    for (int probe = 0; probe < MAX_PROBES; ++probe) {
+        Slot& slot = m_slots[index];
+        if (slot.count == 0) {
+            slot.pc = pc;
+            slot.count = 1;
+            return;
+        }
+        if (slot.pc == pc) {
+            ++slot.count;
+            return;
+        }
+        index = (index + 1) & (HISTOGRAM_SLOTS - 1);
+    }
+    ++m_droppedSamples;
+}
+
+std::string GuestProfiler::buildReport(struct mCore* core, const std::string& romTitle, uint32_t romCrc32) const {
+    std::vector<Slot> hot;
+    hot.reserve(HISTOGRAM_SLOTS);
+    for (const Slot& slot : m_slots) {
+        if (slot.count) {
+            hot.push_back(slot);
+        }
+    }
+
+    std::string out;
+    out.reserve(2048);
+    out += "{\"title\":";
+    appendJsonString(out, romTitle.c_str());
+    char code[5] = {};
+    if (core && core->getGameInfo) {
+        struct mGameInfo info;
+        memset(&info, 0, sizeof(info));
+        core->getGameInfo(core, &info);
+        memcpy(code, info.code, 4);
+    }
+    out += ",\"gameCode\":";
+    appendJsonString(out, code);
+    appendf(out, ",\"crc32\":\"%08X\",\"running\":%s,\"intervalCycles\":%u", romCrc32,
+            m_running ? "true" : "false", m_intervalCycles);
+    appendf(out, ",\"samples\":%llu,\"haltedPercent\":%.1f,\"droppedSamples\":%llu,\"distinctPcs\":%zu",
+            static_cast<unsigned long long>(m_samples), percentOf(m_haltedSamples, m_samples),
+            static_cast<unsigned long long>(m_droppedSamples), hot.size());
+    if (core && core->platform(core) == mPLATFORM_GBA) {
+        const auto* gba = static_cast<const struct GBA*>(core->board);
+        appendf(out, ",\"idleLoop\":\"%08X\",\"idleOptimization\":%d", gba->idleLoop,
+                static_cast<int>(gba->idleOptimization));
+    }
+
+    // Hottest addresses.
+    std::sort(hot.begin(), hot.end(), [](const Slot& a, const Slot& b) { return a.count > b.count; });
+    out += ",\"topPcs\":[";
+    const size_t top = std::min<size_t>(hot.size(), REPORT_TOP);
+    for (size_t i = 0; i < top; ++i) {
+        appendf(out, "%s{\"pc\":\"%08X\",\"samples\":%u,\"percent\":%.1f}", i ? "," : "",
+                hot[i].pc, hot[i].count, percentOf(hot[i].count, m_samples));
+    }
+    out += "]";
+
+    // Tight loops: runs of sampled addresses no more than LOOP_SPAN_BYTES apart
+    // that together hold a large share of the samples. The lowest address of a
+    // loop is the usual idle-loop candidate.
+    std::sort(hot.begin(), hot.end(), [](const Slot& a, const Slot& b) { return a.pc < b.pc; });
+    const uint64_t minLoopSamples = std::max<uint64_t>(1, m_samples * LOOP_MIN_PERMILLE / 1000);
+    out += ",\"hotLoops\":[";
+    bool firstLoop = true;
+    size_t begin = 0;
+    while (begin < hot.size()) {
+        size_t end = begin + 1;
+        uint64_t loopSamples = hot[begin].count;
+        while (end < hot.size() && hot[end].pc - hot[end - 1].pc <= LOOP_SPAN_BYTES) {
+            loopSamples += hot[end].count;
+            ++end;
+        }
+        const uint32_t span = hot[end - 1].pc - hot[begin].pc;
+        if (loopSamples >= minLoopSamples && span <= LOOP_SPAN_BYTES * 2) {
+            appendf(out, "%s{\"start\":\"%08X\",\"end\":\"%08X\",\"samples\":%llu,\"percent\":%.1f}",
+                    firstLoop ? "" : ",", hot[begin].pc, hot[end - 1].pc,
+                    static_cast<unsigned long long>(loopSamples), percentOf(loopSamples, m_samples));
+            firstLoop = false;
+        }
+        begin = end;
+    }
+    out += "]}";
+    return out;
+}
@@ -0,0 +1,51 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <cstdint>
+
+// Post-processing for interleaved stereo int16 audio leaving the audio ring:
+// gain, an optional RBJ biquad low-pass, a DC blocker and a short crossfade
+// after samples were dropped. Works in place and never allocates. Left and
+// right run as the two lanes of one NEON/SSE vector, since every stage is
+// recursive in time. Called under AudioPacer's lock.
+class AudioDsp {
+public:
+    AudioDsp();
+
+    // filterLevel 0..100 maps to the cutoff of the old one-pole Kotlin filter.
+    void configure(float gain, bool lowPass, int filterLevel);
+    bool isEnabled() const { return m_enabled; }
+    void reset();
+    // The next block does not continue the previous one (backlog was trimmed).
+    void markDiscontinuity() { m_discontinuity = true; }
+    void process(int16_t* samples, int count, int sampleRate);
+
+private:
+    static constexpr int EDGE_SMOOTH_FRAMES = 24;
+    static constexpr float EDGE_SMOOTH_THRESHOLD = 8000.0f;
+    static constexpr float DC_CUTOFF_HZ = 10.0f;
+
+    void updateCoefficients(int sampleRate);
+
+    bool m_enabled = false;
+    float m_gain = 1.0f;
+    bool m_lowPass = false;
+    int m_filterLevel = 60;
+    int m_sampleRate = 0;
+    bool m_coefficientsDirty = true;
+
+    // Biquad, transposed direct form II, normalised so a0 = 1.
+    float m_b0 = 1.0f, m_b1 = 0.0f, m_b2 = 0.0f, m_a1 = 0.0f, m_a2 = 0.0f;
+    float m_dcPole = 0.0f;
+
+    // Per-channel state, [0] left and [1] right.
+    float m_z1[2] = {};
+    float m_z2[2] = {};
+    float m_dcIn[2] = {};
+    float m_dcOut[2] = {};
+    float m_last[2] = {};
+    bool m_hasLast = false;
+    bool m_discontinuity = false;
+};
+
+#endif // AUDIO_DSP_H
@@ -0,0 +1,75 @@
+#ifndef AUDIO_PACER_H
+#define AUDIO_PACER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "audio_dsp.h"
+
+// Ring of interleaved stereo samples between the emulation thread and the
+// audio sink, and the pacing built on it.
+//
+// With the wall clock pacing emulation, the sink takes what it needs with
+// consume() and any backlog beyond about 65 ms is dropped to bound latency.
+// With the audio clock, the sink blocks in read() and emulation calls
+// waitForSpace() before each step, so it runs exactly as fast as the sink
+// plays and the backlog stays near CLOCK_LATENCY_MS. Samples pass through
+// AudioDsp on their way out. The pacer has its own lock and never takes the
+// core lock; waitForSpace() must be called without the core lock held.
+class AudioPacer {
+public:
+    static constexpr int CAPACITY = 16384;
+    // Audio-clock pacing keeps about this much audio queued ahead of the sink.
+    static constexpr int CLOCK_LATENCY_MS = 50;
+
+    AudioPacer();
+
+    // The rate the sink plays at, which sizes the backlog targets.
+    void setOutputRate(unsigned sampleRate);
+    // Returns whether the mode changed. Releases a wait made under the old one.
+    bool setAudioClock(bool enabled);
+    // Without a game waits end at once; underruns only count while one runs.
+    void setGameState(bool loaded, bool paused);
+    void configureDsp(float gain, bool lowPass, int filterLevel);
+    // Empties the ring and restarts the DSP.
+    void reset();
+
+    // Emulation thread. sampleRate is the core's output rate, for the DSP.
+    void append(const int16_t* samples, int count, int sampleRate);
+    // Blocks while audio-clock pacing has a full backlog queued, at most timeoutMs.
+    void waitForSpace(int timeoutMs);
+
+    // Wall-clock sink: never blocks, trims the backlog first.
+    int consume(int16_t* out, int maxSamples);
+    // Audio-clock sink: waits up to timeoutMs for at least one stereo frame.
+    int read(int16_t* out, int maxSamples, int timeoutMs);
+
+    int getFill() const;
+    int64_t getDroppedSamples() const;
+    int64_t getUnderruns() const;
+
+private:
+    int highWaterLocked() const;
+    void dropLocked(int count);
+    int takeLocked(int16_t* out, int count);
+
+    mutable std::mutex m_mutex;
+    // Signalled when samples are produced or consumed, and on state changes.
+    std::condition_variable m_cond;
+    int16_t m_buffer[CAPACITY];
+    int m_readIndex = 0;
+    int m_writeIndex = 0;
+    int m_count = 0;
+    unsigned m_outputRate = 44100;
+    int m_sampleRate = 0;
+    bool m_audioClock = false;
+    bool m_loaded = false;
+    bool m_paused = false;
+    int64_t m_droppedSamples = 0;
+    int64_t m_underruns = 0;
+    // Gain, low-pass and DC blocker applied to samples as they leave the ring.
+    AudioDsp m_dsp;
+};
+
+#endif // AUDIO_PACER_H
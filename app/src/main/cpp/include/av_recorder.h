@@ -0,0 +1,98 @@
+#ifndef AV_RECORDER_H
+#define AV_RECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "spsc_queue.h"
+
+// Gameplay recorder: `<base>.y4m` (4:4:4, full range) plus `<base>.wav`.
+//
+// Frames travel in pooled slots. While a frame renders, the emulation thread
+// writes the lines that changed into the slot's picture in the same pass that
+// updates its own buffer, adds the samples the frame produced, and pushes
+// only the slot pointer onto a lock-free queue. An encoder thread, woken
+// through a condition variable, converts the changed lines into the YUV
+// picture it keeps, writes it, and returns the slot through a second queue.
+// When the encoder falls behind and the pool runs dry the frame is dropped
+// and counted, and the next slot carries the whole picture; emulation never
+// waits.
+class AvRecorder {
+public:
+    static constexpr int FRAME_WIDTH = 240;
+    static constexpr int FRAME_HEIGHT = 160;
+    static constexpr int DIRTY_WORDS = (FRAME_HEIGHT + 31) / 32;
+
+    AvRecorder();
+    ~AvRecorder();
+
+    bool start(const std::string& basePath, int sampleRate);
+    // Drains queued frames, finalises both files and joins the encoder.
+    void stop();
+    bool isRecording() const { return m_recording; }
+
+    // Emulation thread only.
+    void appendAudio(const int16_t* samples, int count);
+    // While a frame renders: where its changed lines go (RGB565, FRAME_WIDTH * 2
+    // bytes per line), or null when not recording or the pool is empty.
+    uint8_t* frameBuffer();
+    // Queues the frame. dirtyLines has a bit per line that differs from the
+    // previous frame; whatever the slot still lacks is copied from rgb565.
+    void commitFrame(const uint8_t* rgb565, const uint32_t* dirtyLines);
+
+    int64_t getWrittenFrames() const { return m_writtenFrames.load(std::memory_order_relaxed); }
+    int64_t getDroppedFrames() const { return m_droppedFrames; }
+    int64_t getLastEnqueueUs() const { return m_lastEnqueueUs; }
+
+private:
+    static constexpr size_t POOL_SIZE = 16;
+    // About two frames of stereo audio at 48 kHz.
+    static constexpr int MAX_AUDIO_SAMPLES = 4096;
+
+    struct Slot {
+        uint8_t video[FRAME_WIDTH * FRAME_HEIGHT * 2];
+        // Lines of `video` that are new in this frame; the rest are stale.
+        uint32_t dirtyLines[DIRTY_WORDS];
+        bool videoWritten;
+        int16_t audio[MAX_AUDIO_SAMPLES];
+        int audioCount;
+    };
+
+    Slot* acquireSlot();
+    static void copyLines(Slot* slot, const uint8_t* rgb565, const uint32_t* lines);
+    void encoderLoop();
+    void writeSlot(const Slot* slot);
+    void finishFiles();
+
+    std::unique_ptr<Slot[]> m_pool;
+    SpscQueue<Slot*, 32> m_freeSlots;
+    SpscQueue<Slot*, 32> m_filledSlots;
+    Slot* m_current = nullptr;
+    // The encoder's picture is missing frames: send the next one whole.
+    bool m_resync = true;
+
+    std::thread m_encoder;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_stopRequested{false};
+    bool m_recording = false;
+
+    FILE* m_videoFile = nullptr;
+    FILE* m_audioFile = nullptr;
+    uint32_t m_audioBytes = 0;
+    int m_audioSampleRate = 0;
+    // The last written picture; each slot updates only its dirty lines.
+    uint8_t m_yuv[FRAME_WIDTH * FRAME_HEIGHT * 3];
+
+    std::atomic<int64_t> m_writtenFrames{0};
+    int64_t m_droppedFrames = 0;
+    int64_t m_lastEnqueueUs = 0;
+};
+
+#endif // AV_RECORDER_H
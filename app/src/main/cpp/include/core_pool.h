@@ -0,0 +1,47 @@
+#ifndef CORE_POOL_H
+#define CORE_POOL_H
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+struct mCore;
+
+// Keeps one GBA mCore created and configured ahead of the first ROM load.
+//
+// mCoreCreate, init, mCoreInitConfig and mCoreLoadConfig allocate the
+// emulated memory and read the config from storage; prewarm() runs them on
+// a background thread while the game list is up. take() hands the spare
+// over under the pool lock, waiting for a warm-up already in progress, or
+// builds a core on the calling thread when none was requested. The caller
+// applies session options after taking it. Independent of JboyCore.
+class CorePool {
+public:
+    struct Timings {
+        int64_t createUs = 0;
+        int64_t configUs = 0;
+        bool prewarmed = false;
+    };
+
+    ~CorePool();
+
+    // Starts a warm-up unless a spare exists or one is already running.
+    void prewarm();
+    // Never null unless mCoreCreate fails. The caller owns the core.
+    struct mCore* take(Timings* timings);
+    // Stops a warm-up and destroys the spare.
+    void clear();
+
+private:
+    static struct mCore* build(Timings& timings);
+    static void destroy(struct mCore* core);
+    void warmLoop();
+    void joinWarmer();
+
+    std::mutex m_mutex;
+    std::thread m_warmer;
+    struct mCore* m_spare = nullptr;
+    Timings m_spareTimings;
+};
+
+#endif // CORE_POOL_H
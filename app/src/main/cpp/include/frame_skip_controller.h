@@ -0,0 +1,63 @@
+#ifndef FRAME_SKIP_CONTROLLER_H
+#define FRAME_SKIP_CONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Adaptive frame skip.
+//
+// Tracks the cost of emulated frames with and without video rendering, plus
+// the presenter's draw cost, as exponentially weighted moving averages. Before
+// each frame the core asks shouldRender(); the controller picks the smallest
+// skip level whose projected per-frame cost fits the frame budget, so it backs
+// off as soon as headroom returns. Skipping only drops mGBA's scanline
+// rendering: every frame is still emulated, so audio stays continuous.
+class FrameSkipController {
+public:
+    static constexpr int MAX_SKIP = 4;
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+    // Emulation speed multiplier; the frame budget is one GBA frame divided by this.
+    void setSpeed(int speed);
+    void reset();
+
+    // Called with the core lock held before/after every emulated frame.
+    bool shouldRender();
+    void onFrameFinished(bool rendered, int64_t costNs);
+
+    int getSkipLevel() const { return m_skipLevel; }
+    int64_t getRenderCostUs() const { return m_renderCostNs / 1000; }
+    int64_t getSkipCostUs() const { return m_skipCostNs / 1000; }
+    int64_t getSkippedFrames() const { return m_skippedFrames; }
+
+    // Reported from the GL thread after every draw.
+    static void reportPresentCost(int64_t costNs);
+    static int64_t getPresentCostUs() { return s_presentCostNs.load(std::memory_order_relaxed) / 1000; }
+
+private:
+    // GBA frame: 280896 cycles at 16.78 MHz.
+    static constexpr int64_t GBA_FRAME_NS = 16742706;
+    // EWMA weight of a new sample, in 1/16ths.
+    static constexpr int64_t EWMA_WEIGHT = 2;
+    // Skip when the projected cost exceeds 90% of the budget; only drop a level
+    // again once it fits in 80%, so the level does not flap.
+    static constexpr int64_t RAISE_PERCENT = 90;
+    static constexpr int64_t LOWER_PERCENT = 80;
+
+    static int64_t updateAverage(int64_t average, int64_t sample);
+    int64_t projectedCost(int level) const;
+    void chooseSkipLevel();
+
+    bool m_enabled = false;
+    int64_t m_budgetNs = GBA_FRAME_NS;
+    int64_t m_renderCostNs = 0;
+    int64_t m_skipCostNs = 0;
+    int m_skipLevel = 0;
+    int m_framesUntilRender = 0;
+    int64_t m_skippedFrames = 0;
+
+    static std::atomic<int64_t> s_presentCostNs;
+};
+
+#endif // FRAME_SKIP_CONTROLLER_H
@@ -0,0 +1,62 @@
+#ifndef GUEST_PROFILER_H
+#define GUEST_PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+#include <mgba/core/timing.h>
+
+struct mCore;
+
+// Sampling profiler for the emulated CPU.
+//
+// An mTiming event fires every `intervalCycles` guest cycles and records the
+// address of the executing instruction in a fixed-size open-addressing
+// histogram, so sampling costs one hash probe and never allocates. Samples
+// taken while the CPU is halted are counted separately; their share is how
+// idle the game is. buildReport() turns the histogram into a JSON report with
+// the hottest addresses and the tight loops they form, which is what
+// idle-loop tuning needs.
+class GuestProfiler {
+public:
+    static constexpr uint32_t DEFAULT_INTERVAL_CYCLES = 4096;
+
+    GuestProfiler();
+
+    // Called with the core lock held.
+    void start(struct mCore* core, uint32_t intervalCycles);
+    void stop(struct mCore* core);
+    // Reset and loadState clear mGBA's timing queue; re-arm after them.
+    void ensureScheduled(struct mCore* core);
+    bool isRunning() const { return m_running; }
+    std::string buildReport(struct mCore* core, const std::string& romTitle, uint32_t romCrc32) const;
+
+private:
+    static constexpr int HISTOGRAM_SLOTS = 4096; // power of two
+    static constexpr int MAX_PROBES = 16;
+    static constexpr int REPORT_TOP = 16;
+    // Hot addresses closer than this are treated as one loop.
+    static constexpr uint32_t LOOP_SPAN_BYTES = 32;
+    // A loop must hold this share of all samples to be reported.
+    static constexpr int LOOP_MIN_PERMILLE = 20;
+
+    struct Slot {
+        uint32_t pc;
+        uint32_t count;
+    };
+
+    static void onSample(struct mTiming* timing, void* context, uint32_t cyclesLate);
+    void record(uint32_t pc);
+    void clear();
+
+    struct mTimingEvent m_event;
+    struct mCore* m_core = nullptr;
+    bool m_running = false;
+    uint32_t m_intervalCycles = DEFAULT_INTERVAL_CYCLES;
+    Slot m_slots[HISTOGRAM_SLOTS];
+    uint64_t m_samples = 0;
+    uint64_t m_haltedSamples = 0;
+    uint64_t m_droppedSamples = 0;
+};
+
+#endif // GUEST_PROFILER_H
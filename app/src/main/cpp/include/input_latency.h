@@ -0,0 +1,106 @@
+#ifndef INPUT_LATENCY_H
+#define INPUT_LATENCY_H
+
+#include <cstdint>
+
+#include <mgba/core/interface.h>
+
+struct mCore;
+
+// Input-to-photon latency measurement.
+//
+// MODE_MEASURE timestamps every change of the player's input and follows it
+// through two points: the first KEYINPUT read by the game (mGBA's keysRead
+// callback) and the first converted frame handed to the presenter after the
+// frame that read it. Each stage goes into a histogram of 1 ms buckets. An
+// event whose frame changes nothing on screen is dropped after
+// MAX_UNPRESENTED_FRAMES.
+//
+// MODE_PROBE replaces the player's input with a synthetic press of the given
+// buttons. It waits for a frame with no changed lines, holds the press until
+// the framebuffer changes, and records how many emulated frames that took.
+// It then releases and lets the screen settle before pressing again. This
+// gives per-game latency in frames with no host timing noise. Games whose
+// screen never goes quiet produce only skipped probes.
+//
+// All calls are made with the core lock held.
+class InputLatency {
+public:
+    enum Mode {
+        MODE_OFF = 0,
+        MODE_MEASURE = 1,
+        MODE_PROBE = 2,
+    };
+
+    static constexpr int TIME_BUCKETS = 100;   // 1 ms each; the last also holds everything slower
+    static constexpr int FRAME_BUCKETS = 16;   // 1..16 frames; the last also holds everything slower
+    // Layout: REPORT_* counters, then read, present and probe histograms.
+    enum ReportField {
+        REPORT_MODE = 0,
+        REPORT_EVENTS,
+        REPORT_UNREAD,       // dropped before the game read the keys
+        REPORT_UNPRESENTED,  // read, but nothing on screen changed
+        REPORT_PROBES,
+        REPORT_PROBES_SKIPPED,
+        REPORT_HEADER_SIZE,
+    };
+    static constexpr int REPORT_SIZE = REPORT_HEADER_SIZE + 2 * TIME_BUCKETS + FRAME_BUCKETS;
+
+    // Adds the keysRead callback; call once for every new core.
+    void attach(struct mCore* core);
+    // Clears the histograms. probeButtons is a core button mask, used in MODE_PROBE.
+    void setMode(int mode, int probeButtons);
+    int getMode() const { return m_mode; }
+    bool isProbing() const { return m_mode == MODE_PROBE; }
+
+    // inputNs is when the input arrived, taken before waiting for the core lock.
+    void onInputChanged(int64_t inputNs);
+    // Before each frame. In MODE_PROBE returns the buttons to hold, else -1.
+    int beginFrame();
+    // After each frame; `changed` is whether any framebuffer line changed.
+    void endFrame(bool rendered, bool changed);
+    // A changed frame was handed to the presenter.
+    void onHandoff(int64_t nowNs);
+    void report(int64_t* out, int count) const;
+
+private:
+    static constexpr int MAX_PENDING = 16;
+    static constexpr int MAX_UNREAD_FRAMES = 60;
+    static constexpr int MAX_UNPRESENTED_FRAMES = 30;
+    // A probe gives up waiting for a quiet frame, or for a response, after this many frames.
+    static constexpr int PROBE_TIMEOUT_FRAMES = 120;
+    static constexpr int PROBE_SETTLE_FRAMES = 8;
+
+    struct Event {
+        int64_t inputNs;
+        int64_t inputFrame;
+        int64_t readFrame; // -1 until the game reads the keys
+    };
+
+    enum ProbeState {
+        PROBE_WAIT_QUIET,
+        PROBE_PRESSED,
+        PROBE_RELEASED,
+    };
+
+    static void onKeysRead(void* context);
+    static void addTime(int64_t* histogram, int64_t ns);
+    void removePending(int index);
+
+    struct mCoreCallbacks m_callbacks{};
+    int m_mode = MODE_OFF;
+    int64_t m_frame = 0;
+    Event m_pending[MAX_PENDING] = {};
+    int m_pendingCount = 0;
+    int64_t m_counters[REPORT_HEADER_SIZE] = {};
+    int64_t m_readHistogram[TIME_BUCKETS] = {};
+    int64_t m_presentHistogram[TIME_BUCKETS] = {};
+    int64_t m_probeHistogram[FRAME_BUCKETS] = {};
+
+    int m_probeButtons = 0;
+    int m_probeState = PROBE_WAIT_QUIET;
+    int m_probeFrames = 0;
+    bool m_lastFrameQuiet = false;
+};
+
+#endif // INPUT_LATENCY_H
@@ -0,0 +1,48 @@
+#ifndef JBOY_LOG_H
+#define JBOY_LOG_H
+
+#include <cstdint>
+
+// Native logging that keeps the logcat write off the calling thread.
+//
+// Messages are formatted into a fixed ring of slots that producers claim with
+// a CAS, and a background thread writes them to logcat. Off Android, the
+// thread writes to stdout. The thread sleeps until a message arrives: the
+// first message after it went idle wakes it with one futex call, and messages
+// logged while it is draining make no syscall. A full ring drops the message
+// and counts it; it never blocks. Messages below JBOY_LOG_LEVEL compile to dead code, so their
+// arguments are still type-checked but never evaluated.
+//
+// Files keep their own tag:
+//     #define LOG_TAG "JBOY_Xxx"
+//     #define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+
+// Same values as android_LogPriority.
+#define JBOY_LOG_VERBOSE 2
+#define JBOY_LOG_DEBUG 3
+#define JBOY_LOG_INFO 4
+#define JBOY_LOG_WARN 5
+#define JBOY_LOG_ERROR 6
+
+#ifndef JBOY_LOG_LEVEL
+#define JBOY_LOG_LEVEL JBOY_LOG_DEBUG
+#endif
+
+void jboyLogWrite(int priority, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+// Writes out everything queued so far before returning.
+void jboyLogFlush();
+int64_t jboyLogDroppedCount();
+
+#define JBOY_LOG_AT(priority, tag, ...)                    \
+    do {                                                   \
+        if ((priority) >= JBOY_LOG_LEVEL) {                \
+            jboyLogWrite((priority), (tag), __VA_ARGS__);  \
+        }                                                  \
+    } while (0)
+
+#define JBOY_LOGD(tag, ...) JBOY_LOG_AT(JBOY_LOG_DEBUG, tag, __VA_ARGS__)
+#define JBOY_LOGI(tag, ...) JBOY_LOG_AT(JBOY_LOG_INFO, tag, __VA_ARGS__)
+#define JBOY_LOGW(tag, ...) JBOY_LOG_AT(JBOY_LOG_WARN, tag, __VA_ARGS__)
+#define JBOY_LOGE(tag, ...) JBOY_LOG_AT(JBOY_LOG_ERROR, tag, __VA_ARGS__)
+
+#endif // JBOY_LOG_H
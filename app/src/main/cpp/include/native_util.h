@@ -0,0 +1,32 @@
+#ifndef NATIVE_UTIL_H
+#define NATIVE_UTIL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct FileChunk {
+    const void* data;
+    size_t size;
+};
+
+// Monotonic clock in nanoseconds.
+int64_t nowNanos();
+
+// Writes all chunks to `path` via `path.tmp` + fsync + rename, so a crash never
+// leaves a truncated file behind.
+bool writeFileAtomic(const std::string& path, const FileChunk* chunks, size_t count);
+bool writeFileAtomic(const std::string& path, const void* data, size_t size);
+
+bool readWholeFile(const std::string& path, std::vector<uint8_t>& out);
+
+constexpr size_t WAV_HEADER_SIZE = 44;
+
+// Canonical 16-bit PCM WAV header for `dataBytes` of interleaved samples.
+void buildWavHeader(uint8_t* header, int sampleRate, int channels, uint32_t dataBytes);
+
+// Encodes packed 8-bit RGB (width * 3 bytes per row) as a complete PNG file.
+bool encodePngRgb(const uint8_t* rgb, int width, int height, int level, std::vector<uint8_t>& out);
+
+#endif // NATIVE_UTIL_H
@@ -0,0 +1,81 @@
+#ifndef RAM_SEARCH_H
+#define RAM_SEARCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct mCore;
+
+// Cheat finder over EWRAM (256 KiB) and IWRAM (32 KiB).
+//
+// start() snapshots both regions and marks every aligned 8/16/32-bit value
+// as a candidate, one bit each. filter() takes a fresh snapshot and queues a
+// pass that compares it against a constant or against the previous snapshot;
+// the pass runs in slices of at most SLICE_NS between frames, so a search can
+// narrow down while the game keeps running. Each slice compares 64 candidates
+// per bitset word with NEON/SSE2 and skips words with no candidates left, so
+// later passes touch only the survivors. Called with the core lock held.
+class RamSearch {
+public:
+    enum Relation {
+        // Against the given value.
+        EQUAL = 0,
+        NOT_EQUAL,
+        GREATER,
+        LESS,
+        // Against the previous snapshot.
+        UNCHANGED,
+        CHANGED,
+        INCREASED,
+        DECREASED,
+    };
+
+    struct Result {
+        uint32_t address;
+        uint32_t value;
+        uint32_t previous;
+    };
+
+    static constexpr int64_t SLICE_NS = 1000000;
+
+    // width is 1, 2 or 4 bytes. False when the core exposes no work RAM.
+    bool start(struct mCore* core, int width);
+    // Queues a pass and runs its first slice; completes it at once when
+    // `finishNow` (no frames are running to carry it).
+    bool filter(struct mCore* core, int relation, uint32_t value, bool finishNow);
+    // Between frames: continues a queued pass for up to SLICE_NS.
+    void onFrame();
+    // Completes a queued pass at once, for when frames stopped mid-pass.
+    void finish();
+    void reset();
+
+    bool isActive() const { return m_width != 0; }
+    bool isFiltering() const { return m_passWord < m_words; }
+    int64_t getCandidateCount() const { return m_candidates; }
+    int64_t getLastPassUs() const { return m_lastPassNs / 1000; }
+    // First `max` candidates with their latest and previous values.
+    std::vector<Result> results(int max) const;
+
+private:
+    bool capture(struct mCore* core, std::vector<uint8_t>& out) const;
+    void runSlice(int64_t budgetNs);
+    void finishPass();
+
+    int m_width = 0;
+    size_t m_words = 0;
+    std::vector<uint64_t> m_bits;
+    // Snapshot filters compare against, and the one taken for the pass.
+    std::vector<uint8_t> m_previous;
+    std::vector<uint8_t> m_current;
+    int m_passRelation = EQUAL;
+    // The compare operand repeated across 16 bytes.
+    alignas(16) uint8_t m_operand[16] = {};
+    size_t m_passWord = 0;
+    int64_t m_passCount = 0;
+    int64_t m_passNs = 0;
+    int64_t m_candidates = 0;
+    int64_t m_lastPassNs = 0;
+};
+
+#endif // RAM_SEARCH_H
@@ -0,0 +1,98 @@
+#ifndef REPLAY_BUFFER_H
+#define REPLAY_BUFFER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Always-on instant replay of the last few seconds of video and audio.
+//
+// Every emulated frame becomes one record in a fixed-size byte arena: the
+// lines that changed, XORed against the previous frame and run-length coded
+// as 16-bit words, followed by that frame's raw audio. Every
+// KEYFRAME_INTERVAL frames a record carries the whole picture so playback can
+// start once older records have been evicted; so does any record whose space
+// was made by evicting the last keyframe left. The arena and index are sized by
+// configure() and never reallocated per frame; the oldest records are evicted
+// when either the time or the memory budget is exceeded.
+//
+// onFrame()/appendAudio() run on the emulation thread with the core lock held.
+// Exporting takes a copy under the lock and encodes an APNG plus a WAV
+// without it.
+class ReplayBuffer {
+public:
+    static constexpr int FRAME_WIDTH = 240;
+    static constexpr int FRAME_HEIGHT = 160;
+    static constexpr int DIRTY_WORDS = (FRAME_HEIGHT + 31) / 32;
+
+    struct Snapshot {
+        std::vector<uint8_t> records;
+        int sampleRate = 0;
+    };
+
+    // seconds == 0 or memoryKb == 0 turns the ring off and frees it.
+    void configure(int seconds, int memoryKb);
+    void clear();
+    bool isEnabled() const { return !m_arena.empty(); }
+
+    void appendAudio(const int16_t* samples, int count);
+    // dirtyLines marks the lines of rgb565 that changed since the last call.
+    void onFrame(const uint8_t* rgb565, const uint32_t* dirtyLines, int sampleRate);
+
+    // Copies the records from the oldest keyframe on; false when there is none.
+    bool snapshot(Snapshot& out) const;
+    // Writes `<base>.png` (animated) and `<base>.wav`; runs without the core lock.
+    static bool exportSnapshot(const Snapshot& snapshot, const std::string& basePath);
+
+    int getFrameCount() const { return m_count; }
+    int64_t getUsedBytes() const { return m_usedBytes; }
+    int64_t getCapacityBytes() const { return static_cast<int64_t>(m_arena.size()); }
+    int64_t getLastEncodeUs() const { return m_lastEncodeUs; }
+
+private:
+    static constexpr int KEYFRAME_INTERVAL = 120;
+    static constexpr int MAX_AUDIO_SAMPLES = 4096;
+    static constexpr int FRAMES_PER_SECOND = 60;
+
+    struct RecordHeader {
+        uint32_t size;          // whole record, 4-byte aligned
+        uint32_t frameNumber;
+        uint32_t dirty[DIRTY_WORDS];
+        uint32_t videoBytes;
+        uint16_t audioSamples;
+        uint16_t keyframe;
+    };
+
+    struct IndexEntry {
+        uint32_t offset;
+        uint32_t size;
+        bool keyframe;
+    };
+
+    const IndexEntry& entryAt(int i) const { return m_index[(m_first + i) % m_index.size()]; }
+    void evictOldest();
+    bool reserve(uint32_t size, uint32_t* offset);
+    // Encodes the changed lines (all of them for a keyframe) and updates the
+    // reference picture; returns the video bytes written to `out`.
+    size_t encodeFrame(const uint8_t* rgb565, const uint32_t* dirtyLines, bool keyframe, uint32_t* dirtyOut,
+                       uint8_t* out);
+
+    std::vector<uint8_t> m_arena;
+    std::vector<IndexEntry> m_index;
+    int m_first = 0;
+    int m_count = 0;
+    int m_keyframes = 0;
+    uint32_t m_writePos = 0;
+    int64_t m_usedBytes = 0;
+
+    uint16_t m_reference[FRAME_WIDTH * FRAME_HEIGHT] = {};
+    std::vector<uint8_t> m_scratch;
+    int16_t m_pendingAudio[MAX_AUDIO_SAMPLES];
+    int m_pendingAudioCount = 0;
+    uint32_t m_frameNumber = 0;
+    int m_framesSinceKey = KEYFRAME_INTERVAL;
+    int m_sampleRate = 0;
+    int64_t m_lastEncodeUs = 0;
+};
+
+#endif // REPLAY_BUFFER_H
@@ -0,0 +1,64 @@
+#ifndef ROM_PATCHER_H
+#define ROM_PATCHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct VFile;
+
+// Applies an IPS, UPS or BPS patch while the ROM is loaded, without writing a
+// patched copy to storage.
+//
+// The ROM file is mapped MAP_PRIVATE into an anonymous region the size of the
+// patched image, so unchanged pages stay shared with the page cache and only
+// pages the patch touches are copied. UPS and BPS carry CRC32s of the source,
+// the target and the patch itself; all three are checked. Hashing a 32 MB ROM
+// twice is the slow part, so once a (ROM, patch) pair has verified, its sizes,
+// mtimes and target CRC go into a small cache file and later loads skip the
+// source and target hashes. Called with the core lock held.
+class RomPatcher {
+public:
+    ~RomPatcher();
+
+    // Empty keeps the verification cache in memory only.
+    void setCachePath(const std::string& path);
+    // Builds the patched image and returns a VFile over it for mCore::loadROM,
+    // or nullptr when the patch is malformed or does not match the ROM.
+    struct VFile* open(const std::string& romPath, const std::string& patchPath);
+    // Unmaps the image. Only after the core has unloaded the ROM.
+    void release();
+    bool isActive() const { return m_image != nullptr; }
+
+private:
+    struct CacheEntry {
+        uint32_t targetCrc;
+        int64_t romSize;
+        int64_t romMtimeNs;
+        int64_t patchSize;
+        int64_t patchMtimeNs;
+        std::string romPath;
+        std::string patchPath;
+    };
+
+    bool mapImage(int fd, size_t sourceSize, size_t targetSize);
+    // Each parses its header, maps the image via mapImage(fd) and patches it.
+    // `source` is a read-only view of the unpatched ROM.
+    bool applyIps(const std::vector<uint8_t>& patch, int fd, size_t sourceSize);
+    bool applyUps(const std::vector<uint8_t>& patch, int fd, const uint8_t* source, size_t sourceSize, bool verify);
+    bool applyBps(const std::vector<uint8_t>& patch, int fd, const uint8_t* source, size_t sourceSize, bool verify);
+    const CacheEntry* findVerified(const CacheEntry& key) const;
+    void rememberVerified(const CacheEntry& entry);
+    void loadCache();
+    void saveCache() const;
+
+    std::string m_cachePath;
+    std::vector<CacheEntry> m_cache;
+    bool m_cacheLoaded = false;
+    uint8_t* m_image = nullptr;
+    size_t m_imageSize = 0;
+    size_t m_mapSize = 0;
+};
+
+#endif // ROM_PATCHER_H
@@ -0,0 +1,90 @@
+#ifndef SAVE_RAM_MANAGER_H
+#define SAVE_RAM_MANAGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct mCore;
+
+// Battery save write-back cache.
+//
+// The .sav file is attached to mGBA as a temporary (memory-only) save, so the
+// emulation thread never touches storage. Save RAM is snapshotted periodically,
+// compared block by block against the last snapshot, and written out from a
+// worker thread once it has been quiet for a debounce interval, or immediately
+// on flush().
+//
+// Each write first moves the current .sav, if it is intact, to `<save>.bak`,
+// then records the CRC32 of the new image and of the backup in a `<save>.crc`
+// sidecar, and finally replaces the .sav; both files go through
+// writeFileAtomic. On the next attach a .sav that is missing or does not match
+// the sidecar is restored from the backup. A .sav replaced by hand should have
+// its .crc deleted, or it is taken for damage and rolled back.
+class SaveRamManager {
+public:
+    SaveRamManager();
+    ~SaveRamManager();
+
+    // Attaches `savePath` to a freshly loaded ROM and takes the baseline snapshot.
+    bool attach(struct mCore* core, const std::string& savePath);
+    // Called with the core lock held after every emulated frame.
+    void onFrame(struct mCore* core, int64_t nowNs);
+    // Snapshots now and queues a write if anything changed since the last one.
+    void flush(struct mCore* core);
+    // Final flush for the attached save; blocks until it is on disk.
+    void detach(struct mCore* core);
+
+    int64_t getFlushCount() const { return m_flushCount.load(std::memory_order_relaxed); }
+    int64_t getLastFlushUs() const { return m_lastFlushUs.load(std::memory_order_relaxed); }
+    int64_t getFailureCount() const { return m_failureCount.load(std::memory_order_relaxed); }
+    // Saves restored from `<save>.bak` since this manager was created.
+    int64_t getRestoreCount() const { return m_restoreCount.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 4096; // Flash sector size.
+    static constexpr int POLL_INTERVAL_FRAMES = 15;
+    static constexpr int64_t DEBOUNCE_NS = 1000000000LL;
+    static constexpr int64_t MAX_DELAY_NS = 5000000000LL;
+
+    struct PendingWrite {
+        std::string path;
+        std::vector<uint8_t> data;
+    };
+
+    bool snapshot(struct mCore* core);
+    void queueWrite();
+    void waitIdle();
+    void workerLoop();
+    static bool writeSave(const std::string& path, const std::vector<uint8_t>& data);
+    bool restoreIfDamaged(const std::string& path);
+
+    std::string m_path;
+    std::vector<uint8_t> m_image;
+    bool m_attached = false;
+    bool m_dirty = false;
+    int m_framesUntilPoll = 0;
+    int64_t m_firstDirtyNs = 0;
+    int64_t m_lastChangeNs = 0;
+
+    std::thread m_worker;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCond;
+    std::condition_variable m_idleCond;
+    std::deque<PendingWrite> m_queue;
+    bool m_writing = false;
+    bool m_stopping = false;
+
+    std::atomic<int64_t> m_flushCount{0};
+    std::atomic<int64_t> m_lastFlushUs{0};
+    std::atomic<int64_t> m_failureCount{0};
+    std::atomic<int64_t> m_restoreCount{0};
+};
+
+#endif // SAVE_RAM_MANAGER_H
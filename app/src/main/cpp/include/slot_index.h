@@ -0,0 +1,59 @@
+#ifndef SLOT_INDEX_H
+#define SLOT_INDEX_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Per-ROM index of save-state slots: existence, file size, save time and the
+// offset of the preview thumbnail stored after the state data.
+//
+// The index lives in memory and is mirrored to `<rom>.slots`, updated on
+// every save. Queries take only the index's own lock, never the core lock,
+// and touch storage only when the index is stale: first use after attach(),
+// a missing or unreadable index file, or markStale() after a slot file
+// turned out to be gone. A stale index is rebuilt from one directory listing.
+class SlotIndex {
+public:
+    static constexpr int THUMB_WIDTH = 120;
+    static constexpr int THUMB_HEIGHT = 80;
+    static constexpr size_t THUMB_BYTES = THUMB_WIDTH * THUMB_HEIGHT * 2;
+
+    struct Entry {
+        int slot;
+        int64_t size;
+        int64_t savedAtMs;
+        // -1 when the state file carries no thumbnail.
+        int64_t thumbOffset;
+    };
+
+    static std::string statePath(const std::string& romPath, int slot);
+    // 2x2 average of a 240x160 RGB565 frame into THUMB_BYTES of RGB565.
+    static void buildThumbnail(const uint8_t* rgb565, uint8_t* out);
+
+    // stateSize lets a rebuild recognise files that end with a thumbnail.
+    void attach(const std::string& romPath, size_t stateSize);
+    void detach();
+    void markStale();
+
+    void recordSave(int slot, int64_t size, int64_t thumbOffset);
+    bool has(int slot);
+    std::vector<Entry> entries();
+    bool readThumbnail(int slot, std::vector<uint8_t>& out);
+
+private:
+    void ensureFreshLocked();
+    bool loadLocked();
+    void rescanLocked();
+    void persistLocked() const;
+
+    std::mutex m_mutex;
+    std::string m_romPath;
+    std::map<int, Entry> m_entries;
+    size_t m_stateSize = 0;
+    bool m_stale = true;
+};
+
+#endif // SLOT_INDEX_H
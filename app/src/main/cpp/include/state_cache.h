@@ -0,0 +1,60 @@
+#ifndef STATE_CACHE_H
+#define STATE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class SlotIndex;
+
+// Bounded in-memory copy of the most recently used save-state slots.
+//
+// When a ROM is loaded a background thread reads the newest slots listed in
+// the slot index, so the first quick-load needs no storage access; every
+// save puts the freshly serialised state in directly. loadState then hands
+// the cached buffer straight to the core. At most MAX_ENTRIES states are
+// kept, least recently used first out. Own lock; never takes the core lock.
+class StateCache {
+public:
+    static constexpr size_t MAX_ENTRIES = 4;
+
+    using Buffer = std::shared_ptr<const std::vector<uint8_t>>;
+
+    ~StateCache();
+
+    // Drops everything and starts prefetching `romPath`'s newest slots.
+    void reset(const std::string& romPath, size_t stateSize, SlotIndex* index);
+    // Stops the prefetch and drops everything.
+    void clear();
+
+    void put(int slot, std::vector<uint8_t>&& state);
+    void erase(int slot);
+    // Null on a miss.
+    Buffer get(int slot);
+
+private:
+    struct Entry {
+        int slot;
+        uint64_t lastUse;
+        Buffer data;
+    };
+
+    void prefetchLoop(uint64_t generation, std::string romPath, size_t stateSize, SlotIndex* index);
+    void insertLocked(int slot, Buffer data);
+    void stopPrefetch();
+
+    std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    // Slots saved since reset(); the prefetch must not replace them with older file contents.
+    std::set<int> m_written;
+    uint64_t m_useCounter = 0;
+    std::atomic<uint64_t> m_generation{0};
+    std::thread m_prefetch;
+};
+
+#endif // STATE_CACHE_H
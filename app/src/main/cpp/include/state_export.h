@@ -0,0 +1,88 @@
+#ifndef STATE_EXPORT_H
+#define STATE_EXPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+struct mCore;
+
+// Layout of the shared region, kept free of Android and mGBA types so tools
+// can include this header on their own. All fields are little-endian; the
+// region data follows the header at the offsets given in `regions`.
+//
+// Reading a consistent frame is a seqlock: load `sequence` (acquire), retry
+// while it is odd, copy what is needed, issue an acquire fence and load
+// `sequence` again; if it changed, the copy raced a frame and is retried.
+// `sequence` is twice the number of frames published.
+struct StateExportHeader {
+    uint32_t magic;      // STATE_EXPORT_MAGIC
+    uint16_t version;    // STATE_EXPORT_VERSION
+    uint16_t headerSize; // sizeof(StateExportHeader)
+    uint32_t sequence;   // odd while the writer is inside a frame
+    uint32_t reserved;
+    uint64_t frame;      // emulated frames since the ROM was loaded
+    struct Region {
+        uint32_t offset;
+        uint32_t size;   // 0 when the region was unavailable this frame
+    } regions[4];        // indexed by StateExportRegion
+    uint16_t frameWidth;
+    uint16_t frameHeight;
+    uint16_t frameStride; // bytes per framebuffer line
+    uint16_t frameFormat; // STATE_EXPORT_FORMAT_RGB565
+    uint8_t padding[64];
+};
+
+enum StateExportRegion {
+    STATE_EXPORT_EWRAM = 0,     // 0x02000000, 256 KiB
+    STATE_EXPORT_IWRAM = 1,     // 0x03000000, 32 KiB
+    STATE_EXPORT_IO = 2,        // 0x04000000, 1 KiB as latched by the core
+    STATE_EXPORT_FRAMEBUFFER = 3,
+};
+
+constexpr uint32_t STATE_EXPORT_MAGIC = 0x5853424A; // "JBSX" in memory
+constexpr uint16_t STATE_EXPORT_VERSION = 1;
+constexpr uint16_t STATE_EXPORT_FORMAT_RGB565 = 1;
+// Abstract socket (leading NUL) that hands the region's fd to a connecting
+// process with SCM_RIGHTS, followed by the region size as a uint32. Only
+// processes running as the app, root or shell are served. The fd can only be
+// mapped read-only; tools/state_export_reader.cpp is a reference reader.
+constexpr char STATE_EXPORT_SOCKET[] = "jboy.state_export";
+
+static_assert(sizeof(StateExportHeader) == 128, "StateExportHeader layout is shared with external readers");
+
+// Publishes emulated memory and the converted framebuffer to a memfd once per
+// frame, so external tools can follow the game without screenshots or JNI.
+// Readers map the fd read-only and see every frame in place; the only copy is
+// the writer's, about 360 KiB per frame while enabled. Called with the core
+// lock held.
+class StateExport {
+public:
+    ~StateExport();
+
+    // Creates the region and starts the socket server. Returns false when no
+    // shared memory could be created and made read-only for other mappings;
+    // the socket is best effort.
+    bool enable();
+    void disable();
+    bool isEnabled() const { return m_map != nullptr; }
+    // A new descriptor for the region (caller closes it), or -1 when disabled.
+    int duplicateFd() const;
+    // Restarts the frame counter for a new ROM.
+    void resetFrames() { m_frames = 0; }
+    void publish(struct mCore* core, const uint8_t* frame, int width, int height);
+    int64_t getLastPublishUs() const { return m_lastPublishUs; }
+
+private:
+    void serveLoop();
+
+    int m_fd = -1;
+    uint8_t* m_map = nullptr;
+    size_t m_mapSize = 0;
+    int m_listenFd = -1;
+    std::thread m_server;
+    uint64_t m_frames = 0;
+    int64_t m_lastPublishUs = 0;
+};
+
+#endif // STATE_EXPORT_H
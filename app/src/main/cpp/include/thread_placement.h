@@ -0,0 +1,51 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include <cstdint>
+#include <sys/types.h>
+
+// CPU placement and scheduling priority for the emulation and audio threads.
+//
+// Performance cores are found once from /sys/devices/system/cpu/cpuN/
+// cpu_capacity, falling back to cpufreq/cpuinfo_max_freq: every CPU within
+// 3/4 of the fastest counts. The emulation thread is pinned to them and gets
+// an urgent-display nice value; the audio writer asks for SCHED_FIFO and
+// settles for the urgent-audio nice value when the kernel refuses. Uniform
+// CPUs, unreadable sysfs or a refused syscall leave the thread as it was.
+class ThreadPlacement {
+public:
+    enum AudioPolicy {
+        AUDIO_UNCHANGED = 0,
+        AUDIO_NICE = 1,
+        AUDIO_FIFO = 2,
+    };
+
+    // Process-wide switch; the emulation thread follows on its next frame.
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    // Called on the audio writer thread when it starts. Returns an AudioPolicy.
+    static int promoteAudioThread();
+    static int getAudioPolicy();
+    static int getPerformanceCoreCount();
+    // CPUs whose capacity score is within 3/4 of the fastest, as a bit mask.
+    static uint64_t selectPerformanceCores(const long* scores, int count);
+
+    // Called with the core lock held before every frame, on the emulation thread.
+    void onEmulationFrame();
+    bool isPinned() const { return m_pinned; }
+    int getLastCpu() const { return m_lastCpu; }
+    // Frames that ran on a CPU outside the performance set.
+    int64_t getOffPerformanceFrames() const { return m_offPerformanceFrames; }
+
+private:
+    void placeCurrentThread(bool enabled);
+
+    pid_t m_tid = 0;
+    uint64_t m_generation = 0;
+    bool m_pinned = false;
+    bool m_boosted = false;
+    int m_lastCpu = -1;
+    int64_t m_offPerformanceFrames = 0;
+};
+
+#endif // THREAD_PLACEMENT_H
@@ -0,0 +1,40 @@
+#ifndef THUMBNAIL_GENERATOR_H
+#define THUMBNAIL_GENERATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Batch job that boots ROMs headlessly and saves a downscaled screenshot.
+//
+// Each ROM gets its own short-lived mCore, independent of the playing core:
+// no BIOS, no save file, no audio output. PPU rendering is skipped for every
+// frame but the last, so a boot costs little more than the CPU emulation.
+// The picture is reduced with a 2x2 box filter (NEON/SSE2) per halving step
+// and written as PNG. Workers pull ROMs from a shared index, so a batch
+// spreads across `threads` cores; run() blocks, callers keep it off the UI
+// thread.
+class ThumbnailGenerator {
+public:
+    struct Job {
+        std::string romPath;
+        std::string outPath;
+    };
+
+    // Returns how many thumbnails were written. One batch runs at a time.
+    int run(const std::vector<Job>& jobs, int frames, int halvings, int threads);
+    // Stops a running batch after the ROMs already in progress.
+    void cancel();
+
+private:
+    struct Scratch;
+
+    bool renderOne(const Job& job, int frames, int halvings, Scratch& scratch);
+
+    std::mutex m_runMutex;
+    std::atomic<bool> m_cancelled{false};
+};
+
+#endif // THUMBNAIL_GENERATOR_H
@@ -0,0 +1,51 @@
+#ifndef TUNING_DATABASE_H
+#define TUNING_DATABASE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct mCore;
+
+// Per-ROM tuning that outlives the process.
+//
+// Entries are keyed by the 4-character cartridge game code plus the ROM CRC32,
+// so revisions and hacks that share a code keep separate records. Loop
+// addresses found by mGBA's idle-loop detection are captured when a session
+// ends and written to a small text file; the next load applies them straight
+// after reset. A built-in seed table adds per-title hints that apply to every
+// revision (CRC 0). All methods are called with the core lock held.
+class TuningDatabase {
+public:
+    // Matches the idle loop setting order (remove / detect / ignore).
+    enum IdleHint {
+        IDLE_HINT_DEFAULT = 0,
+        IDLE_HINT_DETECT,
+        IDLE_HINT_IGNORE
+    };
+
+    struct Entry {
+        char gameCode[5];
+        uint32_t crc32;
+        uint32_t idleLoop;
+        int idleHint;
+    };
+
+    // Loads `path`; an empty path keeps the database in memory only.
+    void open(const std::string& path);
+    bool lookup(const char* gameCode, uint32_t crc32, Entry* out) const;
+    // Called after every reset. userIdleMode follows JboyCore::m_idleLoopMode.
+    void apply(struct mCore* core, uint32_t crc32, int userIdleMode) const;
+    // Records the loop mGBA currently uses; writes the file when it changed.
+    void capture(struct mCore* core, uint32_t crc32);
+
+private:
+    static bool readGameCode(struct mCore* core, char out[5]);
+    Entry* findExact(const char* gameCode, uint32_t crc32);
+    bool save() const;
+
+    std::string m_path;
+    std::vector<Entry> m_entries;
+};
+
+#endif // TUNING_DATABASE_H
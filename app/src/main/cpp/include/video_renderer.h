@@ -3,33 +3,78 @@
 
 #include <GLES2/gl2.h>
 #include <cstdint>
+#include <string>
 
+#include "video_renderer_util.h"
+
+// 后处理预设，与 VideoRenderer.kt 中的 ShaderPreset 保持一致
+enum ShaderPreset {
+    SHADER_PRESET_NEAREST = 0,
+    SHADER_PRESET_LINEAR,
+    SHADER_PRESET_CRT,
+    SHADER_PRESET_XBR,
+    SHADER_PRESET_LCD,
+    SHADER_PRESET_COUNT
+};
+
+// 多 pass 着色器管线：每个中间 pass 渲染到 FBO，最后一个 pass 输出到屏幕。
+// 所有方法都必须在 GL 线程调用。
 class VideoRenderer {
 public:
+    static constexpr int MAX_PASSES = 3;
+
     VideoRenderer();
     ~VideoRenderer();
-    
-    bool initialize();
+
+    // cacheDir 用于保存 program binary，为空时不缓存
+    bool initialize(const std::string& cacheDir);
     void shutdown();
-    void renderFrame(const uint8_t* frameBuffer);
+    void setPreset(int preset);
+    void setScaleMode(int mode);
     void updateScreenSize(int width, int height);
-    
+    // frame 为 RGB565 小端数据；dirtyLines 每行一位，只上传置位的行，为空时整帧上传
+    void renderFrame(const uint8_t* frame, int width, int height, const uint32_t* dirtyLines);
+
 private:
-    bool compileShader(GLuint& shader, GLenum type, const char* source);
-    bool createProgram();
-    
-    GLuint m_program = 0;
-    GLuint m_texture = 0;
+    struct PassState {
+        GLuint program = 0;
+        GLint textureLoc = -1;
+        GLint sourceSizeLoc = -1;
+        GLint outputSizeLoc = -1;
+        GLuint framebuffer = 0;
+        GLuint texture = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    bool buildPipeline();
+    void releasePipeline();
+    bool ensurePassTargets(int sourceWidth, int sourceHeight);
+    void uploadSource(const uint8_t* frame, int width, int height, const uint32_t* dirtyLines);
+    GLuint loadProgram(const char* fragmentSource);
+    GLuint loadCachedProgram(const std::string& path);
+    void storeCachedProgram(const std::string& path, GLuint program);
+    std::string getCachePath(const char* fragmentSource) const;
+
+    static bool compileShader(GLuint& shader, GLenum type, const char* const* sources, int count);
+
+    std::string m_cacheDir;
+    std::string m_driverId;
+    bool m_binaryCacheSupported = false;
+
+    GLuint m_sourceTexture = 0;
+    int m_sourceWidth = 0;
+    int m_sourceHeight = 0;
     GLuint m_vertexBuffer = 0;
-    GLint m_positionLoc = -1;
-    GLint m_texCoordLoc = -1;
-    GLint m_textureLoc = -1;
-    
+
+    int m_preset = SHADER_PRESET_NEAREST;
+    int m_scaleMode = SCALE_MODE_FIT;
+    bool m_pipelineReady = false;
+    int m_passCount = 0;
+    PassState m_passes[MAX_PASSES];
+
     int m_screenWidth = 0;
     int m_screenHeight = 0;
-    
-    // RGB565帧缓冲区
-    uint16_t m_frameBuffer[160 * 144];
 };
 
 #endif // VIDEO_RENDERER_H
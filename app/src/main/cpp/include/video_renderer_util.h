@@ -0,0 +1,45 @@
+#ifndef VIDEO_RENDERER_UTIL_H
+#define VIDEO_RENDERER_UTIL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// VideoRenderer 中不依赖 GL 的部分：视口计算和 program binary 缓存的文件格式
+
+// 缩放模式，与 VideoRenderer.kt 中的 ScaleMode 保持一致
+enum ScaleMode {
+    SCALE_MODE_FIT = 0,
+    SCALE_MODE_FILL,
+    SCALE_MODE_STRETCH,
+    SCALE_MODE_INTEGER
+};
+
+// GL 视口，原点在左下角
+struct Viewport {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// 最后一个 pass 在屏幕上的视口，居中放置。FILL 的视口会超出屏幕，超出部分被裁掉；
+// INTEGER 在屏幕放不下 1 倍画面时仍按 1 倍输出并裁掉四周
+Viewport computeViewport(int scaleMode, int screenWidth, int screenHeight, int sourceWidth, int sourceHeight);
+
+// <hash>.bin 布局：头 + 驱动返回的二进制
+struct ProgramCacheHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint32_t length;
+};
+
+constexpr uint32_t PROGRAM_CACHE_MAGIC = 0x50534A42; // "BJSP"
+
+// 文件名是各段文本（着色器源码、驱动标识）的 FNV-1a 哈希，任何一段变化都会换一个文件
+std::string programCachePath(const std::string& cacheDir, const char* const* parts, int count);
+ProgramCacheHeader makeProgramCacheHeader(uint32_t format, uint32_t length);
+// 魔数和长度都对得上才返回 true，二进制紧跟在头后面
+bool parseProgramCacheHeader(const uint8_t* data, size_t size, ProgramCacheHeader* header);
+
+#endif // VIDEO_RENDERER_UTIL_H
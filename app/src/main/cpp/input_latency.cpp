@@ -0,0 +1,161 @@
+#include "input_latency.h"
+
+#include <cstring>
+
+#include <mgba/core/core.h>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#define LOG_TAG "JBOY_InputLatency"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+void InputLatency::attach(struct mCore* core) {
+    if (!core || !core->addCoreCallbacks) {
+        return;
+    }
+    memset(&m_callbacks, 0, sizeof(m_callbacks));
+    m_callbacks.context = this;
+    m_callbacks.keysRead = onKeysRead;
+    core->addCoreCallbacks(core, &m_callbacks);
+}
+
+void InputLatency::setMode(int mode, int probeButtons) {
+    m_mode = mode == MODE_MEASURE || mode == MODE_PROBE ? mode : MODE_OFF;
+    m_probeButtons = probeButtons;
+    m_probeState = PROBE_WAIT_QUIET;
+    m_probeFrames = 0;
+    m_lastFrameQuiet = false;
+    m_pendingCount = 0;
+    memset(m_counters, 0, sizeof(m_counters));
+    memset(m_readHistogram, 0, sizeof(m_readHistogram));
+    memset(m_presentHistogram, 0, sizeof(m_presentHistogram));
+    memset(m_probeHistogram, 0, sizeof(m_probeHistogram));
+    LOGD("Latency mode %d (probe buttons 0x%x)", m_mode, probeButtons);
+}
+
+void InputLatency::onInputChanged(int64_t inputNs) {
+    if (m_mode != MODE_MEASURE) {
+        return;
+    }
+    if (m_pendingCount == MAX_PENDING) {
+        ++m_counters[m_pending[0].readFrame < 0 ? REPORT_UNREAD : REPORT_UNPRESENTED];
+        removePending(0);
+    }
+    m_pending[m_pendingCount++] = Event{inputNs, m_frame, -1};
+    ++m_counters[REPORT_EVENTS];
+}
+
+void InputLatency::onKeysRead(void* context) {
+    InputLatency* self = static_cast<InputLatency*>(context);
+    if (self->m_mode != MODE_MEASURE || self->m_pendingCount == 0) {
+        return;
+    }
+    // Games poll KEYINPUT many times per frame; only the first read after a change counts.
+    const int64_t nowNs = nowNanos();
+    for (int i = 0; i < self->m_pendingCount; ++i) {
+        Event& event = self->m_pending[i];
+        if (event.readFrame < 0) {
+            event.readFrame = self->m_frame;
+            addTime(self->m_readHistogram, nowNs - event.inputNs);
+        }
+    }
+}
+
+int InputLatency::beginFrame() {
+    if (m_mode != MODE_PROBE) {
+        return -1;
+    }
+    if (m_probeState == PROBE_WAIT_QUIET) {
+        if (m_lastFrameQuiet) {
+            m_probeState = PROBE_PRESSED;
+            m_probeFrames = 0;
+        } else if (++m_probeFrames >= PROBE_TIMEOUT_FRAMES) {
+            ++m_counters[REPORT_PROBES_SKIPPED];
+            m_probeFrames = 0;
+        }
+    }
+    return m_probeState == PROBE_PRESSED ? m_probeButtons : 0;
+}
+
+void InputLatency::endFrame(bool rendered, bool changed) {
+    ++m_frame;
+    m_lastFrameQuiet = rendered && !changed;
+    if (m_mode == MODE_MEASURE) {
+        for (int i = 0; i < m_pendingCount;) {
+            const Event& event = m_pending[i];
+            if (event.readFrame < 0 && m_frame - event.inputFrame > MAX_UNREAD_FRAMES) {
+                ++m_counters[REPORT_UNREAD];
+            } else if (event.readFrame >= 0 && m_frame - event.readFrame > MAX_UNPRESENTED_FRAMES) {
+                ++m_counters[REPORT_UNPRESENTED];
+            } else {
+                ++i;
+                continue;
+            }
+            removePending(i);
+        }
+        return;
+    }
+    if (m_mode != MODE_PROBE) {
+        return;
+    }
+    if (m_probeState == PROBE_PRESSED) {
+        ++m_probeFrames;
+        if (rendered && changed) {
+            // A response within the press frame itself counts as one frame.
+            const int bucket = m_probeFrames < FRAME_BUCKETS ? m_probeFrames - 1 : FRAME_BUCKETS - 1;
+            ++m_probeHistogram[bucket];
+            ++m_counters[REPORT_PROBES];
+        } else if (m_probeFrames < PROBE_TIMEOUT_FRAMES) {
+            return;
+        } else {
+            ++m_counters[REPORT_PROBES_SKIPPED];
+        }
+        m_probeState = PROBE_RELEASED;
+        m_probeFrames = 0;
+    } else if (m_probeState == PROBE_RELEASED && ++m_probeFrames >= PROBE_SETTLE_FRAMES) {
+        m_probeState = PROBE_WAIT_QUIET;
+        m_probeFrames = 0;
+    }
+}
+
+void InputLatency::onHandoff(int64_t nowNs) {
+    if (m_mode != MODE_MEASURE) {
+        return;
+    }
+    // Only events whose reading frame has finished can be in this picture.
+    for (int i = 0; i < m_pendingCount;) {
+        const Event& event = m_pending[i];
+        if (event.readFrame >= 0 && event.readFrame < m_frame) {
+            addTime(m_presentHistogram, nowNs - event.inputNs);
+            removePending(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void InputLatency::report(int64_t* out, int count) const {
+    int64_t values[REPORT_SIZE];
+    memcpy(values, m_counters, sizeof(m_counters));
+    values[REPORT_MODE] = m_mode;
+    memcpy(values + REPORT_HEADER_SIZE, m_readHistogram, sizeof(m_readHistogram));
+    memcpy(values + REPORT_HEADER_SIZE + TIME_BUCKETS, m_presentHistogram, sizeof(m_presentHistogram));
+    memcpy(values + REPORT_HEADER_SIZE + 2 * TIME_BUCKETS, m_probeHistogram, sizeof(m_probeHistogram));
+    for (int i = 0; i < count && i < REPORT_SIZE; ++i) {
+        out[i] = values[i];
+    }
+}
+
+void InputLatency::addTime(int64_t* histogram, int64_t ns) {
+    const int64_t bucket = ns > 0 ? ns / 1000000 : 0;
+    ++histogram[bucket < TIME_BUCKETS ? bucket : TIME_BUCKETS - 1];
+}
+
+void InputLatency::removePending(int index) {
+    for (int i = index + 1; i < m_pendingCount; ++i) {
+        m_pending[i - 1] = m_pending[i];
+    }
+    --m_pendingCount;
+}
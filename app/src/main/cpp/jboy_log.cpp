@@ -0,0 +1,194 @@
+#include "jboy_log.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#if defined(__ANDROID__)
+#include <android/log.h>
+#endif
+
+namespace {
+
+constexpr uint64_t SLOT_COUNT = 256; // power of two
+constexpr size_t MESSAGE_SIZE = 240;
+
+struct Slot {
+    // Bounded MPMC sequence: == index when free, index + 1 once published.
+    std::atomic<uint64_t> sequence;
+    int priority;
+    const char* tag; // LOG_TAG literals live for the whole process.
+    char text[MESSAGE_SIZE];
+};
+
+class Logger {
+public:
+    Logger() {
+        for (uint64_t i = 0; i < SLOT_COUNT; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    void write(int priority, const char* tag, const char* format, va_list args) {
+        std::call_once(m_started, [this] {
+            // Never joined: the logger lives until the process exits, and the
+            // atexit flush writes out whatever the thread has not reached.
+            std::thread(&Logger::writerLoop, this).detach();
+            atexit(jboyLogFlush);
+        });
+        uint64_t position = m_head.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &m_slots[position & (SLOT_COUNT - 1)];
+            const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const int64_t diff = static_cast<int64_t>(sequence - position);
+            if (diff == 0) {
+                if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                wakeWriter();
+                return;
+            } else {
+                position = m_head.load(std::memory_order_relaxed);
+            }
+        }
+        slot->priority = priority;
+        slot->tag = tag;
+        vsnprintf(slot->text, sizeof(slot->text), format, args);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        wakeWriter();
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(m_drainMutex);
+        drainLocked();
+    }
+
+    int64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    // Only the first message after the writer went idle pays for the mutex and
+    // the futex wake; messages logged while it drains find m_sleeping clear.
+    void wakeWriter() {
+        // Pairs with the fence in writerLoop: either the writer's re-check sees
+        // this message, or this sees m_sleeping set.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_relaxed) && m_sleeping.exchange(false, std::memory_order_relaxed)) {
+            // The writer holds m_sleepMutex until it is blocked in wait(), so
+            // the notify cannot fall between its re-check and the wait.
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_wake.notify_one();
+        }
+    }
+
+    void writerLoop() {
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(m_drainMutex);
+                if (drainLocked() > 0) {
+                    continue;
+                }
+            }
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // A message published before the store above saw the writer awake
+            // and did not wake it; it must be in the ring now.
+            if (hasPending()) {
+                m_sleeping.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            m_wake.wait(lock, [this] { return !m_sleeping.load(std::memory_order_relaxed); });
+        }
+    }
+
+    // Whether a drain would write anything.
+    bool hasPending() {
+        std::lock_guard<std::mutex> lock(m_drainMutex);
+        const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        return m_slots[tail & (SLOT_COUNT - 1)].sequence.load(std::memory_order_acquire) == tail + 1 ||
+               m_dropped.load(std::memory_order_relaxed) != m_reportedDropped;
+    }
+
+    // Single consumer: the writer thread or a flushing caller, under m_drainMutex.
+    int drainLocked() {
+        int written = 0;
+        const int64_t dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped != m_reportedDropped) {
+            char text[64];
+            snprintf(text, sizeof(text), "%lld log messages dropped",
+                     static_cast<long long>(dropped - m_reportedDropped));
+            output(JBOY_LOG_WARN, "JBOY_Log", text);
+            m_reportedDropped = dropped;
+            ++written;
+        }
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = m_slots[tail & (SLOT_COUNT - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+                break;
+            }
+            output(slot.priority, slot.tag, slot.text);
+            slot.sequence.store(tail + SLOT_COUNT, std::memory_order_release);
+            m_tail.store(++tail, std::memory_order_relaxed);
+            ++written;
+        }
+#if !defined(__ANDROID__)
+        if (written > 0) {
+            fflush(stdout);
+        }
+#endif
+        return written;
+    }
+
+    static void output(int priority, const char* tag, const char* text) {
+#if defined(__ANDROID__)
+        __android_log_write(priority, tag, text);
+#else
+        static const char LETTERS[] = "??VDIWEF";
+        const char letter = priority >= 0 && priority < 8 ? LETTERS[priority] : '?';
+        fprintf(stdout, "%c/%s: %s\n", letter, tag, text);
+#endif
+    }
+
+    Slot m_slots[SLOT_COUNT];
+    std::atomic<uint64_t> m_head{0};
+    std::atomic<uint64_t> m_tail{0};
+    std::atomic<int64_t> m_dropped{0};
+    int64_t m_reportedDropped = 0;
+    std::atomic<bool> m_sleeping{false};
+    std::once_flag m_started;
+    // Taken in this order when both are held.
+    std::mutex m_sleepMutex;
+    std::mutex m_drainMutex;
+    std::condition_variable m_wake;
+};
+
+// Leaked on purpose: static destructors must not race the detached writer.
+Logger& logger() {
+    static Logger* instance = new Logger();
+    return *instance;
+}
+
+} // namespace
+
+void jboyLogWrite(int priority, const char* tag, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    logger().write(priority, tag, format, args);
+    va_end(args);
+}
+
+void jboyLogFlush() {
+    logger().flush();
+}
+
+int64_t jboyLogDroppedCount() {
+    return logger().dropped();
+}
@@ -0,0 +1,173 @@
+#include "native_util.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+int64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static bool writeAll(int fd, const void* data, size_t size) {
+    const uint8_t* cursor = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t written = write(fd, cursor, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        cursor += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool writeFileAtomic(const std::string& path, const FileChunk* chunks, size_t count) {
+    if (path.empty()) {
+        return false;
+    }
+    const std::string tempPath = path + ".tmp";
+    const int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; ++i) {
+        if (chunks[i].size) {
+            ok = writeAll(fd, chunks[i].data, chunks[i].size);
+        }
+    }
+    if (ok) {
+        ok = fsync(fd) == 0;
+    }
+    if (close(fd) != 0) {
+        ok = false;
+    }
+    if (ok) {
+        ok = rename(tempPath.c_str(), path.c_str()) == 0;
+    }
+    if (!ok) {
+        unlink(tempPath.c_str());
+    }
+    return ok;
+}
+
+bool writeFileAtomic(const std::string& path, const void* data, size_t size) {
+    const FileChunk chunk = { data, size };
+    return writeFileAtomic(path, &chunk, 1);
+}
+
+bool readWholeFile(const std::string& path, std::vector<uint8_t>& out) {
+    out.clear();
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0) {
+        close(fd);
+        return false;
+    }
+    out.resize(static_cast<size_t>(st.st_size));
+    size_t offset = 0;
+    while (offset < out.size()) {
+        const ssize_t got = read(fd, out.data() + offset, out.size() - offset);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            break;
+        }
+        offset += static_cast<size_t>(got);
+    }
+    close(fd);
+    out.resize(offset);
+    return offset == static_cast<size_t>(st.st_size);
+}
+
+static void putLe16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static void putLe32(uint8_t* p, uint32_t v) {
+    putLe16(p, static_cast<uint16_t>(v));
+    putLe16(p + 2, static_cast<uint16_t>(v >> 16));
+}
+
+void buildWavHeader(uint8_t* header, int sampleRate, int channels, uint32_t dataBytes) {
+    const uint32_t blockAlign = static_cast<uint32_t>(channels) * 2;
+    memcpy(header, "RIFF", 4);
+    putLe32(header + 4, 36 + dataBytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    putLe32(header + 16, 16);
+    putLe16(header + 20, 1); // PCM
+    putLe16(header + 22, static_cast<uint16_t>(channels));
+    putLe32(header + 24, static_cast<uint32_t>(sampleRate));
+    putLe32(header + 28, static_cast<uint32_t>(sampleRate) * blockAlign);
+    putLe16(header + 32, static_cast<uint16_t>(blockAlign));
+    putLe16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    putLe32(header + 40, dataBytes);
+}
+
+static void putBe32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+static void appendPngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+    const size_t offset = out.size();
+    out.resize(offset + 12 + size);
+    uint8_t* chunk = out.data() + offset;
+    putBe32(chunk, static_cast<uint32_t>(size));
+    memcpy(chunk + 4, type, 4);
+    if (size) {
+        memcpy(chunk + 8, data, size);
+    }
+    // The CRC covers the type and the payload.
+    const uLong crc = crc32(0, chunk + 4, static_cast<uInt>(size + 4));
+    putBe32(chunk + 8 + size, static_cast<uint32_t>(crc));
+}
+
+bool encodePngRgb(const uint8_t* rgb, int width, int height, int level, std::vector<uint8_t>& out) {
+    if (!rgb || width <= 0 || height <= 0) {
+        return false;
+    }
+    const size_t stride = static_cast<size_t>(width) * 3;
+    const size_t rawSize = (stride + 1) * static_cast<size_t>(height);
+    std::vector<uint8_t> raw(rawSize);
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = raw.data() + y * (stride + 1);
+        row[0] = 0; // filter: none
+        memcpy(row + 1, rgb + y * stride, stride);
+    }
+    uLongf packedSize = compressBound(rawSize);
+    std::vector<uint8_t> packed(packedSize);
+    if (compress2(packed.data(), &packedSize, raw.data(), rawSize, level) != Z_OK) {
+        return false;
+    }
+
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.assign(kSignature, kSignature + sizeof(kSignature));
+    uint8_t ihdr[13] = {};
+    putBe32(ihdr, static_cast<uint32_t>(width));
+    putBe32(ihdr + 4, static_cast<uint32_t>(height));
+    ihdr[8] = 8; // bit depth
+    ihdr[9] = 2; // truecolor RGB
+    appendPngChunk(out, "IHDR", ihdr, sizeof(ihdr));
+    appendPngChunk(out, "IDAT", packed.data(), packedSize);
+    appendPngChunk(out, "IEND", nullptr, 0);
+    return true;
+}
@@ -0,0 +1,354 @@
+#include "ram_search.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <mgba/core/core.h>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define JBOY_RAMSEARCH_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define JBOY_RAMSEARCH_SSE 1
+#endif
+
+#define LOG_TAG "JBOY_RamSearch"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+constexpr uint32_t EWRAM_BASE = 0x02000000;
+constexpr uint32_t IWRAM_BASE = 0x03000000;
+constexpr size_t EWRAM_SIZE = 256 * 1024;
+constexpr size_t IWRAM_SIZE = 32 * 1024;
+constexpr size_t TOTAL_SIZE = EWRAM_SIZE + IWRAM_SIZE;
+// A bitset word covers 64 values, so up to 256 bytes at 32 bits.
+static_assert(TOTAL_SIZE % (64 * 4) == 0, "regions must fill whole bitset words");
+// Words compared between clock reads.
+constexpr size_t CHECK_INTERVAL = 64;
+
+enum CompareOp {
+    OP_EQ = 0,
+    OP_NE,
+    OP_GT,
+    OP_LT,
+};
+
+#if JBOY_RAMSEARCH_NEON
+// One bit per byte lane, like SSE2's movemask.
+uint32_t moveMask(uint8x16_t mask) {
+    static const uint8_t kWeights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t bits = vandq_u8(mask, vld1q_u8(kWeights));
+    uint8x8_t sum = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+    sum = vpadd_u8(sum, sum);
+    sum = vpadd_u8(sum, sum);
+    return vget_lane_u8(sum, 0) | (static_cast<uint32_t>(vget_lane_u8(sum, 1)) << 8);
+}
+
+template <typename T> uint8x16_t vectorEq(uint8x16_t a, uint8x16_t b);
+template <typename T> uint8x16_t vectorGt(uint8x16_t a, uint8x16_t b);
+
+template <> uint8x16_t vectorEq<uint8_t>(uint8x16_t a, uint8x16_t b) {
+    return vceqq_u8(a, b);
+}
+template <> uint8x16_t vectorGt<uint8_t>(uint8x16_t a, uint8x16_t b) {
+    return vcgtq_u8(a, b);
+}
+template <> uint8x16_t vectorEq<uint16_t>(uint8x16_t a, uint8x16_t b) {
+    return vreinterpretq_u8_u16(vceqq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+}
+template <> uint8x16_t vectorGt<uint16_t>(uint8x16_t a, uint8x16_t b) {
+    return vreinterpretq_u8_u16(vcgtq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+}
+template <> uint8x16_t vectorEq<uint32_t>(uint8x16_t a, uint8x16_t b) {
+    return vreinterpretq_u8_u32(vceqq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)));
+}
+template <> uint8x16_t vectorGt<uint32_t>(uint8x16_t a, uint8x16_t b) {
+    return vreinterpretq_u8_u32(vcgtq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)));
+}
+
+// Byte mask of the lanes of one 16-byte block that pass `op`.
+template <typename T>
+uint32_t blockMask(const uint8_t* cur, const uint8_t* ref, int op) {
+    const uint8x16_t a = vld1q_u8(cur);
+    const uint8x16_t b = vld1q_u8(ref);
+    switch (op) {
+    case OP_EQ:
+        return moveMask(vectorEq<T>(a, b));
+    case OP_NE:
+        return moveMask(vmvnq_u8(vectorEq<T>(a, b)));
+    case OP_GT:
+        return moveMask(vectorGt<T>(a, b));
+    default:
+        return moveMask(vectorGt<T>(b, a));
+    }
+}
+#elif JBOY_RAMSEARCH_SSE
+template <typename T> __m128i vectorEq(__m128i a, __m128i b);
+template <typename T> __m128i vectorGt(__m128i a, __m128i b);
+
+// SSE2 compares are signed; flipping the sign bit makes them unsigned.
+template <> __m128i vectorEq<uint8_t>(__m128i a, __m128i b) {
+    return _mm_cmpeq_epi8(a, b);
+}
+template <> __m128i vectorGt<uint8_t>(__m128i a, __m128i b) {
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    return _mm_cmpgt_epi8(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+}
+template <> __m128i vectorEq<uint16_t>(__m128i a, __m128i b) {
+    return _mm_cmpeq_epi16(a, b);
+}
+template <> __m128i vectorGt<uint16_t>(__m128i a, __m128i b) {
+    const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+    return _mm_cmpgt_epi16(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+}
+template <> __m128i vectorEq<uint32_t>(__m128i a, __m128i b) {
+    return _mm_cmpeq_epi32(a, b);
+}
+template <> __m128i vectorGt<uint32_t>(__m128i a, __m128i b) {
+    const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    return _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+}
+
+template <typename T>
+uint32_t blockMask(const uint8_t* cur, const uint8_t* ref, int op) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ref));
+    switch (op) {
+    case OP_EQ:
+        return _mm_movemask_epi8(vectorEq<T>(a, b));
+    case OP_NE:
+        return _mm_movemask_epi8(vectorEq<T>(a, b)) ^ 0xFFFF;
+    case OP_GT:
+        return _mm_movemask_epi8(vectorGt<T>(a, b));
+    default:
+        return _mm_movemask_epi8(vectorGt<T>(b, a));
+    }
+}
+#else
+template <typename T>
+uint32_t blockMask(const uint8_t* cur, const uint8_t* ref, int op) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < 16; i += sizeof(T)) {
+        T a;
+        T b;
+        memcpy(&a, cur + i, sizeof(T));
+        memcpy(&b, ref + i, sizeof(T));
+        bool pass;
+        switch (op) {
+        case OP_EQ:
+            pass = a == b;
+            break;
+        case OP_NE:
+            pass = a != b;
+            break;
+        case OP_GT:
+            pass = a > b;
+            break;
+        default:
+            pass = a < b;
+            break;
+        }
+        if (pass) {
+            mask |= ((1u << sizeof(T)) - 1) << i;
+        }
+    }
+    return mask;
+}
+#endif
+
+// Keeps one bit per lane of a 16-bit byte mask.
+template <typename T> uint32_t laneBits(uint32_t bytes);
+
+template <> uint32_t laneBits<uint8_t>(uint32_t bytes) {
+    return bytes;
+}
+template <> uint32_t laneBits<uint16_t>(uint32_t bytes) {
+    uint32_t x = bytes & 0x5555;
+    x = (x | (x >> 1)) & 0x3333;
+    x = (x | (x >> 2)) & 0x0F0F;
+    return (x | (x >> 4)) & 0x00FF;
+}
+template <> uint32_t laneBits<uint32_t>(uint32_t bytes) {
+    uint32_t x = bytes & 0x1111;
+    x = (x | (x >> 3)) & 0x0303;
+    return (x | (x >> 6)) & 0x000F;
+}
+
+// Pass mask for the 64 values starting at `cur`; refStride 0 repeats one operand block.
+template <typename T>
+uint64_t wordMask(const uint8_t* cur, const uint8_t* ref, size_t refStride, int op) {
+    constexpr int LANES = 16 / sizeof(T);
+    uint64_t mask = 0;
+    for (int block = 0; block < 64 / LANES; ++block) {
+        const uint64_t bits = laneBits<T>(blockMask<T>(cur + block * 16, ref + block * refStride, op));
+        mask |= bits << (block * LANES);
+    }
+    return mask;
+}
+
+uint32_t readValue(const std::vector<uint8_t>& data, size_t offset, int width) {
+    uint32_t value = 0;
+    memcpy(&value, data.data() + offset, width);
+    return value;
+}
+
+} // namespace
+
+bool RamSearch::start(struct mCore* core, int width) {
+    reset();
+    if (width != 1 && width != 2 && width != 4) {
+        return false;
+    }
+    if (!capture(core, m_previous)) {
+        LOGE("Work RAM is not accessible");
+        m_previous.clear();
+        return false;
+    }
+    m_width = width;
+    m_words = TOTAL_SIZE / width / 64;
+    m_bits.assign(m_words, ~0ull);
+    m_passWord = m_words;
+    m_candidates = static_cast<int64_t>(TOTAL_SIZE / width);
+    return true;
+}
+
+bool RamSearch::filter(struct mCore* core, int relation, uint32_t value, bool finishNow) {
+    if (!isActive() || relation < EQUAL || relation > DECREASED) {
+        return false;
+    }
+    // Passes must apply in order; finish the queued one first.
+    finish();
+    if (!capture(core, m_current)) {
+        return false;
+    }
+    m_passRelation = relation;
+    for (size_t i = 0; i < sizeof(m_operand); i += m_width) {
+        memcpy(m_operand + i, &value, m_width);
+    }
+    m_passWord = 0;
+    m_passCount = 0;
+    m_passNs = 0;
+    runSlice(finishNow ? -1 : SLICE_NS);
+    return true;
+}
+
+void RamSearch::onFrame() {
+    if (isFiltering()) {
+        runSlice(SLICE_NS);
+    }
+}
+
+void RamSearch::finish() {
+    if (isFiltering()) {
+        runSlice(-1);
+    }
+}
+
+void RamSearch::reset() {
+    m_width = 0;
+    m_words = 0;
+    m_passWord = 0;
+    m_candidates = 0;
+    std::vector<uint64_t>().swap(m_bits);
+    std::vector<uint8_t>().swap(m_previous);
+    std::vector<uint8_t>().swap(m_current);
+}
+
+std::vector<RamSearch::Result> RamSearch::results(int max) const {
+    std::vector<Result> out;
+    if (!isActive() || isFiltering()) {
+        return out;
+    }
+    // Before the first filter there is only one snapshot.
+    const std::vector<uint8_t>& before = m_current.size() == m_previous.size() ? m_current : m_previous;
+    for (size_t word = 0; word < m_words && static_cast<int>(out.size()) < max; ++word) {
+        uint64_t bits = m_bits[word];
+        while (bits && static_cast<int>(out.size()) < max) {
+            const int lane = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            const size_t offset = (word * 64 + lane) * m_width;
+            const uint32_t address = offset < EWRAM_SIZE ? EWRAM_BASE + static_cast<uint32_t>(offset)
+                                                         : IWRAM_BASE + static_cast<uint32_t>(offset - EWRAM_SIZE);
+            out.push_back(Result{address, readValue(m_previous, offset, m_width), readValue(before, offset, m_width)});
+        }
+    }
+    return out;
+}
+
+bool RamSearch::capture(struct mCore* core, std::vector<uint8_t>& out) const {
+    if (!core || !core->listMemoryBlocks || !core->getMemoryBlock) {
+        return false;
+    }
+    out.resize(TOTAL_SIZE);
+    const struct mCoreMemoryBlock* blocks = nullptr;
+    const size_t count = core->listMemoryBlocks(core, &blocks);
+    int found = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const bool ewram = blocks[i].start == EWRAM_BASE;
+        if (!ewram && blocks[i].start != IWRAM_BASE) {
+            continue;
+        }
+        size_t size = 0;
+        const void* data = core->getMemoryBlock(core, blocks[i].id, &size);
+        const size_t expected = ewram ? EWRAM_SIZE : IWRAM_SIZE;
+        if (!data || size < expected) {
+            continue;
+        }
+        memcpy(out.data() + (ewram ? 0 : EWRAM_SIZE), data, expected);
+        ++found;
+    }
+    return found == 2;
+}
+
+void RamSearch::runSlice(int64_t budgetNs) {
+    const int64_t startNs = nowNanos();
+    const size_t bytesPerWord = 64 * static_cast<size_t>(m_width);
+    const bool againstPrevious = m_passRelation >= UNCHANGED;
+    const int op = m_passRelation & 3;
+    const size_t refStride = againstPrevious ? 16 : 0;
+    while (m_passWord < m_words) {
+        const size_t end = std::min(m_passWord + CHECK_INTERVAL, m_words);
+        for (; m_passWord < end; ++m_passWord) {
+            uint64_t& bits = m_bits[m_passWord];
+            if (!bits) {
+                continue;
+            }
+            const size_t offset = m_passWord * bytesPerWord;
+            const uint8_t* cur = m_current.data() + offset;
+            const uint8_t* ref = againstPrevious ? m_previous.data() + offset : m_operand;
+            switch (m_width) {
+            case 1:
+                bits &= wordMask<uint8_t>(cur, ref, refStride, op);
+                break;
+            case 2:
+                bits &= wordMask<uint16_t>(cur, ref, refStride, op);
+                break;
+            default:
+                bits &= wordMask<uint32_t>(cur, ref, refStride, op);
+                break;
+            }
+            m_passCount += __builtin_popcountll(bits);
+        }
+        if (budgetNs >= 0 && nowNanos() - startNs >= budgetNs) {
+            break;
+        }
+    }
+    m_passNs += nowNanos() - startNs;
+    if (m_passWord >= m_words) {
+        finishPass();
+    }
+}
+
+void RamSearch::finishPass() {
+    m_previous.swap(m_current);
+    m_candidates = m_passCount;
+    m_lastPassNs = m_passNs;
+    LOGD("RAM search pass: %lld candidates, %lld us", static_cast<long long>(m_candidates),
+         static_cast<long long>(m_lastPassNs / 1000));
+}
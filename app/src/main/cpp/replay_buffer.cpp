@@ -0,0 +1,383 @@
+#include "replay_buffer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#define LOG_TAG "JBOY_Replay"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+constexpr int LINE_WORDS = ReplayBuffer::FRAME_WIDTH;
+constexpr int MAX_RUN = 128;
+// One control byte per run of up to MAX_RUN literal words, worst case.
+constexpr size_t MAX_LINE_BYTES = LINE_WORDS * 2 + (LINE_WORDS + MAX_RUN - 1) / MAX_RUN;
+
+uint32_t align4(size_t size) {
+    return static_cast<uint32_t>((size + 3) & ~static_cast<size_t>(3));
+}
+
+// Control byte 0nnnnnnn: n+1 zero words. 1nnnnnnn: n+1 literal words follow.
+size_t encodeLine(const uint16_t* words, uint8_t* out) {
+    uint8_t* cursor = out;
+    int i = 0;
+    while (i < LINE_WORDS) {
+        int run = 0;
+        if (words[i] == 0) {
+            while (i + run < LINE_WORDS && run < MAX_RUN && words[i + run] == 0) {
+                ++run;
+            }
+            *cursor++ = static_cast<uint8_t>(run - 1);
+        } else {
+            while (i + run < LINE_WORDS && run < MAX_RUN && words[i + run] != 0) {
+                ++run;
+            }
+            *cursor++ = static_cast<uint8_t>(0x80 | (run - 1));
+            memcpy(cursor, words + i, run * sizeof(uint16_t));
+            cursor += run * sizeof(uint16_t);
+        }
+        i += run;
+    }
+    return static_cast<size_t>(cursor - out);
+}
+
+const uint8_t* decodeLine(const uint8_t* in, const uint8_t* end, uint16_t* words) {
+    int i = 0;
+    while (i < LINE_WORDS && in < end) {
+        const uint8_t control = *in++;
+        int run = (control & 0x7F) + 1;
+        if (run > LINE_WORDS - i) {
+            return nullptr;
+        }
+        if (control & 0x80) {
+            if (end - in < run * 2) {
+                return nullptr;
+            }
+            for (int k = 0; k < run; ++k) {
+                uint16_t value;
+                memcpy(&value, in + k * 2, sizeof(value));
+                words[i + k] ^= value;
+            }
+            in += run * 2;
+        }
+        i += run;
+    }
+    return i == LINE_WORDS ? in : nullptr;
+}
+
+void putBe32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+void putBe16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+bool writeChunk(FILE* file, const char* type, const uint8_t* data, size_t size) {
+    uint8_t header[8];
+    putBe32(header, static_cast<uint32_t>(size));
+    memcpy(header + 4, type, 4);
+    uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+    if (size) {
+        crc = crc32(crc, data, static_cast<uInt>(size));
+    }
+    uint8_t trailer[4];
+    putBe32(trailer, static_cast<uint32_t>(crc));
+    return fwrite(header, 1, 8, file) == 8 &&
+           (size == 0 || fwrite(data, 1, size, file) == size) &&
+           fwrite(trailer, 1, 4, file) == 4;
+}
+
+} // namespace
+
+void ReplayBuffer::configure(int seconds, int memoryKb) {
+    const size_t arenaBytes = seconds > 0 && memoryKb > 0 ? static_cast<size_t>(memoryKb) * 1024 : 0;
+    const size_t indexSize = arenaBytes ? static_cast<size_t>(seconds) * FRAMES_PER_SECOND + KEYFRAME_INTERVAL : 0;
+    if (arenaBytes == m_arena.size() && indexSize == m_index.size()) {
+        return;
+    }
+    // Released outright when disabled, so an idle ring costs nothing.
+    std::vector<uint8_t>(arenaBytes).swap(m_arena);
+    std::vector<IndexEntry>(indexSize).swap(m_index);
+    std::vector<uint8_t>(arenaBytes ? sizeof(RecordHeader) + MAX_LINE_BYTES * FRAME_HEIGHT : 0).swap(m_scratch);
+    clear();
+    LOGD("Replay ring: %d s, %zu KB", seconds, arenaBytes / 1024);
+}
+
+void ReplayBuffer::clear() {
+    m_first = 0;
+    m_count = 0;
+    m_keyframes = 0;
+    m_writePos = 0;
+    m_usedBytes = 0;
+    m_pendingAudioCount = 0;
+    m_framesSinceKey = KEYFRAME_INTERVAL;
+}
+
+void ReplayBuffer::evictOldest() {
+    m_usedBytes -= entryAt(0).size;
+    m_keyframes -= entryAt(0).keyframe ? 1 : 0;
+    m_first = (m_first + 1) % static_cast<int>(m_index.size());
+    --m_count;
+}
+
+bool ReplayBuffer::reserve(uint32_t size, uint32_t* offset) {
+    if (size > m_arena.size()) {
+        return false;
+    }
+    if (m_count == static_cast<int>(m_index.size())) {
+        evictOldest();
+    }
+    if (m_writePos + size > m_arena.size()) {
+        // Records past the write position are from the previous lap, hence oldest.
+        while (m_count > 0 && entryAt(0).offset >= m_writePos) {
+            evictOldest();
+        }
+        m_writePos = 0;
+    }
+    while (m_count > 0) {
+        const IndexEntry& oldest = entryAt(0);
+        if (oldest.offset >= m_writePos + size || oldest.offset + oldest.size <= m_writePos) {
+            break;
+        }
+        evictOldest();
+    }
+    *offset = m_writePos;
+    return true;
+}
+
+void ReplayBuffer::appendAudio(const int16_t* samples, int count) {
+    if (m_arena.empty() || count <= 0) {
+        return;
+    }
+    const int space = MAX_AUDIO_SAMPLES - m_pendingAudioCount;
+    const int copy = count < space ? count : space;
+    memcpy(m_pendingAudio + m_pendingAudioCount, samples, copy * sizeof(int16_t));
+    m_pendingAudioCount += copy;
+}
+
+void ReplayBuffer::onFrame(const uint8_t* rgb565, const uint32_t* dirtyLines, int sampleRate) {
+    if (m_arena.empty()) {
+        return;
+    }
+    const int64_t startNs = nowNanos();
+    m_sampleRate = sampleRate;
+    bool keyframe = m_framesSinceKey >= KEYFRAME_INTERVAL;
+    const uint32_t frameNumber = m_frameNumber++;
+    const size_t audioBytes = m_pendingAudioCount * sizeof(int16_t);
+    uint8_t* payload = m_scratch.data();
+
+    RecordHeader header;
+    uint32_t offset = 0;
+    for (;;) {
+        header = {};
+        header.frameNumber = frameNumber;
+        header.keyframe = keyframe ? 1 : 0;
+        const size_t videoBytes = encodeFrame(rgb565, dirtyLines, keyframe, header.dirty, payload);
+        header.videoBytes = static_cast<uint32_t>(videoBytes);
+        header.audioSamples = static_cast<uint16_t>(m_pendingAudioCount);
+        header.size = align4(sizeof(RecordHeader) + videoBytes + audioBytes);
+        if (!reserve(header.size, &offset)) {
+            m_pendingAudioCount = 0;
+            m_framesSinceKey = KEYFRAME_INTERVAL;
+            return;
+        }
+        // Making room evicted the last keyframe, so a delta would have nothing to
+        // decode against; the memory budget, not the interval, sets the pace.
+        if (keyframe || m_keyframes > 0) {
+            break;
+        }
+        keyframe = true;
+    }
+    m_pendingAudioCount = 0;
+    const size_t videoBytes = header.videoBytes;
+    uint8_t* dst = m_arena.data() + offset;
+    memcpy(dst, &header, sizeof(header));
+    memcpy(dst + sizeof(header), payload, videoBytes);
+    memcpy(dst + sizeof(header) + videoBytes, m_pendingAudio, audioBytes);
+    m_writePos = offset + header.size;
+    m_index[(m_first + m_count) % m_index.size()] = {offset, header.size, keyframe};
+    ++m_count;
+    m_keyframes += keyframe ? 1 : 0;
+    m_usedBytes += header.size;
+    m_framesSinceKey = keyframe ? 1 : m_framesSinceKey + 1;
+    m_lastEncodeUs = (nowNanos() - startNs) / 1000;
+}
+
+// Encode into scratch first; the worst case of a full frame is a few tens of
+// KB, copying it once is cheaper than reserving that much arena every frame.
+size_t ReplayBuffer::encodeFrame(const uint8_t* rgb565, const uint32_t* dirtyLines, bool keyframe,
+                                 uint32_t* dirtyOut, uint8_t* out) {
+    size_t videoBytes = 0;
+    uint16_t line[LINE_WORDS];
+    for (int y = 0; y < FRAME_HEIGHT; ++y) {
+        if (!keyframe && !(dirtyLines[y >> 5] & (1u << (y & 31)))) {
+            continue;
+        }
+        uint16_t* reference = m_reference + y * LINE_WORDS;
+        memcpy(line, rgb565 + y * LINE_WORDS * 2, sizeof(line));
+        for (int x = 0; x < LINE_WORDS; ++x) {
+            const uint16_t value = line[x];
+            // Keyframes XOR against black so they decode on their own.
+            line[x] = keyframe ? value : static_cast<uint16_t>(value ^ reference[x]);
+            reference[x] = value;
+        }
+        dirtyOut[y >> 5] |= 1u << (y & 31);
+        videoBytes += encodeLine(line, out + videoBytes);
+    }
+    return videoBytes;
+}
+
+bool ReplayBuffer::snapshot(Snapshot& out) const {
+    out.records.clear();
+    out.sampleRate = m_sampleRate;
+    int start = 0;
+    while (start < m_count && !entryAt(start).keyframe) {
+        ++start;
+    }
+    if (start >= m_count) {
+        return false;
+    }
+    size_t total = 0;
+    for (int i = start; i < m_count; ++i) {
+        total += entryAt(i).size;
+    }
+    out.records.resize(total);
+    uint8_t* cursor = out.records.data();
+    for (int i = start; i < m_count; ++i) {
+        const IndexEntry& entry = entryAt(i);
+        memcpy(cursor, m_arena.data() + entry.offset, entry.size);
+        cursor += entry.size;
+    }
+    return true;
+}
+
+bool ReplayBuffer::exportSnapshot(const Snapshot& snapshot, const std::string& basePath) {
+    // Count frames first; acTL comes before any frame data.
+    uint32_t frameCount = 0;
+    uint32_t audioBytes = 0;
+    for (size_t pos = 0; pos + sizeof(RecordHeader) <= snapshot.records.size();) {
+        RecordHeader header;
+        memcpy(&header, snapshot.records.data() + pos, sizeof(header));
+        if (header.size < sizeof(header) || pos + header.size > snapshot.records.size()) {
+            return false;
+        }
+        ++frameCount;
+        audioBytes += header.audioSamples * sizeof(int16_t);
+        pos += header.size;
+    }
+    if (frameCount == 0) {
+        return false;
+    }
+
+    const std::string pngPath = basePath + ".png";
+    const std::string wavPath = basePath + ".wav";
+    FILE* png = fopen(pngPath.c_str(), "wb");
+    FILE* wav = fopen(wavPath.c_str(), "wb");
+    if (!png || !wav) {
+        LOGE("Replay export failed to open %s", basePath.c_str());
+        if (png) fclose(png);
+        if (wav) fclose(wav);
+        return false;
+    }
+
+    bool ok = true;
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    ok = ok && fwrite(kSignature, 1, sizeof(kSignature), png) == sizeof(kSignature);
+    uint8_t ihdr[13] = {};
+    putBe32(ihdr, FRAME_WIDTH);
+    putBe32(ihdr + 4, FRAME_HEIGHT);
+    ihdr[8] = 8; // bit depth
+    ihdr[9] = 2; // truecolor RGB
+    ok = ok && writeChunk(png, "IHDR", ihdr, sizeof(ihdr));
+    uint8_t actl[8];
+    putBe32(actl, frameCount);
+    putBe32(actl + 4, 0); // loop forever
+    ok = ok && writeChunk(png, "acTL", actl, sizeof(actl));
+
+    uint8_t wavHeader[WAV_HEADER_SIZE];
+    buildWavHeader(wavHeader, snapshot.sampleRate, 2, audioBytes);
+    ok = ok && fwrite(wavHeader, 1, sizeof(wavHeader), wav) == sizeof(wavHeader);
+
+    std::vector<uint16_t> frame(FRAME_WIDTH * FRAME_HEIGHT, 0);
+    const size_t rawSize = (FRAME_WIDTH * 3 + 1) * FRAME_HEIGHT;
+    std::vector<uint8_t> raw(rawSize);
+    std::vector<uint8_t> packed(4 + compressBound(rawSize));
+    uint32_t sequence = 0;
+    uint32_t index = 0;
+    for (size_t pos = 0; ok && pos < snapshot.records.size(); ++index) {
+        RecordHeader header;
+        memcpy(&header, snapshot.records.data() + pos, sizeof(header));
+        const uint8_t* cursor = snapshot.records.data() + pos + sizeof(header);
+        const uint8_t* videoEnd = cursor + header.videoBytes;
+        if (header.keyframe) {
+            std::fill(frame.begin(), frame.end(), 0);
+        }
+        for (int y = 0; y < FRAME_HEIGHT && cursor; ++y) {
+            if (header.dirty[y >> 5] & (1u << (y & 31))) {
+                cursor = decodeLine(cursor, videoEnd, frame.data() + y * FRAME_WIDTH);
+            }
+        }
+        if (!cursor) {
+            ok = false;
+            break;
+        }
+        if (header.audioSamples) {
+            const size_t bytes = header.audioSamples * sizeof(int16_t);
+            ok = fwrite(videoEnd, 1, bytes, wav) == bytes;
+        }
+        pos += header.size;
+
+        uint8_t* row = raw.data();
+        for (int y = 0; y < FRAME_HEIGHT; ++y) {
+            *row++ = 0; // filter: none
+            for (int x = 0; x < FRAME_WIDTH; ++x) {
+                const uint16_t c = frame[y * FRAME_WIDTH + x];
+                const int r5 = c >> 11;
+                const int g6 = (c >> 5) & 0x3F;
+                const int b5 = c & 0x1F;
+                *row++ = static_cast<uint8_t>((r5 << 3) | (r5 >> 2));
+                *row++ = static_cast<uint8_t>((g6 << 2) | (g6 >> 4));
+                *row++ = static_cast<uint8_t>((b5 << 3) | (b5 >> 2));
+            }
+        }
+
+        uint8_t fctl[26] = {};
+        putBe32(fctl, sequence++);
+        putBe32(fctl + 4, FRAME_WIDTH);
+        putBe32(fctl + 8, FRAME_HEIGHT);
+        // One emulated frame at 59.727 Hz.
+        putBe16(fctl + 20, 1000);
+        putBe16(fctl + 22, 59727);
+        ok = ok && writeChunk(png, "fcTL", fctl, sizeof(fctl));
+
+        // fdAT is IDAT with a sequence number in front.
+        const bool first = index == 0;
+        uint8_t* target = first ? packed.data() : packed.data() + 4;
+        uLongf packedSize = static_cast<uLongf>(compressBound(rawSize));
+        if (compress2(target, &packedSize, raw.data(), rawSize, 1) != Z_OK) {
+            ok = false;
+            break;
+        }
+        if (first) {
+            ok = ok && writeChunk(png, "IDAT", packed.data(), packedSize);
+        } else {
+            putBe32(packed.data(), sequence++);
+            ok = ok && writeChunk(png, "fdAT", packed.data(), packedSize + 4);
+        }
+    }
+    ok = ok && writeChunk(png, "IEND", nullptr, 0);
+    ok = (fclose(png) == 0) && ok;
+    ok = (fclose(wav) == 0) && ok;
+    LOGD("Replay export %s: %u frames, %s", basePath.c_str(), frameCount, ok ? "ok" : "failed");
+    return ok;
+}
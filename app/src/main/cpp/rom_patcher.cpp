@@ -0,0 +1,505 @@
+#include "rom_patcher.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <mgba-util/vfs.h>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#define LOG_TAG "JBOY_Patcher"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+const char kCacheHeader[] = "# jboy patch cache v1: targetCrc romSize romMtimeNs patchSize patchMtimeNs romPath<TAB>patchPath\n";
+constexpr size_t MAX_CACHE_ENTRIES = 64;
+// Well above the 32 MB GBA cartridge space; rejects absurd sizes from corrupt headers.
+constexpr uint64_t MAX_TARGET_SIZE = 64u * 1024 * 1024;
+// UPS and BPS end with source, target and patch CRC32s.
+constexpr size_t CHECKSUM_FOOTER = 12;
+
+uint32_t readLe32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint32_t crc32Of(const uint8_t* data, size_t size) {
+    uLong crc = crc32(0, nullptr, 0);
+    // zlib takes uInt lengths.
+    while (size > 0) {
+        const uInt chunk = static_cast<uInt>(std::min<size_t>(size, 1u << 30));
+        crc = crc32(crc, data, chunk);
+        data += chunk;
+        size -= chunk;
+    }
+    return static_cast<uint32_t>(crc);
+}
+
+// Variable-length integer shared by UPS and BPS.
+bool readNumber(const uint8_t* data, size_t end, size_t& pos, uint64_t& out) {
+    uint64_t value = 0;
+    uint64_t shift = 1;
+    while (pos < end) {
+        const uint8_t x = data[pos++];
+        value += (x & 0x7F) * shift;
+        if (x & 0x80) {
+            out = value;
+            return true;
+        }
+        shift <<= 7;
+        value += shift;
+        if (shift > (1ull << 56)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// Writing only bytes that differ keeps untouched pages shared with the page cache.
+void storeBytes(uint8_t* dst, const uint8_t* src, size_t size) {
+    if (memcmp(dst, src, size) != 0) {
+        memcpy(dst, src, size);
+    }
+}
+
+int64_t mtimeNs(const struct stat& st) {
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+} // namespace
+
+RomPatcher::~RomPatcher() {
+    release();
+}
+
+void RomPatcher::setCachePath(const std::string& path) {
+    m_cachePath = path;
+    m_cache.clear();
+    m_cacheLoaded = false;
+}
+
+struct VFile* RomPatcher::open(const std::string& romPath, const std::string& patchPath) {
+    release();
+    const int64_t startNs = nowNanos();
+
+    std::vector<uint8_t> patch;
+    struct stat patchStat;
+    if (stat(patchPath.c_str(), &patchStat) != 0 || !readWholeFile(patchPath, patch)) {
+        LOGE("Cannot read patch %s", patchPath.c_str());
+        return nullptr;
+    }
+    const int fd = ::open(romPath.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat romStat;
+    if (fd < 0 || fstat(fd, &romStat) != 0 || romStat.st_size <= 0) {
+        LOGE("Cannot open ROM %s", romPath.c_str());
+        if (fd >= 0) {
+            close(fd);
+        }
+        return nullptr;
+    }
+    const size_t sourceSize = static_cast<size_t>(romStat.st_size);
+    void* sourceMap = mmap(nullptr, sourceSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (sourceMap == MAP_FAILED) {
+        LOGE("Cannot map ROM %s", romPath.c_str());
+        close(fd);
+        return nullptr;
+    }
+    const uint8_t* source = static_cast<const uint8_t*>(sourceMap);
+
+    CacheEntry key{0, static_cast<int64_t>(sourceSize), mtimeNs(romStat), static_cast<int64_t>(patch.size()),
+                   mtimeNs(patchStat), romPath, patchPath};
+    bool ok = false;
+    bool verified = false;
+    const char* format = "unknown";
+    if (patch.size() >= 8 && memcmp(patch.data(), "PATCH", 5) == 0) {
+        format = "IPS";
+        ok = applyIps(patch, fd, sourceSize);
+    } else if (patch.size() >= 4 + CHECKSUM_FOOTER &&
+               (memcmp(patch.data(), "UPS1", 4) == 0 || memcmp(patch.data(), "BPS1", 4) == 0)) {
+        const bool ups = patch[0] == 'U';
+        format = ups ? "UPS" : "BPS";
+        key.targetCrc = readLe32(patch.data() + patch.size() - 8);
+        if (!m_cacheLoaded) {
+            loadCache();
+        }
+        verified = findVerified(key) != nullptr;
+        ok = ups ? applyUps(patch, fd, source, sourceSize, !verified)
+                 : applyBps(patch, fd, source, sourceSize, !verified);
+        if (ok && !verified) {
+            rememberVerified(key);
+        }
+    } else {
+        LOGE("Unrecognised patch format: %s", patchPath.c_str());
+    }
+    // mapImage() maps the file separately; the pristine view is only needed while applying.
+    munmap(sourceMap, sourceSize);
+    close(fd);
+    if (!ok) {
+        release();
+        return nullptr;
+    }
+
+    struct VFile* vf = VFileFromMemory(m_image, m_imageSize);
+    if (!vf) {
+        release();
+        return nullptr;
+    }
+    LOGD("Applied %s patch (%zu -> %zu bytes) in %lld us%s", format, sourceSize, m_imageSize,
+         static_cast<long long>((nowNanos() - startNs) / 1000), verified ? ", checksums cached" : "");
+    return vf;
+}
+
+void RomPatcher::release() {
+    if (m_image) {
+        munmap(m_image, m_mapSize);
+    }
+    m_image = nullptr;
+    m_imageSize = 0;
+    m_mapSize = 0;
+}
+
+bool RomPatcher::mapImage(int fd, size_t sourceSize, size_t targetSize) {
+    if (targetSize == 0 || targetSize > MAX_TARGET_SIZE) {
+        LOGE("Invalid patched size %zu", targetSize);
+        return false;
+    }
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    m_mapSize = (targetSize + page - 1) / page * page;
+    // Anonymous zero pages cover growth past the end of the ROM; the ROM
+    // itself is mapped privately over the start.
+    void* base = mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        m_mapSize = 0;
+        return false;
+    }
+    const size_t fileBytes = std::min(sourceSize, targetSize);
+    if (mmap(base, fileBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, m_mapSize);
+        m_mapSize = 0;
+        return false;
+    }
+    m_image = static_cast<uint8_t*>(base);
+    m_imageSize = targetSize;
+    // Bytes of the last file page beyond the target belong to the source.
+    if (targetSize < sourceSize && targetSize % page != 0) {
+        memset(m_image + targetSize, 0, page - targetSize % page);
+    }
+    return true;
+}
+
+bool RomPatcher::applyIps(const std::vector<uint8_t>& patch, int fd, size_t sourceSize) {
+    const uint8_t* data = patch.data();
+    const size_t size = patch.size();
+    // First pass validates the records and finds the final size.
+    size_t targetSize = sourceSize;
+    size_t pos = 5;
+    bool sawEof = false;
+    while (pos + 3 <= size) {
+        if (memcmp(data + pos, "EOF", 3) == 0) {
+            pos += 3;
+            sawEof = true;
+            break;
+        }
+        if (pos + 5 > size) {
+            break;
+        }
+        const size_t offset = (data[pos] << 16) | (data[pos + 1] << 8) | data[pos + 2];
+        size_t length = (data[pos + 3] << 8) | data[pos + 4];
+        pos += 5;
+        if (length == 0) {
+            // Run-length record: 16-bit count, one value byte.
+            if (pos + 3 > size) {
+                break;
+            }
+            length = (data[pos] << 8) | data[pos + 1];
+            pos += 3;
+        } else {
+            if (pos + length > size) {
+                break;
+            }
+            pos += length;
+        }
+        targetSize = std::max(targetSize, offset + length);
+    }
+    if (!sawEof) {
+        LOGE("IPS patch is truncated");
+        return false;
+    }
+    // Optional truncation extension after EOF.
+    if (pos + 3 <= size) {
+        targetSize = (data[pos] << 16) | (data[pos + 1] << 8) | data[pos + 2];
+    }
+    if (!mapImage(fd, sourceSize, targetSize)) {
+        return false;
+    }
+
+    pos = 5;
+    while (memcmp(data + pos, "EOF", 3) != 0) {
+        const size_t offset = (data[pos] << 16) | (data[pos + 1] << 8) | data[pos + 2];
+        size_t length = (data[pos + 3] << 8) | data[pos + 4];
+        pos += 5;
+        if (length == 0) {
+            length = (data[pos] << 8) | data[pos + 1];
+            const uint8_t value = data[pos + 2];
+            pos += 3;
+            for (size_t i = offset; i < offset + length && i < targetSize; ++i) {
+                if (m_image[i] != value) {
+                    m_image[i] = value;
+                }
+            }
+        } else {
+            if (offset < targetSize) {
+                storeBytes(m_image + offset, data + pos, std::min(length, targetSize - offset));
+            }
+            pos += length;
+        }
+    }
+    return true;
+}
+
+bool RomPatcher::applyUps(const std::vector<uint8_t>& patch, int fd, const uint8_t* source, size_t sourceSize,
+                          bool verify) {
+    const uint8_t* data = patch.data();
+    const size_t end = patch.size() - CHECKSUM_FOOTER;
+    if (crc32Of(data, patch.size() - 4) != readLe32(data + patch.size() - 4)) {
+        LOGE("UPS patch checksum mismatch");
+        return false;
+    }
+    size_t pos = 4;
+    uint64_t inputSize = 0;
+    uint64_t outputSize = 0;
+    if (!readNumber(data, end, pos, inputSize) || !readNumber(data, end, pos, outputSize)) {
+        return false;
+    }
+    if (inputSize != sourceSize) {
+        LOGE("UPS patch expects a %llu byte ROM, got %zu", static_cast<unsigned long long>(inputSize), sourceSize);
+        return false;
+    }
+    if (verify && crc32Of(source, sourceSize) != readLe32(data + end)) {
+        LOGE("UPS patch does not match this ROM (source CRC)");
+        return false;
+    }
+    if (outputSize > MAX_TARGET_SIZE || !mapImage(fd, sourceSize, static_cast<size_t>(outputSize))) {
+        return false;
+    }
+
+    // XOR runs against the source, each ended by a zero byte; offsets are relative.
+    size_t output = 0;
+    while (pos < end) {
+        uint64_t skip = 0;
+        if (!readNumber(data, end, pos, skip)) {
+            return false;
+        }
+        output += static_cast<size_t>(std::min<uint64_t>(skip, MAX_TARGET_SIZE));
+        while (pos < end) {
+            const uint8_t x = data[pos++];
+            if (x == 0) {
+                ++output;
+                break;
+            }
+            if (output < m_imageSize) {
+                m_image[output] ^= x;
+            }
+            ++output;
+        }
+    }
+    if (verify && crc32Of(m_image, m_imageSize) != readLe32(data + end + 4)) {
+        LOGE("UPS patched image CRC mismatch");
+        return false;
+    }
+    return true;
+}
+
+bool RomPatcher::applyBps(const std::vector<uint8_t>& patch, int fd, const uint8_t* source, size_t sourceSize,
+                          bool verify) {
+    const uint8_t* data = patch.data();
+    const size_t end = patch.size() - CHECKSUM_FOOTER;
+    if (crc32Of(data, patch.size() - 4) != readLe32(data + patch.size() - 4)) {
+        LOGE("BPS patch checksum mismatch");
+        return false;
+    }
+    size_t pos = 4;
+    uint64_t inputSize = 0;
+    uint64_t outputSize = 0;
+    uint64_t metadataSize = 0;
+    if (!readNumber(data, end, pos, inputSize) || !readNumber(data, end, pos, outputSize) ||
+        !readNumber(data, end, pos, metadataSize) || metadataSize > end - pos) {
+        return false;
+    }
+    pos += static_cast<size_t>(metadataSize);
+    if (inputSize != sourceSize) {
+        LOGE("BPS patch expects a %llu byte ROM, got %zu", static_cast<unsigned long long>(inputSize), sourceSize);
+        return false;
+    }
+    if (verify && crc32Of(source, sourceSize) != readLe32(data + end)) {
+        LOGE("BPS patch does not match this ROM (source CRC)");
+        return false;
+    }
+    if (outputSize > MAX_TARGET_SIZE || !mapImage(fd, sourceSize, static_cast<size_t>(outputSize))) {
+        return false;
+    }
+
+    const size_t targetSize = m_imageSize;
+    size_t output = 0;
+    int64_t sourceRelative = 0;
+    int64_t targetRelative = 0;
+    while (pos < end) {
+        uint64_t command = 0;
+        if (!readNumber(data, end, pos, command)) {
+            return false;
+        }
+        const size_t length = static_cast<size_t>((command >> 2) + 1);
+        if (length > targetSize - output) {
+            LOGE("BPS command runs past the end of the image");
+            return false;
+        }
+        switch (command & 3) {
+        case 0: // SourceRead: the image already holds the source at this offset.
+            if (output + length > sourceSize) {
+                return false;
+            }
+            break;
+        case 1: // TargetRead
+            if (length > end - pos) {
+                return false;
+            }
+            storeBytes(m_image + output, data + pos, length);
+            pos += length;
+            break;
+        case 2:
+        case 3: {
+            uint64_t encoded = 0;
+            if (!readNumber(data, end, pos, encoded)) {
+                return false;
+            }
+            const int64_t delta = static_cast<int64_t>(encoded >> 1) * ((encoded & 1) ? -1 : 1);
+            if ((command & 3) == 2) {
+                // SourceCopy reads the pristine ROM, never the partly patched image.
+                sourceRelative += delta;
+                if (sourceRelative < 0 || static_cast<uint64_t>(sourceRelative) + length > sourceSize) {
+                    return false;
+                }
+                storeBytes(m_image + output, source + sourceRelative, length);
+                sourceRelative += static_cast<int64_t>(length);
+            } else {
+                // TargetCopy may overlap its own output; copy bytewise.
+                targetRelative += delta;
+                if (targetRelative < 0 || static_cast<size_t>(targetRelative) >= output) {
+                    return false;
+                }
+                for (size_t i = 0; i < length; ++i) {
+                    const uint8_t value = m_image[targetRelative++];
+                    if (m_image[output + i] != value) {
+                        m_image[output + i] = value;
+                    }
+                }
+            }
+            break;
+        }
+        }
+        output += length;
+    }
+    if (output != targetSize) {
+        LOGE("BPS patch produced %zu of %zu bytes", output, targetSize);
+        return false;
+    }
+    if (verify && crc32Of(m_image, m_imageSize) != readLe32(data + end + 4)) {
+        LOGE("BPS patched image CRC mismatch");
+        return false;
+    }
+    return true;
+}
+
+const RomPatcher::CacheEntry* RomPatcher::findVerified(const CacheEntry& key) const {
+    for (const CacheEntry& entry : m_cache) {
+        if (entry.targetCrc == key.targetCrc && entry.romSize == key.romSize && entry.romMtimeNs == key.romMtimeNs &&
+            entry.patchSize == key.patchSize && entry.patchMtimeNs == key.patchMtimeNs &&
+            entry.romPath == key.romPath && entry.patchPath == key.patchPath) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void RomPatcher::rememberVerified(const CacheEntry& entry) {
+    m_cache.erase(std::remove_if(m_cache.begin(), m_cache.end(),
+                                 [&entry](const CacheEntry& old) {
+                                     return old.romPath == entry.romPath && old.patchPath == entry.patchPath;
+                                 }),
+                  m_cache.end());
+    m_cache.push_back(entry);
+    if (m_cache.size() > MAX_CACHE_ENTRIES) {
+        m_cache.erase(m_cache.begin(), m_cache.end() - MAX_CACHE_ENTRIES);
+    }
+    saveCache();
+}
+
+void RomPatcher::loadCache() {
+    m_cacheLoaded = true;
+    m_cache.clear();
+    std::vector<uint8_t> data;
+    if (m_cachePath.empty() || !readWholeFile(m_cachePath, data)) {
+        return;
+    }
+    data.push_back('\0');
+    char* line = reinterpret_cast<char*>(data.data());
+    while (*line) {
+        char* next = strchr(line, '\n');
+        if (next) {
+            *next = '\0';
+        }
+        CacheEntry entry;
+        unsigned crc = 0;
+        long long romSize = 0;
+        long long romMtime = 0;
+        long long patchSize = 0;
+        long long patchMtime = 0;
+        int consumed = 0;
+        char* tab = strchr(line, '\t');
+        if (line[0] != '#' && tab &&
+            sscanf(line, "%x %lld %lld %lld %lld %n", &crc, &romSize, &romMtime, &patchSize, &patchMtime, &consumed) == 5 &&
+            consumed > 0 && line + consumed < tab) {
+            entry.targetCrc = crc;
+            entry.romSize = romSize;
+            entry.romMtimeNs = romMtime;
+            entry.patchSize = patchSize;
+            entry.patchMtimeNs = patchMtime;
+            entry.romPath.assign(line + consumed, tab);
+            entry.patchPath = tab + 1;
+            m_cache.push_back(entry);
+        }
+        if (!next) {
+            break;
+        }
+        line = next + 1;
+    }
+}
+
+void RomPatcher::saveCache() const {
+    if (m_cachePath.empty()) {
+        return;
+    }
+    std::string text = kCacheHeader;
+    char numbers[96];
+    for (const CacheEntry& entry : m_cache) {
+        snprintf(numbers, sizeof(numbers), "%08X %lld %lld %lld %lld ", entry.targetCrc,
+                 static_cast<long long>(entry.romSize), static_cast<long long>(entry.romMtimeNs),
+                 static_cast<long long>(entry.patchSize), static_cast<long long>(entry.patchMtimeNs));
+        text += numbers;
+        text += entry.romPath;
+        text += '\t';
+        text += entry.patchPath;
+        text += '\n';
+    }
+    if (!writeFileAtomic(m_cachePath, text.data(), text.size())) {
+        LOGE("Failed to write patch cache %s", m_cachePath.c_str());
+    }
+}
@@ -0,0 +1,310 @@
+#include "save_ram_manager.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+
+#include <mgba/core/core.h>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#define LOG_TAG "JBOY_SaveRam"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+// <save>.crc: size and CRC32 of the last .sav written by this manager and of
+// the copy kept in <save>.bak (backupSize 0 when there is none). Older
+// sidecars end after crc32.
+struct SaveChecksum {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t crc32;
+    uint32_t backupSize;
+    uint32_t backupCrc32;
+};
+
+static constexpr uint32_t SAVE_CHECKSUM_MAGIC = 0x43534A42; // "BJSC"
+static constexpr size_t SAVE_CHECKSUM_V1_SIZE = 3 * sizeof(uint32_t);
+
+static std::string getChecksumPath(const std::string& savePath) {
+    return savePath + ".crc";
+}
+
+static std::string getBackupPath(const std::string& savePath) {
+    return savePath + ".bak";
+}
+
+static uint32_t computeCrc32(const std::vector<uint8_t>& data) {
+    return static_cast<uint32_t>(crc32(0L, data.data(), static_cast<uInt>(data.size())));
+}
+
+static bool matches(const std::vector<uint8_t>& data, uint32_t size, uint32_t crc) {
+    return size != 0 && data.size() == size && computeCrc32(data) == crc;
+}
+
+static bool readChecksum(const std::string& savePath, SaveChecksum* checksum) {
+    std::vector<uint8_t> raw;
+    if (!readWholeFile(getChecksumPath(savePath), raw) ||
+        (raw.size() != sizeof(SaveChecksum) && raw.size() != SAVE_CHECKSUM_V1_SIZE)) {
+        return false;
+    }
+    memset(checksum, 0, sizeof(*checksum));
+    memcpy(checksum, raw.data(), raw.size());
+    return checksum->magic == SAVE_CHECKSUM_MAGIC;
+}
+
+static bool writeChecksum(const std::string& savePath, const SaveChecksum& checksum) {
+    return writeFileAtomic(getChecksumPath(savePath), &checksum, sizeof(checksum));
+}
+
+SaveRamManager::SaveRamManager() = default;
+
+SaveRamManager::~SaveRamManager() {
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stopping = true;
+    }
+    m_queueCond.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+bool SaveRamManager::attach(struct mCore* core, const std::string& savePath) {
+    m_path = savePath;
+    m_image.clear();
+    m_dirty = false;
+    m_framesUntilPoll = POLL_INTERVAL_FRAMES;
+    m_attached = false;
+    if (!core || savePath.empty()) {
+        return false;
+    }
+
+    restoreIfDamaged(savePath);
+    // Temporary: mGBA keeps writes in memory and never syncs the file itself.
+    if (!mCoreLoadSaveFile(core, savePath.c_str(), true)) {
+        LOGE("Failed to attach save data file: %s", savePath.c_str());
+        return false;
+    }
+    snapshot(core);
+    m_attached = true;
+    m_dirty = false;
+    LOGD("Save data attached: %s (%zu bytes)", savePath.c_str(), m_image.size());
+    return true;
+}
+
+void SaveRamManager::onFrame(struct mCore* core, int64_t nowNs) {
+    if (!m_attached) {
+        return;
+    }
+    if (--m_framesUntilPoll > 0) {
+        return;
+    }
+    m_framesUntilPoll = POLL_INTERVAL_FRAMES;
+
+    if (snapshot(core)) {
+        if (!m_dirty) {
+            m_firstDirtyNs = nowNs;
+        }
+        m_dirty = true;
+        m_lastChangeNs = nowNs;
+    }
+    // Games usually write a save in bursts; wait for the burst to settle but
+    // never hold dirty data longer than MAX_DELAY_NS.
+    if (m_dirty && (nowNs - m_lastChangeNs >= DEBOUNCE_NS || nowNs - m_firstDirtyNs >= MAX_DELAY_NS)) {
+        queueWrite();
+    }
+}
+
+void SaveRamManager::flush(struct mCore* core) {
+    if (!m_attached) {
+        return;
+    }
+    if (snapshot(core)) {
+        m_dirty = true;
+    }
+    if (m_dirty) {
+        queueWrite();
+    }
+}
+
+void SaveRamManager::detach(struct mCore* core) {
+    flush(core);
+    waitIdle();
+    m_attached = false;
+    m_dirty = false;
+    m_image.clear();
+    m_path.clear();
+}
+
+bool SaveRamManager::snapshot(struct mCore* core) {
+    if (!core || !core->savedataClone) {
+        return false;
+    }
+    void* sram = nullptr;
+    const size_t size = core->savedataClone(core, &sram);
+    if (!sram) {
+        return false;
+    }
+
+    bool changed = size != m_image.size();
+    size_t dirtyBlocks = 0;
+    if (changed) {
+        m_image.assign(static_cast<uint8_t*>(sram), static_cast<uint8_t*>(sram) + size);
+        dirtyBlocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    } else {
+        const uint8_t* src = static_cast<const uint8_t*>(sram);
+        for (size_t offset = 0; offset < size; offset += BLOCK_SIZE) {
+            const size_t length = size - offset < BLOCK_SIZE ? size - offset : BLOCK_SIZE;
+            if (memcmp(m_image.data() + offset, src + offset, length) != 0) {
+                memcpy(m_image.data() + offset, src + offset, length);
+                ++dirtyBlocks;
+            }
+        }
+        changed = dirtyBlocks > 0;
+    }
+    free(sram);
+    if (changed && m_attached && !m_image.empty()) {
+        LOGD("Save RAM changed: %zu dirty blocks", dirtyBlocks);
+    }
+    return changed;
+}
+
+void SaveRamManager::queueWrite() {
+    if (m_path.empty() || m_image.empty()) {
+        m_dirty = false;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        // Only the newest image of a given save matters.
+        bool replaced = false;
+        for (PendingWrite& pending : m_queue) {
+            if (pending.path == m_path) {
+                pending.data = m_image;
+                replaced = true;
+                break;
+            }
+        }
+        if (!replaced) {
+            m_queue.push_back(PendingWrite{ m_path, m_image });
+        }
+        if (!m_worker.joinable()) {
+            m_worker = std::thread(&SaveRamManager::workerLoop, this);
+        }
+    }
+    m_queueCond.notify_one();
+    m_dirty = false;
+}
+
+void SaveRamManager::waitIdle() {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    m_idleCond.wait(lock, [this] { return m_queue.empty() && !m_writing; });
+}
+
+void SaveRamManager::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    while (true) {
+        m_queueCond.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            break;
+        }
+        PendingWrite pending = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_writing = true;
+        lock.unlock();
+
+        const int64_t startNs = nowNanos();
+        const bool ok = writeSave(pending.path, pending.data);
+        if (ok) {
+            m_flushCount.fetch_add(1, std::memory_order_relaxed);
+            m_lastFlushUs.store((nowNanos() - startNs) / 1000, std::memory_order_relaxed);
+            LOGD("Save data written: %s (%zu bytes)", pending.path.c_str(), pending.data.size());
+        } else {
+            m_failureCount.fetch_add(1, std::memory_order_relaxed);
+            LOGE("Failed to write save data: %s", pending.path.c_str());
+        }
+
+        lock.lock();
+        m_writing = false;
+        if (m_queue.empty()) {
+            m_idleCond.notify_all();
+        }
+    }
+    m_writing = false;
+    m_idleCond.notify_all();
+}
+
+bool SaveRamManager::writeSave(const std::string& path, const std::vector<uint8_t>& data) {
+    SaveChecksum previous;
+    const bool hasPrevious = readChecksum(path, &previous);
+    SaveChecksum checksum = {
+        SAVE_CHECKSUM_MAGIC,
+        static_cast<uint32_t>(data.size()),
+        computeCrc32(data),
+        hasPrevious ? previous.backupSize : 0,
+        hasPrevious ? previous.backupCrc32 : 0
+    };
+
+    // The .sav on disk becomes the fallback, unless it is already damaged;
+    // then the older backup stays.
+    std::vector<uint8_t> current;
+    if (readWholeFile(path, current) && !current.empty()) {
+        const uint32_t crc = computeCrc32(current);
+        const bool intact = !hasPrevious || (current.size() == previous.size && crc == previous.crc32);
+        if (intact && rename(path.c_str(), getBackupPath(path).c_str()) == 0) {
+            checksum.backupSize = static_cast<uint32_t>(current.size());
+            checksum.backupCrc32 = crc;
+        }
+    }
+
+    // Sidecar first: a .sav that matches it is always the newest complete one,
+    // and until it is replaced the backup still matches one of its entries.
+    return writeChecksum(path, checksum) && writeFileAtomic(path, data.data(), data.size());
+}
+
+bool SaveRamManager::restoreIfDamaged(const std::string& path) {
+    SaveChecksum checksum;
+    if (!readChecksum(path, &checksum)) {
+        // Never written by this manager; load whatever is there.
+        return false;
+    }
+    std::vector<uint8_t> save;
+    const bool present = readWholeFile(path, save);
+    if (present && matches(save, checksum.size, checksum.crc32)) {
+        return false;
+    }
+
+    // A write interrupted after moving the .sav aside leaves the backup
+    // matching the sidecar's current entry; storage damage leaves it matching
+    // the backup entry.
+    std::vector<uint8_t> backup;
+    if (readWholeFile(getBackupPath(path), backup) &&
+        (matches(backup, checksum.size, checksum.crc32) || matches(backup, checksum.backupSize, checksum.backupCrc32))) {
+        LOGE("Save data %s: %s, restoring %zu bytes from backup", path.c_str(),
+             present ? "checksum mismatch" : "missing", backup.size());
+        const uint32_t crc = computeCrc32(backup);
+        const SaveChecksum restored = {
+            SAVE_CHECKSUM_MAGIC,
+            static_cast<uint32_t>(backup.size()),
+            crc,
+            static_cast<uint32_t>(backup.size()),
+            crc
+        };
+        if (writeFileAtomic(path, backup.data(), backup.size()) && writeChecksum(path, restored)) {
+            m_restoreCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        LOGE("Failed to restore save data backup: %s", path.c_str());
+        return false;
+    }
+    if (present) {
+        // No usable backup: still load it, but leave a trace so a corrupt save
+        // can be diagnosed.
+        LOGE("Save data checksum mismatch: %s (size %zu, expected %u), no backup",
+             path.c_str(), save.size(), checksum.size);
+    }
+    return false;
+}
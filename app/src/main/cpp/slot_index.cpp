@@ -0,0 +1,232 @@
+#include "slot_index.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#define LOG_TAG "JBOY_Slots"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+const char kFileHeader[] = "# jboy slot index v1: slot size savedAtMs thumbOffset\n";
+const char kSlotInfix[] = ".slot";
+const char kStateSuffix[] = ".ss";
+
+int64_t wallClockMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+std::string indexPath(const std::string& romPath) {
+    return romPath + ".slots";
+}
+
+} // namespace
+
+std::string SlotIndex::statePath(const std::string& romPath, int slot) {
+    return romPath + kSlotInfix + std::to_string(slot) + kStateSuffix;
+}
+
+void SlotIndex::buildThumbnail(const uint8_t* rgb565, uint8_t* out) {
+    constexpr int srcWidth = THUMB_WIDTH * 2;
+    for (int y = 0; y < THUMB_HEIGHT; ++y) {
+        const uint8_t* row0 = rgb565 + (y * 2) * srcWidth * 2;
+        const uint8_t* row1 = row0 + srcWidth * 2;
+        for (int x = 0; x < THUMB_WIDTH; ++x) {
+            uint32_t r = 0;
+            uint32_t g = 0;
+            uint32_t b = 0;
+            const uint8_t* quad[4] = {row0 + x * 4, row0 + x * 4 + 2, row1 + x * 4, row1 + x * 4 + 2};
+            for (const uint8_t* p : quad) {
+                const uint32_t c = p[0] | (p[1] << 8);
+                r += c >> 11;
+                g += (c >> 5) & 0x3F;
+                b += c & 0x1F;
+            }
+            const uint16_t c = static_cast<uint16_t>((((r + 2) >> 2) << 11) | (((g + 2) >> 2) << 5) | ((b + 2) >> 2));
+            uint8_t* dst = out + (y * THUMB_WIDTH + x) * 2;
+            dst[0] = static_cast<uint8_t>(c);
+            dst[1] = static_cast<uint8_t>(c >> 8);
+        }
+    }
+}
+
+void SlotIndex::attach(const std::string& romPath, size_t stateSize) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stateSize = stateSize;
+    if (romPath == m_romPath && !m_stale) {
+        return;
+    }
+    m_romPath = romPath;
+    m_entries.clear();
+    m_stale = true;
+}
+
+void SlotIndex::detach() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_romPath.clear();
+    m_entries.clear();
+    m_stale = true;
+}
+
+void SlotIndex::markStale() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stale = true;
+}
+
+void SlotIndex::recordSave(int slot, int64_t size, int64_t thumbOffset) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_romPath.empty()) {
+        return;
+    }
+    ensureFreshLocked();
+    m_entries[slot] = Entry{slot, size, wallClockMs(), thumbOffset};
+    persistLocked();
+}
+
+bool SlotIndex::has(int slot) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_romPath.empty()) {
+        return false;
+    }
+    ensureFreshLocked();
+    return m_entries.count(slot) != 0;
+}
+
+std::vector<SlotIndex::Entry> SlotIndex::entries() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Entry> out;
+    if (m_romPath.empty()) {
+        return out;
+    }
+    ensureFreshLocked();
+    out.reserve(m_entries.size());
+    for (const auto& item : m_entries) {
+        out.push_back(item.second);
+    }
+    return out;
+}
+
+bool SlotIndex::readThumbnail(int slot, std::vector<uint8_t>& out) {
+    std::string path;
+    int64_t offset = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_romPath.empty()) {
+            return false;
+        }
+        ensureFreshLocked();
+        auto it = m_entries.find(slot);
+        if (it == m_entries.end() || it->second.thumbOffset < 0) {
+            return false;
+        }
+        path = statePath(m_romPath, slot);
+        offset = it->second.thumbOffset;
+    }
+    // The read itself happens outside the lock.
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        markStale();
+        return false;
+    }
+    out.resize(THUMB_BYTES);
+    const ssize_t got = pread(fd, out.data(), THUMB_BYTES, static_cast<off_t>(offset));
+    close(fd);
+    return got == static_cast<ssize_t>(THUMB_BYTES);
+}
+
+void SlotIndex::ensureFreshLocked() {
+    if (!m_stale) {
+        return;
+    }
+    m_entries.clear();
+    if (!loadLocked()) {
+        rescanLocked();
+        persistLocked();
+    }
+    m_stale = false;
+}
+
+bool SlotIndex::loadLocked() {
+    std::vector<uint8_t> data;
+    if (!readWholeFile(indexPath(m_romPath), data) || data.size() < sizeof(kFileHeader) - 1 ||
+        memcmp(data.data(), kFileHeader, sizeof(kFileHeader) - 1) != 0) {
+        return false;
+    }
+    data.push_back('\0');
+    const char* line = reinterpret_cast<const char*>(data.data());
+    while (*line) {
+        const char* next = strchr(line, '\n');
+        int slot = 0;
+        long long size = 0;
+        long long savedAtMs = 0;
+        long long thumbOffset = -1;
+        if (line[0] != '#' && sscanf(line, "%d %lld %lld %lld", &slot, &size, &savedAtMs, &thumbOffset) == 4) {
+            m_entries[slot] = Entry{slot, size, savedAtMs, thumbOffset};
+        }
+        if (!next) {
+            break;
+        }
+        line = next + 1;
+    }
+    return true;
+}
+
+void SlotIndex::rescanLocked() {
+    const size_t slash = m_romPath.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "." : m_romPath.substr(0, slash);
+    const std::string prefix = (slash == std::string::npos ? m_romPath : m_romPath.substr(slash + 1)) + kSlotInfix;
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) {
+        return;
+    }
+    while (struct dirent* item = readdir(handle)) {
+        const char* name = item->d_name;
+        if (strncmp(name, prefix.c_str(), prefix.size()) != 0) {
+            continue;
+        }
+        char* end = nullptr;
+        const long slot = strtol(name + prefix.size(), &end, 10);
+        if (end == name + prefix.size() || slot < 0 || strcmp(end, kStateSuffix) != 0) {
+            continue;
+        }
+        struct stat st;
+        if (fstatat(dirfd(handle), name, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        const int64_t savedAtMs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+        // States saved with a thumbnail are exactly one thumbnail longer than
+        // the core's state size; older files have none.
+        const int64_t size = static_cast<int64_t>(st.st_size);
+        const int64_t stateSize = static_cast<int64_t>(m_stateSize);
+        const int64_t thumbOffset = (stateSize > 0 && size == stateSize + static_cast<int64_t>(THUMB_BYTES)) ? stateSize : -1;
+        m_entries[static_cast<int>(slot)] = Entry{static_cast<int>(slot), size, savedAtMs, thumbOffset};
+    }
+    closedir(handle);
+    LOGD("Rebuilt slot index for %s: %zu slots", m_romPath.c_str(), m_entries.size());
+}
+
+void SlotIndex::persistLocked() const {
+    std::string text = kFileHeader;
+    char line[96];
+    for (const auto& item : m_entries) {
+        const Entry& entry = item.second;
+        snprintf(line, sizeof(line), "%d %lld %lld %lld\n", entry.slot, static_cast<long long>(entry.size),
+                 static_cast<long long>(entry.savedAtMs), static_cast<long long>(entry.thumbOffset));
+        text += line;
+    }
+    if (!writeFileAtomic(indexPath(m_romPath), text.data(), text.size())) {
+        LOGE("Failed to write slot index for %s", m_romPath.c_str());
+    }
+}
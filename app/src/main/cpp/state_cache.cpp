@@ -0,0 +1,126 @@
+#include "state_cache.h"
+
+#include <algorithm>
+
+#include "jboy_log.h"
+#include "native_util.h"
+#include "slot_index.h"
+
+#define LOG_TAG "JBOY_StateCache"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+StateCache::~StateCache() {
+    clear();
+}
+
+void StateCache::reset(const std::string& romPath, size_t stateSize, SlotIndex* index) {
+    clear();
+    if (romPath.empty() || stateSize == 0 || !index) {
+        return;
+    }
+    const uint64_t generation = m_generation.load(std::memory_order_relaxed);
+    m_prefetch = std::thread(&StateCache::prefetchLoop, this, generation, romPath, stateSize, index);
+}
+
+void StateCache::clear() {
+    stopPrefetch();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_written.clear();
+}
+
+void StateCache::put(int slot, std::vector<uint8_t>&& state) {
+    Buffer data = std::make_shared<const std::vector<uint8_t>>(std::move(state));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_written.insert(slot);
+    insertLocked(slot, std::move(data));
+}
+
+void StateCache::erase(int slot) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_written.insert(slot);
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                   [slot](const Entry& entry) { return entry.slot == slot; }),
+                    m_entries.end());
+}
+
+StateCache::Buffer StateCache::get(int slot) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (Entry& entry : m_entries) {
+        if (entry.slot == slot) {
+            entry.lastUse = ++m_useCounter;
+            return entry.data;
+        }
+    }
+    return nullptr;
+}
+
+void StateCache::prefetchLoop(uint64_t generation, std::string romPath, size_t stateSize, SlotIndex* index) {
+    const int64_t startNs = nowNanos();
+    std::vector<SlotIndex::Entry> slots = index->entries();
+    // Newest first; entries without a local file (size 0) live in mGBA's state directory.
+    slots.erase(std::remove_if(slots.begin(), slots.end(),
+                               [stateSize](const SlotIndex::Entry& entry) {
+                                   return entry.size < static_cast<int64_t>(stateSize);
+                               }),
+                slots.end());
+    std::sort(slots.begin(), slots.end(), [](const SlotIndex::Entry& a, const SlotIndex::Entry& b) {
+        return a.savedAtMs > b.savedAtMs;
+    });
+    if (slots.size() > MAX_ENTRIES) {
+        slots.resize(MAX_ENTRIES);
+    }
+
+    size_t loaded = 0;
+    // Oldest of the selection first, so the newest ends up most recently used.
+    for (auto it = slots.rbegin(); it != slots.rend(); ++it) {
+        if (m_generation.load(std::memory_order_relaxed) != generation) {
+            return;
+        }
+        std::vector<uint8_t> state;
+        if (!readWholeFile(SlotIndex::statePath(romPath, it->slot), state) || state.size() < stateSize) {
+            continue;
+        }
+        // Drop the slot thumbnail that follows the state data.
+        state.resize(stateSize);
+        Buffer data = std::make_shared<const std::vector<uint8_t>>(std::move(state));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_generation.load(std::memory_order_relaxed) != generation) {
+            return;
+        }
+        if (m_written.count(it->slot)) {
+            continue;
+        }
+        insertLocked(it->slot, std::move(data));
+        ++loaded;
+    }
+    LOGD("Prefetched %zu save states in %lld us", loaded,
+         static_cast<long long>((nowNanos() - startNs) / 1000));
+}
+
+void StateCache::insertLocked(int slot, Buffer data) {
+    const uint64_t use = ++m_useCounter;
+    for (Entry& entry : m_entries) {
+        if (entry.slot == slot) {
+            entry.data = std::move(data);
+            entry.lastUse = use;
+            return;
+        }
+    }
+    if (m_entries.size() >= MAX_ENTRIES) {
+        auto oldest = std::min_element(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) {
+            return a.lastUse < b.lastUse;
+        });
+        *oldest = Entry{slot, use, std::move(data)};
+        return;
+    }
+    m_entries.push_back(Entry{slot, use, std::move(data)});
+}
+
+void StateCache::stopPrefetch() {
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+    if (m_prefetch.joinable()) {
+        m_prefetch.join();
+    }
+}
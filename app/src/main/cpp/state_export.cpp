@@ -0,0 +1,281 @@
+#include "state_export.h"
+
+#include <android/sharedmem.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/memfd.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <mgba/core/core.h>
+#include <mgba/internal/gba/gba.h>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#define LOG_TAG "JBOY_StateExport"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#endif
+#ifndef F_SEAL_SHRINK
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
+namespace {
+
+constexpr uint32_t EWRAM_BASE = 0x02000000;
+constexpr uint32_t IWRAM_BASE = 0x03000000;
+constexpr uint32_t EWRAM_SIZE = 256 * 1024;
+constexpr uint32_t IWRAM_SIZE = 32 * 1024;
+constexpr uint32_t IO_SIZE = 0x400;
+constexpr uint32_t FRAME_MAX_SIZE = 240 * 160 * 2;
+constexpr uint32_t REGION_ALIGN = 64;
+// AID_SHELL.
+constexpr uid_t SHELL_UID = 2000;
+
+uint32_t alignUp(uint32_t value, uint32_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+// Creates the region, maps it writable for us and then restricts the fd so every
+// later mapping, including those of the processes it is handed to, is
+// read-only. memfd does that with F_SEAL_FUTURE_WRITE, which needs Linux 5.1;
+// ashmem with ASharedMemory_setProt. A region that cannot be restricted is
+// unmapped and closed rather than shared writable.
+int createRegion(size_t size, bool memfd, void** mapOut) {
+    const int fd = memfd ? static_cast<int>(syscall(__NR_memfd_create, "jboy-state", MFD_CLOEXEC | MFD_ALLOW_SEALING))
+                         : ASharedMemory_create("jboy-state", size);
+    if (fd < 0) {
+        return -1;
+    }
+    if (memfd && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        LOGE("Failed to map shared memory: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    // All seals in one call: an old kernel rejects the set and adds none.
+    const bool readOnly = memfd ? fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_FUTURE_WRITE) == 0
+                                : ASharedMemory_setProt(fd, PROT_READ) == 0;
+    if (!readOnly) {
+        LOGE("Failed to make the %s region read-only: %s", memfd ? "memfd" : "ashmem", strerror(errno));
+        munmap(map, size);
+        close(fd);
+        return -1;
+    }
+    *mapOut = map;
+    return fd;
+}
+
+// The abstract namespace has no file permissions, so the peer is checked
+// instead: this app, root, or the shell user that adb runs tools as.
+bool isTrustedPeer(int socketFd, uid_t* uid) {
+    struct ucred credentials = {};
+    socklen_t length = sizeof(credentials);
+    if (getsockopt(socketFd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0) {
+        *uid = static_cast<uid_t>(-1);
+        return false;
+    }
+    *uid = credentials.uid;
+    return credentials.uid == getuid() || credentials.uid == 0 || credentials.uid == SHELL_UID;
+}
+
+bool sendFd(int socketFd, int fd, uint32_t size) {
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    struct iovec iov = {&size, sizeof(size)};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    ssize_t sent;
+    do {
+        sent = sendmsg(socketFd, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    return sent == static_cast<ssize_t>(sizeof(size));
+}
+
+} // namespace
+
+StateExport::~StateExport() {
+    disable();
+}
+
+bool StateExport::enable() {
+    if (m_map) {
+        return true;
+    }
+    uint32_t offset = sizeof(StateExportHeader);
+    StateExportHeader::Region regions[4];
+    const uint32_t sizes[4] = {EWRAM_SIZE, IWRAM_SIZE, IO_SIZE, FRAME_MAX_SIZE};
+    for (int i = 0; i < 4; ++i) {
+        offset = alignUp(offset, REGION_ALIGN);
+        regions[i] = {offset, 0};
+        offset += sizes[i];
+    }
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t mapSize = (offset + pageSize - 1) / pageSize * pageSize;
+
+    // memfd where the kernel has it (3.17+) and can seal it; ashmem otherwise.
+    bool memfd = true;
+    void* map = nullptr;
+    int fd = createRegion(mapSize, true, &map);
+    if (fd < 0) {
+        memfd = false;
+        fd = createRegion(mapSize, false, &map);
+    }
+    if (fd < 0) {
+        LOGE("No read-only shared memory available; state export stays off");
+        return false;
+    }
+
+    m_fd = fd;
+    m_map = static_cast<uint8_t*>(map);
+    m_mapSize = mapSize;
+    StateExportHeader* header = reinterpret_cast<StateExportHeader*>(m_map);
+    memset(header, 0, sizeof(*header));
+    header->magic = STATE_EXPORT_MAGIC;
+    header->version = STATE_EXPORT_VERSION;
+    header->headerSize = sizeof(StateExportHeader);
+    memcpy(header->regions, regions, sizeof(regions));
+    header->frameFormat = STATE_EXPORT_FORMAT_RGB565;
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path + 1, STATE_EXPORT_SOCKET, sizeof(STATE_EXPORT_SOCKET) - 1);
+    const socklen_t addressSize = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + sizeof(STATE_EXPORT_SOCKET));
+    if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<struct sockaddr*>(&address), addressSize) != 0 ||
+        listen(m_listenFd, 4) != 0) {
+        // Another process owns the name; the fd is still reachable through duplicateFd().
+        LOGE("State export socket unavailable: %s", strerror(errno));
+        if (m_listenFd >= 0) {
+            close(m_listenFd);
+            m_listenFd = -1;
+        }
+    } else {
+        m_server = std::thread(&StateExport::serveLoop, this);
+    }
+    LOGD("State export enabled: %zu bytes (%s)", m_mapSize, memfd ? "memfd" : "ashmem");
+    return true;
+}
+
+void StateExport::disable() {
+    if (m_listenFd >= 0) {
+        // Wakes the blocked accept().
+        shutdown(m_listenFd, SHUT_RDWR);
+    }
+    if (m_server.joinable()) {
+        m_server.join();
+    }
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        m_listenFd = -1;
+    }
+    if (m_map) {
+        munmap(m_map, m_mapSize);
+        m_map = nullptr;
+        m_mapSize = 0;
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+int StateExport::duplicateFd() const {
+    return m_fd >= 0 ? fcntl(m_fd, F_DUPFD_CLOEXEC, 0) : -1;
+}
+
+void StateExport::serveLoop() {
+    for (;;) {
+        const int client = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        uid_t uid;
+        if (!isTrustedPeer(client, &uid)) {
+            LOGE("Refused state export to uid %d", static_cast<int>(uid));
+        } else if (!sendFd(client, m_fd, static_cast<uint32_t>(m_mapSize))) {
+            LOGE("Failed to pass state export fd: %s", strerror(errno));
+        }
+        close(client);
+    }
+}
+
+void StateExport::publish(struct mCore* core, const uint8_t* frame, int width, int height) {
+    if (!m_map || !core) {
+        return;
+    }
+    const int64_t startNs = nowNanos();
+    StateExportHeader* header = reinterpret_cast<StateExportHeader*>(m_map);
+    const uint32_t sequence = __atomic_load_n(&header->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->sequence, sequence + 1, __ATOMIC_RELAXED);
+    // Orders the odd sequence before the data: a reader that sees new data sees it too.
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    header->regions[STATE_EXPORT_EWRAM].size = 0;
+    header->regions[STATE_EXPORT_IWRAM].size = 0;
+    if (core->listMemoryBlocks && core->getMemoryBlock) {
+        const struct mCoreMemoryBlock* blocks = nullptr;
+        const size_t count = core->listMemoryBlocks(core, &blocks);
+        for (size_t i = 0; i < count; ++i) {
+            const bool ewram = blocks[i].start == EWRAM_BASE;
+            if (!ewram && blocks[i].start != IWRAM_BASE) {
+                continue;
+            }
+            size_t size = 0;
+            const void* data = core->getMemoryBlock(core, blocks[i].id, &size);
+            StateExportHeader::Region& region = header->regions[ewram ? STATE_EXPORT_EWRAM : STATE_EXPORT_IWRAM];
+            const uint32_t expected = ewram ? EWRAM_SIZE : IWRAM_SIZE;
+            if (data && size >= expected) {
+                memcpy(m_map + region.offset, data, expected);
+                region.size = expected;
+            }
+        }
+    }
+    // getMemoryBlock does not cover MMIO; read the core's register file directly.
+    const struct GBA* gba = static_cast<const struct GBA*>(core->board);
+    StateExportHeader::Region& io = header->regions[STATE_EXPORT_IO];
+    io.size = sizeof(gba->memory.io) < IO_SIZE ? sizeof(gba->memory.io) : IO_SIZE;
+    memcpy(m_map + io.offset, gba->memory.io, io.size);
+
+    StateExportHeader::Region& framebuffer = header->regions[STATE_EXPORT_FRAMEBUFFER];
+    const uint32_t frameSize = static_cast<uint32_t>(width * height * 2);
+    if (frame && frameSize <= FRAME_MAX_SIZE) {
+        memcpy(m_map + framebuffer.offset, frame, frameSize);
+        framebuffer.size = frameSize;
+        header->frameWidth = static_cast<uint16_t>(width);
+        header->frameHeight = static_cast<uint16_t>(height);
+        header->frameStride = static_cast<uint16_t>(width * 2);
+    } else {
+        framebuffer.size = 0;
+    }
+    header->frame = ++m_frames;
+    __atomic_store_n(&header->sequence, sequence + 2, __ATOMIC_RELEASE);
+    m_lastPublishUs = (nowNanos() - startNs) / 1000;
+}
@@ -0,0 +1,203 @@
+#include "thread_placement.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "jboy_log.h"
+
+#define LOG_TAG "JBOY_Threads"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+// android.os.Process.THREAD_PRIORITY_URGENT_DISPLAY / _AUDIO / _URGENT_AUDIO.
+constexpr int NICE_URGENT_DISPLAY = -8;
+constexpr int NICE_AUDIO = -16;
+constexpr int NICE_URGENT_AUDIO = -19;
+// Low end of the FIFO range: above every normal thread, below the audio HAL.
+constexpr int AUDIO_FIFO_PRIORITY = 2;
+constexpr int MAX_CPUS = 64;
+
+struct Topology {
+    int cpuCount = 0;
+    // Empty when the CPUs are uniform or could not be read.
+    uint64_t performanceMask = 0;
+    int performanceCount = 0;
+};
+
+std::atomic<bool> s_enabled{true};
+// Bumped by setEnabled so the emulation thread re-applies its placement.
+std::atomic<uint64_t> s_generation{1};
+std::atomic<int> s_audioPolicy{ThreadPlacement::AUDIO_UNCHANGED};
+
+long readSysfsNumber(const char* path) {
+    FILE* file = fopen(path, "re");
+    if (!file) {
+        return -1;
+    }
+    long value = -1;
+    if (fscanf(file, "%ld", &value) != 1) {
+        value = -1;
+    }
+    fclose(file);
+    return value;
+}
+
+Topology detectTopology() {
+    Topology topology;
+    long configured = sysconf(_SC_NPROCESSORS_CONF);
+    topology.cpuCount = static_cast<int>(configured > MAX_CPUS ? MAX_CPUS : (configured > 0 ? configured : 1));
+
+    long scores[MAX_CPUS] = {};
+    // cpu_capacity is the scheduler's own view; max frequency is the next best guess.
+    const char* sources[] = {"/sys/devices/system/cpu/cpu%d/cpu_capacity",
+                             "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq"};
+    const char* used = nullptr;
+    for (const char* format : sources) {
+        bool complete = true;
+        char path[96];
+        for (int cpu = 0; cpu < topology.cpuCount && complete; ++cpu) {
+            snprintf(path, sizeof(path), format, cpu);
+            scores[cpu] = readSysfsNumber(path);
+            complete = scores[cpu] > 0;
+        }
+        if (complete) {
+            used = format;
+            break;
+        }
+    }
+    if (!used) {
+        LOGD("CPU capacities unavailable; threads stay unpinned");
+        return topology;
+    }
+
+    topology.performanceMask = ThreadPlacement::selectPerformanceCores(scores, topology.cpuCount);
+    topology.performanceCount = __builtin_popcountll(topology.performanceMask);
+    LOGD("%d of %d CPUs are performance cores (mask 0x%llx, from %s)", topology.performanceCount,
+         topology.cpuCount, static_cast<unsigned long long>(topology.performanceMask),
+         strstr(used, "capacity") ? "cpu_capacity" : "max frequency");
+    if (topology.performanceCount == topology.cpuCount) {
+        // Uniform CPUs: pinning would only take freedom away from the scheduler.
+        topology.performanceMask = 0;
+    }
+    return topology;
+}
+
+const Topology& topology() {
+    static const Topology instance = detectTopology();
+    return instance;
+}
+
+bool setAffinity(uint64_t mask, int cpuCount) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < cpuCount; ++cpu) {
+        if (mask & (1ull << cpu)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    // pid 0 is the calling thread, not the whole process.
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+} // namespace
+
+void ThreadPlacement::setEnabled(bool enabled) {
+    if (s_enabled.exchange(enabled, std::memory_order_relaxed) != enabled) {
+        s_generation.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool ThreadPlacement::isEnabled() {
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+int ThreadPlacement::promoteAudioThread() {
+    int policy = AUDIO_UNCHANGED;
+    if (isEnabled()) {
+        sched_param param{};
+        param.sched_priority = AUDIO_FIFO_PRIORITY;
+        const int fifoError = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (fifoError == 0) {
+            policy = AUDIO_FIFO;
+        } else if (setpriority(PRIO_PROCESS, gettid(), NICE_URGENT_AUDIO) == 0 ||
+                   setpriority(PRIO_PROCESS, gettid(), NICE_AUDIO) == 0) {
+            policy = AUDIO_NICE;
+        }
+        LOGD("Audio thread %d: %s (SCHED_FIFO: %s)", gettid(),
+             policy == AUDIO_FIFO ? "SCHED_FIFO" : (policy == AUDIO_NICE ? "nice" : "unchanged"),
+             fifoError == 0 ? "granted" : strerror(fifoError));
+    }
+    s_audioPolicy.store(policy, std::memory_order_relaxed);
+    return policy;
+}
+
+int ThreadPlacement::getAudioPolicy() {
+    return s_audioPolicy.load(std::memory_order_relaxed);
+}
+
+uint64_t ThreadPlacement::selectPerformanceCores(const long* scores, int count) {
+    long best = 0;
+    for (int cpu = 0; cpu < count && cpu < MAX_CPUS; ++cpu) {
+        best = scores[cpu] > best ? scores[cpu] : best;
+    }
+    uint64_t mask = 0;
+    for (int cpu = 0; cpu < count && cpu < MAX_CPUS; ++cpu) {
+        if (scores[cpu] * 4 >= best * 3) {
+            mask |= 1ull << cpu;
+        }
+    }
+    return mask;
+}
+
+int ThreadPlacement::getPerformanceCoreCount() {
+    return topology().performanceCount;
+}
+
+void ThreadPlacement::onEmulationFrame() {
+    const pid_t tid = gettid();
+    const uint64_t generation = s_generation.load(std::memory_order_relaxed);
+    if (tid != m_tid || generation != m_generation) {
+        if (tid != m_tid) {
+            // A new thread starts with nothing of ours to undo.
+            m_pinned = false;
+            m_boosted = false;
+        }
+        m_tid = tid;
+        m_generation = generation;
+        placeCurrentThread(isEnabled());
+    }
+    m_lastCpu = sched_getcpu();
+    const uint64_t mask = topology().performanceMask;
+    if (mask && m_lastCpu >= 0 && m_lastCpu < MAX_CPUS && !(mask & (1ull << m_lastCpu))) {
+        ++m_offPerformanceFrames;
+    }
+}
+
+void ThreadPlacement::placeCurrentThread(bool enabled) {
+    const Topology& cpus = topology();
+    if (enabled) {
+        m_pinned = cpus.performanceMask != 0 && setAffinity(cpus.performanceMask, cpus.cpuCount);
+        m_boosted = setpriority(PRIO_PROCESS, gettid(), NICE_URGENT_DISPLAY) == 0;
+    } else {
+        // Undo only what this thread did, in case the caller tuned it itself.
+        if (m_pinned) {
+            setAffinity(cpus.cpuCount >= MAX_CPUS ? ~0ull : (1ull << cpus.cpuCount) - 1, cpus.cpuCount);
+        }
+        if (m_boosted) {
+            setpriority(PRIO_PROCESS, gettid(), 0);
+        }
+        m_pinned = false;
+        m_boosted = false;
+    }
+    LOGD("Emulation thread %d: %s, %s", gettid(), m_pinned ? "pinned to performance cores" : "unpinned",
+         m_boosted ? "urgent priority" : "default priority");
+}
@@ -0,0 +1,238 @@
+#include "thumbnail_generator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <thread>
+
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba-util/audio-buffer.h>
+#include <mgba-util/vfs.h>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define JBOY_THUMB_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define JBOY_THUMB_SSE 1
+#endif
+
+#define LOG_TAG "JBOY_Thumbs"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+constexpr int SCREEN_WIDTH = 240;
+constexpr int SCREEN_HEIGHT = 160;
+constexpr int MAX_HALVINGS = 3;
+constexpr int MAX_THREADS = 4;
+constexpr size_t AUDIO_BUFFER_FRAMES = 1024;
+// Small files matter more than encode time for a library grid.
+constexpr int PNG_LEVEL = 6;
+
+// XBGR8 (R in the low byte), as mGBA's 32-bit mColor.
+uint32_t expand565(uint16_t c) {
+    const uint32_t r5 = c >> 11;
+    const uint32_t g6 = (c >> 5) & 0x3F;
+    const uint32_t b5 = c & 0x1F;
+    const uint32_t r = (r5 << 3) | (r5 >> 2);
+    const uint32_t g = (g6 << 2) | (g6 >> 4);
+    const uint32_t b = (b5 << 3) | (b5 >> 2);
+    return r | (g << 8) | (b << 16);
+}
+
+uint32_t average4(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        const uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) +
+                             ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+        out |= ((sum + 2) >> 2) << shift;
+    }
+    return out;
+}
+
+// 2x2 box filter on XBGR8. The vector paths average horizontally, then
+// vertically, with rounding each time: at most one step above the exact mean.
+void halve(const uint32_t* src, int width, int height, uint32_t* dst) {
+    const int outWidth = width / 2;
+    const int outHeight = height / 2;
+    for (int y = 0; y < outHeight; ++y) {
+        const uint32_t* row0 = src + (y * 2) * width;
+        const uint32_t* row1 = row0 + width;
+        uint32_t* out = dst + y * outWidth;
+        int x = 0;
+#if JBOY_THUMB_NEON
+        for (; x + 4 <= outWidth; x += 4) {
+            const uint32x4x2_t top = vld2q_u32(row0 + x * 2);
+            const uint32x4x2_t bottom = vld2q_u32(row1 + x * 2);
+            const uint8x16_t a = vrhaddq_u8(vreinterpretq_u8_u32(top.val[0]), vreinterpretq_u8_u32(top.val[1]));
+            const uint8x16_t b = vrhaddq_u8(vreinterpretq_u8_u32(bottom.val[0]), vreinterpretq_u8_u32(bottom.val[1]));
+            vst1q_u32(out + x, vreinterpretq_u32_u8(vrhaddq_u8(a, b)));
+        }
+#elif JBOY_THUMB_SSE
+        for (; x + 4 <= outWidth; x += 4) {
+            const __m128 t0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2)));
+            const __m128 t1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2 + 4)));
+            const __m128 b0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2)));
+            const __m128 b1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2 + 4)));
+            // Split each row into even and odd pixels.
+            const __m128i a = _mm_avg_epu8(_mm_castps_si128(_mm_shuffle_ps(t0, t1, _MM_SHUFFLE(2, 0, 2, 0))),
+                                           _mm_castps_si128(_mm_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 1, 3, 1))));
+            const __m128i b = _mm_avg_epu8(_mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0))),
+                                           _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1))));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_avg_epu8(a, b));
+        }
+#endif
+        for (; x < outWidth; ++x) {
+            out[x] = average4(row0[x * 2], row0[x * 2 + 1], row1[x * 2], row1[x * 2 + 1]);
+        }
+    }
+}
+
+} // namespace
+
+struct ThumbnailGenerator::Scratch {
+    mColor video[SCREEN_WIDTH * SCREEN_HEIGHT];
+    uint32_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
+    uint32_t half[SCREEN_WIDTH * SCREEN_HEIGHT / 4];
+    uint8_t rgb[SCREEN_WIDTH * SCREEN_HEIGHT * 3];
+    int16_t audio[AUDIO_BUFFER_FRAMES * 2];
+    std::vector<uint8_t> png;
+};
+
+int ThumbnailGenerator::run(const std::vector<Job>& jobs, int frames, int halvings, int threads) {
+    std::lock_guard<std::mutex> lock(m_runMutex);
+    m_cancelled.store(false, std::memory_order_relaxed);
+    if (jobs.empty()) {
+        return 0;
+    }
+    frames = std::max(frames, 1);
+    halvings = std::max(0, std::min(halvings, MAX_HALVINGS));
+    if (threads <= 0) {
+        // Leave cores for the UI and a running game.
+        threads = static_cast<int>(std::thread::hardware_concurrency()) / 2;
+    }
+    threads = std::max(1, std::min({threads, MAX_THREADS, static_cast<int>(jobs.size())}));
+
+    const int64_t startNs = nowNanos();
+    std::atomic<size_t> next{0};
+    std::atomic<int> written{0};
+    auto worker = [&]() {
+        std::unique_ptr<Scratch> scratch(new Scratch());
+        while (!m_cancelled.load(std::memory_order_relaxed)) {
+            const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= jobs.size()) {
+                break;
+            }
+            if (renderOne(jobs[index], frames, halvings, *scratch)) {
+                written.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (int i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    LOGD("Thumbnails: %d/%zu written in %lld ms on %d threads%s", written.load(), jobs.size(),
+         static_cast<long long>((nowNanos() - startNs) / 1000000), threads,
+         m_cancelled.load() ? " (cancelled)" : "");
+    return written.load();
+}
+
+void ThumbnailGenerator::cancel() {
+    m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool ThumbnailGenerator::renderOne(const Job& job, int frames, int halvings, Scratch& scratch) {
+    struct mCore* core = mCoreCreate(mPLATFORM_GBA);
+    if (!core) {
+        LOGE("Thumbnail: failed to create core");
+        return false;
+    }
+    core->init(core);
+    // No port: the user's mGBA config must not leak into a headless boot.
+    mCoreInitConfig(core, nullptr);
+    core->opts.useBios = false;
+    core->opts.skipBios = true;
+    core->opts.mute = true;
+    core->setVideoBuffer(core, scratch.video, SCREEN_WIDTH);
+    core->setAudioBufferSize(core, AUDIO_BUFFER_FRAMES);
+
+    bool ok = false;
+    struct VFile* vf = VFileOpen(job.romPath.c_str(), O_RDONLY);
+    if (!vf) {
+        LOGE("Thumbnail: failed to open %s", job.romPath.c_str());
+    } else if (!core->loadROM(core, vf)) {
+        LOGE("Thumbnail: failed to load %s", job.romPath.c_str());
+        vf->close(vf);
+    } else {
+        // No save file is attached, so the boot never touches the player's saves.
+        core->reset(core);
+        struct GBA* gba = static_cast<struct GBA*>(core->board);
+        for (int frame = 0; frame < frames && !m_cancelled.load(std::memory_order_relaxed); ++frame) {
+            // Same trick as frame skip: only the last frame goes through the PPU.
+            if (frame + 1 < frames && gba->video.frameskipCounter <= 0) {
+                gba->video.frameskipCounter = 1;
+            }
+            core->runFrame(core);
+            if (core->getAudioBuffer) {
+                struct mAudioBuffer* audio = core->getAudioBuffer(core);
+                while (audio && mAudioBufferAvailable(audio) > 0) {
+                    mAudioBufferRead(audio, scratch.audio, AUDIO_BUFFER_FRAMES);
+                }
+            }
+            if (frame + 1 == frames) {
+                ok = true;
+            }
+        }
+        core->unloadROM(core);
+    }
+    mCoreConfigDeinit(&core->config);
+    core->deinit(core);
+    if (!ok) {
+        return false;
+    }
+
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; ++i) {
+        if (sizeof(mColor) == 2) {
+            scratch.pixels[i] = expand565(static_cast<uint16_t>(scratch.video[i]));
+        } else {
+            scratch.pixels[i] = static_cast<uint32_t>(scratch.video[i]);
+        }
+    }
+    int width = SCREEN_WIDTH;
+    int height = SCREEN_HEIGHT;
+    const uint32_t* pixels = scratch.pixels;
+    for (int i = 0; i < halvings; ++i) {
+        // Ping-pong between the two buffers; each step fits in the first quarter.
+        uint32_t* target = (pixels == scratch.pixels) ? scratch.half : scratch.pixels;
+        halve(pixels, width, height, target);
+        width /= 2;
+        height /= 2;
+        pixels = target;
+    }
+    for (int i = 0; i < width * height; ++i) {
+        const uint32_t c = pixels[i];
+        scratch.rgb[i * 3] = static_cast<uint8_t>(c);
+        scratch.rgb[i * 3 + 1] = static_cast<uint8_t>(c >> 8);
+        scratch.rgb[i * 3 + 2] = static_cast<uint8_t>(c >> 16);
+    }
+    if (!encodePngRgb(scratch.rgb, width, height, PNG_LEVEL, scratch.png)) {
+        LOGE("Thumbnail: PNG encode failed for %s", job.romPath.c_str());
+        return false;
+    }
+    return writeFileAtomic(job.outPath, scratch.png.data(), scratch.png.size());
+}
@@ -0,0 +1,182 @@
+// Reference reader for the state export region (see include/state_export.h).
+//
+// Connects to the abstract socket, receives the region's fd, checks that it
+// cannot be mapped writable, and then follows the game for a number of
+// frames using the seqlock protocol. It prints one line per consistent frame
+// with an FNV-1a hash of the region data, and exits non-zero on a protocol
+// violation. It needs only the C++ standard library and that header, so it
+// builds for a device with the NDK's clang:
+//     aarch64-linux-android26-clang++ -std=c++17 -static-libstdc++ \
+//         -I app/src/main/cpp/include app/src/main/cpp/tools/state_export_reader.cpp
+//     adb push a.out /data/local/tmp/state_export_reader
+//     adb shell /data/local/tmp/state_export_reader 600
+
+#include "state_export.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr auto CONNECT_TIMEOUT = std::chrono::seconds(5);
+// Longest wait for the next frame before giving up (the game may be paused).
+constexpr auto FRAME_TIMEOUT = std::chrono::seconds(5);
+
+int connectToExport() {
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path + 1, STATE_EXPORT_SOCKET, sizeof(STATE_EXPORT_SOCKET) - 1);
+    const socklen_t addressSize = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + sizeof(STATE_EXPORT_SOCKET));
+    const auto deadline = std::chrono::steady_clock::now() + CONNECT_TIMEOUT;
+    for (;;) {
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), addressSize) == 0) {
+            return fd;
+        }
+        close(fd);
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return -1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+// The region's fd and size, or -1 when the server sent none (refused peer).
+int receiveFd(int socketFd, uint32_t* size) {
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    struct iovec iov = {size, sizeof(*size)};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t received;
+    do {
+        received = recvmsg(socketFd, &msg, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+    const struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (received != static_cast<ssize_t>(sizeof(*size)) || !cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+        cmsg->cmsg_type != SCM_RIGHTS) {
+        return -1;
+    }
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+    return fd;
+}
+
+uint32_t hashRegions(const uint8_t* copy) {
+    const StateExportHeader* header = reinterpret_cast<const StateExportHeader*>(copy);
+    uint32_t hash = 2166136261u;
+    for (const StateExportHeader::Region& region : header->regions) {
+        for (uint32_t i = 0; i < region.size; ++i) {
+            hash = (hash ^ copy[region.offset + i]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const long frames = argc > 1 ? strtol(argv[1], nullptr, 10) : 60;
+
+    const int socketFd = connectToExport();
+    if (socketFd < 0) {
+        fprintf(stderr, "connect: %s (is state export enabled?)\n", strerror(errno));
+        return 1;
+    }
+    uint32_t size = 0;
+    const int fd = receiveFd(socketFd, &size);
+    close(socketFd);
+    if (fd < 0 || size < sizeof(StateExportHeader)) {
+        fprintf(stderr, "no region received (this uid may not be allowed)\n");
+        return 1;
+    }
+
+    void* writable = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (writable != MAP_FAILED) {
+        fprintf(stderr, "region can be mapped writable\n");
+        return 1;
+    }
+    const uint8_t* map = static_cast<const uint8_t*>(mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0));
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "mmap: %s\n", strerror(errno));
+        return 1;
+    }
+    const StateExportHeader* header = reinterpret_cast<const StateExportHeader*>(map);
+    if (header->magic != STATE_EXPORT_MAGIC || header->version != STATE_EXPORT_VERSION ||
+        header->headerSize != sizeof(StateExportHeader)) {
+        fprintf(stderr, "unexpected header: magic %08x version %u size %u\n", header->magic, header->version,
+                header->headerSize);
+        return 1;
+    }
+    printf("region %u bytes, version %u\n", size, header->version);
+
+    std::vector<uint8_t> copy(size);
+    const StateExportHeader* snapshot = reinterpret_cast<const StateExportHeader*>(copy.data());
+    long read = 0;
+    long retries = 0;
+    long skipped = 0;
+    uint64_t lastFrame = 0;
+    uint32_t lastSequence = 0;
+    auto deadline = std::chrono::steady_clock::now() + FRAME_TIMEOUT;
+    while (read < frames) {
+        const uint32_t sequence = __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE);
+        if (sequence & 1) {
+            ++retries;
+            continue;
+        }
+        memcpy(copy.data(), map, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&header->sequence, __ATOMIC_RELAXED) != sequence) {
+            ++retries;
+            continue;
+        }
+        if (snapshot->frame == lastFrame) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                fprintf(stderr, "no new frame after frame %llu\n", static_cast<unsigned long long>(lastFrame));
+                return 1;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        // `frame` restarts with each ROM, `sequence` only ever grows.
+        if (static_cast<int32_t>(sequence - lastSequence) <= 0) {
+            fprintf(stderr, "sequence went from %u to %u\n", lastSequence, sequence);
+            return 1;
+        }
+        lastSequence = sequence;
+        for (const StateExportHeader::Region& region : snapshot->regions) {
+            if (region.size != 0 && (region.offset < sizeof(StateExportHeader) || region.offset > size ||
+                                     region.size > size - region.offset)) {
+                fprintf(stderr, "region at %u+%u is outside the mapping\n", region.offset, region.size);
+                return 1;
+            }
+        }
+        if (lastFrame != 0 && snapshot->frame > lastFrame + 1) {
+            skipped += static_cast<long>(snapshot->frame - lastFrame - 1);
+        }
+        lastFrame = snapshot->frame;
+        deadline = std::chrono::steady_clock::now() + FRAME_TIMEOUT;
+        printf("frame %llu ewram %u iwram %u io %u fb %ux%u hash %08x\n", static_cast<unsigned long long>(lastFrame),
+               snapshot->regions[STATE_EXPORT_EWRAM].size, snapshot->regions[STATE_EXPORT_IWRAM].size,
+               snapshot->regions[STATE_EXPORT_IO].size, snapshot->frameWidth, snapshot->frameHeight,
+               hashRegions(copy.data()));
+        ++read;
+    }
+    printf("read %ld frames, %ld retries, %ld skipped\n", read, retries, skipped);
+    return 0;
+}
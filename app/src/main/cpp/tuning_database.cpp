@@ -0,0 +1,171 @@
+#include "tuning_database.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <mgba/core/core.h>
+#include <mgba/internal/gba/gba.h>
+
+#include "jboy_log.h"
+#include "native_util.h"
+
+#define LOG_TAG "JBOY_Tuning"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+// Seed hints, valid for every revision of a title. Loop addresses themselves
+// come from mGBA's built-in override table or from detection, never from here:
+// a wrong address stalls the game, while a detection hint only starts mGBA's
+// own verified search.
+const TuningDatabase::Entry kSeedEntries[] = {
+    {"AXVE", 0, IDLE_LOOP_NONE, TuningDatabase::IDLE_HINT_DETECT}, // Pokemon Ruby
+    {"AXPE", 0, IDLE_LOOP_NONE, TuningDatabase::IDLE_HINT_DETECT}, // Pokemon Sapphire
+    {"BPEE", 0, IDLE_LOOP_NONE, TuningDatabase::IDLE_HINT_DETECT}, // Pokemon Emerald
+    {"BPRE", 0, IDLE_LOOP_NONE, TuningDatabase::IDLE_HINT_DETECT}, // Pokemon FireRed
+    {"BPGE", 0, IDLE_LOOP_NONE, TuningDatabase::IDLE_HINT_DETECT}, // Pokemon LeafGreen
+    {"BZME", 0, IDLE_LOOP_NONE, TuningDatabase::IDLE_HINT_DETECT}, // Zelda: The Minish Cap
+    {"AGSE", 0, IDLE_LOOP_NONE, TuningDatabase::IDLE_HINT_DETECT}, // Golden Sun
+    {"AE7E", 0, IDLE_LOOP_NONE, TuningDatabase::IDLE_HINT_DETECT}, // Fire Emblem
+    {"AMTE", 0, IDLE_LOOP_NONE, TuningDatabase::IDLE_HINT_DETECT}, // Metroid Fusion
+    {"BMXE", 0, IDLE_LOOP_NONE, TuningDatabase::IDLE_HINT_DETECT}, // Metroid: Zero Mission
+};
+
+const char* const kFileHeader = "# JBoy tuning database: <code> <crc32> <idleLoop> <idleHint>\n";
+
+bool codeEquals(const char* a, const char* b) {
+    return strncmp(a, b, 4) == 0;
+}
+
+} // namespace
+
+void TuningDatabase::open(const std::string& path) {
+    m_path = path;
+    m_entries.clear();
+    if (path.empty()) {
+        return;
+    }
+    std::vector<uint8_t> data;
+    if (!readWholeFile(path, data)) {
+        return;
+    }
+    data.push_back('\0');
+    const char* line = reinterpret_cast<const char*>(data.data());
+    while (*line) {
+        const char* next = strchr(line, '\n');
+        Entry entry = {};
+        unsigned crc = 0;
+        unsigned idleLoop = 0;
+        if (line[0] != '#' &&
+            sscanf(line, "%4s %x %x %d", entry.gameCode, &crc, &idleLoop, &entry.idleHint) == 4) {
+            entry.crc32 = crc;
+            entry.idleLoop = idleLoop;
+            m_entries.push_back(entry);
+        }
+        if (!next) {
+            break;
+        }
+        line = next + 1;
+    }
+    LOGD("Loaded %zu tuning entries from %s", m_entries.size(), path.c_str());
+}
+
+bool TuningDatabase::lookup(const char* gameCode, uint32_t crc32, Entry* out) const {
+    for (const Entry& entry : m_entries) {
+        if (entry.crc32 == crc32 && codeEquals(entry.gameCode, gameCode)) {
+            *out = entry;
+            return true;
+        }
+    }
+    for (const Entry& entry : kSeedEntries) {
+        if (codeEquals(entry.gameCode, gameCode)) {
+            *out = entry;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TuningDatabase::readGameCode(struct mCore* core, char out[5]) {
+    if (!core || !core->getGameInfo || core->platform(core) != mPLATFORM_GBA) {
+        return false;
+    }
+    struct mGameInfo info;
+    memset(&info, 0, sizeof(info));
+    core->getGameInfo(core, &info);
+    memcpy(out, info.code, 4);
+    out[4] = '\0';
+    return out[0] != '\0';
+}
+
+void TuningDatabase::apply(struct mCore* core, uint32_t crc32, int userIdleMode) const {
+    char code[5];
+    Entry entry;
+    if (userIdleMode == IDLE_HINT_IGNORE || !readGameCode(core, code) || !lookup(code, crc32, &entry)) {
+        return;
+    }
+    auto* gba = static_cast<struct GBA*>(core->board);
+    if (entry.idleHint == IDLE_HINT_IGNORE) {
+        gba->idleOptimization = IDLE_LOOP_IGNORE;
+        LOGD("%s: idle loop removal disabled by tuning", code);
+    } else if (entry.idleLoop != IDLE_LOOP_NONE) {
+        // Same effect as an mGBA override: a known loop is removed, not searched for.
+        gba->idleLoop = entry.idleLoop;
+        gba->idleOptimization = IDLE_LOOP_REMOVE;
+        LOGD("%s: idle loop %08X from tuning", code, entry.idleLoop);
+    } else if (entry.idleHint == IDLE_HINT_DETECT && gba->idleLoop == IDLE_LOOP_NONE) {
+        gba->idleOptimization = IDLE_LOOP_DETECT;
+        LOGD("%s: idle loop detection enabled by tuning", code);
+    }
+}
+
+TuningDatabase::Entry* TuningDatabase::findExact(const char* gameCode, uint32_t crc32) {
+    for (Entry& entry : m_entries) {
+        if (entry.crc32 == crc32 && codeEquals(entry.gameCode, gameCode)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void TuningDatabase::capture(struct mCore* core, uint32_t crc32) {
+    char code[5];
+    if (!readGameCode(core, code)) {
+        return;
+    }
+    const auto* gba = static_cast<const struct GBA*>(core->board);
+    if (gba->idleLoop == IDLE_LOOP_NONE || gba->idleOptimization == IDLE_LOOP_IGNORE) {
+        return;
+    }
+    Entry* entry = findExact(code, crc32);
+    if (entry && entry->idleLoop == gba->idleLoop) {
+        return;
+    }
+    if (!entry) {
+        Entry created = {};
+        memcpy(created.gameCode, code, sizeof(created.gameCode));
+        created.crc32 = crc32;
+        created.idleHint = IDLE_HINT_DEFAULT;
+        m_entries.push_back(created);
+        entry = &m_entries.back();
+    }
+    entry->idleLoop = gba->idleLoop;
+    LOGD("%s: recorded idle loop %08X", code, entry->idleLoop);
+    if (!save()) {
+        LOGE("Failed to write tuning database %s", m_path.c_str());
+    }
+}
+
+bool TuningDatabase::save() const {
+    if (m_path.empty()) {
+        return true;
+    }
+    std::string text = kFileHeader;
+    char line[64];
+    for (const Entry& entry : m_entries) {
+        snprintf(line, sizeof(line), "%s %08X %08X %d\n", entry.gameCode, entry.crc32, entry.idleLoop, entry.idleHint);
+        text += line;
+    }
+    return writeFileAtomic(m_path, text.data(), text.size());
+}
@@ -1,19 +1,22 @@
-#include <GLES2/gl2.h>
+#include "video_renderer.h"
+
+#include <GLES2/gl2ext.h>
 #include <EGL/egl.h>
-#include <android/log.h>
 #include <cstdint>
 #include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 
-#define LOG_TAG "JBOY_Video"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#include "jboy_log.h"
+#include "native_util.h"
 
-// GB屏幕分辨率
-const int GB_SCREEN_WIDTH = 160;
-const int GB_SCREEN_HEIGHT = 144;
+#define LOG_TAG "JBOY_Video"
+#define LOGD(...) JBOY_LOGD(LOG_TAG, __VA_ARGS__)
+#define LOGE(...) JBOY_LOGE(LOG_TAG, __VA_ARGS__)
 
-// 简单的顶点着色器
-const char* vertexShaderSource = R"(
+// 所有 pass 共用的顶点着色器
+static const char* vertexShaderSource = R"(
     attribute vec2 a_position;
     attribute vec2 a_texCoord;
     varying vec2 v_texCoord;
@@ -23,110 +26,354 @@ const char* vertexShaderSource = R"(
     }
 )";
 
-// 简单的片段着色器
-const char* fragmentShaderSource = R"(
+// 所有片段着色器共用的前缀
+static const char* fragmentHeaderSource = R"(
+    #ifdef GL_FRAGMENT_PRECISION_HIGH
+    precision highp float;
+    #else
     precision mediump float;
+    #endif
     varying vec2 v_texCoord;
     uniform sampler2D u_texture;
+    uniform vec2 u_sourceSize;
+    uniform vec2 u_outputSize;
+)";
+
+// 直通
+static const char* passthroughShaderSource = R"(
     void main() {
         gl_FragColor = texture2D(u_texture, v_texCoord);
     }
 )";
 
-class VideoRenderer {
-public:
-    VideoRenderer();
-    ~VideoRenderer();
-    
-    bool initialize();
-    void shutdown();
-    void renderFrame(const uint8_t* frameBuffer);
-    void updateScreenSize(int width, int height);
-    
-private:
-    bool compileShader(GLuint& shader, GLenum type, const char* source);
-    bool createProgram();
-    
-    GLuint m_program = 0;
-    GLuint m_texture = 0;
-    GLuint m_vertexBuffer = 0;
-    GLint m_positionLoc = -1;
-    GLint m_texCoordLoc = -1;
-    GLint m_textureLoc = -1;
-    
-    int m_screenWidth = 0;
-    int m_screenHeight = 0;
-    
-    // RGB565帧缓冲区
-    uint16_t m_frameBuffer[GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT];
+// CRT 第一步：横向荧光扩散
+static const char* crtBleedShaderSource = R"(
+    void main() {
+        vec2 dx = vec2(1.0 / u_sourceSize.x, 0.0);
+        vec3 c = texture2D(u_texture, v_texCoord).rgb * 0.6;
+        c += texture2D(u_texture, v_texCoord - dx).rgb * 0.2;
+        c += texture2D(u_texture, v_texCoord + dx).rgb * 0.2;
+        gl_FragColor = vec4(c, 1.0);
+    }
+)";
+
+// CRT 第二步：随亮度变化的扫描线 + 荫罩
+static const char* crtScanlineShaderSource = R"(
+    void main() {
+        vec2 pixel = v_texCoord * u_sourceSize;
+        float dy = fract(pixel.y) - 0.5;
+        vec2 uv = vec2(v_texCoord.x, (floor(pixel.y) + 0.5) / u_sourceSize.y);
+        vec3 c = pow(texture2D(u_texture, uv).rgb, vec3(2.4));
+        float lum = dot(c, vec3(0.299, 0.587, 0.114));
+        float width = mix(0.30, 0.48, lum);
+        float scan = exp(-(dy * dy) / (2.0 * width * width));
+        float m = mod(floor(gl_FragCoord.x), 3.0);
+        vec3 mask = vec3(0.85);
+        if (m < 1.0) {
+            mask.r = 1.15;
+        } else if (m < 2.0) {
+            mask.g = 1.15;
+        } else {
+            mask.b = 1.15;
+        }
+        c = pow(c * scan * mask * 1.25, vec3(1.0 / 2.2));
+        gl_FragColor = vec4(clamp(c, 0.0, 1.0), 1.0);
+    }
+)";
+
+// xBR-lv2（Hyllian），在 3 倍 FBO 上运行，输入需为最邻近采样
+static const char* xbrShaderSource = R"(
+    const float XBR_EQ_THRESHOLD = 0.06;
+    const float XBR_LV2_COEFFICIENT = 2.0;
+    const vec3 Y = vec3(0.2126, 0.7152, 0.0722);
+    const vec4 Ao = vec4(1.0, -1.0, -1.0, 1.0);
+    const vec4 Bo = vec4(1.0, 1.0, -1.0, -1.0);
+    const vec4 Co = vec4(1.5, 0.5, -0.5, 0.5);
+    const vec4 Ax = vec4(1.0, -1.0, -1.0, 1.0);
+    const vec4 Bx = vec4(0.5, 2.0, -0.5, -2.0);
+    const vec4 Cx = vec4(1.0, 1.0, -0.5, 0.0);
+    const vec4 Ay = vec4(1.0, -1.0, -1.0, 1.0);
+    const vec4 By = vec4(2.0, 0.5, -2.0, -0.5);
+    const vec4 Cy = vec4(2.0, 0.0, -1.0, 0.5);
+    const vec4 Ci = vec4(0.25);
+
+    vec4 df(vec4 a, vec4 b) { return abs(a - b); }
+    float cdf(vec3 a, vec3 b) { vec3 d = abs(a - b); return d.r + d.g + d.b; }
+    vec4 eq(vec4 a, vec4 b) { return vec4(lessThan(df(a, b), vec4(XBR_EQ_THRESHOLD))); }
+    vec4 neq(vec4 a, vec4 b) { return vec4(notEqual(a, b)); }
+    vec4 luma(vec3 a, vec3 b, vec3 c, vec3 d) { return vec4(dot(a, Y), dot(b, Y), dot(c, Y), dot(d, Y)); }
+    vec4 wd(vec4 a, vec4 b, vec4 c, vec4 d, vec4 e, vec4 f, vec4 g, vec4 h) {
+        return df(a, b) + df(a, c) + df(d, e) + df(d, f) + 4.0 * df(g, h);
+    }
+    vec3 fetch(vec2 uv) { return texture2D(u_texture, uv).rgb; }
+
+    void main() {
+        vec2 pixel = v_texCoord * u_sourceSize;
+        vec2 fp = fract(pixel);
+        vec2 tc = (floor(pixel) + 0.5) / u_sourceSize;
+        vec2 dx = vec2(1.0 / u_sourceSize.x, 0.0);
+        vec2 dy = vec2(0.0, 1.0 / u_sourceSize.y);
+
+        vec3 A1 = fetch(tc - dx - 2.0 * dy);
+        vec3 B1 = fetch(tc - 2.0 * dy);
+        vec3 C1 = fetch(tc + dx - 2.0 * dy);
+        vec3 A0 = fetch(tc - 2.0 * dx - dy);
+        vec3 A = fetch(tc - dx - dy);
+        vec3 B = fetch(tc - dy);
+        vec3 C = fetch(tc + dx - dy);
+        vec3 C4 = fetch(tc + 2.0 * dx - dy);
+        vec3 D0 = fetch(tc - 2.0 * dx);
+        vec3 D = fetch(tc - dx);
+        vec3 E = fetch(tc);
+        vec3 F = fetch(tc + dx);
+        vec3 F4 = fetch(tc + 2.0 * dx);
+        vec3 G0 = fetch(tc - 2.0 * dx + dy);
+        vec3 G = fetch(tc - dx + dy);
+        vec3 H = fetch(tc + dy);
+        vec3 I = fetch(tc + dx + dy);
+        vec3 I4 = fetch(tc + 2.0 * dx + dy);
+        vec3 G5 = fetch(tc - dx + 2.0 * dy);
+        vec3 H5 = fetch(tc + 2.0 * dy);
+        vec3 I5 = fetch(tc + dx + 2.0 * dy);
+
+        vec4 b = luma(B, D, H, F);
+        vec4 c = luma(C, A, G, I);
+        vec4 e = vec4(dot(E, Y));
+        vec4 d = b.yzwx;
+        vec4 f = b.wxyz;
+        vec4 g = c.zwxy;
+        vec4 h = b.zwxy;
+        vec4 i = c.wxyz;
+        vec4 i4 = luma(I4, C1, A0, G5);
+        vec4 i5 = luma(I5, C4, A1, G0);
+        vec4 h5 = luma(H5, F4, B1, D0);
+        vec4 f4 = h5.yzwx;
+
+        vec4 fx = Ao * fp.y + Bo * fp.x;
+        vec4 fxLeft = Ax * fp.y + Bx * fp.x;
+        vec4 fxUp = Ay * fp.y + By * fp.x;
+
+        vec4 lv0 = neq(e, f) * neq(e, h);
+        vec4 lv1 = lv0 * clamp((1.0 - eq(f, b)) * (1.0 - eq(h, d))
+            + eq(e, i) * (1.0 - eq(f, i4)) * (1.0 - eq(h, i5))
+            + eq(e, g) + eq(e, c), 0.0, 1.0);
+        vec4 lv2Left = neq(e, g) * neq(d, g);
+        vec4 lv2Up = neq(e, c) * neq(b, c);
+
+        vec4 delta = vec4(u_sourceSize.x / u_outputSize.x);
+        vec4 fx45i = clamp((fx + delta - Co - Ci) / (2.0 * delta), 0.0, 1.0);
+        vec4 fx45 = clamp((fx + delta - Co) / (2.0 * delta), 0.0, 1.0);
+        vec4 fx30 = clamp((fxLeft + delta - Cx) / (2.0 * delta), 0.0, 1.0);
+        vec4 fx60 = clamp((fxUp + delta - Cy) / (2.0 * delta), 0.0, 1.0);
+
+        vec4 wd1 = wd(e, c, g, i, h5, f4, h, f);
+        vec4 wd2 = wd(h, d, i5, f, i4, b, e, i);
+
+        vec4 edri = vec4(lessThanEqual(wd1, wd2)) * lv0;
+        vec4 edr = vec4(lessThan(wd1, wd2)) * lv1;
+        vec4 edrLeft = vec4(lessThanEqual(XBR_LV2_COEFFICIENT * df(f, g), df(h, c))) * lv2Left * edr;
+        vec4 edrUp = vec4(greaterThanEqual(df(f, g), XBR_LV2_COEFFICIENT * df(h, c))) * lv2Up * edr;
+
+        fx45 = edr * fx45;
+        fx30 = edrLeft * fx30;
+        fx60 = edrUp * fx60;
+        fx45i = edri * fx45i;
+
+        vec4 px = vec4(lessThanEqual(df(e, f), df(e, h)));
+        vec4 maximos = max(max(fx30, fx60), max(fx45, fx45i));
+
+        vec3 res1 = E;
+        res1 = mix(res1, mix(H, F, px.x), maximos.x);
+        res1 = mix(res1, mix(B, D, px.z), maximos.z);
+        vec3 res2 = E;
+        res2 = mix(res2, mix(F, B, px.y), maximos.y);
+        res2 = mix(res2, mix(D, H, px.w), maximos.w);
+        vec3 res = mix(res1, res2, step(cdf(E, res1), cdf(E, res2)));
+        gl_FragColor = vec4(res, 1.0);
+    }
+)";
+
+// LCD 第一步：GBA 屏幕色彩校正（偏暗、低饱和）
+static const char* lcdColorShaderSource = R"(
+    void main() {
+        vec3 c = pow(texture2D(u_texture, v_texCoord).rgb, vec3(2.4));
+        mat3 lcd = mat3(
+            0.82, 0.24, -0.06,
+            0.125, 0.665, 0.21,
+            0.195, 0.075, 0.73);
+        c = clamp(lcd * c * 0.94, 0.0, 1.0);
+        gl_FragColor = vec4(pow(c, vec3(1.0 / 2.2)), 1.0);
+    }
+)";
+
+// LCD 第二步：像素网格
+static const char* lcdGridShaderSource = R"(
+    void main() {
+        vec2 pixel = v_texCoord * u_sourceSize;
+        vec2 scale = max(u_outputSize / u_sourceSize, vec2(1.0));
+        vec2 dist = abs(fract(pixel) - 0.5) * 2.0;
+        vec2 edge = vec2(smoothstep(1.0 - 2.0 / scale.x, 1.0, dist.x),
+                         smoothstep(1.0 - 2.0 / scale.y, 1.0, dist.y));
+        float grid = 1.0 - 0.35 * max(edge.x, edge.y);
+        vec3 c = texture2D(u_texture, (floor(pixel) + 0.5) / u_sourceSize).rgb;
+        gl_FragColor = vec4(c * grid, 1.0);
+    }
+)";
+
+struct ShaderPassDesc {
+    const char* fragmentSource;
+    int scale;          // 相对输入尺寸的 FBO 倍数；最后一个 pass 忽略，直接输出到屏幕
+    bool linearInput;   // 本 pass 采样输入纹理时是否使用线性过滤
+};
+
+struct ShaderPresetDesc {
+    const char* name;
+    int passCount;
+    ShaderPassDesc passes[VideoRenderer::MAX_PASSES];
 };
 
-VideoRenderer::VideoRenderer() {
-    std::memset(m_frameBuffer, 0, sizeof(m_frameBuffer));
+static const ShaderPresetDesc SHADER_PRESETS[SHADER_PRESET_COUNT] = {
+    { "nearest", 1, { { passthroughShaderSource, 1, false } } },
+    { "linear", 1, { { passthroughShaderSource, 1, true } } },
+    { "crt", 2, { { crtBleedShaderSource, 1, false }, { crtScanlineShaderSource, 1, true } } },
+    { "xbr-lv2", 2, { { xbrShaderSource, 3, false }, { passthroughShaderSource, 1, true } } },
+    { "lcd", 2, { { lcdColorShaderSource, 1, false }, { lcdGridShaderSource, 1, false } } },
+};
+
+// 两个四边形：输出到屏幕时纹理坐标 y 向下；输出到 FBO 时上下翻转，
+// 使 FBO 纹理与源纹理保持同样的行序（第 0 行 = 画面顶部）
+static const float QUAD_VERTICES[] = {
+    // 屏幕
+    -1.0f, -1.0f,  0.0f, 1.0f,
+     1.0f, -1.0f,  1.0f, 1.0f,
+    -1.0f,  1.0f,  0.0f, 0.0f,
+     1.0f,  1.0f,  1.0f, 0.0f,
+    // FBO
+    -1.0f, -1.0f,  0.0f, 0.0f,
+     1.0f, -1.0f,  1.0f, 0.0f,
+    -1.0f,  1.0f,  0.0f, 1.0f,
+     1.0f,  1.0f,  1.0f, 1.0f
+};
+
+static const GLuint ATTRIB_POSITION = 0;
+static const GLuint ATTRIB_TEXCOORD = 1;
+
+static PFNGLGETPROGRAMBINARYOESPROC s_glGetProgramBinaryOES = nullptr;
+static PFNGLPROGRAMBINARYOESPROC s_glProgramBinaryOES = nullptr;
+
+static const char* glString(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+static void setTextureFilter(GLuint texture, bool linear) {
+    const GLint filter = linear ? GL_LINEAR : GL_NEAREST;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
 }
 
+VideoRenderer::VideoRenderer() = default;
+
 VideoRenderer::~VideoRenderer() {
     shutdown();
 }
 
-bool VideoRenderer::initialize() {
+bool VideoRenderer::initialize(const std::string& cacheDir) {
     LOGD("Initializing video renderer");
-    
-    // 创建着色器程序
-    if (!createProgram()) {
-        LOGE("Failed to create shader program");
-        return false;
+
+    m_cacheDir = cacheDir;
+    m_driverId = std::string(glString(GL_VENDOR)) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+
+    // 检查 program binary 扩展
+    m_binaryCacheSupported = false;
+    if (!m_cacheDir.empty() && strstr(glString(GL_EXTENSIONS), "GL_OES_get_program_binary")) {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+        s_glGetProgramBinaryOES = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glGetProgramBinaryOES"));
+        s_glProgramBinaryOES = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glProgramBinaryOES"));
+        m_binaryCacheSupported = formats > 0 && s_glGetProgramBinaryOES && s_glProgramBinaryOES;
+        if (m_binaryCacheSupported) {
+            mkdir(m_cacheDir.c_str(), 0700);
+        }
     }
-    
-    // 生成纹理
-    glGenTextures(1, &m_texture);
-    glBindTexture(GL_TEXTURE_2D, m_texture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
-    // 创建顶点缓冲区
+    LOGD("Program binary cache: %s", m_binaryCacheSupported ? "enabled" : "unavailable");
+
+    // 源纹理
+    glGenTextures(1, &m_sourceTexture);
+    glBindTexture(GL_TEXTURE_2D, m_sourceTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    m_sourceWidth = 0;
+    m_sourceHeight = 0;
+
+    // 顶点缓冲区只上传一次
     glGenBuffers(1, &m_vertexBuffer);
-    
-    // 获取uniform和attribute位置
-    m_positionLoc = glGetAttribLocation(m_program, "a_position");
-    m_texCoordLoc = glGetAttribLocation(m_program, "a_texCoord");
-    m_textureLoc = glGetUniformLocation(m_program, "u_texture");
-    
-    // 设置视口
-    glViewport(0, 0, m_screenWidth, m_screenHeight);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD_VERTICES), QUAD_VERTICES, GL_STATIC_DRAW);
+
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    if (!buildPipeline()) {
+        LOGE("Failed to build shader pipeline");
+        return false;
+    }
+
     LOGD("Video renderer initialized successfully");
     return true;
 }
 
 void VideoRenderer::shutdown() {
     LOGD("Shutting down video renderer");
-    
-    if (m_texture != 0) {
-        glDeleteTextures(1, &m_texture);
-        m_texture = 0;
+
+    releasePipeline();
+
+    if (m_sourceTexture != 0) {
+        glDeleteTextures(1, &m_sourceTexture);
+        m_sourceTexture = 0;
     }
-    
+
     if (m_vertexBuffer != 0) {
         glDeleteBuffers(1, &m_vertexBuffer);
         m_vertexBuffer = 0;
     }
-    
-    if (m_program != 0) {
-        glDeleteProgram(m_program);
-        m_program = 0;
+}
+
+void VideoRenderer::setPreset(int preset) {
+    if (preset < 0 || preset >= SHADER_PRESET_COUNT) {
+        preset = SHADER_PRESET_NEAREST;
+    }
+    if (preset == m_preset && m_pipelineReady) {
+        return;
+    }
+    m_preset = preset;
+    releasePipeline();
+    if (m_vertexBuffer != 0 && !buildPipeline()) {
+        LOGE("Failed to build shader preset %s", SHADER_PRESETS[preset].name);
     }
 }
 
-bool VideoRenderer::compileShader(GLuint& shader, GLenum type, const char* source) {
+void VideoRenderer::setScaleMode(int mode) {
+    m_scaleMode = mode;
+}
+
+void VideoRenderer::updateScreenSize(int width, int height) {
+    m_screenWidth = width;
+    m_screenHeight = height;
+}
+
+bool VideoRenderer::compileShader(GLuint& shader, GLenum type, const char* const* sources, int count) {
     shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, nullptr);
+    glShaderSource(shader, count, sources, nullptr);
     glCompileShader(shader);
-    
+
     GLint compiled = 0;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-    
+
     if (!compiled) {
         GLint infoLen = 0;
         glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
@@ -140,104 +387,286 @@ bool VideoRenderer::compileShader(GLuint& shader, GLenum type, const char* sourc
         shader = 0;
         return false;
     }
-    
+
     return true;
 }
 
-bool VideoRenderer::createProgram() {
+std::string VideoRenderer::getCachePath(const char* fragmentSource) const {
+    const char* parts[] = { vertexShaderSource, fragmentHeaderSource, fragmentSource, m_driverId.c_str() };
+    return programCachePath(m_cacheDir, parts, 4);
+}
+
+GLuint VideoRenderer::loadCachedProgram(const std::string& path) {
+    std::vector<uint8_t> data;
+    if (!readWholeFile(path, data)) {
+        return 0;
+    }
+    ProgramCacheHeader header;
+    if (!parseProgramCacheHeader(data.data(), data.size(), &header)) {
+        unlink(path.c_str());
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    s_glProgramBinaryOES(program, header.format, data.data() + sizeof(header), static_cast<GLint>(header.length));
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // 驱动升级后旧的 binary 会被拒绝，删掉后重新编译
+        glDeleteProgram(program);
+        unlink(path.c_str());
+        return 0;
+    }
+    return program;
+}
+
+void VideoRenderer::storeCachedProgram(const std::string& path, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<uint8_t> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    GLsizei written = 0;
+    s_glGetProgramBinaryOES(program, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+    const ProgramCacheHeader header = makeProgramCacheHeader(format, static_cast<uint32_t>(written));
+    const FileChunk chunks[] = {
+        { &header, sizeof(header) },
+        { binary.data(), static_cast<size_t>(written) }
+    };
+    if (!writeFileAtomic(path, chunks, 2)) {
+        LOGE("Failed to write program cache: %s", path.c_str());
+    }
+}
+
+GLuint VideoRenderer::loadProgram(const char* fragmentSource) {
+    std::string cachePath;
+    if (m_binaryCacheSupported) {
+        cachePath = getCachePath(fragmentSource);
+        const GLuint cached = loadCachedProgram(cachePath);
+        if (cached != 0) {
+            return cached;
+        }
+    }
+
     GLuint vertexShader = 0;
     GLuint fragmentShader = 0;
-    
-    if (!compileShader(vertexShader, GL_VERTEX_SHADER, vertexShaderSource)) {
-        return false;
+
+    if (!compileShader(vertexShader, GL_VERTEX_SHADER, &vertexShaderSource, 1)) {
+        return 0;
     }
-    
-    if (!compileShader(fragmentShader, GL_FRAGMENT_SHADER, fragmentShaderSource)) {
+
+    const char* fragmentSources[] = { fragmentHeaderSource, fragmentSource };
+    if (!compileShader(fragmentShader, GL_FRAGMENT_SHADER, fragmentSources, 2)) {
         glDeleteShader(vertexShader);
-        return false;
+        return 0;
     }
-    
-    m_program = glCreateProgram();
-    glAttachShader(m_program, vertexShader);
-    glAttachShader(m_program, fragmentShader);
-    glLinkProgram(m_program);
-    
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, ATTRIB_POSITION, "a_position");
+    glBindAttribLocation(program, ATTRIB_TEXCOORD, "a_texCoord");
+    glLinkProgram(program);
+
     GLint linked = 0;
-    glGetProgramiv(m_program, GL_LINK_STATUS, &linked);
-    
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
-    
+
     if (!linked) {
         GLint infoLen = 0;
-        glGetProgramiv(m_program, GL_INFO_LOG_LENGTH, &infoLen);
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLen);
         if (infoLen > 0) {
             char* infoLog = new char[infoLen];
-            glGetProgramInfoLog(m_program, infoLen, nullptr, infoLog);
+            glGetProgramInfoLog(program, infoLen, nullptr, infoLog);
             LOGE("Program linking failed: %s", infoLog);
             delete[] infoLog;
         }
-        glDeleteProgram(m_program);
-        m_program = 0;
-        return false;
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    if (m_binaryCacheSupported) {
+        storeCachedProgram(cachePath, program);
+    }
+    return program;
+}
+
+bool VideoRenderer::buildPipeline() {
+    const ShaderPresetDesc& preset = SHADER_PRESETS[m_preset];
+    const int64_t startNs = nowNanos();
+    for (int i = 0; i < preset.passCount; ++i) {
+        PassState& pass = m_passes[i];
+        pass.program = loadProgram(preset.passes[i].fragmentSource);
+        if (pass.program == 0) {
+            releasePipeline();
+            return false;
+        }
+        pass.textureLoc = glGetUniformLocation(pass.program, "u_texture");
+        pass.sourceSizeLoc = glGetUniformLocation(pass.program, "u_sourceSize");
+        pass.outputSizeLoc = glGetUniformLocation(pass.program, "u_outputSize");
+    }
+    m_passCount = preset.passCount;
+    m_pipelineReady = true;
+    LOGD("Shader preset %s ready in %lld us", preset.name,
+         static_cast<long long>((nowNanos() - startNs) / 1000));
+    return true;
+}
+
+void VideoRenderer::releasePipeline() {
+    for (PassState& pass : m_passes) {
+        if (pass.program != 0) {
+            glDeleteProgram(pass.program);
+        }
+        if (pass.framebuffer != 0) {
+            glDeleteFramebuffers(1, &pass.framebuffer);
+        }
+        if (pass.texture != 0) {
+            glDeleteTextures(1, &pass.texture);
+        }
+        pass = PassState();
+    }
+    m_passCount = 0;
+    m_pipelineReady = false;
+}
+
+bool VideoRenderer::ensurePassTargets(int sourceWidth, int sourceHeight) {
+    const ShaderPresetDesc& preset = SHADER_PRESETS[m_preset];
+    int width = sourceWidth;
+    int height = sourceHeight;
+    // 最后一个 pass 直接画到屏幕，不需要 FBO
+    for (int i = 0; i + 1 < m_passCount; ++i) {
+        PassState& pass = m_passes[i];
+        width *= preset.passes[i].scale;
+        height *= preset.passes[i].scale;
+        if (pass.framebuffer != 0 && pass.width == width && pass.height == height) {
+            continue;
+        }
+
+        if (pass.texture == 0) {
+            glGenTextures(1, &pass.texture);
+        }
+        glBindTexture(GL_TEXTURE_2D, pass.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        if (pass.framebuffer == 0) {
+            glGenFramebuffers(1, &pass.framebuffer);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pass.texture, 0);
+        const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            LOGE("Framebuffer for pass %d incomplete: 0x%x", i, status);
+            return false;
+        }
+        pass.width = width;
+        pass.height = height;
     }
-    
     return true;
 }
 
-void VideoRenderer::renderFrame(const uint8_t* frameBuffer) {
-    if (m_program == 0 || frameBuffer == nullptr) {
+void VideoRenderer::uploadSource(const uint8_t* frame, int width, int height, const uint32_t* dirtyLines) {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_sourceTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    if (width != m_sourceWidth || height != m_sourceHeight) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, frame);
+        m_sourceWidth = width;
+        m_sourceHeight = height;
+        return;
+    }
+    if (!dirtyLines) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, frame);
         return;
     }
-    
-    // 将GB帧缓冲区转换为RGB565纹理数据
-    for (int i = 0; i < GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT; i++) {
-        uint8_t pixel = frameBuffer[i];
-        // GB灰度到RGB565转换 (0-3 到 RGB565)
-        uint8_t gray = (3 - pixel) * 85; // 0, 85, 170, 255
-        uint16_t rgb565 = ((gray >> 3) << 11) | ((gray >> 2) << 5) | (gray >> 3);
-        m_frameBuffer[i] = rgb565;
+
+    // 把连续的脏行合并成一次 glTexSubImage2D
+    const size_t stride = static_cast<size_t>(width) * 2;
+    int y = 0;
+    while (y < height) {
+        if (!(dirtyLines[y >> 5] & (1u << (y & 31)))) {
+            ++y;
+            continue;
+        }
+        const int start = y;
+        while (y < height && (dirtyLines[y >> 5] & (1u << (y & 31)))) {
+            ++y;
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, start, width, y - start, GL_RGB, GL_UNSIGNED_SHORT_5_6_5,
+                        frame + start * stride);
     }
-    
+}
+
+void VideoRenderer::renderFrame(const uint8_t* frame, int width, int height, const uint32_t* dirtyLines) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, m_screenWidth, m_screenHeight);
     glClear(GL_COLOR_BUFFER_BIT);
-    glUseProgram(m_program);
-    
-    // 更新纹理
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB565, GB_SCREEN_WIDTH, GB_SCREEN_HEIGHT, 
-                 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, m_frameBuffer);
-    glUniform1i(m_textureLoc, 0);
-    
-    // 全屏四边形顶点数据
-    const float vertices[] = {
-        // 位置        // 纹理坐标
-        -1.0f, -1.0f,  0.0f, 1.0f,
-         1.0f, -1.0f,  1.0f, 1.0f,
-        -1.0f,  1.0f,  0.0f, 0.0f,
-         1.0f,  1.0f,  1.0f, 0.0f
-    };
-    
-    // 绑定顶点缓冲区
+    if (!m_pipelineReady || frame == nullptr || width <= 0 || height <= 0) {
+        return;
+    }
+
+    // 上传 RGB565 帧：尺寸不变时只更新变化的行
+    uploadSource(frame, width, height, dirtyLines);
+
+    if (!ensurePassTargets(width, height)) {
+        return;
+    }
+
+    const ShaderPresetDesc& preset = SHADER_PRESETS[m_preset];
     glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    
-    // 设置顶点属性
-    glVertexAttribPointer(m_positionLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(m_positionLoc);
-    
-    glVertexAttribPointer(m_texCoordLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    glEnableVertexAttribArray(m_texCoordLoc);
-    
-    // 绘制
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    
-    glDisableVertexAttribArray(m_positionLoc);
-    glDisableVertexAttribArray(m_texCoordLoc);
-}
+    glEnableVertexAttribArray(ATTRIB_POSITION);
+    glEnableVertexAttribArray(ATTRIB_TEXCOORD);
 
-void VideoRenderer::updateScreenSize(int width, int height) {
-    m_screenWidth = width;
-    m_screenHeight = height;
-    glViewport(0, 0, width, height);
+    GLuint inputTexture = m_sourceTexture;
+    int inputWidth = width;
+    int inputHeight = height;
+    for (int i = 0; i < m_passCount; ++i) {
+        const PassState& pass = m_passes[i];
+        const bool toScreen = i + 1 == m_passCount;
+        int outX = 0;
+        int outY = 0;
+        int outW = pass.width;
+        int outH = pass.height;
+        if (toScreen) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            const Viewport viewport = computeViewport(m_scaleMode, m_screenWidth, m_screenHeight, width, height);
+            outX = viewport.x;
+            outY = viewport.y;
+            outW = viewport.width;
+            outH = viewport.height;
+        } else {
+            glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+        }
+        glViewport(outX, outY, outW, outH);
+
+        glUseProgram(pass.program);
+        glActiveTexture(GL_TEXTURE0);
+        setTextureFilter(inputTexture, preset.passes[i].linearInput);
+        glUniform1i(pass.textureLoc, 0);
+        glUniform2f(pass.sourceSizeLoc, static_cast<float>(inputWidth), static_cast<float>(inputHeight));
+        glUniform2f(pass.outputSizeLoc, static_cast<float>(outW), static_cast<float>(outH));
+
+        const uintptr_t offset = toScreen ? 0 : 16 * sizeof(float);
+        glVertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
+                              reinterpret_cast<const void*>(offset));
+        glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
+                              reinterpret_cast<const void*>(offset + 2 * sizeof(float)));
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+        inputTexture = pass.texture;
+        inputWidth = pass.width;
+        inputHeight = pass.height;
+    }
+
+    glDisableVertexAttribArray(ATTRIB_POSITION);
+    glDisableVertexAttribArray(ATTRIB_TEXCOORD);
 }
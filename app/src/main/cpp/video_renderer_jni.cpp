@@ -0,0 +1,81 @@
+#include "video_renderer.h"
+
+#include <jni.h>
+#include <cstdint>
+#include <string>
+
+#include "frame_skip_controller.h"
+#include "native_util.h"
+
+// VideoRenderer 的 JNI 入口，都在 GLSurfaceView 的 GL 线程调用；与渲染器本身分开，
+// 渲染器才能在主机上用 EGL 测试
+
+static VideoRenderer* g_videoRenderer = nullptr;
+
+extern "C" {
+
+JNIEXPORT jboolean JNICALL Java_com_jboy_emulator_core_VideoRenderer_nativeInit(JNIEnv* env, jobject thiz, jstring cacheDir) {
+    (void) thiz;
+    // EGL 上下文重建后旧的 GL 对象已经失效，直接重新创建
+    delete g_videoRenderer;
+    g_videoRenderer = new VideoRenderer();
+    std::string dir;
+    if (cacheDir) {
+        const char* path = env->GetStringUTFChars(cacheDir, nullptr);
+        dir = path;
+        env->ReleaseStringUTFChars(cacheDir, path);
+    }
+    return g_videoRenderer->initialize(dir) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_VideoRenderer_nativeResize(JNIEnv* env, jobject thiz, jint width, jint height) {
+    (void) env;
+    (void) thiz;
+    if (g_videoRenderer) g_videoRenderer->updateScreenSize(width, height);
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_VideoRenderer_nativeSetPreset(JNIEnv* env, jobject thiz, jint preset) {
+    (void) env;
+    (void) thiz;
+    if (g_videoRenderer) g_videoRenderer->setPreset(preset);
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_VideoRenderer_nativeSetScaleMode(JNIEnv* env, jobject thiz, jint mode) {
+    (void) env;
+    (void) thiz;
+    if (g_videoRenderer) g_videoRenderer->setScaleMode(mode);
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_VideoRenderer_nativeDraw(JNIEnv* env, jobject thiz, jobject frame, jint width, jint height, jintArray dirtyLines) {
+    (void) thiz;
+    if (!g_videoRenderer) return;
+    const uint8_t* data = nullptr;
+    if (frame) {
+        data = static_cast<const uint8_t*>(env->GetDirectBufferAddress(frame));
+        if (data && env->GetDirectBufferCapacity(frame) < static_cast<jlong>(width) * height * 2) {
+            data = nullptr;
+        }
+    }
+    // 最多 256 行；超出或未提供时整帧上传
+    uint32_t mask[8] = {};
+    const uint32_t* maskPtr = nullptr;
+    if (dirtyLines && height > 0 && height <= 256) {
+        const jsize words = (height + 31) / 32;
+        const jsize length = env->GetArrayLength(dirtyLines);
+        env->GetIntArrayRegion(dirtyLines, 0, length < words ? length : words, reinterpret_cast<jint*>(mask));
+        maskPtr = mask;
+    }
+    // 绘制耗时 (CPU 提交部分) 供自动跳帧参考
+    const int64_t startNs = nowNanos();
+    g_videoRenderer->renderFrame(data, width, height, maskPtr);
+    FrameSkipController::reportPresentCost(nowNanos() - startNs);
+}
+
+JNIEXPORT void JNICALL Java_com_jboy_emulator_core_VideoRenderer_nativeRelease(JNIEnv* env, jobject thiz) {
+    (void) env;
+    (void) thiz;
+    delete g_videoRenderer;
+    g_videoRenderer = nullptr;
+}
+
+} // extern "C"
@@ -0,0 +1,76 @@
+#include "video_renderer_util.h"
+
+#include <cstdio>
+#include <cstring>
+
+static uint64_t fnv1a64(uint64_t hash, const char* text) {
+    while (text && *text) {
+        hash ^= static_cast<uint8_t>(*text++);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+Viewport computeViewport(int scaleMode, int screenWidth, int screenHeight, int sourceWidth, int sourceHeight) {
+    if (sourceWidth <= 0 || sourceHeight <= 0) {
+        return { 0, 0, screenWidth, screenHeight };
+    }
+    int outW = screenWidth;
+    int outH = screenHeight;
+    switch (scaleMode) {
+        case SCALE_MODE_STRETCH:
+            break;
+        case SCALE_MODE_INTEGER: {
+            int scale = screenWidth / sourceWidth;
+            if (screenHeight / sourceHeight < scale) {
+                scale = screenHeight / sourceHeight;
+            }
+            if (scale < 1) {
+                scale = 1;
+            }
+            outW = sourceWidth * scale;
+            outH = sourceHeight * scale;
+            break;
+        }
+        case SCALE_MODE_FILL:
+            // 保持比例填满，超出部分裁掉
+            if (static_cast<int64_t>(screenWidth) * sourceHeight > static_cast<int64_t>(screenHeight) * sourceWidth) {
+                outH = screenWidth * sourceHeight / sourceWidth;
+            } else {
+                outW = screenHeight * sourceWidth / sourceHeight;
+            }
+            break;
+        case SCALE_MODE_FIT:
+        default:
+            if (static_cast<int64_t>(screenWidth) * sourceHeight > static_cast<int64_t>(screenHeight) * sourceWidth) {
+                outW = screenHeight * sourceWidth / sourceHeight;
+            } else {
+                outH = screenWidth * sourceHeight / sourceWidth;
+            }
+            break;
+    }
+    return { (screenWidth - outW) / 2, (screenHeight - outH) / 2, outW, outH };
+}
+
+std::string programCachePath(const std::string& cacheDir, const char* const* parts, int count) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < count; ++i) {
+        hash = fnv1a64(hash, parts[i]);
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", static_cast<unsigned long long>(hash));
+    return cacheDir + name;
+}
+
+ProgramCacheHeader makeProgramCacheHeader(uint32_t format, uint32_t length) {
+    return { PROGRAM_CACHE_MAGIC, format, length };
+}
+
+bool parseProgramCacheHeader(const uint8_t* data, size_t size, ProgramCacheHeader* header) {
+    if (!data || size < sizeof(ProgramCacheHeader)) {
+        return false;
+    }
+    memcpy(header, data, sizeof(ProgramCacheHeader));
+    return header->magic == PROGRAM_CACHE_MAGIC && header->length > 0
+        && header->length == size - sizeof(ProgramCacheHeader);
+}
@@ -4,6 +4,7 @@ import android.app.Application
 import android.util.Log
 import com.jboy.emulator.core.*
 import dagger.hilt.android.HiltAndroidApp
+import kotlin.concurrent.thread
 
 /**
  * JBoy 应用程序类 - 全局初始化管理
@@ -67,7 +68,7 @@ class JBoyApplication : Application() {
         Log.d(TAG, "VideoRenderer initialized")
         
         // 模拟器核心
-        EmulatorCore.getInstance()
+        EmulatorCore.getInstance().setDataDirectory(filesDir.absolutePath)
         Log.d(TAG, "EmulatorCore initialized")
     }
     
@@ -158,6 +159,12 @@ class JBoyApplication : Application() {
     
     override fun onTrimMemory(level: Int) {
         super.onTrimMemory(level)
+        if (level >= TRIM_MEMORY_UI_HIDDEN) {
+            // 进程可能随时被回收，先写回电池存档；休眠存档只由 GameViewModel.onHostPaused 写入
+            thread(name = "JBoySaveFlush") {
+                runCatching { EmulatorCore.getInstance().flushSaveData() }
+            }
+        }
         when (level) {
             TRIM_MEMORY_RUNNING_CRITICAL,
             TRIM_MEMORY_COMPLETE -> {
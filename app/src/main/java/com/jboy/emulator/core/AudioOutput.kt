@@ -38,6 +38,13 @@ class AudioOutput private constructor() {
         }
     }
 
+    /** Supplies samples when the audio device is the master clock (see [EmulatorCore.PacingMode]). */
+    interface PullSource {
+        /** Waits briefly for samples; returns how many interleaved stereo samples were written to [out]. */
+        fun read(out: ShortArray): Int
+        fun sampleRate(): Int
+    }
+
     private var audioTrack: AudioTrack? = null
     private var initialized = false
     private var playing = false
@@ -57,9 +64,10 @@ class AudioOutput private constructor() {
     private var lastChunkTailRight = 0
     private var audioFilterEnabled = true
     private var audioFilterLevel = 60
-    private var filterStateLeft = 0f
-    private var filterStateRight = 0f
-    private var filterStateReady = false
+
+    @Volatile
+    private var pullSource: PullSource? = null
+    private val pullBuffer = ShortArray(WRITE_CHUNK_FRAMES * CHANNELS)
 
     private var outputSampleRate: Int = SAMPLE_RATE
     private var outputBufferFrames: Int = BUFFER_SIZE_FRAMES
@@ -184,26 +192,38 @@ class AudioOutput private constructor() {
         }
     }
 
+    /**
+     * Switches between the push queue fed by [writeAudioData] and pulling from [source]
+     * on the writer thread. While pulling, the writer's blocking AudioTrack writes set
+     * the pace and nothing is dropped for latency.
+     */
     @Synchronized
+    fun setPullSource(source: PullSource?) {
+        if (pullSource === source) return
+        pullSource = source
+        clearQueuedAudio()
+        Log.d(TAG, if (source != null) "Audio pull mode" else "Audio push mode")
+    }
+
     fun writeAudioData(audioData: ShortArray, sourceSampleRate: Int) {
-        if (!initialized || !audioEnabled || audioData.isEmpty()) return
+        writeAudioData(audioData, audioData.size, sourceSampleRate)
+    }
+
+    /** Queues the first [count] samples; [audioData] is copied, so the caller may reuse it. */
+    @Synchronized
+    fun writeAudioData(audioData: ShortArray, count: Int, sourceSampleRate: Int) {
+        if (!initialized || !audioEnabled || count <= 0 || pullSource != null) return
 
         val shouldStartAfterEnqueue = !playing
 
-        val volumeScaled = applyVolume(audioData)
-        val processed = if (sourceSampleRate > 0 && sourceSampleRate != outputSampleRate) {
-            resampleStereo(volumeScaled, sourceSampleRate, outputSampleRate)
-        } else {
-            resetResamplerState()
-            volumeScaled
-        }
-        val filtered = applyAudioFilter(processed)
+        val filtered = processSamples(audioData, count, sourceSampleRate)
+        val filteredSize = if (filtered === audioData) count else filtered.size
 
         val chunkSamples = WRITE_CHUNK_FRAMES * CHANNELS
         var offset = 0
         var startPending = shouldStartAfterEnqueue
-        while (offset < filtered.size) {
-            val size = min(chunkSamples, filtered.size - offset)
+        while (offset < filteredSize) {
+            val size = min(chunkSamples, filteredSize - offset)
             val chunk = ShortArray(size)
             filtered.copyInto(chunk, destinationOffset = 0, startIndex = offset, endIndex = offset + size)
             enqueueChunk(chunk)
@@ -217,6 +237,7 @@ class AudioOutput private constructor() {
 
     fun setVolume(vol: Float) {
         volume = vol.coerceIn(0f, 1f)
+        applyCoreDsp()
         try {
             audioTrack?.setVolume(volume)
         } catch (e: Exception) {
@@ -230,11 +251,12 @@ class AudioOutput private constructor() {
     fun setAudioFilterConfig(enabled: Boolean, level: Int) {
         audioFilterEnabled = enabled
         audioFilterLevel = level.coerceIn(0, 100)
-        if (!audioFilterEnabled) {
-            filterStateReady = false
-            filterStateLeft = 0f
-            filterStateRight = 0f
-        }
+        applyCoreDsp()
+    }
+
+    // Gain and filtering run natively as samples leave the core (audio_dsp.cpp).
+    private fun applyCoreDsp() {
+        EmulatorCore.getInstance().setAudioDsp(volume, audioFilterEnabled, audioFilterLevel)
     }
 
     @Synchronized
@@ -262,17 +284,54 @@ class AudioOutput private constructor() {
         initialized = false
     }
 
+    private fun processSamples(audioData: ShortArray, count: Int, sourceSampleRate: Int): ShortArray {
+        return if (sourceSampleRate > 0 && sourceSampleRate != outputSampleRate) {
+            resampleStereo(audioData, count, sourceSampleRate, outputSampleRate)
+        } else {
+            resetResamplerState()
+            audioData
+        }
+    }
+
+    /** Returns [pullBuffer] itself unless resampling was needed; null when muted. */
+    @Synchronized
+    private fun processPulled(count: Int, sourceSampleRate: Int): ShortArray? {
+        if (!audioEnabled) return null
+        if (sourceSampleRate > 0 && sourceSampleRate != outputSampleRate) {
+            val chunk = resampleStereo(pullBuffer.copyOf(count), count, sourceSampleRate, outputSampleRate)
+            smoothChunkBoundary(chunk, chunk.size)
+            return chunk
+        }
+        resetResamplerState()
+        smoothChunkBoundary(pullBuffer, count)
+        return pullBuffer
+    }
+
     private fun startAudioThreadIfNeeded() {
         if (audioThread?.isAlive == true) return
         audioThread = thread(name = "AudioOutputThread", isDaemon = true) {
             runCatching { Process.setThreadPriority(Process.THREAD_PRIORITY_AUDIO) }
+            // Native side tries SCHED_FIFO; on refusal the priority above stays or is raised.
+            runCatching { EmulatorCore.getInstance().promoteAudioThread() }
             while (!Thread.currentThread().isInterrupted) {
                 if (!playing) break
                 try {
+                    val source = pullSource
+                    if (source != null) {
+                        val count = source.read(pullBuffer)
+                        if (count > 0) {
+                            processPulled(count, source.sampleRate())?.let {
+                                writeChunkBlocking(it, if (it === pullBuffer) count else it.size)
+                            }
+                        } else {
+                            Thread.sleep(1)
+                        }
+                        continue
+                    }
                     val chunk = audioQueue.poll(2, TimeUnit.MILLISECONDS)
                     if (chunk != null) {
                         decreaseQueuedSamples(chunk.size)
-                        writeChunkBlocking(chunk)
+                        writeChunkBlocking(chunk, chunk.size)
                     }
                 } catch (e: InterruptedException) {
                     Thread.currentThread().interrupt()
@@ -283,13 +342,13 @@ class AudioOutput private constructor() {
         }
     }
 
-    private fun writeChunkBlocking(chunk: ShortArray) {
+    private fun writeChunkBlocking(chunk: ShortArray, size: Int) {
         var writtenOffset = 0
-        while (writtenOffset < chunk.size && playing) {
+        while (writtenOffset < size && playing) {
             val written = audioTrack?.write(
                 chunk,
                 writtenOffset,
-                chunk.size - writtenOffset,
+                size - writtenOffset,
                 AudioTrack.WRITE_BLOCKING
             ) ?: 0
             if (written <= 0) {
@@ -300,7 +359,7 @@ class AudioOutput private constructor() {
     }
 
     private fun enqueueChunk(chunk: ShortArray) {
-        smoothChunkBoundary(chunk)
+        smoothChunkBoundary(chunk, chunk.size)
         trimQueueForLatency(chunk.size)
         try {
             var offered = audioQueue.offer(chunk, 2, TimeUnit.MILLISECONDS)
@@ -364,13 +423,10 @@ class AudioOutput private constructor() {
         hasChunkTail = false
         lastChunkTailLeft = 0
         lastChunkTailRight = 0
-        filterStateReady = false
-        filterStateLeft = 0f
-        filterStateRight = 0f
     }
 
-    private fun smoothChunkBoundary(chunk: ShortArray) {
-        if (chunk.size < 4) {
+    private fun smoothChunkBoundary(chunk: ShortArray, size: Int) {
+        if (size < 4) {
             return
         }
 
@@ -382,7 +438,7 @@ class AudioOutput private constructor() {
                     abs(startR - lastChunkTailRight) >= EDGE_SMOOTH_THRESHOLD
 
             if (needSmooth) {
-                val frameCount = min(EDGE_SMOOTH_FRAMES, chunk.size / 2)
+                val frameCount = min(EDGE_SMOOTH_FRAMES, size / 2)
 
                 for (i in 0 until frameCount) {
                     val t = (i + 1).toFloat() / frameCount.toFloat()
@@ -395,50 +451,12 @@ class AudioOutput private constructor() {
             }
         }
 
-        val tailIndex = chunk.size - 2
+        val tailIndex = size - 2
         lastChunkTailLeft = chunk[tailIndex].toInt()
         lastChunkTailRight = chunk[tailIndex + 1].toInt()
         hasChunkTail = true
     }
 
-    private fun applyAudioFilter(input: ShortArray): ShortArray {
-        if (!audioFilterEnabled || input.isEmpty()) {
-            return input
-        }
-
-        val strength = audioFilterLevel.coerceIn(0, 100) / 100f
-        val alpha = (0.86f - strength * 0.62f).coerceIn(0.08f, 0.9f)
-        val output = ShortArray(input.size)
-
-        var stateL = filterStateLeft
-        var stateR = filterStateRight
-        var stateReady = filterStateReady
-
-        var i = 0
-        while (i + 1 < input.size) {
-            val inL = input[i].toFloat()
-            val inR = input[i + 1].toFloat()
-
-            if (!stateReady) {
-                stateL = inL
-                stateR = inR
-                stateReady = true
-            } else {
-                stateL += alpha * (inL - stateL)
-                stateR += alpha * (inR - stateR)
-            }
-
-            output[i] = stateL.toInt().coerceIn(Short.MIN_VALUE.toInt(), Short.MAX_VALUE.toInt()).toShort()
-            output[i + 1] = stateR.toInt().coerceIn(Short.MIN_VALUE.toInt(), Short.MAX_VALUE.toInt()).toShort()
-            i += 2
-        }
-
-        filterStateLeft = stateL
-        filterStateRight = stateR
-        filterStateReady = stateReady
-        return output
-    }
-
     private fun decreaseQueuedSamples(amount: Int) {
         while (true) {
             val current = queuedSamples.get()
@@ -449,19 +467,8 @@ class AudioOutput private constructor() {
         }
     }
 
-    private fun applyVolume(input: ShortArray): ShortArray {
-        if (volume >= 0.999f) {
-            return input
-        }
-        val scale = volume
-        return ShortArray(input.size) { i ->
-            val mixed = (input[i] * scale).toInt()
-            mixed.coerceIn(Short.MIN_VALUE.toInt(), Short.MAX_VALUE.toInt()).toShort()
-        }
-    }
-
-    private fun resampleStereo(input: ShortArray, inRate: Int, outRate: Int): ShortArray {
-        val inFrames = input.size / 2
+    private fun resampleStereo(input: ShortArray, count: Int, inRate: Int, outRate: Int): ShortArray {
+        val inFrames = count / 2
         if (inFrames < 2 || inRate <= 0 || outRate <= 0) {
             return input
         }
@@ -0,0 +1,51 @@
+package com.jboy.emulator.core
+
+/**
+ * Indices into the array filled by [EmulatorCore.getStats].
+ * Must stay in sync with `CoreStat` in emulator_core.cpp.
+ */
+object CoreStats {
+    const val HIBERNATE_WRITE_US = 0
+    const val HIBERNATE_RESTORE_US = 1
+    const val RESET_US = 2
+    const val ROM_LOAD_US = 3
+    const val SAVE_FLUSH_COUNT = 4
+    const val SAVE_FLUSH_US = 5
+    const val SAVE_FLUSH_FAILURES = 6
+    const val FRAME_SKIP_LEVEL = 7
+    const val FRAMES_SKIPPED = 8
+    const val FRAME_RENDER_US = 9
+    const val FRAME_SKIP_US = 10
+    const val PRESENT_US = 11
+    const val AUDIO_RING_FILL = 12
+    const val AUDIO_DROPPED_SAMPLES = 13
+    const val AUDIO_UNDERRUNS = 14
+    const val RECORD_FRAMES = 15
+    const val RECORD_DROPPED_FRAMES = 16
+    const val RECORD_ENQUEUE_US = 17
+    const val REPLAY_FRAMES = 18
+    const val REPLAY_BYTES = 19
+    const val REPLAY_CAPACITY_BYTES = 20
+    const val REPLAY_ENCODE_US = 21
+    // Startup phases; create and config ran in the background when CORE_PREWARMED is 1.
+    const val CORE_CREATE_US = 22
+    const val CORE_CONFIG_US = 23
+    const val CORE_PREWARMED = 24
+    const val CORE_ACQUIRE_US = 25
+    // From loadRom entry to the end of the first emulated frame.
+    const val FIRST_FRAME_US = 26
+    // Thread placement: emulation CPU is the one the last frame ran on.
+    const val PERFORMANCE_CORES = 27
+    const val EMU_THREAD_PINNED = 28
+    const val EMU_THREAD_CPU = 29
+    const val EMU_OFF_PERFORMANCE_FRAMES = 30
+    // 0 unchanged, 1 raised nice value, 2 SCHED_FIFO.
+    const val AUDIO_THREAD_POLICY = 31
+    const val RAM_SEARCH_CANDIDATES = 32
+    const val RAM_SEARCH_PASS_US = 33
+    // Time the last frame spent copying into the shared state region.
+    const val STATE_EXPORT_US = 34
+    // Saves rolled back to <save>.bak because the .sav was missing or damaged.
+    const val SAVE_RESTORES = 35
+    const val COUNT = 36
+}
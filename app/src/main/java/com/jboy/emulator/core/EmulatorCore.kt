@@ -1,7 +1,10 @@
 package com.jboy.emulator.core
 
 import android.content.Context
+import android.os.ParcelFileDescriptor
 import android.util.Log
+import java.io.File
+import java.nio.ByteBuffer
 
 class EmulatorCore private constructor() {
 
@@ -15,9 +18,22 @@ class EmulatorCore private constructor() {
         val canStartLink: Boolean
     )
 
+    /** Matches `PacingMode` in emulator_core.cpp. */
+    enum class PacingMode {
+        // The frame loop paces from System.nanoTime(); the core trims excess audio.
+        WALL_CLOCK,
+        // The audio sink pulls samples via readAudio() and emulation waits for ring space.
+        AUDIO_CLOCK
+    }
+
     companion object {
         private const val TAG = "EmulatorCore"
         
+        // 160 scanlines, one bit each; matches DIRTY_LINE_WORDS in emulator_core.cpp
+        const val DIRTY_LINE_WORDS = 5
+
+        private val PATCH_EXTENSIONS = listOf("ips", "ups", "bps")
+
         @Volatile
         private var instance: EmulatorCore? = null
         
@@ -39,7 +55,12 @@ class EmulatorCore private constructor() {
 
     // Native methods - matching JNI interface
     external fun nativeInit(): Boolean
+    external fun nativePrewarmCore()
+    external fun nativeSetThreadPlacement(enabled: Boolean)
+    external fun nativePromoteAudioThread(): Int
+    external fun nativeSetDataDirectory(dir: String)
     external fun nativeLoadRom(romPath: String): Boolean
+    external fun nativeLoadPatchedRom(romPath: String, patchPath: String): Boolean
     external fun nativeRunFrame()
     external fun nativeSetInput(buttons: Int)
     external fun nativeSetAudioConfig(sampleRate: Int, bufferSize: Int)
@@ -49,22 +70,60 @@ class EmulatorCore private constructor() {
         frameSkipInterval: Int,
         interframeBlending: Boolean,
         idleLoopRemoval: String,
-        gbControllerRumble: Boolean
+        gbControllerRumble: Boolean,
+        threadedVideo: Boolean
     )
     external fun nativeSaveState(slot: Int): Boolean
     external fun nativeLoadState(slot: Int): Boolean
     external fun nativeHasSaveState(slot: Int): Boolean
+    external fun nativeGetSaveSlots(): LongArray
+    external fun nativeStartRamSearch(width: Int): Boolean
+    external fun nativeFilterRamSearch(relation: Int, value: Int): Boolean
+    external fun nativeGetRamSearchResults(max: Int): LongArray?
+    external fun nativeSetStateExport(enabled: Boolean): Boolean
+    external fun nativeDupStateExportFd(): Int
+    external fun nativeSetLatencyMode(mode: Int, probeButtons: Int)
+    external fun nativeGetLatencyReport(): LongArray
+    external fun nativeGetSlotThumbnail(slot: Int): ByteArray?
     external fun nativeCleanup()
     external fun nativeIsPaused(): Boolean
     external fun nativePause()
     external fun nativeResume()
-    external fun nativeReset()
+    external fun nativeReset(): Boolean
+    external fun nativeUnloadRom()
     external fun nativeGetRomTitle(): String
     external fun nativeGetAudioSampleRate(): Int
     external fun nativeGetVideoFrame(): ByteArray?
+    external fun nativeGetChangedVideoFrame(dirtyLinesOut: IntArray): ByteArray?
     external fun nativeGetAudioFrame(): ShortArray?
+    external fun nativeStep(
+        frames: Int,
+        inputMask: Int,
+        outVideo: ByteBuffer?,
+        outAudio: ByteBuffer?,
+        outStats: ByteBuffer
+    ): Int
     external fun nativeClearCheats()
     external fun nativeAddCheatCode(code: String): Boolean
+    external fun nativeFlushSaveData()
+    external fun nativeSetEmulationSpeed(speed: Int)
+    external fun nativeSetPacingMode(mode: Int)
+    external fun nativeReadAudio(out: ShortArray, timeoutMs: Int): Int
+    external fun nativeSetAudioDsp(gain: Float, lowPass: Boolean, filterLevel: Int)
+    external fun nativeHibernate(): Boolean
+    external fun nativeRestoreHibernation(): Boolean
+    external fun nativePeekHibernationFrame(romPath: String): ByteArray?
+    external fun nativeDiscardHibernation(romPath: String)
+    external fun nativeGetStats(out: LongArray)
+    external fun nativeStartRecording(basePath: String): Boolean
+    external fun nativeStopRecording()
+    external fun nativeSetReplayConfig(seconds: Int, memoryKb: Int)
+    external fun nativeExportReplay(basePath: String): Boolean
+    external fun nativeStartProfiler(intervalCycles: Int)
+    external fun nativeStopProfiler()
+    external fun nativeGetProfileReport(): String
+    external fun nativeGenerateThumbnails(romPaths: Array<String>, outPaths: Array<String>, frames: Int, halvings: Int): Int
+    external fun nativeCancelThumbnails()
 
     // State callback interface
     interface StateCallback {
@@ -80,8 +139,36 @@ class EmulatorCore private constructor() {
     private var currentButtons = 0
     private var pendingAudioSampleRate = 44100
     private var pendingAudioBufferSize = 8192
+    private var dataDirectory: String? = null
+    private var audioDspGain = 1.0f
+    private var audioDspLowPass = true
+    private var audioDspFilterLevel = 60
+    private var replaySeconds = 30
+    private var replayMemoryKb = 16 * 1024
+    private var stateExportEnabled = false
     private var activeNetplayLinkSession: NetplayLinkSession? = null
 
+    /**
+     * Builds and configures an mCore on a native background thread so [init] or the
+     * next [loadRom] after [cleanup] can adopt it instead of creating one.
+     */
+    fun prewarm() {
+        if (!isInitialized) {
+            nativePrewarmCore()
+        }
+    }
+
+    /**
+     * Pins the thread that runs frames to the performance cores and raises its priority.
+     * Process-wide and independent of [init]; CoreStats reports what the kernel granted.
+     */
+    fun setThreadPlacement(enabled: Boolean) {
+        nativeSetThreadPlacement(enabled)
+    }
+
+    /** Asks for SCHED_FIFO on the calling (audio) thread, else an urgent-audio nice value. */
+    fun promoteAudioThread(): Int = nativePromoteAudioThread()
+
     fun init(): Boolean {
         if (isInitialized) {
             Log.w(TAG, "Emulator already initialized")
@@ -91,18 +178,36 @@ class EmulatorCore private constructor() {
         isInitialized = nativeInit()
         if (isInitialized) {
             nativeSetAudioConfig(pendingAudioSampleRate, pendingAudioBufferSize)
+            dataDirectory?.let { nativeSetDataDirectory(it) }
+            nativeSetAudioDsp(audioDspGain, audioDspLowPass, audioDspFilterLevel)
+            nativeSetReplayConfig(replaySeconds, replayMemoryKb)
+            if (stateExportEnabled) {
+                nativeSetStateExport(true)
+            }
         }
         Log.d(TAG, "Emulator initialization result: $isInitialized")
         return isInitialized
     }
     
-    fun loadRom(romPath: String): Boolean {
+    /** Where the core keeps per-ROM tuning (discovered idle loops); applied on init. */
+    fun setDataDirectory(path: String) {
+        dataDirectory = path
+        if (isInitialized) {
+            nativeSetDataDirectory(path)
+        }
+    }
+
+    /**
+     * Loads a ROM, applying an IPS/UPS/BPS patch in memory when one is given.
+     * A patched game keeps its saves and states next to the patch file.
+     */
+    fun loadRom(romPath: String, patchPath: String? = null): Boolean {
         if (!isInitialized) {
             Log.e(TAG, "Cannot load ROM - emulator not initialized")
             return false
         }
         
-        isRomLoaded = nativeLoadRom(romPath)
+        isRomLoaded = if (patchPath != null) nativeLoadPatchedRom(romPath, patchPath) else nativeLoadRom(romPath)
         if (isRomLoaded) {
             activeNetplayLinkSession?.let { session ->
                 Log.i(
@@ -110,7 +215,7 @@ class EmulatorCore private constructor() {
                     "Applying netplay session protocol=${session.protocol} room=${session.roomId} player=${session.nickname} peers=${session.connectedPeers} ready=${session.readyPeers}"
                 )
             }
-            Log.d(TAG, "ROM loaded: $romPath")
+            Log.d(TAG, "ROM loaded: $romPath${patchPath?.let { " + $it" } ?: ""}")
             return true
         }
         Log.e(TAG, "ROM load failed: $romPath")
@@ -149,7 +254,8 @@ class EmulatorCore private constructor() {
         frameSkipInterval: Int,
         interframeBlending: Boolean,
         idleLoopRemoval: String,
-        gbControllerRumble: Boolean
+        gbControllerRumble: Boolean,
+        threadedVideo: Boolean
     ) {
         if (!isInitialized) {
             return
@@ -160,14 +266,34 @@ class EmulatorCore private constructor() {
             frameSkipInterval = frameSkipInterval.coerceIn(0, 12),
             interframeBlending = interframeBlending,
             idleLoopRemoval = idleLoopRemoval,
-            gbControllerRumble = gbControllerRumble
+            gbControllerRumble = gbControllerRumble,
+            threadedVideo = threadedVideo
         )
     }
 
+    /** Speed multiplier (fast-forward); sets the frame budget of automatic frame skip. */
+    fun setEmulationSpeed(speed: Int) {
+        if (isInitialized) {
+            nativeSetEmulationSpeed(speed.coerceAtLeast(1))
+        }
+    }
+
     fun loadGame(gamePath: String): Boolean {
-        return loadRom(gamePath)
+        return loadRom(gamePath, findPatch(gamePath))
     }
 
+    /** A patch next to the ROM with the same base name (game.ips/.ups/.bps), as mGBA does. */
+    fun findPatch(romPath: String): String? {
+        val rom = File(romPath)
+        return PATCH_EXTENSIONS
+            .map { File(rom.parentFile, "${rom.nameWithoutExtension}.$it") }
+            .firstOrNull { it.isFile }
+            ?.absolutePath
+    }
+
+    /** The path saves, states and hibernation are keyed by: the patch when one applies. */
+    fun sessionPath(gamePath: String): String = findPatch(gamePath) ?: gamePath
+
     fun stopGame() {
         pause()
     }
@@ -218,6 +344,76 @@ class EmulatorCore private constructor() {
             false
         }
     }
+
+    /**
+     * Every occupied slot of the loaded ROM in one call. Served from the native slot
+     * index, so it is cheap enough to call whenever the menu opens.
+     */
+    fun getSaveSlots(): List<SaveSlotInfo> {
+        if (!isInitialized || !isRomLoaded) return emptyList()
+        val packed = nativeGetSaveSlots()
+        return (0 until packed.size / 4).map { i ->
+            SaveSlotInfo(
+                slot = packed[i * 4].toInt(),
+                sizeBytes = packed[i * 4 + 1],
+                savedAtMs = packed[i * 4 + 2],
+                hasThumbnail = packed[i * 4 + 3] >= 0
+            )
+        }
+    }
+
+    /**
+     * Publishes EWRAM, IWRAM, the I/O registers and the RGB565 framebuffer to a shared
+     * memory region every frame (layout in cpp/include/state_export.h). Local tools get
+     * the fd from the abstract socket "jboy.state_export"; [openStateExport] hands it
+     * out for binder transfer.
+     */
+    fun setStateExport(enabled: Boolean): Boolean {
+        stateExportEnabled = enabled
+        return !isInitialized || nativeSetStateExport(enabled)
+    }
+
+    /** A read-only descriptor for the shared state region, or null while the export is off. */
+    fun openStateExport(): ParcelFileDescriptor? {
+        if (!isInitialized) return null
+        val fd = nativeDupStateExportFd()
+        return if (fd >= 0) ParcelFileDescriptor.adoptFd(fd) else null
+    }
+
+    /**
+     * Snapshots EWRAM and IWRAM and makes every aligned value of [width] bytes a candidate.
+     * Starting again discards the previous search.
+     */
+    fun startRamSearch(width: Int): Boolean {
+        return isInitialized && isRomLoaded && nativeStartRamSearch(width)
+    }
+
+    /**
+     * Takes a new snapshot and keeps the candidates that match [relation]. The pass runs
+     * between frames in 1 ms slices while the game plays; poll [getRamSearchResults].
+     */
+    fun filterRamSearch(relation: RamSearchRelation, value: Long = 0): Boolean {
+        return isInitialized && isRomLoaded && nativeFilterRamSearch(relation.nativeId, value.toInt())
+    }
+
+    /** Up to [max] candidates, or null while a filter pass is still running. */
+    fun getRamSearchResults(width: Int, max: Int = 50): List<RamSearchResult>? {
+        if (!isInitialized || !isRomLoaded) return emptyList()
+        val packed = nativeGetRamSearchResults(max) ?: return null
+        return (0 until packed.size / 3).map { i ->
+            RamSearchResult(
+                address = packed[i * 3],
+                value = packed[i * 3 + 1],
+                previous = packed[i * 3 + 2],
+                width = width
+            )
+        }
+    }
+
+    /** RGB565 preview stored with the slot, or null. Reads storage; call off the main thread. */
+    fun getSlotThumbnail(slot: Int): ByteArray? {
+        return if (isInitialized && isRomLoaded) nativeGetSlotThumbnail(slot) else null
+    }
     
     fun pause() {
         if (isInitialized && isRomLoaded) {
@@ -233,10 +429,25 @@ class EmulatorCore private constructor() {
         }
     }
     
-    fun reset() {
+    /** Soft reset: resets the running core in place without reloading the ROM. */
+    fun reset(): Boolean {
+        if (!isInitialized || !isRomLoaded) {
+            return false
+        }
+        val ok = nativeReset()
+        if (ok) {
+            isPaused = false
+        }
+        return ok
+    }
+
+    /** Unloads the ROM but keeps the native core alive so the next game can reuse it. */
+    fun unloadRom() {
         if (isInitialized && isRomLoaded) {
-            nativeReset()
+            nativeUnloadRom()
         }
+        isRomLoaded = false
+        isPaused = false
     }
     
     fun cleanup() {
@@ -276,6 +487,19 @@ class EmulatorCore private constructor() {
         }
     }
 
+    /**
+     * Returns the current frame only if some scanline changed since the last call,
+     * together with the changed lines. Null when the screen is static.
+     */
+    fun getChangedVideoFrame(): VideoFrame? {
+        if (!isInitialized || !isRomLoaded || isPaused) {
+            return null
+        }
+        val dirtyLines = IntArray(DIRTY_LINE_WORDS)
+        val pixels = nativeGetChangedVideoFrame(dirtyLines) ?: return null
+        return VideoFrame(pixels, dirtyLines)
+    }
+
     fun getAudioFrame(): ShortArray? {
         return if (isInitialized && isRomLoaded && !isPaused) {
             nativeGetAudioFrame()
@@ -284,6 +508,65 @@ class EmulatorCore private constructor() {
         }
     }
 
+    /**
+     * Runs [frames] frames and fills [buffers] with the changed video, the pending
+     * audio and per-step stats in a single JNI call. [inputMask] is applied before
+     * the first frame; -1 keeps the current input. Pass `withVideo = false` to
+     * leave dirty lines pending for a later step (e.g. when the frame is skipped),
+     * and `withAudio = false` when the audio sink pulls samples itself.
+     * With [PacingMode.AUDIO_CLOCK] the call first waits for audio ring space.
+     * Returns the number of frames run, or -1 when no ROM is running.
+     */
+    fun step(
+        frames: Int,
+        buffers: StepBuffers,
+        inputMask: Int = -1,
+        withVideo: Boolean = true,
+        withAudio: Boolean = true
+    ): Int {
+        if (!isInitialized || !isRomLoaded || isPaused) {
+            return -1
+        }
+        return nativeStep(
+            frames,
+            inputMask,
+            if (withVideo) buffers.video else null,
+            if (withAudio) buffers.audio else null,
+            buffers.stats
+        )
+    }
+
+    fun setPacingMode(mode: PacingMode) {
+        if (isInitialized) {
+            nativeSetPacingMode(mode.ordinal)
+        }
+    }
+
+    /**
+     * Native post-processing applied as samples leave the core: gain, then an optional
+     * low-pass whose cutoff follows [filterLevel] (0..100), then a DC blocker.
+     */
+    fun setAudioDsp(gain: Float, lowPass: Boolean, filterLevel: Int) {
+        audioDspGain = gain.coerceIn(0f, 1f)
+        audioDspLowPass = lowPass
+        audioDspFilterLevel = filterLevel.coerceIn(0, 100)
+        if (isInitialized) {
+            nativeSetAudioDsp(audioDspGain, audioDspLowPass, audioDspFilterLevel)
+        }
+    }
+
+    /**
+     * Audio-clock pacing: called from the audio sink thread. Waits up to [timeoutMs]
+     * for samples and returns how many interleaved stereo samples were written to [out].
+     */
+    fun readAudio(out: ShortArray, timeoutMs: Int): Int {
+        return if (isInitialized && isRomLoaded) {
+            nativeReadAudio(out, timeoutMs)
+        } else {
+            0
+        }
+    }
+
     fun getAudioSampleRate(): Int {
         return if (isInitialized) {
             nativeGetAudioSampleRate()
@@ -309,6 +592,140 @@ class EmulatorCore private constructor() {
         return nativeAddCheatCode(trimmed)
     }
 
+    /**
+     * Writes a compressed auto-state plus the current frame next to the ROM so the
+     * session can be resumed after process death. Cheap when nothing changed.
+     */
+    /** Queues an immediate write-back of battery save RAM; the write itself is asynchronous. */
+    fun flushSaveData() {
+        if (isInitialized && isRomLoaded) {
+            nativeFlushSaveData()
+        }
+    }
+
+    fun hibernate(): Boolean {
+        return if (isInitialized && isRomLoaded) {
+            nativeHibernate()
+        } else {
+            false
+        }
+    }
+
+    /** Restores the hibernation image for the ROM that was just loaded. */
+    fun restoreHibernation(): Boolean {
+        return if (isInitialized && isRomLoaded) {
+            nativeRestoreHibernation()
+        } else {
+            false
+        }
+    }
+
+    /** Returns the last frame of a hibernated session without needing a loaded core. */
+    fun peekHibernationFrame(romPath: String): ByteArray? = nativePeekHibernationFrame(romPath)
+
+    fun discardHibernation(romPath: String) {
+        nativeDiscardHibernation(romPath)
+    }
+
+    fun getStats(): LongArray {
+        val out = LongArray(CoreStats.COUNT)
+        if (isInitialized) {
+            nativeGetStats(out)
+        }
+        return out
+    }
+
+    /**
+     * Records gameplay to `[basePath].y4m` and `[basePath].wav` on a native encoder
+     * thread. Stops on [stopRecording], ROM unload or cleanup.
+     */
+    fun startRecording(basePath: String): Boolean {
+        return isInitialized && isRomLoaded && nativeStartRecording(basePath)
+    }
+
+    fun stopRecording() {
+        if (isInitialized) {
+            nativeStopRecording()
+        }
+    }
+
+    /**
+     * Instant replay ring: keeps up to [seconds] of frames and audio within [memoryKb].
+     * Either value at 0 turns it off and frees the memory. On by default (30 s / 16 MB).
+     */
+    fun setReplayConfig(seconds: Int, memoryKb: Int) {
+        replaySeconds = seconds.coerceIn(0, 600)
+        replayMemoryKb = memoryKb.coerceIn(0, 256 * 1024)
+        if (isInitialized) {
+            nativeSetReplayConfig(replaySeconds, replayMemoryKb)
+        }
+    }
+
+    /**
+     * Writes the replay ring to `[basePath].png` (animated PNG) and `[basePath].wav`.
+     * Blocks while encoding; call off the main thread.
+     */
+    fun exportReplay(basePath: String): Boolean {
+        return isInitialized && isRomLoaded && nativeExportReplay(basePath)
+    }
+
+    /**
+     * Starts sampling the guest PC every [intervalCycles] emulated cycles (0 for the
+     * native default). The histogram is cleared on start and kept after [stopProfiler].
+     */
+    fun startProfiler(intervalCycles: Int = 0) {
+        if (isInitialized && isRomLoaded) {
+            nativeStartProfiler(intervalCycles)
+        }
+    }
+
+    fun stopProfiler() {
+        if (isInitialized) {
+            nativeStopProfiler()
+        }
+    }
+
+    /**
+     * Starts input-latency measurement and clears earlier results. In [LatencyMode.PROBE]
+     * the core ignores the player and presses [probeButtons] (a button mask as used by
+     * [setButtonPressed]) itself, until the mode is switched back.
+     */
+    fun setLatencyMode(mode: LatencyMode, probeButtons: Int = 0x001) {
+        if (isInitialized) {
+            nativeSetLatencyMode(mode.nativeId, probeButtons)
+        }
+    }
+
+    fun getLatencyReport(): InputLatencyReport? {
+        return if (isInitialized) InputLatencyReport.fromPacked(nativeGetLatencyReport()) else null
+    }
+
+    /** JSON report: top sampled PCs, tight loops and the current idle-loop setting. */
+    fun getProfileReport(): String {
+        return if (isInitialized) nativeGetProfileReport() else ""
+    }
+
+    /**
+     * Boots each ROM headlessly for [frames] frames and writes the last frame, halved
+     * [halvings] times, as PNG to the matching entry of [outPaths]. Runs on a native
+     * thread pool and does not need [init]; blocks, so call it from a background
+     * dispatcher. Returns the number of images written.
+     */
+    fun generateThumbnails(romPaths: List<String>, outPaths: List<String>, frames: Int = 360, halvings: Int = 1): Int {
+        if (romPaths.isEmpty() || romPaths.size != outPaths.size) return 0
+        return nativeGenerateThumbnails(
+            romPaths.toTypedArray(),
+            outPaths.toTypedArray(),
+            frames.coerceIn(1, 3600),
+            halvings.coerceIn(0, 3)
+        )
+    }
+
+    /** Stops a running [generateThumbnails] batch after the ROMs in progress. */
+    fun cancelThumbnails() {
+        nativeCancelThumbnails()
+    }
+
     fun setNetplayLinkSession(session: NetplayLinkSession?) {
         activeNetplayLinkSession = session
         if (session == null) {
@@ -0,0 +1,65 @@
+package com.jboy.emulator.core
+
+/** Modes of [EmulatorCore.setLatencyMode]; values match `InputLatency::Mode` in input_latency.h. */
+enum class LatencyMode(val nativeId: Int) {
+    OFF(0),
+    // Times real input changes: until the game reads KEYINPUT, and until the frame is handed off.
+    MEASURE(1),
+    // Presses the probe buttons itself and counts emulated frames until the screen changes.
+    PROBE(2)
+}
+
+/**
+ * Snapshot of the latency histograms. [readMs] and [presentMs] have 1 ms buckets and
+ * [probeFrames] has one bucket per frame, starting at one frame. In every histogram the
+ * last bucket also counts all slower samples.
+ */
+data class InputLatencyReport(
+    val mode: Int,
+    val events: Long,
+    val unread: Long,
+    val unpresented: Long,
+    val probes: Long,
+    val probesSkipped: Long,
+    val readMs: LongArray,
+    val presentMs: LongArray,
+    val probeFrames: LongArray
+) {
+    /** Bucket index at [percent] of the samples, or -1 when there are none. */
+    fun percentile(histogram: LongArray, percent: Int): Int {
+        val total = histogram.sum()
+        if (total == 0L) return -1
+        val target = (total * percent + 99) / 100
+        var seen = 0L
+        histogram.forEachIndexed { index, count ->
+            seen += count
+            if (seen >= target) return index
+        }
+        return histogram.lastIndex
+    }
+
+    companion object {
+        private const val HEADER_SIZE = 6
+        private const val TIME_BUCKETS = 100
+        private const val FRAME_BUCKETS = 16
+        const val SIZE = HEADER_SIZE + 2 * TIME_BUCKETS + FRAME_BUCKETS
+
+        fun fromPacked(packed: LongArray): InputLatencyReport? {
+            if (packed.size < SIZE) return null
+            val read = HEADER_SIZE
+            val present = read + TIME_BUCKETS
+            val probe = present + TIME_BUCKETS
+            return InputLatencyReport(
+                mode = packed[0].toInt(),
+                events = packed[1],
+                unread = packed[2],
+                unpresented = packed[3],
+                probes = packed[4],
+                probesSkipped = packed[5],
+                readMs = packed.copyOfRange(read, present),
+                presentMs = packed.copyOfRange(present, probe),
+                probeFrames = packed.copyOfRange(probe, probe + FRAME_BUCKETS)
+            )
+        }
+    }
+}
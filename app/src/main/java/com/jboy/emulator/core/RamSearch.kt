@@ -0,0 +1,28 @@
+package com.jboy.emulator.core
+
+/** Filters of [EmulatorCore.filterRamSearch]; values match `RamSearch::Relation` in ram_search.h. */
+enum class RamSearchRelation(val nativeId: Int, val comparesToValue: Boolean) {
+    EQUAL(0, true),
+    NOT_EQUAL(1, true),
+    GREATER(2, true),
+    LESS(3, true),
+    UNCHANGED(4, false),
+    CHANGED(5, false),
+    INCREASED(6, false),
+    DECREASED(7, false)
+}
+
+/** A surviving RAM search candidate; [width] is 1, 2 or 4 bytes. */
+data class RamSearchResult(
+    val address: Long,
+    val value: Long,
+    val previous: Long,
+    val width: Int
+) {
+    /** Constant-write code in mGBA's VBA format: `AAAAAAAA:VV`, `:VVVV` or `:VVVVVVVV`. */
+    fun toCheatCode(newValue: Long = value): String {
+        val digits = width * 2
+        val mask = (1L shl (width * 8)) - 1
+        return "%08X:%0${digits}X".format(address, newValue and mask)
+    }
+}
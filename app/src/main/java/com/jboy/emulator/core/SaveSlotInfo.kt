@@ -0,0 +1,18 @@
+package com.jboy.emulator.core
+
+/**
+ * One entry of the native save-slot index, as returned by [EmulatorCore.getSaveSlots].
+ * [sizeBytes] is 0 for states written through mGBA's own state directory.
+ */
+data class SaveSlotInfo(
+    val slot: Int,
+    val sizeBytes: Long,
+    val savedAtMs: Long,
+    val hasThumbnail: Boolean
+) {
+    companion object {
+        // RGB565 little endian, 2x2 downscale of the GBA frame
+        const val THUMB_WIDTH = 120
+        const val THUMB_HEIGHT = 80
+    }
+}
@@ -0,0 +1,58 @@
+package com.jboy.emulator.core
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Direct buffers reused by every [EmulatorCore.step] call, so stepping the core
+ * does not allocate on either side of JNI. Owned by a single frame loop.
+ *
+ * [video] goes straight to [VideoRenderer.updateFrame]; audio is copied into the
+ * reused [audioSamples] for [AudioOutput.writeAudioData].
+ */
+class StepBuffers(audioCapacitySamples: Int = DEFAULT_AUDIO_CAPACITY) {
+
+    companion object {
+        // Six frames at 48 kHz stereo are 9600 samples; rounded up to whole
+        // 2048-sample chunks, which is how the native step drains the ring.
+        const val DEFAULT_AUDIO_CAPACITY = 10240
+    }
+
+    val video: ByteBuffer = allocate(VideoRenderer.SCREEN_WIDTH * VideoRenderer.SCREEN_HEIGHT * 2)
+    val audio: ByteBuffer = allocate(audioCapacitySamples * 2)
+    val stats: ByteBuffer = allocate(StepStats.COUNT * 8)
+    /** Filled by [readAudio]; valid until the next call. */
+    val audioSamples = ShortArray(audioCapacitySamples)
+
+    private val audioView = audio.asShortBuffer()
+    private val dirtyLines = IntArray(EmulatorCore.DIRTY_LINE_WORDS)
+
+    fun stat(index: Int): Long = stats.getLong(index * 8)
+
+    val framesRun: Int get() = stat(StepStats.FRAMES_RUN).toInt()
+    val videoChanged: Boolean get() = stat(StepStats.VIDEO_CHANGED) != 0L
+    val audioSampleCount: Int get() = stat(StepStats.AUDIO_SAMPLES).toInt()
+    val audioSampleRate: Int get() = stat(StepStats.AUDIO_RATE).toInt()
+    val emulationUs: Long get() = stat(StepStats.EMULATION_US)
+
+    /** The last step's dirty-line bitmap, in an array reused by every call. */
+    fun readDirtyLines(): IntArray {
+        for (word in dirtyLines.indices) {
+            dirtyLines[word] = stat(StepStats.DIRTY_LINES + word).toInt()
+        }
+        return dirtyLines
+    }
+
+    /** Copies the last step's interleaved stereo samples into [audioSamples]; returns the count. */
+    fun readAudio(): Int {
+        val count = audioSampleCount.coerceAtMost(audioSamples.size)
+        if (count <= 0) return 0
+        audioView.position(0)
+        audioView.get(audioSamples, 0, count)
+        audioView.position(0)
+        return count
+    }
+
+    private fun allocate(size: Int): ByteBuffer =
+        ByteBuffer.allocateDirect(size).order(ByteOrder.nativeOrder())
+}
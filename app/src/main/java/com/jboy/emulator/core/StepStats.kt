@@ -0,0 +1,16 @@
+package com.jboy.emulator.core
+
+/**
+ * Slots of the stats buffer filled by [EmulatorCore.step].
+ * Must stay in sync with `StepStat` in emulator_core.cpp.
+ */
+object StepStats {
+    const val FRAMES_RUN = 0
+    const val VIDEO_CHANGED = 1
+    const val AUDIO_SAMPLES = 2
+    const val AUDIO_RATE = 3
+    const val EMULATION_US = 4
+    // DIRTY_LINE_WORDS consecutive slots, one scanline bitmap word each
+    const val DIRTY_LINES = 5
+    const val COUNT = DIRTY_LINES + EmulatorCore.DIRTY_LINE_WORDS
+}
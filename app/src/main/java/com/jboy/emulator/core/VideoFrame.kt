@@ -0,0 +1,11 @@
+package com.jboy.emulator.core
+
+/**
+ * A frame handed to the presenter: RGB565 pixels plus the scanlines that changed
+ * since the previous frame (one bit per line, see [EmulatorCore.DIRTY_LINE_WORDS]).
+ * A null [dirtyLines] means the whole frame has to be uploaded.
+ */
+class VideoFrame(
+    val pixels: ByteArray,
+    val dirtyLines: IntArray?
+)
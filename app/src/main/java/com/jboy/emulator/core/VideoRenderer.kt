@@ -1,351 +1,275 @@
 package com.jboy.emulator.core
 
-import android.content.Context
 import android.graphics.SurfaceTexture
-import android.opengl.GLES20
 import android.opengl.GLSurfaceView
-import android.opengl.Matrix
 import android.util.Log
-import android.view.Surface
 import android.view.TextureView
+import java.io.File
 import java.nio.ByteBuffer
 import java.nio.ByteOrder
-import java.nio.FloatBuffer
 import javax.microedition.khronos.egl.EGLConfig
 import javax.microedition.khronos.opengles.GL10
 
 /**
  * 视频渲染器 - 使用OpenGL ES渲染游戏画面
+ *
+ * 着色器管线在原生层 (video_renderer.cpp)，这里只负责 GLSurfaceView 生命周期与帧数据传递。
  */
 class VideoRenderer private constructor() {
 
     companion object {
         private const val TAG = "VideoRenderer"
-        private const val VERTEX_SHADER_CODE = """
-            attribute vec4 vPosition;
-            attribute vec2 vTexCoord;
-            varying vec2 vTextureCoord;
-            uniform mat4 uMVPMatrix;
-            
-            void main() {
-                gl_Position = uMVPMatrix * vPosition;
-                vTextureCoord = vTexCoord;
-            }
-        """
-        
-        private const val FRAGMENT_SHADER_CODE = """
-            precision mediump float;
-            varying vec2 vTextureCoord;
-            uniform sampler2D uTexture;
-            
-            void main() {
-                gl_FragColor = texture2D(uTexture, vTextureCoord);
-            }
-        """
-        
+
         // GBA屏幕分辨率
         const val SCREEN_WIDTH = 240
         const val SCREEN_HEIGHT = 160
-        
-        // 顶点坐标 (x, y)
-        private val VERTEX_COORDS = floatArrayOf(
-            -1.0f,  1.0f,  // 左上
-            -1.0f, -1.0f,  // 左下
-             1.0f, -1.0f,  // 右下
-             1.0f,  1.0f   // 右上
-        )
-        
-        // 纹理坐标 (u, v)
-        private val TEX_COORDS = floatArrayOf(
-            0.0f, 0.0f,  // 左上
-            0.0f, 1.0f,  // 左下
-            1.0f, 1.0f,  // 右下
-            1.0f, 0.0f   // 右上
-        )
-        
-        // 顶点绘制顺序
-        private val DRAW_ORDER = shortArrayOf(0, 1, 2, 0, 2, 3)
-        
+
         @Volatile
         private var instance: VideoRenderer? = null
-        
+
         fun getInstance(): VideoRenderer {
             return instance ?: synchronized(this) {
                 instance ?: VideoRenderer().also { instance = it }
             }
         }
+
+        init {
+            try {
+                System.loadLibrary("jboy-core")
+            } catch (e: UnsatisfiedLinkError) {
+                Log.e(TAG, "Failed to load native library: ${e.message}")
+            }
+        }
     }
-    
+
+    private external fun nativeInit(cacheDir: String?): Boolean
+    private external fun nativeResize(width: Int, height: Int)
+    private external fun nativeSetPreset(preset: Int)
+    private external fun nativeSetScaleMode(mode: Int)
+    private external fun nativeDraw(frame: ByteBuffer?, width: Int, height: Int, dirtyLines: IntArray?)
+    private external fun nativeRelease()
+
     private var glSurfaceView: GLSurfaceView? = null
     private var textureView: TextureView? = null
     private var renderer: GLRenderer? = null
-    
-    // 帧缓冲区
-    private var frameBuffer: ByteArray? = null
+
+    // 帧缓冲区 (RGB565)，直接内存供原生层读取
+    private val frameBuffer: ByteBuffer = ByteBuffer
+        .allocateDirect(SCREEN_WIDTH * SCREEN_HEIGHT * 2)
+        .order(ByteOrder.nativeOrder())
+    private var hasFrame = false
+    // 自上次绘制以来变化的行；needsFullUpload 时整帧上传
+    private val pendingDirtyLines = IntArray(EmulatorCore.DIRTY_LINE_WORDS)
+    private var needsFullUpload = true
     private val frameBufferLock = Object()
-    
-    // 缩放模式
+
+    // 缩放模式，顺序与原生 ScaleMode 一致
     enum class ScaleMode {
         FIT,        // 适应屏幕
         FILL,       // 填充屏幕
         STRETCH,    // 拉伸
         INTEGER     // 整数倍缩放
     }
-    
+
+    // 后处理预设，顺序与原生 ShaderPreset 一致
+    enum class ShaderPreset {
+        NEAREST,    // 最邻近
+        LINEAR,     // 线性
+        CRT,        // 扫描线 + 荫罩
+        XBR,        // xBR-lv2 平滑放大
+        LCD         // GBA 色彩 + 像素网格
+    }
+
+    @Volatile
     private var currentScaleMode = ScaleMode.FIT
+    @Volatile
+    private var currentPreset = ShaderPreset.NEAREST
     private var isInitialized = false
-    
+
     /**
      * 初始化GLSurfaceView渲染器
      */
     fun initWithSurfaceView(surfaceView: GLSurfaceView) {
         this.glSurfaceView = surfaceView
-        
+
         surfaceView.setEGLContextClientVersion(2)
-        renderer = GLRenderer()
+        surfaceView.preserveEGLContextOnPause = true
+        renderer = GLRenderer(File(surfaceView.context.cacheDir, "shaders").absolutePath)
         surfaceView.setRenderer(renderer)
         surfaceView.renderMode = GLSurfaceView.RENDERMODE_WHEN_DIRTY
-        
+
         isInitialized = true
         Log.d(TAG, "VideoRenderer initialized with GLSurfaceView")
     }
-    
+
     /**
      * 初始化TextureView渲染器
      */
     fun initWithTextureView(textureView: TextureView) {
         this.textureView = textureView
-        
+
         textureView.surfaceTextureListener = object : TextureView.SurfaceTextureListener {
             override fun onSurfaceTextureAvailable(surface: SurfaceTexture, width: Int, height: Int) {
                 Log.d(TAG, "TextureView surface available: $width x $height")
                 // 可以在这里初始化OpenGL上下文
             }
-            
+
             override fun onSurfaceTextureSizeChanged(surface: SurfaceTexture, width: Int, height: Int) {
                 Log.d(TAG, "TextureView size changed: $width x $height")
             }
-            
+
             override fun onSurfaceTextureDestroyed(surface: SurfaceTexture): Boolean {
                 return true
             }
-            
+
             override fun onSurfaceTextureUpdated(surface: SurfaceTexture) {
                 // 纹理更新
             }
         }
-        
+
         isInitialized = true
         Log.d(TAG, "VideoRenderer initialized with TextureView")
     }
-    
+
+    /**
+     * 更新帧数据 (RGB565 小端)
+     *
+     * @param dirtyLines 每行一位的脏行位图，为 null 时视为整帧变化
+     */
+    fun updateFrame(frameData: ByteArray, dirtyLines: IntArray? = null) {
+        if (frameData.size < frameBuffer.capacity()) return
+        copyFrameRows(dirtyLines) { offset, length ->
+            frameBuffer.put(frameData, offset, length)
+        }
+    }
+
     /**
-     * 更新帧数据
+     * 同上，直接从原生直接缓冲区拷贝 (StepBuffers.video)，不经过 ByteArray
+     *
+     * 调用返回后 frame 与 dirtyLines 可立即复用
      */
-    fun updateFrame(frameData: ByteArray) {
+    fun updateFrame(frame: ByteBuffer, dirtyLines: IntArray? = null) {
+        if (frame.capacity() < frameBuffer.capacity()) return
+        copyFrameRows(dirtyLines) { offset, length ->
+            frame.limit(offset + length)
+            frame.position(offset)
+            frameBuffer.put(frame)
+        }
+        frame.clear()
+    }
+
+    /** 已接收的帧数，供 FPS 显示使用 */
+    @Volatile
+    var framesReceived = 0L
+        private set
+
+    private inline fun copyFrameRows(dirtyLines: IntArray?, copyRow: (offset: Int, length: Int) -> Unit) {
         synchronized(frameBufferLock) {
-            frameBuffer = frameData.copyOf()
+            if (!hasFrame || dirtyLines == null) {
+                frameBuffer.clear()
+                copyRow(0, frameBuffer.capacity())
+                frameBuffer.position(0)
+                hasFrame = true
+                needsFullUpload = true
+            } else {
+                // 只拷贝变化的行
+                val stride = SCREEN_WIDTH * 2
+                var changed = false
+                for (y in 0 until SCREEN_HEIGHT) {
+                    val word = y shr 5
+                    val bit = 1 shl (y and 31)
+                    if (word >= dirtyLines.size || (dirtyLines[word] and bit) == 0) continue
+                    frameBuffer.position(y * stride)
+                    copyRow(y * stride, stride)
+                    pendingDirtyLines[word] = pendingDirtyLines[word] or bit
+                    changed = true
+                }
+                frameBuffer.position(0)
+                if (!changed) return
+            }
+            framesReceived++
         }
         glSurfaceView?.requestRender()
     }
-    
+
     /**
      * 设置缩放模式
      */
     fun setScaleMode(mode: ScaleMode) {
         currentScaleMode = mode
-        renderer?.updateScaleMode(mode)
+        glSurfaceView?.requestRender()
+    }
+
+    /**
+     * 设置后处理预设
+     */
+    fun setShaderPreset(preset: ShaderPreset) {
+        currentPreset = preset
+        glSurfaceView?.requestRender()
     }
-    
+
     /**
      * 清理资源
      */
     fun cleanup() {
+        glSurfaceView?.queueEvent { nativeRelease() }
         isInitialized = false
         glSurfaceView = null
         textureView = null
         renderer = null
-        frameBuffer = null
+        synchronized(frameBufferLock) {
+            hasFrame = false
+            needsFullUpload = true
+            pendingDirtyLines.fill(0)
+        }
         Log.d(TAG, "VideoRenderer cleaned up")
     }
-    
+
     /**
-     * OpenGL渲染器
+     * OpenGL渲染器，所有原生调用都在 GL 线程
      */
-    private inner class GLRenderer : GLSurfaceView.Renderer {
-        
-        private var program: Int = 0
-        private var positionHandle: Int = 0
-        private var texCoordHandle: Int = 0
-        private var mvpMatrixHandle: Int = 0
-        private var textureHandle: Int = 0
-        
-        private var textureId: Int = 0
-        
-        private lateinit var vertexBuffer: FloatBuffer
-        private lateinit var texCoordBuffer: FloatBuffer
-        private lateinit var drawListBuffer: java.nio.ShortBuffer
-        
-        private val mvpMatrix = FloatArray(16)
-        private val projectionMatrix = FloatArray(16)
-        private val viewMatrix = FloatArray(16)
-        
-        private var viewWidth: Int = 0
-        private var viewHeight: Int = 0
-        
-        init {
-            // 初始化顶点缓冲区
-            val vbb = ByteBuffer.allocateDirect(VERTEX_COORDS.size * 4)
-            vbb.order(ByteOrder.nativeOrder())
-            vertexBuffer = vbb.asFloatBuffer()
-            vertexBuffer.put(VERTEX_COORDS)
-            vertexBuffer.position(0)
-            
-            // 初始化纹理坐标缓冲区
-            val tbb = ByteBuffer.allocateDirect(TEX_COORDS.size * 4)
-            tbb.order(ByteOrder.nativeOrder())
-            texCoordBuffer = tbb.asFloatBuffer()
-            texCoordBuffer.put(TEX_COORDS)
-            texCoordBuffer.position(0)
-            
-            // 初始化绘制顺序缓冲区
-            val dlb = ByteBuffer.allocateDirect(DRAW_ORDER.size * 2)
-            dlb.order(ByteOrder.nativeOrder())
-            drawListBuffer = dlb.asShortBuffer()
-            drawListBuffer.put(DRAW_ORDER)
-            drawListBuffer.position(0)
-        }
-        
+    private inner class GLRenderer(private val cacheDir: String) : GLSurfaceView.Renderer {
+
+        private var appliedPreset: ShaderPreset? = null
+        private var appliedScaleMode: ScaleMode? = null
+
         override fun onSurfaceCreated(gl: GL10?, config: EGLConfig?) {
-            GLES20.glClearColor(0.0f, 0.0f, 0.0f, 1.0f)
-            
-            // 编译着色器
-            val vertexShader = loadShader(GLES20.GL_VERTEX_SHADER, VERTEX_SHADER_CODE)
-            val fragmentShader = loadShader(GLES20.GL_FRAGMENT_SHADER, FRAGMENT_SHADER_CODE)
-            
-            // 创建程序
-            program = GLES20.glCreateProgram()
-            GLES20.glAttachShader(program, vertexShader)
-            GLES20.glAttachShader(program, fragmentShader)
-            GLES20.glLinkProgram(program)
-            
-            // 获取句柄
-            positionHandle = GLES20.glGetAttribLocation(program, "vPosition")
-            texCoordHandle = GLES20.glGetAttribLocation(program, "vTexCoord")
-            mvpMatrixHandle = GLES20.glGetUniformLocation(program, "uMVPMatrix")
-            textureHandle = GLES20.glGetUniformLocation(program, "uTexture")
-            
-            // 创建纹理
-            val textures = IntArray(1)
-            GLES20.glGenTextures(1, textures, 0)
-            textureId = textures[0]
-            
-            GLES20.glBindTexture(GLES20.GL_TEXTURE_2D, textureId)
-            GLES20.glTexParameteri(GLES20.GL_TEXTURE_2D, GLES20.GL_TEXTURE_MIN_FILTER, GLES20.GL_LINEAR)
-            GLES20.glTexParameteri(GLES20.GL_TEXTURE_2D, GLES20.GL_TEXTURE_MAG_FILTER, GLES20.GL_NEAREST)
+            // 上下文重建后原生对象需要重新创建
+            if (!nativeInit(cacheDir)) {
+                Log.e(TAG, "Native video renderer init failed")
+            }
+            appliedPreset = null
+            appliedScaleMode = null
         }
-        
+
         override fun onSurfaceChanged(gl: GL10?, width: Int, height: Int) {
-            GLES20.glViewport(0, 0, width, height)
-            viewWidth = width
-            viewHeight = height
-            updateProjectionMatrix()
+            nativeResize(width, height)
         }
-        
+
         override fun onDrawFrame(gl: GL10?) {
-            GLES20.glClear(GLES20.GL_COLOR_BUFFER_BIT)
-            
-            // 获取当前帧数据
-            var currentFrame: ByteArray? = null
-            synchronized(frameBufferLock) {
-                currentFrame = frameBuffer
+            val preset = currentPreset
+            if (preset != appliedPreset) {
+                nativeSetPreset(preset.ordinal)
+                appliedPreset = preset
             }
-            
-            if (currentFrame == null) return
-            
-            // 更新纹理
-            updateTexture(currentFrame!!)
-            
-            // 使用程序
-            GLES20.glUseProgram(program)
-            
-            // 设置顶点数据
-            GLES20.glEnableVertexAttribArray(positionHandle)
-            GLES20.glVertexAttribPointer(positionHandle, 2, GLES20.GL_FLOAT, false, 0, vertexBuffer)
-            
-            // 设置纹理坐标
-            GLES20.glEnableVertexAttribArray(texCoordHandle)
-            GLES20.glVertexAttribPointer(texCoordHandle, 2, GLES20.GL_FLOAT, false, 0, texCoordBuffer)
-            
-            // 设置MVP矩阵
-            GLES20.glUniformMatrix4fv(mvpMatrixHandle, 1, false, mvpMatrix, 0)
-            
-            // 绑定纹理
-            GLES20.glActiveTexture(GLES20.GL_TEXTURE0)
-            GLES20.glBindTexture(GLES20.GL_TEXTURE_2D, textureId)
-            GLES20.glUniform1i(textureHandle, 0)
-            
-            // 绘制
-            GLES20.glDrawElements(GLES20.GL_TRIANGLES, DRAW_ORDER.size, GLES20.GL_UNSIGNED_SHORT, drawListBuffer)
-            
-            // 禁用顶点数组
-            GLES20.glDisableVertexAttribArray(positionHandle)
-            GLES20.glDisableVertexAttribArray(texCoordHandle)
-        }
-        
-        private fun loadShader(type: Int, shaderCode: String): Int {
-            val shader = GLES20.glCreateShader(type)
-            GLES20.glShaderSource(shader, shaderCode)
-            GLES20.glCompileShader(shader)
-            return shader
-        }
-        
-        private fun updateTexture(frameData: ByteArray) {
-            // 将RGBA字节数组转换为纹理
-            val buffer = ByteBuffer.allocateDirect(frameData.size)
-            buffer.order(ByteOrder.nativeOrder())
-            buffer.put(frameData)
-            buffer.position(0)
-            
-            GLES20.glBindTexture(GLES20.GL_TEXTURE_2D, textureId)
-            GLES20.glTexImage2D(
-                GLES20.GL_TEXTURE_2D, 0, GLES20.GL_RGBA,
-                SCREEN_WIDTH, SCREEN_HEIGHT, 0,
-                GLES20.GL_RGBA, GLES20.GL_UNSIGNED_BYTE, buffer
-            )
-        }
-        
-        private fun updateProjectionMatrix() {
-            Matrix.setLookAtM(viewMatrix, 0, 0f, 0f, -3f, 0f, 0f, 0f, 0f, 1f, 0f)
-            
-            val aspectRatio = viewWidth.toFloat() / viewHeight.toFloat()
-            val gameAspectRatio = SCREEN_WIDTH.toFloat() / SCREEN_HEIGHT.toFloat()
-            
-            when (currentScaleMode) {
-                ScaleMode.FIT -> {
-                    if (aspectRatio > gameAspectRatio) {
-                        val scale = gameAspectRatio / aspectRatio
-                        Matrix.frustumM(projectionMatrix, 0, -scale, scale, -1f, 1f, 3f, 7f)
-                    } else {
-                        val scale = aspectRatio / gameAspectRatio
-                        Matrix.frustumM(projectionMatrix, 0, -1f, 1f, -scale, scale, 3f, 7f)
-                    }
-                }
-                ScaleMode.FILL, ScaleMode.STRETCH -> {
-                    Matrix.frustumM(projectionMatrix, 0, -1f, 1f, -1f, 1f, 3f, 7f)
-                }
-                ScaleMode.INTEGER -> {
-                    // 整数倍缩放逻辑
-                    Matrix.frustumM(projectionMatrix, 0, -1f, 1f, -1f, 1f, 3f, 7f)
+            val scaleMode = currentScaleMode
+            if (scaleMode != appliedScaleMode) {
+                nativeSetScaleMode(scaleMode.ordinal)
+                appliedScaleMode = scaleMode
+            }
+
+            synchronized(frameBufferLock) {
+                nativeDraw(
+                    if (hasFrame) frameBuffer else null,
+                    SCREEN_WIDTH,
+                    SCREEN_HEIGHT,
+                    if (needsFullUpload) null else pendingDirtyLines
+                )
+                if (hasFrame) {
+                    needsFullUpload = false
+                    pendingDirtyLines.fill(0)
                 }
             }
-            
-            Matrix.multiplyMM(mvpMatrix, 0, projectionMatrix, 0, viewMatrix, 0)
-        }
-        
-        fun updateScaleMode(mode: ScaleMode) {
-            currentScaleMode = mode
-            updateProjectionMatrix()
         }
     }
 }
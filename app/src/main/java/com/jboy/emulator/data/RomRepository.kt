@@ -7,6 +7,7 @@ import android.graphics.Color
 import android.graphics.Paint
 import android.net.Uri
 import androidx.documentfile.provider.DocumentFile
+import com.jboy.emulator.core.EmulatorCore
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.flow.Flow
 import kotlinx.coroutines.flow.flow
@@ -53,6 +54,8 @@ class RomRepository(private val context: Context) {
     }
     
     private val supportedExtensions = listOf("gba", "zip")
+    // 与ROM同名的补丁在加载时由原生层应用，不单独列为游戏
+    private val patchExtensions = listOf("ips", "ups", "bps")
 
     private data class RomMetadata(
         val isFavorite: Boolean = false,
@@ -96,7 +99,7 @@ class RomRepository(private val context: Context) {
         folder.listFiles().forEach { file ->
             when {
                 file.isDirectory -> collectRomFiles(file, result)
-                file.isFile && isRomFile(file.name) -> result.add(file)
+                file.isFile && (isRomFile(file.name) || isPatchFile(file.name)) -> result.add(file)
             }
         }
     }
@@ -109,6 +112,23 @@ class RomRepository(private val context: Context) {
         val extension = fileName.substringAfterLast('.', "").lowercase()
         return extension in supportedExtensions
     }
+
+    private fun isPatchFile(fileName: String?): Boolean {
+        if (fileName == null) return false
+        return fileName.substringAfterLast('.', "").lowercase() in patchExtensions
+    }
+
+    /**
+     * 把补丁复制到ROM目录，放在同名ROM旁边
+     */
+    private fun importPatch(uri: Uri, fileName: String) {
+        val target = File(romCacheDir, fileName.replace("/", "_"))
+        context.contentResolver.openInputStream(uri)?.use { input ->
+            target.outputStream().use { output ->
+                input.copyTo(output)
+            }
+        }
+    }
     
     /**
      * 处理单个ROM文件
@@ -116,6 +136,10 @@ class RomRepository(private val context: Context) {
     private suspend fun processRomFile(file: DocumentFile): RomInfo? = withContext(Dispatchers.IO) {
         try {
             val fileName = file.name ?: return@withContext null
+            if (isPatchFile(fileName)) {
+                importPatch(file.uri, fileName)
+                return@withContext null
+            }
             val displayName = fileName.substringBeforeLast('.', fileName)
             
             // 复制到缓存目录以便快速访问
@@ -175,6 +199,10 @@ class RomRepository(private val context: Context) {
     private suspend fun processSingleUri(uri: Uri, fallbackName: String): RomInfo? = withContext(Dispatchers.IO) {
         try {
             val rawName = DocumentFile.fromSingleUri(context, uri)?.name ?: fallbackName
+            if (isPatchFile(rawName)) {
+                importPatch(uri, rawName)
+                return@withContext null
+            }
             if (!isRomFile(rawName)) {
                 return@withContext null
             }
@@ -321,6 +349,28 @@ class RomRepository(private val context: Context) {
         }
     }
     
+    private fun screenshotFile(fileName: String): File {
+        return File(coverCacheDir, "$fileName.shot.png")
+    }
+
+    /**
+     * 为还没有截图的游戏生成开机画面截图（原生线程池，无头运行 [frames] 帧）
+     *
+     * 阻塞直到完成或被 EmulatorCore.cancelThumbnails() 取消，返回新生成的数量
+     */
+    suspend fun generateScreenshots(games: List<RomInfo>, frames: Int = 360): Int = withContext(Dispatchers.IO) {
+        val pending = games.filter { !screenshotFile(it.fileName).exists() }
+        if (pending.isEmpty()) return@withContext 0
+        val romPaths = ArrayList<String>(pending.size)
+        val outPaths = ArrayList<String>(pending.size)
+        pending.forEach { rom ->
+            val gameFile = getGameFile(rom) ?: return@forEach
+            romPaths.add(gameFile.absolutePath)
+            outPaths.add(screenshotFile(rom.fileName).absolutePath)
+        }
+        EmulatorCore.getInstance().generateThumbnails(romPaths, outPaths, frames)
+    }
+
     /**
      * 加载最近游戏列表
      */
@@ -348,7 +398,9 @@ class RomRepository(private val context: Context) {
             ?.map { file ->
                 val key = metadataKey(file.absolutePath)
                 val entry = metadata[key] ?: RomMetadata()
-                val cover = File(coverCacheDir, "${file.name}.png").takeIf { it.exists() }?.absolutePath
+                // 优先使用原生生成的截图，其次是文字封面
+                val cover = listOf(screenshotFile(file.name), File(coverCacheDir, "${file.name}.png"))
+                    .firstOrNull { it.exists() }?.absolutePath
                 RomInfo(
                     fileName = file.name,
                     filePath = file.absolutePath,
@@ -392,6 +444,7 @@ class RomRepository(private val context: Context) {
         try {
             File(romInfo.filePath).delete()
             romInfo.coverPath?.let { File(it).delete() }
+            screenshotFile(romInfo.fileName).delete()
             true
         } catch (e: Exception) {
             false
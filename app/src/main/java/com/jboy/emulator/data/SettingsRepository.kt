@@ -28,6 +28,7 @@ data class SettingsData(
     val audioBufferSize: Int = 8192,
     val audioFilterEnabled: Boolean = true,
     val audioFilterLevel: Int = 60,
+    val audioClockPacing: Boolean = false,
     val controllerOpacity: Float = 0.8f,
     val buttonSize: Float = 1f,
     val dpadMode: String = "WHEEL",
@@ -37,6 +38,9 @@ data class SettingsData(
     val frameSkipThrottlePercent: Int = 33,
     val frameSkipInterval: Int = 0,
     val interframeBlending: Boolean = false,
+    val threadedVideo: Boolean = false,
+    val performanceThreads: Boolean = true,
+    val stateExport: Boolean = false,
     val idleLoopRemoval: String = "REMOVE_KNOWN",
     val keyMapA: String = "A",
     val keyMapB: String = "B",
@@ -86,6 +90,7 @@ class SettingsDataStore(private val context: Context) {
         val AUDIO_BUFFER_SIZE = intPreferencesKey("audio_buffer_size")
         val AUDIO_FILTER_ENABLED = booleanPreferencesKey("audio_filter_enabled")
         val AUDIO_FILTER_LEVEL = intPreferencesKey("audio_filter_level")
+        val AUDIO_CLOCK_PACING = booleanPreferencesKey("audio_clock_pacing")
         val CONTROLLER_OPACITY = floatPreferencesKey("controller_opacity")
         val BUTTON_SIZE = floatPreferencesKey("button_size")
         val DPAD_MODE = stringPreferencesKey("dpad_mode")
@@ -95,6 +100,9 @@ class SettingsDataStore(private val context: Context) {
         val FRAME_SKIP_THROTTLE_PERCENT = intPreferencesKey("frame_skip_throttle_percent")
         val FRAME_SKIP_INTERVAL = intPreferencesKey("frame_skip_interval")
         val INTERFRAME_BLENDING = booleanPreferencesKey("interframe_blending")
+        val THREADED_VIDEO = booleanPreferencesKey("threaded_video")
+        val PERFORMANCE_THREADS = booleanPreferencesKey("performance_threads")
+        val STATE_EXPORT = booleanPreferencesKey("state_export")
         val IDLE_LOOP_REMOVAL = stringPreferencesKey("idle_loop_removal")
         val KEY_MAP_A = stringPreferencesKey("key_map_a")
         val KEY_MAP_B = stringPreferencesKey("key_map_b")
@@ -144,6 +152,7 @@ class SettingsDataStore(private val context: Context) {
                 audioBufferSize = preferences[PreferencesKeys.AUDIO_BUFFER_SIZE] ?: 8192,
                 audioFilterEnabled = preferences[PreferencesKeys.AUDIO_FILTER_ENABLED] ?: true,
                 audioFilterLevel = (preferences[PreferencesKeys.AUDIO_FILTER_LEVEL] ?: 60).coerceIn(0, 100),
+                audioClockPacing = preferences[PreferencesKeys.AUDIO_CLOCK_PACING] ?: false,
                 controllerOpacity = preferences[PreferencesKeys.CONTROLLER_OPACITY] ?: 0.8f,
                 buttonSize = preferences[PreferencesKeys.BUTTON_SIZE] ?: 1f,
                 dpadMode = preferences[PreferencesKeys.DPAD_MODE] ?: "WHEEL",
@@ -153,6 +162,9 @@ class SettingsDataStore(private val context: Context) {
                 frameSkipThrottlePercent = (preferences[PreferencesKeys.FRAME_SKIP_THROTTLE_PERCENT] ?: 33).coerceIn(0, 100),
                 frameSkipInterval = (preferences[PreferencesKeys.FRAME_SKIP_INTERVAL] ?: 0).coerceIn(0, 12),
                 interframeBlending = preferences[PreferencesKeys.INTERFRAME_BLENDING] ?: false,
+                threadedVideo = preferences[PreferencesKeys.THREADED_VIDEO] ?: false,
+                performanceThreads = preferences[PreferencesKeys.PERFORMANCE_THREADS] ?: true,
+                stateExport = preferences[PreferencesKeys.STATE_EXPORT] ?: false,
                 idleLoopRemoval = preferences[PreferencesKeys.IDLE_LOOP_REMOVAL] ?: "REMOVE_KNOWN",
                 keyMapA = preferences[PreferencesKeys.KEY_MAP_A] ?: "A",
                 keyMapB = preferences[PreferencesKeys.KEY_MAP_B] ?: "B",
@@ -279,6 +291,12 @@ class SettingsDataStore(private val context: Context) {
             preferences[PreferencesKeys.AUDIO_FILTER_LEVEL] = level.coerceIn(0, 100)
         }
     }
+
+    suspend fun updateAudioClockPacing(enabled: Boolean) {
+        context.settingsDataStore.edit { preferences ->
+            preferences[PreferencesKeys.AUDIO_CLOCK_PACING] = enabled
+        }
+    }
     
     suspend fun updateControllerOpacity(opacity: Float) {
         context.settingsDataStore.edit { preferences ->
@@ -334,6 +352,24 @@ class SettingsDataStore(private val context: Context) {
         }
     }
 
+    suspend fun updateThreadedVideo(enabled: Boolean) {
+        context.settingsDataStore.edit { preferences ->
+            preferences[PreferencesKeys.THREADED_VIDEO] = enabled
+        }
+    }
+
+    suspend fun updatePerformanceThreads(enabled: Boolean) {
+        context.settingsDataStore.edit { preferences ->
+            preferences[PreferencesKeys.PERFORMANCE_THREADS] = enabled
+        }
+    }
+
+    suspend fun updateStateExport(enabled: Boolean) {
+        context.settingsDataStore.edit { preferences ->
+            preferences[PreferencesKeys.STATE_EXPORT] = enabled
+        }
+    }
+
     suspend fun updateIdleLoopRemoval(mode: String) {
         context.settingsDataStore.edit { preferences ->
             preferences[PreferencesKeys.IDLE_LOOP_REMOVAL] = mode
@@ -527,6 +563,7 @@ class SettingsRepository(private val dataStore: SettingsDataStore) {
     suspend fun updateAudioBufferSize(bufferSize: Int) = dataStore.updateAudioBufferSize(bufferSize)
     suspend fun updateAudioFilterEnabled(enabled: Boolean) = dataStore.updateAudioFilterEnabled(enabled)
     suspend fun updateAudioFilterLevel(level: Int) = dataStore.updateAudioFilterLevel(level)
+    suspend fun updateAudioClockPacing(enabled: Boolean) = dataStore.updateAudioClockPacing(enabled)
     suspend fun updateControllerOpacity(opacity: Float) = dataStore.updateControllerOpacity(opacity)
     suspend fun updateButtonSize(size: Float) = dataStore.updateButtonSize(size)
     suspend fun updateDpadMode(mode: String) = dataStore.updateDpadMode(mode)
@@ -536,6 +573,9 @@ class SettingsRepository(private val dataStore: SettingsDataStore) {
     suspend fun updateFrameSkipThrottlePercent(percent: Int) = dataStore.updateFrameSkipThrottlePercent(percent)
     suspend fun updateFrameSkipInterval(interval: Int) = dataStore.updateFrameSkipInterval(interval)
     suspend fun updateInterframeBlending(enabled: Boolean) = dataStore.updateInterframeBlending(enabled)
+    suspend fun updateThreadedVideo(enabled: Boolean) = dataStore.updateThreadedVideo(enabled)
+    suspend fun updatePerformanceThreads(enabled: Boolean) = dataStore.updatePerformanceThreads(enabled)
+    suspend fun updateStateExport(enabled: Boolean) = dataStore.updateStateExport(enabled)
     suspend fun updateIdleLoopRemoval(mode: String) = dataStore.updateIdleLoopRemoval(mode)
     suspend fun updateKeyMapA(target: String) = dataStore.updateKeyMapA(target)
     suspend fun updateKeyMapB(target: String) = dataStore.updateKeyMapB(target)
@@ -1,9 +1,11 @@
 package com.jboy.emulator.ui.game
 
+import androidx.compose.foundation.Image
 import androidx.compose.foundation.layout.Arrangement
 import androidx.compose.foundation.layout.Column
 import androidx.compose.foundation.layout.Row
 import androidx.compose.foundation.layout.Spacer
+import androidx.compose.foundation.layout.aspectRatio
 import androidx.compose.foundation.layout.fillMaxWidth
 import androidx.compose.foundation.layout.height
 import androidx.compose.foundation.layout.heightIn
@@ -29,11 +31,17 @@ import androidx.compose.runtime.remember
 import androidx.compose.runtime.setValue
 import androidx.compose.ui.Alignment
 import androidx.compose.ui.Modifier
+import androidx.compose.ui.draw.clip
+import androidx.compose.ui.graphics.FilterQuality
 import androidx.compose.ui.text.font.FontWeight
 import androidx.compose.ui.text.style.TextOverflow
 import androidx.compose.ui.unit.dp
 import androidx.compose.ui.unit.sp
+import com.jboy.emulator.core.RamSearchRelation
 import com.jboy.emulator.ui.i18n.l10n
+import java.text.SimpleDateFormat
+import java.util.Date
+import java.util.Locale
 
 @Composable
 fun GameMenu(
@@ -66,7 +74,11 @@ fun GameMenu(
     isMuted: Boolean,
     isLayoutEditMode: Boolean,
     cheatCodes: List<CheatCodeItem>,
-    saveSlots: List<Int>
+    saveSlots: List<Int>,
+    slotPreviews: Map<Int, SaveSlotPreview> = emptyMap(),
+    ramSearch: RamSearchUiState = RamSearchUiState(),
+    onStartRamSearch: (Int) -> Unit = {},
+    onFilterRamSearch: (RamSearchRelation, Long) -> Unit = { _, _ -> }
 ) {
     var cheatInput by remember { mutableStateOf("") }
     var slotInput by remember { mutableStateOf("") }
@@ -303,6 +315,7 @@ fun GameMenu(
                             rowSlots.forEach { slot ->
                                 SaveSlotPanel(
                                     slot = slot,
+                                    preview = slotPreviews[slot],
                                     onSave = {
                                         onSaveSlot(slot)
                                         onDismiss()
@@ -466,6 +479,13 @@ fun GameMenu(
                     }
                 }
 
+                RamSearchPanel(
+                    state = ramSearch,
+                    onStart = onStartRamSearch,
+                    onFilter = onFilterRamSearch,
+                    onAddCheat = onAddCheatCode
+                )
+
                 Spacer(modifier = Modifier.height(6.dp))
             }
         },
@@ -491,6 +511,7 @@ fun GameMenu(
 @Composable
 private fun SaveSlotPanel(
     slot: Int,
+    preview: SaveSlotPreview?,
     onSave: () -> Unit,
     onLoad: () -> Unit,
     onRemove: () -> Unit,
@@ -515,6 +536,24 @@ private fun SaveSlotPanel(
                 fontSize = 12.sp,
                 fontWeight = FontWeight.SemiBold
             )
+            preview?.thumbnail?.let { thumbnail ->
+                Image(
+                    bitmap = thumbnail,
+                    contentDescription = null,
+                    filterQuality = FilterQuality.None,
+                    modifier = Modifier
+                        .fillMaxWidth()
+                        .aspectRatio(3f / 2f)
+                        .clip(RoundedCornerShape(6.dp))
+                )
+            }
+            Text(
+                text = preview?.let {
+                    SimpleDateFormat("yyyy-MM-dd HH:mm", Locale.getDefault()).format(Date(it.info.savedAtMs))
+                } ?: l10n("空槽位"),
+                fontSize = 11.sp,
+                color = MaterialTheme.colorScheme.onSurfaceVariant
+            )
             Row(
                 modifier = Modifier.fillMaxWidth(),
                 horizontalArrangement = Arrangement.spacedBy(6.dp)
@@ -4,10 +4,7 @@ import android.app.Activity
 import android.content.pm.ActivityInfo
 import android.view.KeyEvent
 import androidx.compose.foundation.background
-import androidx.compose.foundation.Canvas
-import androidx.compose.foundation.Image
 import androidx.compose.foundation.layout.Box
-import androidx.compose.foundation.layout.BoxWithConstraints
 import androidx.compose.foundation.layout.Row
 import androidx.compose.foundation.layout.fillMaxSize
 import androidx.compose.foundation.layout.padding
@@ -33,21 +30,19 @@ import androidx.compose.runtime.setValue
 import androidx.compose.ui.Alignment
 import androidx.compose.ui.Modifier
 import androidx.compose.ui.graphics.Color
-import androidx.compose.ui.graphics.ColorFilter
-import androidx.compose.ui.graphics.ColorMatrix
-import androidx.compose.ui.graphics.FilterQuality
-import androidx.compose.ui.graphics.asImageBitmap
-import androidx.compose.ui.layout.ContentScale
 import androidx.compose.ui.platform.LocalContext
-import androidx.compose.ui.platform.LocalDensity
+import androidx.compose.ui.platform.LocalLifecycleOwner
 import androidx.compose.foundation.layout.statusBarsPadding
 import androidx.compose.ui.unit.dp
+import androidx.compose.ui.viewinterop.AndroidView
 import androidx.datastore.preferences.core.booleanPreferencesKey
 import androidx.datastore.preferences.core.floatPreferencesKey
 import androidx.datastore.preferences.core.intPreferencesKey
 import androidx.datastore.preferences.core.edit
 import androidx.datastore.preferences.core.stringPreferencesKey
 import androidx.hilt.navigation.compose.hiltViewModel
+import androidx.lifecycle.Lifecycle
+import androidx.lifecycle.LifecycleEventObserver
 import androidx.core.view.WindowCompat
 import androidx.core.view.WindowInsetsCompat
 import androidx.core.view.WindowInsetsControllerCompat
@@ -55,6 +50,8 @@ import com.jboy.emulator.data.RomRepository
 import com.jboy.emulator.data.settingsDataStore
 import com.jboy.emulator.core.InputHandler as CoreInputHandler
 import com.jboy.emulator.core.InputKeys
+import com.jboy.emulator.core.VideoFrame
+import com.jboy.emulator.core.VideoRenderer as GlVideoRenderer
 import com.jboy.emulator.input.InputHandler
 import com.jboy.emulator.ui.i18n.l10n
 import com.jboy.emulator.ui.gamepad.DpadMode
@@ -63,13 +60,12 @@ import com.jboy.emulator.ui.gamepad.GamepadLayoutOffsets
 import com.jboy.emulator.ui.gamepad.VirtualGamepad
 import com.jboy.emulator.ui.settings.AspectRatio
 import com.jboy.emulator.ui.settings.VideoFilter
+import kotlinx.coroutines.delay
 import kotlinx.coroutines.flow.StateFlow
 import kotlinx.coroutines.flow.first
 import kotlinx.coroutines.flow.map
 import kotlinx.coroutines.launch
-import android.graphics.Bitmap
-import kotlin.math.floor
-import kotlin.math.min
+import android.opengl.GLSurfaceView
 
 private val PREF_VIDEO_FILTER = stringPreferencesKey("video_filter")
 private val PREF_ASPECT_RATIO = stringPreferencesKey("aspect_ratio")
@@ -86,11 +82,15 @@ private val PREF_AUDIO_SAMPLE_RATE = intPreferencesKey("audio_sample_rate")
 private val PREF_AUDIO_BUFFER_SIZE = intPreferencesKey("audio_buffer_size")
 private val PREF_AUDIO_FILTER_ENABLED = booleanPreferencesKey("audio_filter_enabled")
 private val PREF_AUDIO_FILTER_LEVEL = intPreferencesKey("audio_filter_level")
+private val PREF_AUDIO_CLOCK_PACING = booleanPreferencesKey("audio_clock_pacing")
 private val PREF_DPAD_MODE = stringPreferencesKey("dpad_mode")
 private val PREF_FRAME_SKIP_ENABLED = booleanPreferencesKey("frame_skip_enabled")
 private val PREF_FRAME_SKIP_THROTTLE_PERCENT = intPreferencesKey("frame_skip_throttle_percent")
 private val PREF_FRAME_SKIP_INTERVAL = intPreferencesKey("frame_skip_interval")
 private val PREF_INTERFRAME_BLENDING = booleanPreferencesKey("interframe_blending")
+private val PREF_THREADED_VIDEO = booleanPreferencesKey("threaded_video")
+private val PREF_PERFORMANCE_THREADS = booleanPreferencesKey("performance_threads")
+private val PREF_STATE_EXPORT = booleanPreferencesKey("state_export")
 private val PREF_IDLE_LOOP_REMOVAL = stringPreferencesKey("idle_loop_removal")
 private val PREF_GB_CONTROLLER_RUMBLE = booleanPreferencesKey("gb_controller_rumble")
 private val PREF_KEY_MAP_A = stringPreferencesKey("key_map_a")
@@ -205,7 +205,9 @@ fun GameScreen(
     viewModel: GameViewModel = hiltViewModel()
 ) {
     val uiState by viewModel.uiState.collectAsState()
+    val ramSearch by viewModel.ramSearch.collectAsState()
     var showMenu by remember { mutableStateOf(false) }
+    var slotPreviews by remember(gamePath) { mutableStateOf<Map<Int, SaveSlotPreview>>(emptyMap()) }
     var isLayoutEditMode by remember { mutableStateOf(false) }
     val inputHandler = remember { InputHandler.getInstance() }
     val context = LocalContext.current
@@ -238,10 +240,14 @@ fun GameScreen(
                 audioBufferSize = prefs[PREF_AUDIO_BUFFER_SIZE] ?: 8192,
                 audioFilterEnabled = prefs[PREF_AUDIO_FILTER_ENABLED] ?: true,
                 audioFilterLevel = (prefs[PREF_AUDIO_FILTER_LEVEL] ?: 60).coerceIn(0, 100),
+                audioClockPacing = prefs[PREF_AUDIO_CLOCK_PACING] ?: false,
                 frameSkipEnabled = prefs[PREF_FRAME_SKIP_ENABLED] ?: false,
                 frameSkipThrottlePercent = (prefs[PREF_FRAME_SKIP_THROTTLE_PERCENT] ?: 33).coerceIn(0, 100),
                 frameSkipInterval = (prefs[PREF_FRAME_SKIP_INTERVAL] ?: 0).coerceIn(0, 12),
                 interframeBlending = prefs[PREF_INTERFRAME_BLENDING] ?: false,
+                threadedVideo = prefs[PREF_THREADED_VIDEO] ?: false,
+                performanceThreads = prefs[PREF_PERFORMANCE_THREADS] ?: true,
+                stateExport = prefs[PREF_STATE_EXPORT] ?: false,
                 idleLoopRemoval = prefs[PREF_IDLE_LOOP_REMOVAL] ?: "REMOVE_KNOWN",
                 gbControllerRumble = prefs[PREF_GB_CONTROLLER_RUMBLE] ?: false,
                 keyMapA = prefs[PREF_KEY_MAP_A] ?: "A",
@@ -337,6 +343,13 @@ fun GameScreen(
         viewModel.applyCheatCodes(cheatCodes.filter { it.enabled }.map { it.code })
     }
 
+    // 菜单打开时从原生槽位索引刷新存档信息
+    LaunchedEffect(showMenu) {
+        if (showMenu) {
+            slotPreviews = viewModel.loadSaveSlotPreviews()
+        }
+    }
+
     LaunchedEffect(gamePath, saveSlots, saveSlotsLoaded) {
         if (!saveSlotsLoaded) {
             return@LaunchedEffect
@@ -459,13 +472,26 @@ fun GameScreen(
         )
     }
 
+    LaunchedEffect(gamepadPrefs.audioClockPacing) {
+        viewModel.updatePacing(gamepadPrefs.audioClockPacing)
+    }
+
+    LaunchedEffect(gamepadPrefs.performanceThreads) {
+        viewModel.updateThreadPlacement(gamepadPrefs.performanceThreads)
+    }
+
+    LaunchedEffect(gamepadPrefs.stateExport) {
+        viewModel.updateStateExport(gamepadPrefs.stateExport)
+    }
+
     LaunchedEffect(
         gamepadPrefs.frameSkipEnabled,
         gamepadPrefs.frameSkipThrottlePercent,
         gamepadPrefs.frameSkipInterval,
         gamepadPrefs.interframeBlending,
         gamepadPrefs.idleLoopRemoval,
-        gamepadPrefs.gbControllerRumble
+        gamepadPrefs.gbControllerRumble,
+        gamepadPrefs.threadedVideo
     ) {
         viewModel.updateGameOptions(
             frameSkipEnabled = gamepadPrefs.frameSkipEnabled,
@@ -473,10 +499,24 @@ fun GameScreen(
             frameSkipInterval = gamepadPrefs.frameSkipInterval,
             interframeBlending = gamepadPrefs.interframeBlending,
             idleLoopRemoval = gamepadPrefs.idleLoopRemoval,
-            gbControllerRumble = gamepadPrefs.gbControllerRumble
+            gbControllerRumble = gamepadPrefs.gbControllerRumble,
+            threadedVideo = gamepadPrefs.threadedVideo
         )
     }
 
+    val lifecycleOwner = LocalLifecycleOwner.current
+    DisposableEffect(lifecycleOwner) {
+        val observer = LifecycleEventObserver { _, event ->
+            if (event == Lifecycle.Event.ON_PAUSE) {
+                viewModel.onHostPaused()
+            }
+        }
+        lifecycleOwner.lifecycle.addObserver(observer)
+        onDispose {
+            lifecycleOwner.lifecycle.removeObserver(observer)
+        }
+    }
+
     DisposableEffect(Unit) {
         val activity = context as? Activity
         activity?.requestedOrientation = ActivityInfo.SCREEN_ORIENTATION_LANDSCAPE
@@ -708,6 +748,10 @@ fun GameScreen(
                     editableLayoutOffsets = GamepadLayoutOffsets.DEFAULT
                 },
                 saveSlots = saveSlots,
+                slotPreviews = slotPreviews,
+                ramSearch = ramSearch,
+                onStartRamSearch = { width -> viewModel.startRamSearch(width) },
+                onFilterRamSearch = { relation, value -> viewModel.filterRamSearch(relation, value) },
                 onSaveSlot = { slot -> viewModel.saveState(slot) },
                 onLoadSlot = { slot -> viewModel.loadState(slot) },
                 onAddSaveSlot = {
@@ -743,10 +787,14 @@ private data class GamepadPrefs(
     val audioBufferSize: Int = 8192,
     val audioFilterEnabled: Boolean = true,
     val audioFilterLevel: Int = 60,
+    val audioClockPacing: Boolean = false,
     val frameSkipEnabled: Boolean = false,
     val frameSkipThrottlePercent: Int = 33,
     val frameSkipInterval: Int = 0,
     val interframeBlending: Boolean = false,
+    val threadedVideo: Boolean = false,
+    val performanceThreads: Boolean = true,
+    val stateExport: Boolean = false,
     val idleLoopRemoval: String = "REMOVE_KNOWN",
     val gbControllerRumble: Boolean = false,
     val keyMapA: String = "A",
@@ -775,119 +823,98 @@ private data class GamepadPrefs(
 
 @Composable
 fun VideoRenderer(
-    frameFlow: StateFlow<ByteArray?>,
+    frameFlow: StateFlow<VideoFrame?>,
     videoFilter: VideoFilter,
     aspectRatio: AspectRatio,
     showFps: Boolean,
     modifier: Modifier = Modifier
 ) {
     val frameData by frameFlow.collectAsState()
-    val width = 240
-    val height = 160
-    val bitmap = remember { Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888) }
-    val pixels = remember { IntArray(width * height) }
+    val glRenderer = remember { GlVideoRenderer.getInstance() }
     var fps by remember { mutableStateOf(0) }
-    var fpsFrameCount by remember { mutableStateOf(0) }
-    var fpsLastTs by remember { mutableStateOf(System.nanoTime()) }
 
+    // 游戏帧由帧循环直接送入渲染器；这里只处理休眠预览等一次性画面
     LaunchedEffect(frameData) {
         val frame = frameData
-        if (frame != null && frame.size >= width * height * 2) {
-            var src = 0
-            var i = 0
-            while (i < pixels.size) {
-                val lo = frame[src].toInt() and 0xFF
-                val hi = frame[src + 1].toInt() and 0xFF
-                val rgb565 = (hi shl 8) or lo
-
-                val r = ((rgb565 shr 11) and 0x1F) * 255 / 31
-                val g = ((rgb565 shr 5) and 0x3F) * 255 / 63
-                val b = (rgb565 and 0x1F) * 255 / 31
-                pixels[i] = (0xFF shl 24) or (r shl 16) or (g shl 8) or b
-
-                src += 2
-                i++
-            }
-            bitmap.setPixels(pixels, 0, width, 0, 0, width, height)
-
-            if (showFps) {
-                fpsFrameCount += 1
-                val now = System.nanoTime()
-                val elapsedNs = now - fpsLastTs
-                if (elapsedNs >= 1_000_000_000L) {
-                    fps = ((fpsFrameCount * 1_000_000_000L) / elapsedNs).toInt()
-                    fpsFrameCount = 0
-                    fpsLastTs = now
-                }
-            }
+        if (frame != null && frame.pixels.size >= 240 * 160 * 2) {
+            glRenderer.updateFrame(frame.pixels, frame.dirtyLines)
         }
     }
 
-    val filterQuality = when (videoFilter) {
-        VideoFilter.NEAREST -> FilterQuality.None
-        VideoFilter.LINEAR -> FilterQuality.Medium
-        VideoFilter.CRT -> FilterQuality.None
-        VideoFilter.ADVANCED -> FilterQuality.High
+    LaunchedEffect(showFps) {
+        if (!showFps) return@LaunchedEffect
+        var lastFrames = glRenderer.framesReceived
+        var lastTs = System.nanoTime()
+        while (true) {
+            delay(1000)
+            val frames = glRenderer.framesReceived
+            val now = System.nanoTime()
+            fps = (((frames - lastFrames) * 1_000_000_000L) / (now - lastTs)).toInt()
+            lastFrames = frames
+            lastTs = now
+        }
     }
 
-    val colorFilter = when (videoFilter) {
-        VideoFilter.ADVANCED -> {
-            val matrix = ColorMatrix()
-            matrix.setToSaturation(1.12f)
-            ColorFilter.colorMatrix(matrix)
-        }
-        else -> null
+    LaunchedEffect(videoFilter) {
+        glRenderer.setShaderPreset(
+            when (videoFilter) {
+                VideoFilter.NEAREST -> GlVideoRenderer.ShaderPreset.NEAREST
+                VideoFilter.LINEAR -> GlVideoRenderer.ShaderPreset.LINEAR
+                VideoFilter.CRT -> GlVideoRenderer.ShaderPreset.CRT
+                VideoFilter.ADVANCED -> GlVideoRenderer.ShaderPreset.XBR
+                VideoFilter.LCD -> GlVideoRenderer.ShaderPreset.LCD
+            }
+        )
     }
 
-    BoxWithConstraints(modifier = modifier.background(Color.Black)) {
-        val density = LocalDensity.current
-        val maxWpx = with(density) { maxWidth.toPx() }
-        val maxHpx = with(density) { maxHeight.toPx() }
-
-        val imageModifier = when (aspectRatio) {
-            AspectRatio.STRETCH -> Modifier.fillMaxSize()
-            AspectRatio.FIT -> Modifier.fillMaxSize()
-            AspectRatio.ORIGINAL -> Modifier.size(240.dp, 160.dp)
-            AspectRatio.INTEGER_SCALE -> {
-                val scale = floor(min(maxWpx / 240f, maxHpx / 160f)).toInt().coerceAtLeast(1)
-                val scaledW = with(density) { (240f * scale).dp }
-                val scaledH = with(density) { (160f * scale).dp }
-                Modifier.size(scaledW, scaledH)
+    LaunchedEffect(aspectRatio) {
+        glRenderer.setScaleMode(
+            when (aspectRatio) {
+                AspectRatio.STRETCH -> GlVideoRenderer.ScaleMode.STRETCH
+                AspectRatio.FIT, AspectRatio.ORIGINAL -> GlVideoRenderer.ScaleMode.FIT
+                AspectRatio.INTEGER_SCALE -> GlVideoRenderer.ScaleMode.INTEGER
             }
-        }
+        )
+    }
 
-        val contentScale = when (aspectRatio) {
-            AspectRatio.STRETCH -> ContentScale.FillBounds
-            AspectRatio.FIT, AspectRatio.ORIGINAL, AspectRatio.INTEGER_SCALE -> ContentScale.Fit
+    var surfaceView by remember { mutableStateOf<GLSurfaceView?>(null) }
+    val lifecycleOwner = LocalLifecycleOwner.current
+    DisposableEffect(lifecycleOwner, surfaceView) {
+        val view = surfaceView
+        val observer = LifecycleEventObserver { _, event ->
+            when (event) {
+                Lifecycle.Event.ON_PAUSE -> view?.onPause()
+                Lifecycle.Event.ON_RESUME -> view?.onResume()
+                else -> Unit
+            }
+        }
+        lifecycleOwner.lifecycle.addObserver(observer)
+        onDispose {
+            lifecycleOwner.lifecycle.removeObserver(observer)
         }
+    }
 
-        if (frameData != null) {
-            Box(modifier = Modifier.fillMaxSize(), contentAlignment = Alignment.Center) {
-                Image(
-                    bitmap = bitmap.asImageBitmap(),
-                    contentDescription = "Game Frame",
-                    modifier = imageModifier,
-                    contentScale = contentScale,
-                    filterQuality = filterQuality,
-                    colorFilter = colorFilter
-                )
+    DisposableEffect(Unit) {
+        onDispose {
+            glRenderer.cleanup()
+        }
+    }
 
-                if (videoFilter == VideoFilter.CRT) {
-                    Canvas(modifier = imageModifier) {
-                        val stripe = 3f
-                        var y = 0f
-                        while (y < size.height) {
-                            drawRect(
-                                color = Color.Black.copy(alpha = 0.12f),
-                                topLeft = androidx.compose.ui.geometry.Offset(0f, y),
-                                size = androidx.compose.ui.geometry.Size(size.width, stripe)
-                            )
-                            y += stripe * 2f
-                        }
-                    }
-                }
-            }
+    Box(modifier = modifier.background(Color.Black)) {
+        // 画面缩放与滤镜都在原生着色器管线中完成
+        val surfaceModifier = when (aspectRatio) {
+            AspectRatio.ORIGINAL -> Modifier.size(240.dp, 160.dp).align(Alignment.Center)
+            else -> Modifier.fillMaxSize()
         }
+        AndroidView(
+            factory = { context ->
+                GLSurfaceView(context).also { view ->
+                    glRenderer.initWithSurfaceView(view)
+                    surfaceView = view
+                }
+            },
+            modifier = surfaceModifier
+        )
 
         if (showFps) {
             Text(
@@ -1,13 +1,22 @@
 package com.jboy.emulator.ui.game
 
+import android.graphics.Bitmap
 import android.os.SystemClock
+import androidx.compose.ui.graphics.asImageBitmap
 import androidx.lifecycle.ViewModel
 import androidx.lifecycle.viewModelScope
 import com.jboy.emulator.core.AudioOutput
+import com.jboy.emulator.core.CoreStats
 import com.jboy.emulator.core.EmulatorCore
+import com.jboy.emulator.core.RamSearchRelation
+import com.jboy.emulator.core.SaveSlotInfo
+import com.jboy.emulator.core.StepBuffers
+import com.jboy.emulator.core.VideoFrame
+import com.jboy.emulator.core.VideoRenderer
 import com.jboy.emulator.netplay.NetplaySessionBus
 import dagger.hilt.android.lifecycle.HiltViewModel
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.asCoroutineDispatcher
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
 import kotlinx.coroutines.flow.asStateFlow
@@ -17,6 +26,9 @@ import kotlinx.coroutines.Job
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.launch
 import kotlinx.coroutines.cancelAndJoin
+import kotlinx.coroutines.withContext
+import java.nio.ByteBuffer
+import java.util.concurrent.Executors
 import javax.inject.Inject
 
 data class GameUiState(
@@ -47,15 +59,30 @@ class GameViewModel @Inject constructor(
 ) : ViewModel() {
 
     private val audioOutput = AudioOutput.getInstance()
+    private val videoRenderer = VideoRenderer.getInstance()
 
     private val _uiState = MutableStateFlow(GameUiState())
     val uiState: StateFlow<GameUiState> = _uiState.asStateFlow()
 
     private var currentGamePath: String? = null
     private var frameLoopJob: Job? = null
-    private var audioPumpJob: Job? = null
-    private val _videoFrame = MutableStateFlow<ByteArray?>(null)
-    val videoFrame: StateFlow<ByteArray?> = _videoFrame.asStateFlow()
+    // The frame loop owns this thread, so the core can pin it without touching shared pool threads.
+    private val emulationDispatcher = Executors.newSingleThreadExecutor { runnable ->
+        Thread(runnable, "JBoyEmulation")
+    }.asCoroutineDispatcher()
+    // Reused by every step of the frame loop; only that loop touches it.
+    private val stepBuffers = StepBuffers()
+    // Audio-clock pacing: the audio writer thread pulls straight from the core's ring.
+    private val coreAudioSource = object : AudioOutput.PullSource {
+        override fun read(out: ShortArray): Int = emulatorCore.readAudio(out, 5)
+        override fun sampleRate(): Int = emulatorCore.getAudioSampleRate().takeIf { it > 0 } ?: 32768
+    }
+    private val _videoFrame = MutableStateFlow<VideoFrame?>(null)
+    val videoFrame: StateFlow<VideoFrame?> = _videoFrame.asStateFlow()
+
+    private val _ramSearch = MutableStateFlow(RamSearchUiState())
+    val ramSearch: StateFlow<RamSearchUiState> = _ramSearch.asStateFlow()
+    private var ramSearchJob: Job? = null
 
     private var audioSampleRate: Int = 44100
     private var audioBufferSize: Int = 8192
@@ -69,6 +96,8 @@ class GameViewModel @Inject constructor(
     private var interframeBlendingSetting: Boolean = false
     private var idleLoopRemovalSetting: String = "REMOVE_KNOWN"
     private var gbControllerRumbleSetting: Boolean = false
+    private var threadedVideoSetting: Boolean = false
+    private var audioClockPacingSetting: Boolean = false
     private var activeCheatCodes: List<String> = emptyList()
     private var sessionActiveStartMs: Long? = null
     private var sessionAccumulatedMs: Long = 0L
@@ -116,9 +145,6 @@ class GameViewModel @Inject constructor(
             if (frameLoopJob?.isActive != true) {
                 startFrameLoop()
             }
-            if (audioPumpJob?.isActive != true) {
-                startAudioPumpLoop()
-            }
             if (!_uiState.value.isPaused) {
                 resumeSessionTimer()
             }
@@ -131,6 +157,13 @@ class GameViewModel @Inject constructor(
         currentGamePath = gamePath
         viewModelScope.launch {
             try {
+                // Show the hibernated frame right away; the ROM load below takes longer.
+                val hibernatedFrame = withContext(Dispatchers.IO) {
+                    emulatorCore.peekHibernationFrame(emulatorCore.sessionPath(gamePath))
+                }
+                if (hibernatedFrame != null) {
+                    _videoFrame.value = VideoFrame(hibernatedFrame, null)
+                }
                 val initialized = if (emulatorCore.isInitialized()) {
                     true
                 } else {
@@ -151,7 +184,8 @@ class GameViewModel @Inject constructor(
                     frameSkipInterval = frameSkipIntervalSetting,
                     interframeBlending = interframeBlendingSetting,
                     idleLoopRemoval = idleLoopRemovalSetting,
-                    gbControllerRumble = gbControllerRumbleSetting
+                    gbControllerRumble = gbControllerRumbleSetting,
+                    threadedVideo = threadedVideoSetting
                 )
                 val loaded = emulatorCore.loadGame(gamePath)
                 if (!loaded) {
@@ -162,6 +196,12 @@ class GameViewModel @Inject constructor(
                     return@launch
                 }
 
+                if (hibernatedFrame != null && !emulatorCore.restoreHibernation()) {
+                    emulatorCore.discardHibernation(emulatorCore.sessionPath(gamePath))
+                }
+                // From here on the frame loop feeds the renderer directly.
+                _videoFrame.value = null
+
                 applyCurrentCheatsToCore()
 
                 _uiState.value = _uiState.value.copy(
@@ -179,7 +219,6 @@ class GameViewModel @Inject constructor(
                     }
                 }
                 startFrameLoop()
-                startAudioPumpLoop()
                 startPlaySessionTimer()
             } catch (e: Exception) {
                 _uiState.value = _uiState.value.copy(
@@ -189,12 +228,32 @@ class GameViewModel @Inject constructor(
         }
     }
 
+    private fun applyPacingMode(audioClock: Boolean) {
+        if (audioClock) {
+            emulatorCore.setPacingMode(EmulatorCore.PacingMode.AUDIO_CLOCK)
+            audioOutput.setPullSource(coreAudioSource)
+        } else {
+            audioOutput.setPullSource(null)
+            emulatorCore.setPacingMode(EmulatorCore.PacingMode.WALL_CLOCK)
+        }
+    }
+
+    /** Hands the last step's frame straight to the renderer, which copies it under its own lock. */
+    private fun presentStepVideo() {
+        // Static screens produce no frame, so nothing is uploaded or presented.
+        if (stepBuffers.videoChanged) {
+            videoRenderer.updateFrame(stepBuffers.video, stepBuffers.readDirtyLines())
+        }
+    }
+
     private fun startFrameLoop() {
         frameLoopJob?.cancel()
-        frameLoopJob = viewModelScope.launch(Dispatchers.Default) {
+        frameLoopJob = viewModelScope.launch(emulationDispatcher) {
             var nextEmuTick = System.nanoTime()
             var nextRenderTick = nextEmuTick
             var frameCounter = 0L
+            var appliedSpeed = 0
+            var appliedAudioClock: Boolean? = null
             while (isActive && _uiState.value.isPlaying) {
                 if (_uiState.value.isPaused) {
                     delay(8)
@@ -204,35 +263,67 @@ class GameViewModel @Inject constructor(
                 }
 
                 val speed = _uiState.value.fastForwardSpeed.coerceAtLeast(1)
+                if (speed != appliedSpeed) {
+                    emulatorCore.setEmulationSpeed(speed)
+                    appliedSpeed = speed
+                }
+                // The audio clock only works while the sink is actually draining at 1x.
+                val audioClock = audioClockPacingSetting && speed == 1 && audioOutput.isPlaying()
+                if (audioClock != appliedAudioClock) {
+                    applyPacingMode(audioClock)
+                    appliedAudioClock = audioClock
+                }
+                if (audioClock) {
+                    // The native step blocks until the sink has drained enough audio;
+                    // the newest frame is presented at the next vsync.
+                    if (emulatorCore.step(1, stepBuffers, withAudio = false) >= 0) {
+                        presentStepVideo()
+                    } else {
+                        delay(1)
+                    }
+                    nextEmuTick = System.nanoTime()
+                    nextRenderTick = nextEmuTick
+                    continue
+                }
                 val fps = _uiState.value.targetFps.coerceIn(30, 120)
                 val emuFrameNs = (1_000_000_000L / (60 * speed)).coerceAtLeast(1_000_000L)
                 val renderFrameNs = (1_000_000_000L / fps).coerceAtLeast(1_000_000L)
 
                 var now = System.nanoTime()
                 var emuSteps = 0
-                while (now >= nextEmuTick && emuSteps < 6) {
-                    emulatorCore.runFrame()
-                    emuSteps++
-                    frameCounter++
-                    nextEmuTick += emuFrameNs
-                    now = System.nanoTime()
+                if (now >= nextEmuTick) {
+                    emuSteps = ((now - nextEmuTick) / emuFrameNs + 1).coerceAtMost(6L).toInt()
+                    frameCounter += emuSteps
+                    nextEmuTick += emuFrameNs * emuSteps
                 }
 
+                // Fixed-interval frame skip; with interval 0 the native controller skips automatically.
                 val backlogPercent = (emuSteps * 100) / 6
                 val shouldSkipRender =
                     frameSkipEnabledSetting &&
                         frameSkipIntervalSetting > 0 &&
                         backlogPercent >= frameSkipThrottlePercentSetting &&
                         (frameCounter % (frameSkipIntervalSetting + 1) != 0L)
-
-                if (now >= nextRenderTick && !shouldSkipRender) {
-                    emulatorCore.getVideoFrame()?.let { frame ->
-                        _videoFrame.value = frame
+                val present = now >= nextRenderTick && !shouldSkipRender
+
+                if (emuSteps > 0 || present) {
+                    // One JNI call runs the frames and returns video, audio and stats together.
+                    // Skipped frames leave their dirty lines pending for the next presented one.
+                    if (emulatorCore.step(emuSteps, stepBuffers, withVideo = present) >= 0) {
+                        if (present) {
+                            presentStepVideo()
+                        }
+                        val audioCount = stepBuffers.readAudio()
+                        if (audioCount > 0) {
+                            val sourceRate = stepBuffers.audioSampleRate.takeIf { it > 0 } ?: 32768
+                            audioOutput.writeAudioData(stepBuffers.audioSamples, audioCount, sourceRate)
+                        }
                     }
-                    nextRenderTick += renderFrameNs
-                } else if (now >= nextRenderTick) {
+                }
+                if (now >= nextRenderTick) {
                     nextRenderTick += renderFrameNs
                 }
+                now = System.nanoTime()
 
                 if (emuSteps == 6 && now > nextEmuTick) {
                     nextEmuTick = now
@@ -251,34 +342,14 @@ class GameViewModel @Inject constructor(
         }
     }
 
-    private fun startAudioPumpLoop() {
-        audioPumpJob?.cancel()
-        audioPumpJob = viewModelScope.launch(Dispatchers.Default) {
-            while (isActive && _uiState.value.isPlaying) {
-                if (_uiState.value.isPaused) {
-                    delay(3)
-                    continue
-                }
-
-                var pulled = false
-                var reads = 0
-                while (reads < 4) {
-                    val audio = emulatorCore.getAudioFrame() ?: break
-                    if (audio.isEmpty()) {
-                        break
-                    }
-                    val sourceRate = emulatorCore.getAudioSampleRate().takeIf { it > 0 } ?: 32768
-                    audioOutput.writeAudioData(audio, sourceRate)
-                    pulled = true
-                    reads++
-                }
-
-                if (pulled) {
-                    delay(1)
-                } else {
-                    delay(1)
-                }
-            }
+    /** Called when the host activity pauses; the process may be killed after this. */
+    fun onHostPaused() {
+        if (!_uiState.value.isPlaying || currentGamePath == null) {
+            return
+        }
+        viewModelScope.launch(Dispatchers.IO) {
+            runCatching { emulatorCore.flushSaveData() }
+            runCatching { emulatorCore.hibernate() }
         }
     }
 
@@ -339,7 +410,8 @@ class GameViewModel @Inject constructor(
         frameSkipInterval: Int,
         interframeBlending: Boolean,
         idleLoopRemoval: String,
-        gbControllerRumble: Boolean
+        gbControllerRumble: Boolean,
+        threadedVideo: Boolean
     ) {
         frameSkipEnabledSetting = frameSkipEnabled
         frameSkipThrottlePercentSetting = frameSkipThrottlePercent.coerceIn(0, 100)
@@ -347,6 +419,7 @@ class GameViewModel @Inject constructor(
         interframeBlendingSetting = interframeBlending
         idleLoopRemovalSetting = idleLoopRemoval
         gbControllerRumbleSetting = gbControllerRumble
+        threadedVideoSetting = threadedVideo
 
         emulatorCore.setGameOptions(
             frameSkipEnabled = frameSkipEnabledSetting,
@@ -354,10 +427,25 @@ class GameViewModel @Inject constructor(
             frameSkipInterval = frameSkipIntervalSetting,
             interframeBlending = interframeBlendingSetting,
             idleLoopRemoval = idleLoopRemovalSetting,
-            gbControllerRumble = gbControllerRumbleSetting
+            gbControllerRumble = gbControllerRumbleSetting,
+            threadedVideo = threadedVideoSetting
         )
     }
 
+    /** Performance-core pinning and raised priorities; the emulation thread follows on its next frame. */
+    fun updateThreadPlacement(enabled: Boolean) {
+        emulatorCore.setThreadPlacement(enabled)
+    }
+
+    fun updateStateExport(enabled: Boolean) {
+        emulatorCore.setStateExport(enabled)
+    }
+
+    /** Selects audio-clock pacing; takes effect on the next frame-loop tick. */
+    fun updatePacing(audioClock: Boolean) {
+        audioClockPacingSetting = audioClock
+    }
+
     fun showMenu(menuType: GameMenuType) {
         _uiState.value = _uiState.value.copy(currentMenu = menuType)
     }
@@ -403,6 +491,28 @@ class GameViewModel @Inject constructor(
         }
     }
 
+    /**
+     * 读取槽位索引与预览图（一次 JNI 调用取全部槽位，缩略图按需读取）
+     */
+    suspend fun loadSaveSlotPreviews(): Map<Int, SaveSlotPreview> = withContext(Dispatchers.IO) {
+        emulatorCore.getSaveSlots().associate { info ->
+            val thumbnail = if (info.hasThumbnail) {
+                emulatorCore.getSlotThumbnail(info.slot)?.let { pixels ->
+                    val bitmap = Bitmap.createBitmap(
+                        SaveSlotInfo.THUMB_WIDTH,
+                        SaveSlotInfo.THUMB_HEIGHT,
+                        Bitmap.Config.RGB_565
+                    )
+                    bitmap.copyPixelsFromBuffer(ByteBuffer.wrap(pixels))
+                    bitmap.asImageBitmap()
+                }
+            } else {
+                null
+            }
+            info.slot to SaveSlotPreview(info, thumbnail)
+        }
+    }
+
     fun loadState(slot: Int) {
         currentGamePath?.let {
             viewModelScope.launch(Dispatchers.Default) {
@@ -469,70 +579,88 @@ class GameViewModel @Inject constructor(
     }
 
     fun resetGame() {
-        val path = currentGamePath ?: return
-        viewModelScope.launch {
+        if (currentGamePath == null) return
+        viewModelScope.launch(Dispatchers.Default) {
             try {
-                pauseSessionTimer()
-                frameLoopJob?.cancelAndJoin()
-                frameLoopJob = null
-                audioPumpJob?.cancelAndJoin()
-                audioPumpJob = null
-                audioOutput.stop()
-
-                emulatorCore.setAudioConfig(audioSampleRate, audioBufferSize)
-                emulatorCore.setGameOptions(
-                    frameSkipEnabled = frameSkipEnabledSetting,
-                    frameSkipThrottlePercent = frameSkipThrottlePercentSetting,
-                    frameSkipInterval = frameSkipIntervalSetting,
-                    interframeBlending = interframeBlendingSetting,
-                    idleLoopRemoval = idleLoopRemovalSetting,
-                    gbControllerRumble = gbControllerRumbleSetting
-                )
-                val loaded = emulatorCore.loadGame(path)
-                if (!loaded) {
-                    _uiState.value = _uiState.value.copy(errorMessage = "重置失败：ROM重载失败")
+                // Soft reset keeps the core, its config and the frame/audio loops alive.
+                if (!emulatorCore.reset()) {
+                    _uiState.value = _uiState.value.copy(errorMessage = "重置失败：核心重置失败")
                     return@launch
                 }
 
-                applyCurrentCheatsToCore()
-
-                if (audioOutput.init(audioSampleRate, audioBufferSize)) {
-                    val finalEnabled = audioEnabledSetting && !_uiState.value.isMuted
-                    audioOutput.setAudioEnabled(finalEnabled)
-                    audioOutput.setVolume((masterVolumeSetting / 100f).coerceIn(0f, 1f))
-                    audioOutput.setAudioFilterConfig(audioFilterEnabledSetting, audioFilterLevelSetting)
-                    if (finalEnabled) {
-                        audioOutput.start()
-                    }
+                audioOutput.stop()
+                if (audioEnabledSetting && !_uiState.value.isMuted) {
+                    audioOutput.start()
                 }
 
+                if (_uiState.value.isPaused) {
+                    resumeSessionTimer()
+                }
                 _uiState.value = _uiState.value.copy(
                     isPaused = false,
                     errorMessage = null
                 )
-                startFrameLoop()
-                startAudioPumpLoop()
-                resumeSessionTimer()
             } catch (e: Exception) {
                 _uiState.value = _uiState.value.copy(errorMessage = "重置失败: ${e.message}")
             }
         }
     }
 
+    fun startRamSearch(width: Int) {
+        if (currentGamePath == null) return
+        ramSearchJob?.cancel()
+        ramSearchJob = viewModelScope.launch(Dispatchers.Default) {
+            if (!emulatorCore.startRamSearch(width)) {
+                _ramSearch.value = RamSearchUiState(width = width)
+                return@launch
+            }
+            publishRamSearch(width)
+        }
+    }
+
+    fun filterRamSearch(relation: RamSearchRelation, value: Long) {
+        val current = _ramSearch.value
+        if (!current.active || current.busy) return
+        ramSearchJob?.cancel()
+        ramSearchJob = viewModelScope.launch(Dispatchers.Default) {
+            if (!emulatorCore.filterRamSearch(relation, value)) return@launch
+            _ramSearch.value = current.copy(busy = true)
+            publishRamSearch(current.width)
+        }
+    }
+
+    // 筛选在帧间分片进行，结果就绪前 getRamSearchResults 返回 null；暂停时原生层会直接算完
+    private suspend fun publishRamSearch(width: Int) {
+        var results = emulatorCore.getRamSearchResults(width)
+        while (results == null && currentGamePath != null) {
+            delay(16)
+            results = emulatorCore.getRamSearchResults(width)
+        }
+        _ramSearch.value = RamSearchUiState(
+            active = results != null,
+            width = width,
+            candidateCount = emulatorCore.getStats().getOrElse(CoreStats.RAM_SEARCH_CANDIDATES) { 0L },
+            results = results.orEmpty()
+        )
+    }
+
     fun exitGame(
         onFinished: (() -> Unit)? = null,
         onSessionSummary: ((String, Long) -> Unit)? = null
     ) {
         viewModelScope.launch {
             val endedPath = currentGamePath
+            ramSearchJob?.cancel()
+            ramSearchJob = null
+            _ramSearch.value = RamSearchUiState()
             val sessionDurationMs = finishSessionTimer()
             frameLoopJob?.cancelAndJoin()
             frameLoopJob = null
-            audioPumpJob?.cancelAndJoin()
-            audioPumpJob = null
+            applyPacingMode(false)
             runCatching { audioOutput.stop() }
             runCatching { emulatorCore.stopGame() }
-            runCatching { emulatorCore.cleanup() }
+            endedPath?.let { path -> runCatching { emulatorCore.discardHibernation(emulatorCore.sessionPath(path)) } }
+            runCatching { emulatorCore.unloadRom() }
             _videoFrame.value = null
             _uiState.value = GameUiState(isPlaying = false, isPaused = false, isMuted = false)
             currentGamePath = null
@@ -583,9 +711,10 @@ class GameViewModel @Inject constructor(
     override fun onCleared() {
         super.onCleared()
         frameLoopJob?.cancel()
-        audioPumpJob?.cancel()
+        audioOutput.setPullSource(null)
         runCatching { audioOutput.cleanup() }
-        runCatching { emulatorCore.cleanup() }
+        runCatching { emulatorCore.unloadRom() }
+        emulationDispatcher.close()
     }
 }
 
@@ -0,0 +1,145 @@
+package com.jboy.emulator.ui.game
+
+import androidx.compose.foundation.horizontalScroll
+import androidx.compose.foundation.layout.Arrangement
+import androidx.compose.foundation.layout.Column
+import androidx.compose.foundation.layout.Row
+import androidx.compose.foundation.layout.fillMaxWidth
+import androidx.compose.foundation.rememberScrollState
+import androidx.compose.foundation.text.KeyboardOptions
+import androidx.compose.material3.Button
+import androidx.compose.material3.MaterialTheme
+import androidx.compose.material3.OutlinedButton
+import androidx.compose.material3.OutlinedTextField
+import androidx.compose.material3.Text
+import androidx.compose.material3.TextButton
+import androidx.compose.runtime.Composable
+import androidx.compose.runtime.getValue
+import androidx.compose.runtime.mutableStateOf
+import androidx.compose.runtime.remember
+import androidx.compose.runtime.setValue
+import androidx.compose.ui.Alignment
+import androidx.compose.ui.Modifier
+import androidx.compose.ui.text.font.FontFamily
+import androidx.compose.ui.text.font.FontWeight
+import androidx.compose.ui.text.input.KeyboardType
+import androidx.compose.ui.unit.dp
+import androidx.compose.ui.unit.sp
+import com.jboy.emulator.core.RamSearchRelation
+import com.jboy.emulator.core.RamSearchResult
+import com.jboy.emulator.ui.i18n.l10n
+
+// 内存搜索的界面状态，由 GameViewModel 维护
+data class RamSearchUiState(
+    val active: Boolean = false,
+    val width: Int = 1,
+    val busy: Boolean = false,
+    val candidateCount: Long = 0,
+    val results: List<RamSearchResult> = emptyList()
+)
+
+private val WIDTH_OPTIONS = listOf(1 to "8 位", 2 to "16 位", 4 to "32 位")
+
+private val RELATION_LABELS = mapOf(
+    RamSearchRelation.EQUAL to "等于",
+    RamSearchRelation.NOT_EQUAL to "不等于",
+    RamSearchRelation.GREATER to "大于",
+    RamSearchRelation.LESS to "小于",
+    RamSearchRelation.UNCHANGED to "未变化",
+    RamSearchRelation.CHANGED to "已变化",
+    RamSearchRelation.INCREASED to "增加",
+    RamSearchRelation.DECREASED to "减少"
+)
+
+/**
+ * 金手指搜索：选位宽后开始，再按数值或与上次快照的关系逐步筛选，
+ * 剩余地址可直接生成金手指（锁定为当前值）。
+ */
+@Composable
+fun RamSearchPanel(
+    state: RamSearchUiState,
+    onStart: (Int) -> Unit,
+    onFilter: (RamSearchRelation, Long) -> Unit,
+    onAddCheat: (String) -> Unit
+) {
+    var width by remember { mutableStateOf(state.width) }
+    var valueInput by remember { mutableStateOf("") }
+    val value = valueInput.toLongOrNull()
+
+    Column(verticalArrangement = Arrangement.spacedBy(6.dp)) {
+        Text(
+            text = l10n("内存搜索"),
+            style = MaterialTheme.typography.titleMedium,
+            fontWeight = FontWeight.Medium
+        )
+        Row(horizontalArrangement = Arrangement.spacedBy(6.dp)) {
+            WIDTH_OPTIONS.forEach { (option, label) ->
+                if (option == width) {
+                    Button(onClick = { }) { Text(l10n(label)) }
+                } else {
+                    OutlinedButton(onClick = { width = option }) { Text(l10n(label)) }
+                }
+            }
+        }
+        Row(
+            modifier = Modifier.fillMaxWidth(),
+            horizontalArrangement = Arrangement.spacedBy(8.dp),
+            verticalAlignment = Alignment.CenterVertically
+        ) {
+            OutlinedTextField(
+                value = valueInput,
+                onValueChange = { input -> valueInput = input.filter { it.isDigit() }.take(10) },
+                modifier = Modifier.weight(1f),
+                singleLine = true,
+                keyboardOptions = KeyboardOptions(keyboardType = KeyboardType.Number),
+                placeholder = { Text(l10n("数值（十进制）")) }
+            )
+            Button(onClick = { onStart(width) }) {
+                Text(l10n(if (state.active) "重新开始" else "开始搜索"))
+            }
+        }
+
+        if (!state.active) {
+            return@Column
+        }
+        Text(
+            text = l10n(if (state.busy) "筛选中…" else "候选 ${state.candidateCount} 个"),
+            style = MaterialTheme.typography.bodySmall,
+            color = MaterialTheme.colorScheme.onSurface.copy(alpha = 0.75f)
+        )
+        listOf(
+            RamSearchRelation.entries.filter { it.comparesToValue },
+            RamSearchRelation.entries.filterNot { it.comparesToValue }
+        ).forEach { relations ->
+            Row(
+                modifier = Modifier.horizontalScroll(rememberScrollState()),
+                horizontalArrangement = Arrangement.spacedBy(6.dp)
+            ) {
+                relations.forEach { relation ->
+                    OutlinedButton(
+                        onClick = { onFilter(relation, value ?: 0) },
+                        enabled = !state.busy && (!relation.comparesToValue || value != null)
+                    ) {
+                        Text(l10n(RELATION_LABELS.getValue(relation)))
+                    }
+                }
+            }
+        }
+        state.results.forEach { result ->
+            Row(
+                modifier = Modifier.fillMaxWidth(),
+                verticalAlignment = Alignment.CenterVertically
+            ) {
+                Text(
+                    text = "%08X  %d ← %d".format(result.address, result.value, result.previous),
+                    modifier = Modifier.weight(1f),
+                    fontFamily = FontFamily.Monospace,
+                    fontSize = 12.sp
+                )
+                TextButton(onClick = { onAddCheat(result.toCheatCode()) }) {
+                    Text(l10n("锁定"))
+                }
+            }
+        }
+    }
+}
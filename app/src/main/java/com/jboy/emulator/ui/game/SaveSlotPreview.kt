@@ -0,0 +1,10 @@
+package com.jboy.emulator.ui.game
+
+import androidx.compose.ui.graphics.ImageBitmap
+import com.jboy.emulator.core.SaveSlotInfo
+
+// 菜单里一个槽位的显示数据
+data class SaveSlotPreview(
+    val info: SaveSlotInfo,
+    val thumbnail: ImageBitmap?
+)
@@ -3,9 +3,11 @@ package com.jboy.emulator.ui.gamelist
 import androidx.lifecycle.ViewModel
 import androidx.lifecycle.viewModelScope
 import com.jboy.emulator.JBoyApplication
+import com.jboy.emulator.core.EmulatorCore
 import com.jboy.emulator.data.RomInfo
 import com.jboy.emulator.data.RomRepository
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
 import kotlinx.coroutines.flow.asStateFlow
@@ -42,7 +44,11 @@ class GameListViewModel : ViewModel() {
     private val _recentGames = MutableStateFlow<List<GameItem>>(emptyList())
     val recentGames: StateFlow<List<GameItem>> = _recentGames.asStateFlow()
 
+    private var screenshotJob: Job? = null
+
     init {
+        // 在用户点选游戏前预先创建模拟器核心
+        EmulatorCore.getInstance().prewarm()
         loadGames()
     }
 
@@ -59,9 +65,32 @@ class GameListViewModel : ViewModel() {
             } finally {
                 _isLoading.value = false
             }
+            fillScreenshots()
         }
     }
 
+    /**
+     * 后台为新游戏生成开机截图，完成后只替换封面路径
+     */
+    private fun fillScreenshots() {
+        if (screenshotJob?.isActive == true) return
+        screenshotJob = viewModelScope.launch {
+            val roms = romRepository.getAllGames()
+            if (romRepository.generateScreenshots(roms) == 0) return@launch
+            val covers = romRepository.getAllGames().associate { it.filePath to it.coverPath }
+            _games.value = _games.value.map { game ->
+                game.copy(coverPath = covers[game.path] ?: game.coverPath)
+            }
+            applyFilters()
+        }
+    }
+
+    override fun onCleared() {
+        // 原生批处理不响应协程取消
+        EmulatorCore.getInstance().cancelThumbnails()
+        super.onCleared()
+    }
+
     fun searchGames(query: String) {
         _searchQuery.value = query
         applyFilters()
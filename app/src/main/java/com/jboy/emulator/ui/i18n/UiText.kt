@@ -33,6 +33,7 @@ private val directZhToEn = mapOf(
     "音频缓冲区" to "Audio buffer size",
     "启用音频过滤" to "Enable audio filter",
     "音频过滤器级别" to "Audio filter level",
+    "以音频时钟同步" to "Sync to audio clock",
     "控制设置" to "Controls",
     "手柄透明度" to "Controller opacity",
     "按钮大小" to "Button size",
@@ -59,7 +60,11 @@ private val directZhToEn = mapOf(
     "跳帧搁置（百分比）" to "Frame skip throttle (%)",
     "跳帧间隔" to "Frame skip interval",
     "禁用" to "Disabled",
+    "自动" to "Auto",
     "帧间混合" to "Interframe blending",
+    "多线程视频渲染（下次启动游戏生效）" to "Threaded video rendering (applies on next game start)",
+    "模拟线程绑定大核，音频线程高优先级" to "Pin emulation to performance cores, raise audio priority",
+    "共享内存导出内存与画面（外部工具）" to "Export memory and screen via shared memory (external tools)",
     "空闲循环移除" to "Idle loop removal",
     "系统设置" to "System",
     "BIOS文件" to "BIOS file",
@@ -76,6 +81,7 @@ private val directZhToEn = mapOf(
     "最邻近" to "Nearest",
     "线性" to "Linear",
     "高级" to "Advanced",
+    "LCD 网格" to "LCD Grid",
     "原始" to "Original",
     "拉伸" to "Stretch",
     "适应屏幕" to "Fit Screen",
@@ -223,6 +229,24 @@ private val directZhToEn = mapOf(
     "ROM 加载失败" to "Failed to load ROM",
     "存档失败：槽位不可用" to "Save failed: invalid slot",
     "读档失败：该槽位没有存档" to "Load failed: no save in this slot",
+    "空槽位" to "Empty slot",
+    "内存搜索" to "RAM search",
+    "8 位" to "8-bit",
+    "16 位" to "16-bit",
+    "32 位" to "32-bit",
+    "数值（十进制）" to "Value (decimal)",
+    "开始搜索" to "Start search",
+    "重新开始" to "Restart",
+    "筛选中…" to "Filtering…",
+    "等于" to "Equal",
+    "不等于" to "Not equal",
+    "大于" to "Greater",
+    "小于" to "Less",
+    "未变化" to "Unchanged",
+    "已变化" to "Changed",
+    "增加" to "Increased",
+    "减少" to "Decreased",
+    "锁定" to "Lock",
     "重置失败：ROM重载失败" to "Reset failed: ROM reload failed",
     "BIOS已加载" to "BIOS loaded",
     "从未游玩" to "Never played",
@@ -237,6 +261,7 @@ private val rules = listOf(
     },
     ReplaceRule(Regex("^总槽位: (\\d+)$")) { m -> "Total slots: ${m.groupValues[1]}" },
     ReplaceRule(Regex("^槽位 (\\d+)$")) { m -> "Slot ${m.groupValues[1]}" },
+    ReplaceRule(Regex("^候选 (\\d+) 个$")) { m -> "${m.groupValues[1]} candidates" },
     ReplaceRule(Regex("^导入成功 (\\d+) 个，跳过重复 (\\d+) 个$")) { m ->
         "Imported ${m.groupValues[1]}, skipped duplicates ${m.groupValues[2]}"
     },
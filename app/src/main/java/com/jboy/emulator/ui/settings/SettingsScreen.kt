@@ -244,6 +244,12 @@ fun SettingsScreen(
                     valueFormatter = { "${it.toInt()}" },
                     enabled = settings.audioFilterEnabled
                 )
+
+                SwitchSetting(
+                    title = "以音频时钟同步",
+                    checked = settings.audioClockPacing,
+                    onCheckedChange = { viewModel.updateAudioClockPacing(it) }
+                )
             }
 
             // 控制设置
@@ -425,13 +431,13 @@ fun SettingsScreen(
                     onValueChange = { viewModel.updateFrameSkipThrottlePercent(it.toInt()) },
                     valueRange = 0f..100f,
                     valueFormatter = { "${it.toInt()}%" },
-                    enabled = settings.frameSkipEnabled
+                    enabled = settings.frameSkipEnabled && settings.frameSkipInterval > 0
                 )
 
                 val frameSkipIntervals = listOf(0, 1, 2, 3, 4, 5, 6)
                 DropdownSetting(
                     title = "跳帧间隔",
-                    options = frameSkipIntervals.map { if (it == 0) "禁用" else "$it" },
+                    options = frameSkipIntervals.map { if (it == 0) "自动" else "$it" },
                     selectedIndex = frameSkipIntervals.indexOf(settings.frameSkipInterval).let { if (it >= 0) it else 0 },
                     onSelect = { index -> viewModel.updateFrameSkipInterval(frameSkipIntervals[index]) }
                 )
@@ -442,6 +448,24 @@ fun SettingsScreen(
                     onCheckedChange = { viewModel.updateInterframeBlending(it) }
                 )
 
+                SwitchSetting(
+                    title = "多线程视频渲染（下次启动游戏生效）",
+                    checked = settings.threadedVideo,
+                    onCheckedChange = { viewModel.updateThreadedVideo(it) }
+                )
+
+                SwitchSetting(
+                    title = "模拟线程绑定大核，音频线程高优先级",
+                    checked = settings.performanceThreads,
+                    onCheckedChange = { viewModel.updatePerformanceThreads(it) }
+                )
+
+                SwitchSetting(
+                    title = "共享内存导出内存与画面（外部工具）",
+                    checked = settings.stateExport,
+                    onCheckedChange = { viewModel.updateStateExport(it) }
+                )
+
                 DropdownSetting(
                     title = "空闲循环移除",
                     options = IdleLoopRemovalMode.entries.map { it.displayName },
@@ -834,7 +858,8 @@ enum class VideoFilter(val displayName: String) {
     NEAREST("最邻近"),
     LINEAR("线性"),
     CRT("CRT"),
-    ADVANCED("高级")
+    ADVANCED("高级"),
+    LCD("LCD 网格")
 }
 
 enum class AspectRatio(val displayName: String) {
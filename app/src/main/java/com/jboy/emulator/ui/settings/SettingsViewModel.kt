@@ -32,6 +32,7 @@ data class AppSettings(
     val audioBufferSize: Int = 8192,
     val audioFilterEnabled: Boolean = true,
     val audioFilterLevel: Int = 60,
+    val audioClockPacing: Boolean = false,
     
     // 控制设置
     val controllerOpacity: Float = 0.8f,
@@ -43,6 +44,9 @@ data class AppSettings(
     val frameSkipThrottlePercent: Int = 33,
     val frameSkipInterval: Int = 0,
     val interframeBlending: Boolean = false,
+    val threadedVideo: Boolean = false,
+    val performanceThreads: Boolean = true,
+    val stateExport: Boolean = false,
     val idleLoopRemoval: IdleLoopRemovalMode = IdleLoopRemovalMode.REMOVE_KNOWN,
     val keyMapA: VirtualKeyTarget = VirtualKeyTarget.A,
     val keyMapB: VirtualKeyTarget = VirtualKeyTarget.B,
@@ -107,6 +111,7 @@ class SettingsViewModel(
                     audioBufferSize = data.audioBufferSize,
                     audioFilterEnabled = data.audioFilterEnabled,
                     audioFilterLevel = data.audioFilterLevel,
+                    audioClockPacing = data.audioClockPacing,
                     controllerOpacity = data.controllerOpacity,
                     buttonSize = data.buttonSize,
                     dpadMode = runCatching { DpadMode.valueOf(data.dpadMode) }.getOrDefault(DpadMode.WHEEL),
@@ -116,6 +121,9 @@ class SettingsViewModel(
                     frameSkipThrottlePercent = data.frameSkipThrottlePercent,
                     frameSkipInterval = data.frameSkipInterval,
                     interframeBlending = data.interframeBlending,
+                    threadedVideo = data.threadedVideo,
+                    performanceThreads = data.performanceThreads,
+                    stateExport = data.stateExport,
                     idleLoopRemoval = runCatching { IdleLoopRemovalMode.valueOf(data.idleLoopRemoval) }
                         .getOrDefault(IdleLoopRemovalMode.REMOVE_KNOWN),
                     keyMapA = runCatching { VirtualKeyTarget.valueOf(data.keyMapA) }.getOrDefault(VirtualKeyTarget.A),
@@ -247,6 +255,12 @@ class SettingsViewModel(
             repository.updateAudioFilterLevel(level)
         }
     }
+
+    fun updateAudioClockPacing(enabled: Boolean) {
+        viewModelScope.launch {
+            repository.updateAudioClockPacing(enabled)
+        }
+    }
     
     // 控制设置
     fun updateControllerOpacity(opacity: Float) {
@@ -303,6 +317,24 @@ class SettingsViewModel(
         }
     }
 
+    fun updateThreadedVideo(enabled: Boolean) {
+        viewModelScope.launch {
+            repository.updateThreadedVideo(enabled)
+        }
+    }
+
+    fun updatePerformanceThreads(enabled: Boolean) {
+        viewModelScope.launch {
+            repository.updatePerformanceThreads(enabled)
+        }
+    }
+
+    fun updateStateExport(enabled: Boolean) {
+        viewModelScope.launch {
+            repository.updateStateExport(enabled)
+        }
+    }
+
     fun updateIdleLoopRemoval(mode: IdleLoopRemovalMode) {
         viewModelScope.launch {
             repository.updateIdleLoopRemoval(mode.name)
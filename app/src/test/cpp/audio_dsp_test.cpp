@@ -0,0 +1,198 @@
+#include "audio_dsp.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+constexpr int RATE = 48000;
+constexpr float PI = 3.14159265358979f;
+
+std::vector<int16_t> stereoSine(int frames, float leftHz, float rightHz, float amplitude) {
+    std::vector<int16_t> samples(frames * 2);
+    for (int i = 0; i < frames; ++i) {
+        samples[i * 2] = static_cast<int16_t>(amplitude * sinf(2.0f * PI * leftHz * i / RATE));
+        samples[i * 2 + 1] = static_cast<int16_t>(amplitude * sinf(2.0f * PI * rightHz * i / RATE));
+    }
+    return samples;
+}
+
+// Peak magnitude of one channel over the second half, after the filters settled.
+int peak(const std::vector<int16_t>& samples, int channel) {
+    int result = 0;
+    for (size_t i = samples.size() / 2 + channel; i < samples.size(); i += 2) {
+        result = std::max(result, std::abs(static_cast<int>(samples[i])));
+    }
+    return result;
+}
+
+// Scalar restatement of the chain, one channel at a time, for the vector path to match.
+class ReferenceChain {
+public:
+    ReferenceChain(float gain, bool lowPass, int filterLevel) : m_gain(gain), m_lowPass(lowPass) {
+        const float fs = static_cast<float>(RATE);
+        m_dcPole = 1.0f - 2.0f * PI * 10.0f / fs;
+        if (!lowPass) {
+            return;
+        }
+        float alpha = 0.86f - filterLevel / 100.0f * 0.62f;
+        alpha = alpha < 0.08f ? 0.08f : (alpha > 0.9f ? 0.9f : alpha);
+        float cutoff = -logf(1.0f - alpha) * fs / (2.0f * PI);
+        cutoff = cutoff > fs * 0.45f ? fs * 0.45f : cutoff;
+        const float w0 = 2.0f * PI * cutoff / fs;
+        const float cosW0 = cosf(w0);
+        const float q = sinf(w0) / (2.0f * 0.70710678f);
+        const float a0 = 1.0f + q;
+        m_b0 = (1.0f - cosW0) * 0.5f / a0;
+        m_b1 = (1.0f - cosW0) / a0;
+        m_b2 = m_b0;
+        m_a1 = -2.0f * cosW0 / a0;
+        m_a2 = (1.0f - q) / a0;
+    }
+
+    void process(std::vector<int16_t>& samples) {
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const int c = static_cast<int>(i & 1);
+            float x = samples[i] * m_gain;
+            if (m_lowPass) {
+                const float y = m_z1[c] + m_b0 * x;
+                m_z1[c] = m_z2[c] + m_b1 * x + -m_a1 * y;
+                m_z2[c] = m_b2 * x + -m_a2 * y;
+                x = y;
+            }
+            m_dcOut[c] = (x - m_dcIn[c]) + m_dcPole * m_dcOut[c];
+            m_dcIn[c] = x;
+            const float clamped = std::min(32767.0f, std::max(-32768.0f, m_dcOut[c]));
+            samples[i] = static_cast<int16_t>(lrintf(clamped));
+        }
+    }
+
+private:
+    float m_gain;
+    bool m_lowPass;
+    float m_b0 = 1.0f, m_b1 = 0.0f, m_b2 = 0.0f, m_a1 = 0.0f, m_a2 = 0.0f;
+    float m_dcPole = 0.0f;
+    float m_z1[2] = {}, m_z2[2] = {}, m_dcIn[2] = {}, m_dcOut[2] = {};
+};
+
+void testMatchesReference() {
+    std::mt19937 rng(3);
+    std::vector<int16_t> input(4096 * 2);
+    for (int16_t& sample : input) {
+        sample = static_cast<int16_t>(static_cast<int>(rng() % 40000) - 20000);
+    }
+    for (bool lowPass : {false, true}) {
+        AudioDsp dsp;
+        dsp.configure(0.8f, lowPass, 60);
+        ReferenceChain reference(0.8f, lowPass, 60);
+        std::vector<int16_t> actual = input;
+        std::vector<int16_t> expected = input;
+        // Uneven blocks: state must carry across calls.
+        for (size_t offset = 0; offset < actual.size();) {
+            const int count = std::min<int>(static_cast<int>(actual.size() - offset), 2 * (37 + static_cast<int>(offset % 300)));
+            dsp.process(actual.data() + offset, count, RATE);
+            offset += count;
+        }
+        reference.process(expected);
+        int worst = 0;
+        for (size_t i = 0; i < actual.size(); ++i) {
+            worst = std::max(worst, std::abs(actual[i] - expected[i]));
+        }
+        // Float rounding differs between the vector and scalar forms by at most an LSB or two.
+        if (worst > 2) {
+            fprintf(stderr, "lowPass=%d differs from the reference by %d\n", lowPass ? 1 : 0, worst);
+        }
+        CHECK(worst <= 2);
+    }
+}
+
+void testGainAndDcBlocker() {
+    AudioDsp dsp;
+    dsp.configure(0.5f, false, 0);
+    std::vector<int16_t> tone = stereoSine(RATE / 2, 1000.0f, 1000.0f, 16000.0f);
+    // A DC offset on top of the tone.
+    for (int16_t& sample : tone) {
+        sample = static_cast<int16_t>(sample + 4000);
+    }
+    dsp.process(tone.data(), static_cast<int>(tone.size()), RATE);
+    CHECK(std::abs(peak(tone, 0) - 8000) < 200);
+    long long sum = 0;
+    for (size_t i = tone.size() / 2; i < tone.size(); i += 2) {
+        sum += tone[i];
+    }
+    CHECK(std::llabs(sum / static_cast<long long>(tone.size() / 4)) < 100);
+}
+
+void testLowPassAndChannels() {
+    AudioDsp dsp;
+    dsp.configure(1.0f, true, 100);
+    // Left carries a low tone, right a high one.
+    std::vector<int16_t> tone = stereoSine(RATE / 2, 200.0f, 15000.0f, 16000.0f);
+    dsp.process(tone.data(), static_cast<int>(tone.size()), RATE);
+    CHECK(peak(tone, 0) > 14000);
+    CHECK(peak(tone, 1) < 4000);
+
+    // Silence on one side stays silent whatever the other side does.
+    AudioDsp mono;
+    mono.configure(1.0f, true, 50);
+    std::vector<int16_t> leftOnly = stereoSine(4800, 440.0f, 0.0f, 30000.0f);
+    mono.process(leftOnly.data(), static_cast<int>(leftOnly.size()), RATE);
+    CHECK_EQ(peak(leftOnly, 1), 0);
+}
+
+void testSaturation() {
+    AudioDsp dsp;
+    dsp.configure(1.0f, false, 0);
+    // Full-scale Nyquist: the DC blocker overshoots, and must clamp, not wrap.
+    std::vector<int16_t> samples(512);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = ((i / 2) % 2 == 0) ? 32767 : -32768;
+    }
+    const std::vector<int16_t> input = samples;
+    dsp.process(samples.data(), static_cast<int>(samples.size()), RATE);
+    for (size_t i = 4; i < samples.size(); ++i) {
+        if ((samples[i] < 0) != (input[i] < 0)) {
+            CHECK(false);
+            break;
+        }
+    }
+}
+
+void testDiscontinuityCrossfade() {
+    AudioDsp dsp;
+    dsp.configure(1.0f, false, 0);
+    const std::vector<int16_t> high(2 * 64, 20000);
+    std::vector<int16_t> first = high;
+    dsp.process(first.data(), static_cast<int>(first.size()), RATE);
+    const int lastLeft = first[first.size() - 2];
+
+    // The backlog was trimmed and the stream jumps to -20000.
+    dsp.markDiscontinuity();
+    std::vector<int16_t> low(2 * 64, -20000);
+    dsp.process(low.data(), static_cast<int>(low.size()), RATE);
+    // The first frame moves only 1/24 of the way from the last emitted value.
+    CHECK(std::abs(low[0] - lastLeft) < 2500);
+    // Without the mark, the same jump is passed through.
+    AudioDsp plain;
+    plain.configure(1.0f, false, 0);
+    std::vector<int16_t> plainFirst = high;
+    plain.process(plainFirst.data(), static_cast<int>(plainFirst.size()), RATE);
+    std::vector<int16_t> jump(2 * 64, -20000);
+    plain.process(jump.data(), static_cast<int>(jump.size()), RATE);
+    CHECK(jump[0] < -10000);
+}
+
+} // namespace
+
+int main() {
+    testMatchesReference();
+    testGainAndDcBlocker();
+    testLowPassAndChannels();
+    testSaturation();
+    testDiscontinuityCrossfade();
+    return testResult("audio_dsp_test");
+}
@@ -0,0 +1,253 @@
+#include "audio_pacer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+constexpr int OUTPUT_RATE = 48000;
+// GBA refresh rate, 16777216 / 280896 Hz.
+constexpr double GBA_FPS = 59.7275;
+constexpr int WAIT_MS = 34;
+// The emulation thread's wait in the audio-clock run. JboyCore's timeout only
+// guards against a sink that stopped; here a sink descheduled for longer than
+// WAIT_MS on a loaded host would let a frame past the high-water mark.
+constexpr int SPACE_WAIT_MS = 1000;
+
+// The emulation side: one frame of stereo audio at a time, about
+// OUTPUT_RATE / GBA_FPS frames each. Both channels carry a running counter so
+// the sink can check order and L/R alignment.
+class Producer {
+public:
+    int frame(AudioPacer& pacer) {
+        m_owed += OUTPUT_RATE / GBA_FPS;
+        const int frames = static_cast<int>(m_owed);
+        m_owed -= frames;
+        m_samples.resize(frames * 2);
+        for (int i = 0; i < frames; ++i) {
+            m_samples[i * 2] = m_samples[i * 2 + 1] = static_cast<int16_t>(m_next++ & 0x7FFF);
+        }
+        pacer.append(m_samples.data(), frames * 2, OUTPUT_RATE);
+        m_produced += frames * 2;
+        return frames * 2;
+    }
+
+    int64_t produced() const { return m_produced; }
+
+private:
+    double m_owed = 0;
+    int64_t m_next = 0;
+    int64_t m_produced = 0;
+    std::vector<int16_t> m_samples;
+};
+
+// The sink side: checks what comes out is in order, skipping only whole frames.
+class Sink {
+public:
+    void take(const int16_t* samples, int count) {
+        for (int i = 0; i + 1 < count; i += 2) {
+            if (samples[i] != samples[i + 1]) {
+                m_misaligned = true;
+            }
+            if (m_hasLast) {
+                // Counters wrap at 15 bits; a trim skips ahead, never back to the same value.
+                const int step = (samples[i] - m_last) & 0x7FFF;
+                m_outOfOrder |= step == 0;
+                m_gaps += step > 1 ? 1 : 0;
+            }
+            m_last = samples[i];
+            m_hasLast = true;
+        }
+        m_consumed += count;
+    }
+
+    int64_t consumed() const { return m_consumed; }
+    int64_t gaps() const { return m_gaps; }
+    bool ok() const { return !m_misaligned && !m_outOfOrder; }
+
+private:
+    int64_t m_consumed = 0;
+    int64_t m_gaps = 0;
+    int16_t m_last = 0;
+    bool m_hasLast = false;
+    bool m_misaligned = false;
+    bool m_outOfOrder = false;
+};
+
+int wallClockBacklog() {
+    return OUTPUT_RATE * 2 * 65 / 1000;
+}
+
+// Wall-clock pacing, simulated over ten minutes: emulation at 59.73 fps, the
+// sink pulling 256-frame chunks at a slightly different rate. Whatever the
+// sink cannot keep up with is dropped; the backlog never grows past its cap.
+void testWallClock(double sinkRatio) {
+    AudioPacer pacer;
+    pacer.setOutputRate(OUTPUT_RATE);
+    pacer.setGameState(true, false);
+    Producer producer;
+    Sink sink;
+    const double sinkRate = OUTPUT_RATE * sinkRatio;
+    const double seconds = 600;
+    const double framePeriod = 1.0 / GBA_FPS;
+    const double pullPeriod = 256 / sinkRate;
+    double nextFrame = 0;
+    double nextPull = 0;
+    int maxFill = 0;
+    int16_t chunk[512];
+    while (nextFrame < seconds || nextPull < seconds) {
+        if (nextFrame <= nextPull) {
+            producer.frame(pacer);
+            nextFrame += framePeriod;
+        } else {
+            const int count = pacer.consume(chunk, 512);
+            sink.take(chunk, count);
+            nextPull += pullPeriod;
+            if (pacer.getFill() > maxFill) {
+                maxFill = pacer.getFill();
+            }
+        }
+    }
+
+    // Samples are conserved: everything produced was played, dropped or is queued.
+    CHECK_EQ(producer.produced(), sink.consumed() + pacer.getDroppedSamples() + pacer.getFill());
+    CHECK(sink.ok());
+    CHECK(maxFill <= wallClockBacklog());
+    const double excess = producer.produced() - seconds * sinkRate * 2;
+    if (excess > 0) {
+        // The sink is slower: it drops what it cannot play, and no more than
+        // that plus one backlog.
+        CHECK(pacer.getDroppedSamples() >= excess - wallClockBacklog() - 2048);
+        CHECK(pacer.getDroppedSamples() <= excess + 2048);
+    } else {
+        CHECK_EQ(pacer.getDroppedSamples(), 0);
+        CHECK_EQ(sink.gaps(), 0);
+    }
+}
+
+// Audio-clock pacing with real threads: emulation runs as fast as
+// waitForSpace() lets it, the sink plays at a rate 0.4% off the nominal one.
+// Emulation must follow the sink, keep the backlog near its latency target
+// and drop nothing.
+void testAudioClock() {
+    AudioPacer pacer;
+    pacer.setOutputRate(OUTPUT_RATE);
+    CHECK(pacer.setAudioClock(true));
+    CHECK(!pacer.setAudioClock(true));
+    pacer.setGameState(true, false);
+    const double sinkRate = OUTPUT_RATE * 1.004;
+    const int highWater = OUTPUT_RATE * 2 * AudioPacer::CLOCK_LATENCY_MS / 1000;
+    const auto runFor = std::chrono::milliseconds(1500);
+
+    std::atomic<bool> stop{false};
+    std::atomic<int64_t> frames{0};
+    Producer producer;
+    std::thread emulation([&] {
+        while (!stop.load()) {
+            pacer.waitForSpace(SPACE_WAIT_MS);
+            producer.frame(pacer);
+            frames.fetch_add(1);
+        }
+    });
+
+    Sink sink;
+    int maxFill = 0;
+    int16_t chunk[480];
+    // Let the backlog build first, as the audio track's start threshold does.
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    const int64_t underrunsBefore = pacer.getUnderruns();
+    const auto start = std::chrono::steady_clock::now();
+    auto played = start;
+    while (played - start < runFor) {
+        const int fill = pacer.getFill();
+        maxFill = fill > maxFill ? fill : maxFill;
+        const int count = pacer.read(chunk, 480, WAIT_MS);
+        sink.take(chunk, count);
+        // Play the chunk: the next read is due when these samples have been heard.
+        played += std::chrono::nanoseconds(static_cast<int64_t>(count / 2 * 1e9 / sinkRate));
+        std::this_thread::sleep_until(played);
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const int finalFill = pacer.getFill();
+    stop.store(true);
+    pacer.setGameState(false, false);
+    emulation.join();
+
+    CHECK(sink.ok());
+    CHECK_EQ(sink.gaps(), 0);
+    CHECK_EQ(pacer.getDroppedSamples(), 0);
+    CHECK(pacer.getUnderruns() - underrunsBefore <= 2);
+    // The ring only ever holds the latency target plus the frame that crossed it.
+    CHECK(maxFill <= highWater + 2 * 805);
+    // Long-run drift between what emulation produced and what the sink played
+    // is the backlog, nothing more.
+    CHECK(finalFill <= highWater + 2 * 805);
+    CHECK_EQ(producer.produced(), sink.consumed() + pacer.getFill());
+    // Emulation ran at the sink's pace: 0.4% above 59.73 fps, not free-running.
+    const double fps = (sink.consumed() / 2.0) / (OUTPUT_RATE / GBA_FPS) / elapsed;
+    CHECK(std::fabs(fps / (GBA_FPS * 1.004) - 1) < 0.03);
+    const double emulatedFps = frames.load() / (elapsed + 0.03);
+    CHECK(emulatedFps < GBA_FPS * 1.1);
+}
+
+// Waiters are released when the game goes away or pacing switches to the wall clock.
+void testRelease() {
+    AudioPacer pacer;
+    pacer.setOutputRate(OUTPUT_RATE);
+    pacer.setAudioClock(true);
+    pacer.setGameState(true, false);
+    Producer producer;
+    while (pacer.getFill() < OUTPUT_RATE * 2 * AudioPacer::CLOCK_LATENCY_MS / 1000) {
+        producer.frame(pacer);
+    }
+
+    auto timeWait = [&](int timeoutMs) {
+        const auto start = std::chrono::steady_clock::now();
+        pacer.waitForSpace(timeoutMs);
+        return std::chrono::steady_clock::now() - start;
+    };
+    CHECK(timeWait(20) >= std::chrono::milliseconds(20));
+
+    std::thread release([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pacer.setAudioClock(false);
+    });
+    CHECK(timeWait(5000) < std::chrono::seconds(2));
+    release.join();
+    CHECK(timeWait(5000) < std::chrono::milliseconds(100));
+
+    // A reader with nothing queued waits, counts an underrun, and is released
+    // at once when the game is unloaded.
+    pacer.reset();
+    CHECK_EQ(pacer.getFill(), 0);
+    int16_t chunk[64];
+    CHECK_EQ(pacer.read(chunk, 64, 10), 0);
+    CHECK_EQ(pacer.getUnderruns(), 1);
+    pacer.setGameState(true, true);
+    CHECK_EQ(pacer.read(chunk, 64, 10), 0);
+    CHECK_EQ(pacer.getUnderruns(), 1);
+    std::thread unload([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pacer.setGameState(false, false);
+    });
+    const auto start = std::chrono::steady_clock::now();
+    CHECK_EQ(pacer.read(chunk, 64, 5000), 0);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+    unload.join();
+}
+
+} // namespace
+
+int main() {
+    testWallClock(0.998);
+    testWallClock(1.002);
+    testAudioClock();
+    testRelease();
+    return testResult("audio_pacer_test");
+}
@@ -0,0 +1,257 @@
+#include "av_recorder.h"
+
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "native_util.h"
+#include "test_util.h"
+
+namespace {
+
+constexpr int WIDTH = AvRecorder::FRAME_WIDTH;
+constexpr int HEIGHT = AvRecorder::FRAME_HEIGHT;
+constexpr int PIXELS = WIDTH * HEIGHT;
+constexpr size_t LINE_BYTES = WIDTH * 2;
+constexpr int SAMPLE_RATE = 32768;
+constexpr char Y4M_HEADER[] = "YUV4MPEG2 W240 H160 F262144:4389 Ip A1:1 C444 XCOLORRANGE=FULL\n";
+constexpr size_t Y4M_FRAME_BYTES = 6 + PIXELS * 3;
+
+// Stands in for JboyCore's frame loop: a picture that changes a few lines per
+// frame, the dirty mask against the previous frame, and the frame's audio.
+class Game {
+public:
+    Game() : m_picture(PIXELS * 2, 0), m_previous(PIXELS * 2, 0) {}
+
+    // Frame n: every fourth frame is skipped and shows the same picture.
+    void step(int n) {
+        m_previous = m_picture;
+        if (n % 4 != 3) {
+            const uint16_t color = static_cast<uint16_t>(0x1234 * (n + 1));
+            const int lines[] = {(n * 7) % HEIGHT, (n * 31 + 5) % HEIGHT};
+            for (int y : lines) {
+                for (int x = (n % 3) * 40; x < WIDTH; ++x) {
+                    m_picture[(y * WIDTH + x) * 2] = static_cast<uint8_t>(color);
+                    m_picture[(y * WIDTH + x) * 2 + 1] = static_cast<uint8_t>(color >> 8);
+                }
+            }
+        }
+        memset(m_dirty, 0, sizeof(m_dirty));
+        for (int y = 0; y < HEIGHT; ++y) {
+            if (memcmp(&m_picture[y * LINE_BYTES], &m_previous[y * LINE_BYTES], LINE_BYTES) != 0) {
+                m_dirty[y >> 5] |= 1u << (y & 31);
+            }
+        }
+        m_audio.clear();
+        for (int i = 0; i < 1094; ++i) {
+            m_audio.push_back(static_cast<int16_t>(n * 3 + i));
+        }
+    }
+
+    // Runs frame n through the recorder. `useFrameBuffer` writes the changed
+    // lines straight into the slot, as updateVideoBufferLocked does.
+    void record(AvRecorder& recorder, bool useFrameBuffer) {
+        if (useFrameBuffer) {
+            uint8_t* slot = recorder.frameBuffer();
+            for (int y = 0; slot && y < HEIGHT; ++y) {
+                if (m_dirty[y >> 5] & (1u << (y & 31))) {
+                    memcpy(slot + y * LINE_BYTES, &m_picture[y * LINE_BYTES], LINE_BYTES);
+                }
+            }
+        }
+        recorder.appendAudio(m_audio.data(), static_cast<int>(m_audio.size()));
+        recorder.commitFrame(m_picture.data(), m_dirty);
+    }
+
+    const std::vector<uint8_t>& picture() const { return m_picture; }
+    const std::vector<int16_t>& audio() const { return m_audio; }
+
+private:
+    std::vector<uint8_t> m_picture;
+    std::vector<uint8_t> m_previous;
+    uint32_t m_dirty[AvRecorder::DIRTY_WORDS] = {};
+    std::vector<int16_t> m_audio;
+};
+
+// The Y4M frame a picture should become: BT.601 full range, planar 4:4:4.
+std::vector<uint8_t> expectedFrame(const std::vector<uint8_t>& rgb565) {
+    std::vector<uint8_t> frame(Y4M_FRAME_BYTES);
+    memcpy(frame.data(), "FRAME\n", 6);
+    uint8_t* planes = frame.data() + 6;
+    for (int i = 0; i < PIXELS; ++i) {
+        const int c = rgb565[i * 2] | (rgb565[i * 2 + 1] << 8);
+        const int r = ((c >> 11) << 3) | (c >> 13);
+        const int g = (((c >> 5) & 0x3F) << 2) | (((c >> 5) & 0x3F) >> 4);
+        const int b = ((c & 0x1F) << 3) | ((c & 0x1F) >> 2);
+        planes[i] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        planes[PIXELS + i] = static_cast<uint8_t>((-43 * r - 85 * g + 128 * b + 32896) >> 8);
+        planes[PIXELS * 2 + i] = static_cast<uint8_t>((128 * r - 107 * g - 21 * b + 32896) >> 8);
+    }
+    return frame;
+}
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::vector<uint8_t> data;
+    readWholeFile(path, data);
+    return data;
+}
+
+// Splits a Y4M file into frames after checking its header.
+std::vector<std::vector<uint8_t>> y4mFrames(const std::vector<uint8_t>& y4m) {
+    std::vector<std::vector<uint8_t>> frames;
+    const size_t headerSize = sizeof(Y4M_HEADER) - 1;
+    CHECK(y4m.size() >= headerSize && memcmp(y4m.data(), Y4M_HEADER, headerSize) == 0);
+    CHECK_EQ((y4m.size() - headerSize) % Y4M_FRAME_BYTES, 0);
+    for (size_t pos = headerSize; pos + Y4M_FRAME_BYTES <= y4m.size(); pos += Y4M_FRAME_BYTES) {
+        frames.emplace_back(y4m.begin() + pos, y4m.begin() + pos + Y4M_FRAME_BYTES);
+    }
+    return frames;
+}
+
+void checkWav(const std::vector<uint8_t>& wav, const std::vector<int16_t>& audio) {
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(header, SAMPLE_RATE, 2, static_cast<uint32_t>(audio.size() * 2));
+    CHECK_EQ(wav.size(), WAV_HEADER_SIZE + audio.size() * 2);
+    if (wav.size() == WAV_HEADER_SIZE + audio.size() * 2) {
+        CHECK(memcmp(wav.data(), header, WAV_HEADER_SIZE) == 0);
+        CHECK(memcmp(wav.data() + WAV_HEADER_SIZE, audio.data(), audio.size() * 2) == 0);
+    }
+}
+
+// An encoder that keeps up writes every frame exactly, whichever way the
+// picture reached the slot, over two recordings with the same pool.
+void testRecording(const std::string& dir) {
+    AvRecorder recorder;
+    for (int take = 0; take < 2; ++take) {
+        const std::string base = dir + "/take" + std::to_string(take);
+        CHECK(recorder.start(base, SAMPLE_RATE));
+        CHECK(recorder.isRecording());
+        Game game;
+        std::vector<std::vector<uint8_t>> expected;
+        std::vector<int16_t> audio;
+        for (int n = 0; n < 200; ++n) {
+            game.step(n);
+            // Slot written directly most of the time; some frames only pass the picture.
+            game.record(recorder, n % 5 != 2);
+            expected.push_back(expectedFrame(game.picture()));
+            audio.insert(audio.end(), game.audio().begin(), game.audio().end());
+            // Stay ahead of the encoder's queue so nothing is dropped.
+            while (recorder.getWrittenFrames() < n - 8) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        recorder.stop();
+        CHECK(!recorder.isRecording());
+        CHECK_EQ(recorder.getDroppedFrames(), 0);
+        CHECK_EQ(recorder.getWrittenFrames(), 200);
+
+        const std::vector<std::vector<uint8_t>> frames = y4mFrames(readFile(base + ".y4m"));
+        CHECK_EQ(frames.size(), expected.size());
+        for (size_t i = 0; i < frames.size() && i < expected.size(); ++i) {
+            if (frames[i] != expected[i]) {
+                fprintf(stderr, "%s: frame %zu differs\n", base.c_str(), i);
+                CHECK(false);
+                break;
+            }
+        }
+        checkWav(readFile(base + ".wav"), audio);
+    }
+}
+
+// The video file is a pipe nobody reads yet, so the encoder blocks and the
+// pool runs dry. Frames are dropped, and each frame after a drop must still
+// carry the whole picture.
+void testPoolExhaustion(const std::string& dir) {
+    const std::string base = dir + "/stalled";
+    const std::string videoPath = base + ".y4m";
+    CHECK(mkfifo(videoPath.c_str(), 0600) == 0);
+    const int readFd = open(videoPath.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    CHECK(readFd >= 0);
+    fcntl(readFd, F_SETFL, fcntl(readFd, F_GETFL) & ~O_NONBLOCK);
+
+    AvRecorder recorder;
+    CHECK(recorder.start(base, SAMPLE_RATE));
+    Game game;
+    std::vector<std::vector<uint8_t>> committed;
+    for (int n = 0; n < 120; ++n) {
+        game.step(n);
+        game.record(recorder, true);
+        committed.push_back(expectedFrame(game.picture()));
+    }
+    CHECK(recorder.getDroppedFrames() > 0);
+
+    // Drain the pipe, then run a few more frames once the encoder has caught up.
+    std::vector<uint8_t> y4m;
+    std::thread reader([&] {
+        uint8_t buffer[65536];
+        ssize_t got;
+        while ((got = read(readFd, buffer, sizeof(buffer))) > 0) {
+            y4m.insert(y4m.end(), buffer, buffer + got);
+        }
+    });
+    const int64_t dropped = recorder.getDroppedFrames();
+    while (recorder.getWrittenFrames() < 120 - dropped) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (int n = 120; n < 140; ++n) {
+        game.step(n);
+        game.record(recorder, n % 2 == 0);
+        committed.push_back(expectedFrame(game.picture()));
+    }
+    recorder.stop();
+    reader.join();
+    close(readFd);
+
+    const std::vector<std::vector<uint8_t>> frames = y4mFrames(y4m);
+    CHECK_EQ(frames.size(), recorder.getWrittenFrames());
+    CHECK_EQ(frames.size() + recorder.getDroppedFrames(), committed.size());
+    // Written frames are the committed pictures in order, with gaps.
+    size_t next = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        while (next < committed.size() && committed[next] != frames[i]) {
+            ++next;
+        }
+        if (next == committed.size()) {
+            fprintf(stderr, "stalled: frame %zu matches no committed picture in order\n", i);
+            CHECK(false);
+            break;
+        }
+        ++next;
+    }
+    CHECK(!frames.empty() && frames.back() == committed.back());
+
+    // Audio of dropped frames is gone; the header still matches what was written.
+    const std::vector<uint8_t> wav = readFile(base + ".wav");
+    CHECK(wav.size() >= WAV_HEADER_SIZE);
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(header, SAMPLE_RATE, 2, static_cast<uint32_t>(wav.size() - WAV_HEADER_SIZE));
+    CHECK(memcmp(wav.data(), header, WAV_HEADER_SIZE) == 0);
+}
+
+void testNotRecording() {
+    AvRecorder recorder;
+    CHECK(!recorder.isRecording());
+    CHECK(recorder.frameBuffer() == nullptr);
+    Game game;
+    game.step(0);
+    game.record(recorder, true);
+    CHECK_EQ(recorder.getWrittenFrames(), 0);
+    CHECK(!recorder.start("", SAMPLE_RATE));
+    CHECK(!recorder.isRecording());
+    recorder.stop();
+}
+
+} // namespace
+
+int main() {
+    const std::string dir = makeTempDir("av_recorder_test");
+    testNotRecording();
+    testRecording(dir);
+    testPoolExhaustion(dir);
+    return testResult("av_recorder_test");
+}
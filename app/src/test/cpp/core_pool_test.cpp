@@ -0,0 +1,184 @@
+#include "core_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <mgba/core/core.h>
+
+#include "test_util.h"
+
+namespace {
+
+// Counts what the pool does to cores; mCoreCreate can be slowed down or made
+// to fail.
+std::atomic<int> g_created{0};
+std::atomic<int> g_destroyed{0};
+std::atomic<int> g_buildDelayMs{0};
+std::atomic<bool> g_createFails{false};
+
+bool initCore(mCore*) {
+    return true;
+}
+
+void deinitCore(mCore* core) {
+    ++g_destroyed;
+    delete core;
+}
+
+// Tears a taken core down the way CorePool::destroy does a spare.
+void release(mCore* core) {
+    mCoreConfigDeinit(&core->config);
+    core->deinit(core);
+}
+
+void reset() {
+    g_created = 0;
+    g_destroyed = 0;
+    g_buildDelayMs = 0;
+    g_createFails = false;
+}
+
+void testTakeWithoutPrewarm() {
+    reset();
+    CorePool pool;
+    CorePool::Timings timings;
+    timings.prewarmed = true;
+    mCore* core = pool.take(&timings);
+    CHECK(core != nullptr);
+    CHECK(!timings.prewarmed);
+    CHECK(core->config.loaded);
+    CHECK(strcmp(core->config.port, "jboy") == 0);
+    CHECK_EQ(g_created.load(), 1);
+    release(core);
+}
+
+void testTakeAfterPrewarm() {
+    reset();
+    CorePool pool;
+    pool.prewarm();
+    // A second request while the first is building or done adds no core.
+    pool.prewarm();
+    CorePool::Timings timings;
+    mCore* core = pool.take(&timings);
+    CHECK(core != nullptr);
+    CHECK(timings.prewarmed);
+    CHECK(core->config.loaded);
+    CHECK_EQ(g_created.load(), 1);
+    release(core);
+
+    // The spare is gone: the next take builds on the caller's thread.
+    core = pool.take(&timings);
+    CHECK(!timings.prewarmed);
+    CHECK_EQ(g_created.load(), 2);
+    release(core);
+}
+
+// take() during a slow warm-up waits for it instead of building a second core.
+void testTakeWaitsForWarmUp() {
+    reset();
+    g_buildDelayMs = 50;
+    CorePool pool;
+    pool.prewarm();
+    CorePool::Timings timings;
+    mCore* core = pool.take(&timings);
+    CHECK(core != nullptr);
+    CHECK(timings.prewarmed);
+    CHECK(timings.createUs >= 50000);
+    CHECK_EQ(g_created.load(), 1);
+    release(core);
+}
+
+void testClearAndDestructor() {
+    reset();
+    {
+        CorePool pool;
+        pool.prewarm();
+        pool.clear();
+        CHECK_EQ(g_created.load(), 1);
+        CHECK_EQ(g_destroyed.load(), 1);
+
+        pool.prewarm();
+        // The destructor destroys a spare nobody took.
+    }
+    CHECK_EQ(g_created.load(), 2);
+    CHECK_EQ(g_destroyed.load(), 2);
+}
+
+void testCreateFailure() {
+    reset();
+    g_createFails = true;
+    CorePool pool;
+    pool.prewarm();
+    CHECK(pool.take(nullptr) == nullptr);
+    g_createFails = false;
+    mCore* core = pool.take(nullptr);
+    CHECK(core != nullptr);
+    release(core);
+    CHECK_EQ(g_created.load(), 1);
+}
+
+// Warm-ups, takes and clears from several threads leave no core behind.
+void testConcurrentUse() {
+    reset();
+    {
+        CorePool pool;
+        std::thread threads[4];
+        for (int t = 0; t < 4; ++t) {
+            threads[t] = std::thread([&pool, t] {
+                for (int i = 0; i < 200; ++i) {
+                    pool.prewarm();
+                    if ((i + t) % 3 == 0) {
+                        pool.clear();
+                    } else if (mCore* core = pool.take(nullptr)) {
+                        release(core);
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+    CHECK(g_created.load() > 0);
+    CHECK_EQ(g_destroyed.load(), g_created.load());
+}
+
+} // namespace
+
+// The mGBA lifecycle calls CorePool makes, defined here so the test can count
+// and delay them.
+struct mCore* mCoreCreate(enum mPlatform) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(g_buildDelayMs.load()));
+    if (g_createFails) {
+        return nullptr;
+    }
+    ++g_created;
+    mCore* core = new mCore();
+    core->init = initCore;
+    core->deinit = deinitCore;
+    return core;
+}
+
+void mCoreInitConfig(struct mCore* core, const char* port) {
+    core->config.port = port;
+}
+
+void mCoreLoadConfig(struct mCore* core) {
+    core->config.loaded = true;
+}
+
+void mCoreConfigDeinit(struct mCoreConfig* config) {
+    config->loaded = false;
+}
+
+int main() {
+    testTakeWithoutPrewarm();
+    testTakeAfterPrewarm();
+    testTakeWaitsForWarmUp();
+    testClearAndDestructor();
+    testCreateFailure();
+    testConcurrentUse();
+    return testResult("core_pool_test");
+}
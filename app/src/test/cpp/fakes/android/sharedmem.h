@@ -0,0 +1,12 @@
+#ifndef JBOY_FAKE_SHAREDMEM_H
+#define JBOY_FAKE_SHAREDMEM_H
+
+#include <cstddef>
+
+// Test double for the NDK's ashmem API, backed by a sealable memfd. Dropping
+// PROT_WRITE adds F_SEAL_FUTURE_WRITE, which behaves like ashmem's prot mask:
+// existing mappings keep their access, new ones cannot be writable.
+int ASharedMemory_create(const char* name, size_t size);
+int ASharedMemory_setProt(int fd, int prot);
+
+#endif // JBOY_FAKE_SHAREDMEM_H
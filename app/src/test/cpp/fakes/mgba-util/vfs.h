@@ -0,0 +1,17 @@
+#ifndef JBOY_FAKE_VFS_H
+#define JBOY_FAKE_VFS_H
+
+#include <cstddef>
+
+// Test double for the part of mGBA's VFile API the tested modules use. The
+// memory file keeps the pointer and size it was opened with so tests can
+// inspect what the core would have loaded.
+struct VFile {
+    bool (*close)(struct VFile*);
+    void* mem;
+    size_t size;
+};
+
+struct VFile* VFileFromMemory(void* mem, size_t size);
+
+#endif // JBOY_FAKE_VFS_H
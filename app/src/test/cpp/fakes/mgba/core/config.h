@@ -0,0 +1,12 @@
+#ifndef JBOY_FAKE_CONFIG_H
+#define JBOY_FAKE_CONFIG_H
+
+// Test double for the core configuration the tested modules initialise.
+struct mCoreConfig {
+    const char* port;
+    bool loaded;
+};
+
+void mCoreConfigDeinit(struct mCoreConfig* config);
+
+#endif // JBOY_FAKE_CONFIG_H
@@ -0,0 +1,41 @@
+#ifndef JBOY_FAKE_CORE_H
+#define JBOY_FAKE_CORE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <mgba/core/config.h>
+
+struct mCoreCallbacks;
+
+enum mPlatform {
+    mPLATFORM_GBA = 0,
+};
+
+// Test double for the mCore fields the tested modules touch. Tests point the
+// function pointers at their own memory; mGBA leaves unsupported ones null.
+struct mCoreMemoryBlock {
+    size_t id;
+    uint32_t start;
+    uint32_t size;
+};
+
+struct mCore {
+    void* board;
+    struct mCoreConfig config;
+    bool (*init)(struct mCore*);
+    void (*deinit)(struct mCore*);
+    void (*addCoreCallbacks)(struct mCore*, struct mCoreCallbacks*);
+    size_t (*listMemoryBlocks)(const struct mCore*, const struct mCoreMemoryBlock**);
+    void* (*getMemoryBlock)(struct mCore*, size_t id, size_t* sizeOut);
+    size_t (*savedataClone)(struct mCore*, void** sram);
+};
+
+// Not implemented by the shared fakes: a test that needs the core lifecycle
+// defines these itself.
+struct mCore* mCoreCreate(enum mPlatform platform);
+void mCoreInitConfig(struct mCore* core, const char* port);
+void mCoreLoadConfig(struct mCore* core);
+bool mCoreLoadSaveFile(struct mCore* core, const char* path, bool temporary);
+
+#endif // JBOY_FAKE_CORE_H
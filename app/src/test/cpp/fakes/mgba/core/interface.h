@@ -0,0 +1,10 @@
+#ifndef JBOY_FAKE_INTERFACE_H
+#define JBOY_FAKE_INTERFACE_H
+
+// Test double for the core callbacks the tested modules install.
+struct mCoreCallbacks {
+    void* context;
+    void (*keysRead)(void* context);
+};
+
+#endif // JBOY_FAKE_INTERFACE_H
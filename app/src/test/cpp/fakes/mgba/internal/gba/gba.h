@@ -0,0 +1,15 @@
+#ifndef JBOY_FAKE_GBA_H
+#define JBOY_FAKE_GBA_H
+
+#include <cstdint>
+
+// Test double for the GBA board state the tested modules read.
+struct GBAMemory {
+    uint16_t io[0x200];
+};
+
+struct GBA {
+    struct GBAMemory memory;
+};
+
+#endif // JBOY_FAKE_GBA_H
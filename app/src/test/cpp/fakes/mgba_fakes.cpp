@@ -0,0 +1,17 @@
+#include <mgba-util/vfs.h>
+
+namespace {
+
+bool closeMemoryFile(struct VFile* vf) {
+    delete vf;
+    return true;
+}
+
+} // namespace
+
+struct VFile* VFileFromMemory(void* mem, size_t size) {
+    if (!mem) {
+        return nullptr;
+    }
+    return new VFile{closeMemoryFile, mem, size};
+}
@@ -0,0 +1,95 @@
+#include "frame_skip_controller.h"
+
+#include "test_util.h"
+
+namespace {
+
+constexpr int64_t MS = 1000000;
+
+// Runs `frames` frames whose cost depends only on whether they were rendered.
+int runFrames(FrameSkipController& controller, int frames, int64_t renderNs, int64_t skipNs) {
+    int rendered = 0;
+    for (int i = 0; i < frames; ++i) {
+        const bool render = controller.shouldRender();
+        controller.onFrameFinished(render, render ? renderNs : skipNs);
+        rendered += render ? 1 : 0;
+    }
+    return rendered;
+}
+
+void testDisabled() {
+    FrameSkipController controller;
+    CHECK_EQ(runFrames(controller, 100, 40 * MS, 10 * MS), 100);
+    CHECK_EQ(controller.getSkipLevel(), 0);
+}
+
+void testRaisesAndLowers() {
+    FrameSkipController controller;
+    controller.setEnabled(true);
+    CHECK_EQ(runFrames(controller, 100, 5 * MS, 2 * MS), 100);
+    CHECK_EQ(controller.getSkipLevel(), 0);
+
+    // 20 ms rendered, 5 ms skipped against a 16.7 ms budget: one skip brings the
+    // average to 12.5 ms, inside 90%.
+    runFrames(controller, 200, 20 * MS, 5 * MS);
+    CHECK_EQ(controller.getSkipLevel(), 1);
+    const int64_t skippedBefore = controller.getSkippedFrames();
+    CHECK_EQ(runFrames(controller, 100, 20 * MS, 5 * MS), 50);
+    CHECK_EQ(controller.getSkippedFrames() - skippedBefore, 50);
+
+    // 14 ms would fit the 90% raise threshold but not the 80% needed to drop a level.
+    runFrames(controller, 200, 14 * MS, 5 * MS);
+    CHECK_EQ(controller.getSkipLevel(), 1);
+    runFrames(controller, 200, 12 * MS, 5 * MS);
+    CHECK_EQ(controller.getSkipLevel(), 0);
+}
+
+void testSpeedShrinksBudget() {
+    FrameSkipController controller;
+    controller.setEnabled(true);
+    controller.setSpeed(2);
+    // 10 ms fits one GBA frame but not half of one.
+    runFrames(controller, 200, 10 * MS, 4 * MS);
+    CHECK(controller.getSkipLevel() >= 1);
+    controller.setSpeed(1);
+    runFrames(controller, 200, 10 * MS, 4 * MS);
+    CHECK_EQ(controller.getSkipLevel(), 0);
+}
+
+void testCapsAtMaxSkip() {
+    FrameSkipController controller;
+    controller.setEnabled(true);
+    runFrames(controller, 200, 200 * MS, 100 * MS);
+    CHECK_EQ(controller.getSkipLevel(), FrameSkipController::MAX_SKIP);
+    // Re-enabling starts over.
+    controller.setEnabled(false);
+    controller.setEnabled(true);
+    CHECK_EQ(controller.getSkipLevel(), 0);
+    CHECK(controller.shouldRender());
+}
+
+void testPresentCostCounts() {
+    FrameSkipController controller;
+    controller.setEnabled(true);
+    runFrames(controller, 100, 10 * MS, 5 * MS);
+    CHECK_EQ(controller.getSkipLevel(), 0);
+    // The GL thread now needs 8 ms per draw: 18 ms per rendered frame no longer fits.
+    for (int i = 0; i < 50; ++i) {
+        FrameSkipController::reportPresentCost(8 * MS);
+    }
+    CHECK_EQ(FrameSkipController::getPresentCostUs(), 8000);
+    runFrames(controller, 100, 10 * MS, 5 * MS);
+    CHECK_EQ(controller.getSkipLevel(), 1);
+}
+
+} // namespace
+
+int main() {
+    testDisabled();
+    testRaisesAndLowers();
+    testSpeedShrinksBudget();
+    testCapsAtMaxSkip();
+    // Last: the present cost is process-wide.
+    testPresentCostCounts();
+    return testResult("frame_skip_controller_test");
+}
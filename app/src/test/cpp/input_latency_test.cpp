@@ -0,0 +1,196 @@
+#include "input_latency.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include <mgba/core/core.h>
+
+#include "native_util.h"
+#include "test_util.h"
+
+namespace {
+
+constexpr int64_t MS = 1000000;
+constexpr int PROBE_BUCKETS = InputLatency::REPORT_HEADER_SIZE + 2 * InputLatency::TIME_BUCKETS;
+constexpr int READ_BUCKETS = InputLatency::REPORT_HEADER_SIZE;
+constexpr int PRESENT_BUCKETS = InputLatency::REPORT_HEADER_SIZE + InputLatency::TIME_BUCKETS;
+
+// Stands in for the core: keeps the callbacks InputLatency installs so the
+// test can fire keysRead the way mGBA does when the game polls KEYINPUT.
+struct FakeCore {
+    mCore core = {};
+    mCoreCallbacks* callbacks = nullptr;
+
+    explicit FakeCore(InputLatency& latency) {
+        core.board = this;
+        core.addCoreCallbacks = [](mCore* core, mCoreCallbacks* callbacks) {
+            static_cast<FakeCore*>(core->board)->callbacks = callbacks;
+        };
+        latency.attach(&core);
+    }
+
+    void keysRead() { callbacks->keysRead(callbacks->context); }
+};
+
+struct Report {
+    int64_t values[InputLatency::REPORT_SIZE];
+
+    explicit Report(const InputLatency& latency) { latency.report(values, InputLatency::REPORT_SIZE); }
+
+    int64_t sum(int first, int count) const {
+        int64_t total = 0;
+        for (int i = first; i < first + count; ++i) {
+            total += values[i];
+        }
+        return total;
+    }
+};
+
+// A game that changes the screen `delay` frames into a held press, and is
+// otherwise still: every probe lands in the same bucket, and a press cycle
+// takes the delay plus the 8 settle frames and one quiet frame.
+void testProbeCountsFrames(int delay) {
+    InputLatency latency;
+    FakeCore fake(latency);
+    latency.setMode(InputLatency::MODE_PROBE, 1);
+    int heldFor = 0;
+    for (int frame = 0; frame < 2000; ++frame) {
+        const int keys = latency.beginFrame();
+        CHECK(keys == 0 || keys == 1);
+        heldFor = keys == 1 ? heldFor + 1 : 0;
+        latency.endFrame(true, heldFor == delay);
+    }
+    const Report report(latency);
+    CHECK_EQ(report.values[InputLatency::REPORT_MODE], InputLatency::MODE_PROBE);
+    CHECK(report.values[InputLatency::REPORT_PROBES] >= 2000 / (delay + 10));
+    CHECK_EQ(report.values[InputLatency::REPORT_PROBES_SKIPPED], 0);
+    CHECK_EQ(report.values[PROBE_BUCKETS + delay - 1], report.values[InputLatency::REPORT_PROBES]);
+    CHECK_EQ(report.sum(PROBE_BUCKETS, InputLatency::FRAME_BUCKETS), report.values[InputLatency::REPORT_PROBES]);
+}
+
+void testProbeSkips() {
+    InputLatency latency;
+    FakeCore fake(latency);
+    // Never quiet: no press is ever made.
+    latency.setMode(InputLatency::MODE_PROBE, 1);
+    for (int frame = 0; frame < 1000; ++frame) {
+        CHECK_EQ(latency.beginFrame(), 0);
+        latency.endFrame(true, true);
+    }
+    Report report(latency);
+    CHECK_EQ(report.values[InputLatency::REPORT_PROBES], 0);
+    CHECK(report.values[InputLatency::REPORT_PROBES_SKIPPED] > 0);
+
+    // Quiet but unresponsive: each press times out.
+    latency.setMode(InputLatency::MODE_PROBE, 1);
+    for (int frame = 0; frame < 1000; ++frame) {
+        latency.beginFrame();
+        latency.endFrame(true, false);
+    }
+    report = Report(latency);
+    CHECK_EQ(report.values[InputLatency::REPORT_PROBES], 0);
+    CHECK(report.values[InputLatency::REPORT_PROBES_SKIPPED] > 0);
+
+    // Other modes leave the keys to the player.
+    latency.setMode(InputLatency::MODE_MEASURE, 1);
+    CHECK_EQ(latency.beginFrame(), -1);
+}
+
+// Input 2 ms before the game reads it, presented 5 ms after the input.
+void testMeasure() {
+    InputLatency latency;
+    FakeCore fake(latency);
+    latency.setMode(InputLatency::MODE_MEASURE, 0);
+    for (int i = 0; i < 20; ++i) {
+        const int64_t inputNs = nowNanos() - 2 * MS;
+        latency.onInputChanged(inputNs);
+        // Only the first poll after a change counts.
+        fake.keysRead();
+        fake.keysRead();
+        // The reading frame has not finished, so this picture predates it.
+        latency.onHandoff(inputNs + 3 * MS);
+        latency.endFrame(true, true);
+        latency.onHandoff(inputNs + 5 * MS);
+    }
+    Report report(latency);
+    CHECK_EQ(report.values[InputLatency::REPORT_EVENTS], 20);
+    CHECK_EQ(report.sum(READ_BUCKETS, InputLatency::TIME_BUCKETS), 20);
+    CHECK_EQ(report.sum(READ_BUCKETS, 2), 0);
+    CHECK_EQ(report.values[PRESENT_BUCKETS + 5], 20);
+    CHECK_EQ(report.sum(PRESENT_BUCKETS, InputLatency::TIME_BUCKETS), 20);
+
+    // Never read, then read but never presented.
+    latency.onInputChanged(nowNanos());
+    for (int i = 0; i < 70; ++i) {
+        latency.endFrame(true, false);
+    }
+    latency.onInputChanged(nowNanos());
+    fake.keysRead();
+    for (int i = 0; i < 40; ++i) {
+        latency.endFrame(true, false);
+    }
+    report = Report(latency);
+    CHECK_EQ(report.values[InputLatency::REPORT_EVENTS], 22);
+    CHECK_EQ(report.values[InputLatency::REPORT_UNREAD], 1);
+    CHECK_EQ(report.values[InputLatency::REPORT_UNPRESENTED], 1);
+
+    // setMode starts over.
+    latency.setMode(InputLatency::MODE_OFF, 0);
+    latency.onInputChanged(nowNanos());
+    report = Report(latency);
+    CHECK_EQ(report.sum(0, InputLatency::REPORT_SIZE), 0);
+}
+
+// An input that arrives while a frame holds the core lock waits for that
+// frame; JboyCore::setInput stamps it before locking, so the wait counts.
+void testWaitForCoreLockCounts() {
+    InputLatency latency;
+    FakeCore fake(latency);
+    latency.setMode(InputLatency::MODE_MEASURE, 0);
+    std::mutex coreMutex;
+    std::atomic<bool> frameRunning{false};
+    std::atomic<bool> inputStamped{false};
+    // The frame keeps the lock for 20 ms after the input is stamped, however
+    // late this thread gets to run.
+    std::thread frame([&] {
+        std::lock_guard<std::mutex> lock(coreMutex);
+        frameRunning = true;
+        while (!inputStamped) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    });
+    while (!frameRunning) {
+        std::this_thread::yield();
+    }
+    const int64_t inputNs = nowNanos();
+    inputStamped = true;
+    {
+        std::lock_guard<std::mutex> lock(coreMutex);
+        latency.onInputChanged(inputNs);
+        fake.keysRead();
+        latency.endFrame(true, true);
+        latency.onHandoff(nowNanos());
+    }
+    frame.join();
+
+    const Report report(latency);
+    CHECK_EQ(report.sum(READ_BUCKETS, InputLatency::TIME_BUCKETS), 1);
+    CHECK_EQ(report.sum(READ_BUCKETS, 19), 0);
+    CHECK_EQ(report.sum(PRESENT_BUCKETS, InputLatency::TIME_BUCKETS), 1);
+    CHECK_EQ(report.sum(PRESENT_BUCKETS, 19), 0);
+}
+
+} // namespace
+
+int main() {
+    testProbeCountsFrames(1);
+    testProbeCountsFrames(3);
+    testProbeCountsFrames(16);
+    testProbeSkips();
+    testMeasure();
+    testWaitForCoreLockCounts();
+    return testResult("input_latency_test");
+}
@@ -0,0 +1,111 @@
+#include "jboy_log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+constexpr const char* TAG = "JBOY_LogTest";
+
+struct Output {
+    long messages = 0;
+    long dropped = 0;
+};
+
+// The writer's stdout, redirected to `path`, parsed back.
+Output readOutput(const std::string& path) {
+    Output output;
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) {
+        return output;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        long count;
+        if (strncmp(line, "D/JBOY_LogTest: ", 16) == 0) {
+            ++output.messages;
+        } else if (sscanf(line, "W/JBOY_Log: %ld log messages dropped", &count) == 1) {
+            output.dropped += count;
+        }
+    }
+    fclose(file);
+    return output;
+}
+
+// Waits for the writer on its own; nothing here calls jboyLogFlush().
+bool waitForMessages(const std::string& path, long count) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (readOutput(path).messages < count) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// One debug message at a time, each logged after the writer went idle. A lost
+// wakeup leaves a message in the ring until the deadline; a writer that polls
+// instead of waking spends half its period on each.
+void testIdleWriterWakes(const std::string& path) {
+    constexpr int MESSAGES = 50;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < MESSAGES; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200 * (i % 5)));
+        jboyLogWrite(JBOY_LOG_DEBUG, TAG, "idle %d", i);
+        if (!waitForMessages(path, i + 1)) {
+            fprintf(stderr, "message %d was not written\n", i);
+            CHECK(false);
+            return;
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(elapsed < std::chrono::seconds(1));
+}
+
+// Producers race each other and the writer; every message is written or counted.
+void testConcurrentProducers(const std::string& path) {
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 5000;
+    const long before = readOutput(path).messages;
+    const int64_t droppedBefore = jboyLogDroppedCount();
+    std::vector<std::thread> producers;
+    for (int t = 0; t < THREADS; ++t) {
+        producers.emplace_back([t] {
+            for (int i = 0; i < PER_THREAD; ++i) {
+                jboyLogWrite(JBOY_LOG_DEBUG, TAG, "thread %d message %d", t, i);
+            }
+        });
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    jboyLogFlush();
+    const Output output = readOutput(path);
+    const int64_t dropped = jboyLogDroppedCount() - droppedBefore;
+    CHECK_EQ(output.messages - before + dropped, THREADS * PER_THREAD);
+    CHECK_EQ(output.dropped, jboyLogDroppedCount());
+}
+
+} // namespace
+
+int main() {
+    const std::string path = makeTempDir("jboy_log_test") + "/stdout.txt";
+    if (!freopen(path.c_str(), "w", stdout)) {
+        perror("freopen");
+        return 2;
+    }
+    testIdleWriterWakes(path);
+    testConcurrentProducers(path);
+    // The result line goes to stderr, where ctest shows it.
+    if (!freopen("/dev/stderr", "w", stdout)) {
+        return 2;
+    }
+    return testResult("jboy_log_test");
+}
@@ -0,0 +1,188 @@
+#include "ram_search.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <mgba/core/core.h>
+
+#include "test_util.h"
+
+namespace {
+
+constexpr uint32_t EWRAM_BASE = 0x02000000;
+constexpr uint32_t IWRAM_BASE = 0x03000000;
+
+// EWRAM and IWRAM as the GBA core lists them, after a block the search must skip.
+struct FakeCore {
+    std::vector<uint8_t> ewram = std::vector<uint8_t>(256 * 1024);
+    std::vector<uint8_t> iwram = std::vector<uint8_t>(32 * 1024);
+    mCoreMemoryBlock blocks[3] = {{0, 0, 0}, {2, EWRAM_BASE, 256 * 1024}, {3, IWRAM_BASE, 32 * 1024}};
+    mCore core = {};
+
+    FakeCore() {
+        core.board = this;
+        core.listMemoryBlocks = listBlocks;
+        core.getMemoryBlock = getBlock;
+    }
+
+    static size_t listBlocks(const mCore* core, const mCoreMemoryBlock** out) {
+        *out = static_cast<FakeCore*>(core->board)->blocks;
+        return 3;
+    }
+
+    static void* getBlock(mCore* core, size_t id, size_t* sizeOut) {
+        FakeCore* self = static_cast<FakeCore*>(core->board);
+        std::vector<uint8_t>* memory = id == 2 ? &self->ewram : id == 3 ? &self->iwram : nullptr;
+        *sizeOut = memory ? memory->size() : 0;
+        return memory ? memory->data() : nullptr;
+    }
+};
+
+// Brute-force model of the search: one flag per aligned value, EWRAM first.
+struct Model {
+    int width;
+    std::vector<bool> candidates;
+    std::vector<uint8_t> previous;
+
+    static std::vector<uint8_t> snapshot(const FakeCore& fake) {
+        std::vector<uint8_t> bytes(fake.ewram);
+        bytes.insert(bytes.end(), fake.iwram.begin(), fake.iwram.end());
+        return bytes;
+    }
+
+    uint32_t valueAt(const std::vector<uint8_t>& bytes, size_t index) const {
+        uint32_t value = 0;
+        memcpy(&value, bytes.data() + index * width, width);
+        return value;
+    }
+
+    static uint32_t addressOf(size_t offset) {
+        return offset < 256 * 1024 ? EWRAM_BASE + offset : IWRAM_BASE + (offset - 256 * 1024);
+    }
+
+    void filter(const std::vector<uint8_t>& current, int relation, uint32_t operand) {
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (!candidates[i]) {
+                continue;
+            }
+            const uint32_t a = valueAt(current, i);
+            const uint32_t b = relation < RamSearch::UNCHANGED ? operand : valueAt(previous, i);
+            switch (relation & 3) {
+            case 0: candidates[i] = a == b; break;
+            case 1: candidates[i] = a != b; break;
+            case 2: candidates[i] = a > b; break;
+            default: candidates[i] = a < b; break;
+            }
+        }
+        previous = current;
+    }
+};
+
+// Small values and small steps keep every relation selective but non-empty.
+void mutate(FakeCore& fake, std::mt19937& rng) {
+    for (int i = 0; i < 20000; ++i) {
+        fake.ewram[rng() % fake.ewram.size()] += static_cast<uint8_t>(rng() % 3 - 1);
+    }
+    for (int i = 0; i < 3000; ++i) {
+        fake.iwram[rng() % fake.iwram.size()] += static_cast<uint8_t>(rng() % 3 - 1);
+    }
+}
+
+void checkAgainstModel(int width) {
+    std::mt19937 rng(7 + width);
+    FakeCore fake;
+    for (uint8_t& b : fake.ewram) b = rng() % 4;
+    for (uint8_t& b : fake.iwram) b = rng() % 4;
+
+    RamSearch search;
+    CHECK(search.start(&fake.core, width));
+    const std::vector<uint8_t> initial = Model::snapshot(fake);
+    Model model{width, std::vector<bool>(initial.size() / width, true), initial};
+    CHECK_EQ(search.getCandidateCount(), static_cast<long long>(model.candidates.size()));
+
+    for (int round = 0; round < 16; ++round) {
+        mutate(fake, rng);
+        const int relation = round % 8;
+        const uint32_t operand = rng() % 3;
+        // Alternate the paused path with the sliced one the frame loop drives.
+        const bool finishNow = round % 2 == 0;
+        CHECK(search.filter(&fake.core, relation, operand, finishNow));
+        if (finishNow) {
+            CHECK(!search.isFiltering());
+        }
+        while (search.isFiltering()) {
+            search.onFrame();
+        }
+        model.filter(Model::snapshot(fake), relation, operand);
+
+        long long expected = 0;
+        for (bool candidate : model.candidates) {
+            expected += candidate;
+        }
+        CHECK_EQ(search.getCandidateCount(), expected);
+
+        const std::vector<RamSearch::Result> results = search.results(64);
+        size_t next = 0;
+        for (size_t i = 0; i < model.candidates.size() && next < results.size(); ++i) {
+            if (!model.candidates[i]) {
+                continue;
+            }
+            CHECK_EQ(results[next].address, Model::addressOf(i * width));
+            CHECK_EQ(results[next].value, model.valueAt(model.previous, i));
+            ++next;
+        }
+        CHECK_EQ(next, results.size());
+    }
+}
+
+// Paused mid-pass: finish() completes what onFrame() would have, and the
+// results match a search that was finished at once.
+void testFinishWhilePaused() {
+    std::mt19937 rng(11);
+    FakeCore fake;
+    for (uint8_t& b : fake.ewram) b = rng() % 4;
+    for (uint8_t& b : fake.iwram) b = rng() % 4;
+    RamSearch sliced;
+    RamSearch immediate;
+    CHECK(sliced.start(&fake.core, 1));
+    CHECK(immediate.start(&fake.core, 1));
+    mutate(fake, rng);
+    CHECK(sliced.filter(&fake.core, RamSearch::CHANGED, 0, false));
+    CHECK(immediate.filter(&fake.core, RamSearch::CHANGED, 0, true));
+    // While a pass is queued there are no results to show.
+    if (sliced.isFiltering()) {
+        CHECK(sliced.results(16).empty());
+    }
+    sliced.finish();
+    CHECK(!sliced.isFiltering());
+    CHECK_EQ(sliced.getCandidateCount(), immediate.getCandidateCount());
+    const std::vector<RamSearch::Result> a = sliced.results(64);
+    const std::vector<RamSearch::Result> b = immediate.results(64);
+    CHECK_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
+        CHECK_EQ(a[i].address, b[i].address);
+        CHECK_EQ(a[i].value, b[i].value);
+    }
+    // Nothing queued: finish() is a no-op.
+    sliced.finish();
+    CHECK_EQ(sliced.getCandidateCount(), immediate.getCandidateCount());
+}
+
+void testWithoutWorkRam() {
+    mCore core = {};
+    RamSearch search;
+    CHECK(!search.start(&core, 4));
+    CHECK(!search.isActive());
+}
+
+} // namespace
+
+int main() {
+    for (int width : {1, 2, 4}) {
+        checkAgainstModel(width);
+    }
+    testFinishWhilePaused();
+    testWithoutWorkRam();
+    return testResult("ram_search_test");
+}
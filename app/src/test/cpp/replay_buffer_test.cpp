@@ -0,0 +1,262 @@
+#include "replay_buffer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "native_util.h"
+#include "test_util.h"
+
+namespace {
+
+constexpr int WIDTH = ReplayBuffer::FRAME_WIDTH;
+constexpr int HEIGHT = ReplayBuffer::FRAME_HEIGHT;
+constexpr int PIXELS = WIDTH * HEIGHT;
+constexpr int SAMPLE_RATE = 32768;
+// Index slots beyond seconds * 60, so a whole keyframe interval can stay.
+constexpr int KEYFRAME_SLACK = 120;
+
+struct Frame {
+    std::vector<uint16_t> pixels;
+    std::vector<int16_t> audio;
+};
+
+// Feeds frames the way JboyCore does, and remembers what the ring should
+// still be able to play back.
+class Feeder {
+public:
+    explicit Feeder(ReplayBuffer& replay) : m_replay(replay), m_previous(PIXELS, 0) {}
+
+    // A black screen with a 16x16 sprite moving across it: small records.
+    static Frame sprite(int n) {
+        Frame frame{std::vector<uint16_t>(PIXELS, 0), {}};
+        const int left = (n * 3) % (WIDTH - 16);
+        const int top = (n * 5) % (HEIGHT - 16);
+        const uint16_t color = static_cast<uint16_t>(0x0841 * (n % 31 + 1));
+        for (int y = top; y < top + 16; ++y) {
+            for (int x = left; x < left + 16; ++x) {
+                frame.pixels[y * WIDTH + x] = color;
+            }
+        }
+        // About one frame of stereo audio, tagged with the frame number.
+        for (int i = 0; i < 1100; ++i) {
+            frame.audio.push_back(static_cast<int16_t>(n * 7 + i));
+        }
+        return frame;
+    }
+
+    // Every pixel changes to noise: the record outgrows a small arena.
+    static Frame noise(std::mt19937& rng) {
+        Frame frame{std::vector<uint16_t>(PIXELS), {}};
+        for (uint16_t& pixel : frame.pixels) {
+            pixel = static_cast<uint16_t>(rng() | 1);
+        }
+        return frame;
+    }
+
+    void feed(const Frame& frame, bool expectStored = true) {
+        uint32_t dirty[ReplayBuffer::DIRTY_WORDS] = {};
+        for (int y = 0; y < HEIGHT; ++y) {
+            if (memcmp(&frame.pixels[y * WIDTH], &m_previous[y * WIDTH], WIDTH * 2) != 0) {
+                dirty[y >> 5] |= 1u << (y & 31);
+            }
+        }
+        if (!frame.audio.empty()) {
+            m_replay.appendAudio(frame.audio.data(), static_cast<int>(frame.audio.size()));
+        }
+        m_replay.onFrame(reinterpret_cast<const uint8_t*>(frame.pixels.data()), dirty, SAMPLE_RATE);
+        m_previous = frame.pixels;
+        if (expectStored) {
+            m_stored.push_back(frame);
+        }
+    }
+
+    void clear() {
+        m_replay.clear();
+        m_stored.clear();
+    }
+
+    const std::vector<Frame>& stored() const { return m_stored; }
+
+private:
+    ReplayBuffer& m_replay;
+    std::vector<uint16_t> m_previous;
+    std::vector<Frame> m_stored;
+};
+
+uint32_t be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::vector<uint8_t> data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return data;
+    }
+    uint8_t buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    fclose(file);
+    return data;
+}
+
+// The frames of an APNG written by exportSnapshot, as the RGB888 rows it
+// compressed (filter byte included).
+std::vector<std::vector<uint8_t>> decodeApng(const std::vector<uint8_t>& png, uint32_t* declaredFrames) {
+    std::vector<std::vector<uint8_t>> frames;
+    const size_t rawSize = (WIDTH * 3 + 1) * HEIGHT;
+    for (size_t pos = 8; pos + 12 <= png.size();) {
+        const uint32_t length = be32(&png[pos]);
+        const std::string type(reinterpret_cast<const char*>(&png[pos + 4]), 4);
+        const uint8_t* data = &png[pos + 8];
+        if (type == "acTL") {
+            *declaredFrames = be32(data);
+        } else if (type == "IDAT" || type == "fdAT") {
+            const size_t skip = type == "fdAT" ? 4 : 0;
+            std::vector<uint8_t> raw(rawSize);
+            uLongf rawLength = rawSize;
+            if (uncompress(raw.data(), &rawLength, data + skip, length - skip) != Z_OK || rawLength != rawSize) {
+                return {};
+            }
+            frames.push_back(std::move(raw));
+        }
+        pos += 12 + length;
+    }
+    return frames;
+}
+
+std::vector<uint8_t> expectedRows(const std::vector<uint16_t>& pixels) {
+    std::vector<uint8_t> raw;
+    for (int y = 0; y < HEIGHT; ++y) {
+        raw.push_back(0);
+        for (int x = 0; x < WIDTH; ++x) {
+            const uint16_t c = pixels[y * WIDTH + x];
+            const int r5 = c >> 11;
+            const int g6 = (c >> 5) & 0x3F;
+            const int b5 = c & 0x1F;
+            raw.push_back(static_cast<uint8_t>((r5 << 3) | (r5 >> 2)));
+            raw.push_back(static_cast<uint8_t>((g6 << 2) | (g6 >> 4)));
+            raw.push_back(static_cast<uint8_t>((b5 << 3) | (b5 >> 2)));
+        }
+    }
+    return raw;
+}
+
+// Exports the ring and checks it replays the newest stored frames exactly,
+// picture and sound. Returns how many frames it held.
+int checkExport(const ReplayBuffer& replay, const Feeder& feeder, const std::string& base) {
+    ReplayBuffer::Snapshot snapshot;
+    CHECK(replay.snapshot(snapshot));
+    CHECK_EQ(snapshot.sampleRate, SAMPLE_RATE);
+    CHECK(ReplayBuffer::exportSnapshot(snapshot, base));
+
+    uint32_t declared = 0;
+    const std::vector<std::vector<uint8_t>> frames = decodeApng(readFile(base + ".png"), &declared);
+    CHECK(!frames.empty());
+    CHECK_EQ(frames.size(), declared);
+    CHECK(frames.size() <= static_cast<size_t>(replay.getFrameCount()));
+    const std::vector<Frame>& stored = feeder.stored();
+    CHECK(frames.size() <= stored.size());
+    if (frames.empty() || frames.size() > stored.size()) {
+        return 0;
+    }
+    const size_t first = stored.size() - frames.size();
+    std::vector<int16_t> audio;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const Frame& frame = stored[first + i];
+        if (frames[i] != expectedRows(frame.pixels)) {
+            fprintf(stderr, "%s: frame %zu of %zu differs\n", base.c_str(), i, frames.size());
+            CHECK(false);
+            break;
+        }
+        audio.insert(audio.end(), frame.audio.begin(), frame.audio.end());
+    }
+
+    const std::vector<uint8_t> wav = readFile(base + ".wav");
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(header, SAMPLE_RATE, 2, static_cast<uint32_t>(audio.size() * 2));
+    CHECK_EQ(wav.size(), WAV_HEADER_SIZE + audio.size() * 2);
+    if (wav.size() == WAV_HEADER_SIZE + audio.size() * 2) {
+        CHECK(memcmp(wav.data(), header, WAV_HEADER_SIZE) == 0);
+        CHECK(memcmp(wav.data() + WAV_HEADER_SIZE, audio.data(), audio.size() * 2) == 0);
+    }
+    return static_cast<int>(frames.size());
+}
+
+// Plenty of memory: the frame count is what evicts.
+void testTimeCap(const std::string& dir) {
+    ReplayBuffer replay;
+    replay.configure(2, 4096);
+    Feeder feeder(replay);
+    for (int n = 0; n < 600; ++n) {
+        feeder.feed(Feeder::sprite(n));
+        CHECK(replay.getFrameCount() <= 2 * 60 + KEYFRAME_SLACK);
+    }
+    CHECK_EQ(replay.getFrameCount(), 2 * 60 + KEYFRAME_SLACK);
+    // At least the configured two seconds can always be played back.
+    CHECK(checkExport(replay, feeder, dir + "/time") >= 2 * 60);
+}
+
+// A 64 KiB arena wraps many times over; an all-noise frame does not fit at
+// all, is dropped, and forces the next frame to be a keyframe.
+void testMemoryCapAndOversizedFrame(const std::string& dir) {
+    ReplayBuffer replay;
+    replay.configure(60, 64);
+    Feeder feeder(replay);
+    std::mt19937 rng(3);
+    for (int n = 0; n < 1000; ++n) {
+        if (n == 500) {
+            feeder.feed(Feeder::noise(rng), false);
+        } else {
+            feeder.feed(Feeder::sprite(n));
+        }
+        CHECK(replay.getUsedBytes() <= replay.getCapacityBytes());
+        CHECK(replay.getFrameCount() < 60 * 60);
+        if (n == 400 || n == 505) {
+            checkExport(replay, feeder, dir + "/memory" + std::to_string(n));
+        }
+    }
+    CHECK_EQ(replay.getCapacityBytes(), 64 * 1024);
+    checkExport(replay, feeder, dir + "/memory");
+}
+
+void testClearMidStream(const std::string& dir) {
+    ReplayBuffer replay;
+    replay.configure(10, 1024);
+    Feeder feeder(replay);
+    for (int n = 0; n < 200; ++n) {
+        feeder.feed(Feeder::sprite(n));
+    }
+    feeder.clear();
+    CHECK_EQ(replay.getFrameCount(), 0);
+    CHECK_EQ(replay.getUsedBytes(), 0);
+    ReplayBuffer::Snapshot snapshot;
+    CHECK(!replay.snapshot(snapshot));
+    // The next frame starts over with a keyframe; nothing from before comes back.
+    for (int n = 200; n < 250; ++n) {
+        feeder.feed(Feeder::sprite(n));
+    }
+    CHECK_EQ(checkExport(replay, feeder, dir + "/clear"), 50);
+
+    replay.configure(0, 0);
+    CHECK(!replay.isEnabled());
+    CHECK_EQ(replay.getCapacityBytes(), 0);
+    feeder.feed(Feeder::sprite(0), false);
+    CHECK_EQ(replay.getFrameCount(), 0);
+}
+
+} // namespace
+
+int main() {
+    const std::string dir = makeTempDir("replay_buffer_test");
+    testTimeCap(dir);
+    testMemoryCapAndOversizedFrame(dir);
+    testClearMidStream(dir);
+    return testResult("replay_buffer_test");
+}
@@ -0,0 +1,255 @@
+#include "rom_patcher.h"
+
+#include <cstring>
+#include <random>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include <mgba-util/vfs.h>
+
+#include "native_util.h"
+#include "test_util.h"
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+void append(Bytes& out, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+void appendBe24(Bytes& out, uint32_t value) {
+    const uint8_t bytes[3] = {static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 8),
+                              static_cast<uint8_t>(value)};
+    append(out, bytes, 3);
+}
+
+void appendLe32(Bytes& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+// UPS/BPS variable-length integer.
+void appendNumber(Bytes& out, uint64_t value) {
+    for (;;) {
+        const uint8_t x = value & 0x7F;
+        value >>= 7;
+        if (value == 0) {
+            out.push_back(0x80 | x);
+            return;
+        }
+        out.push_back(x);
+        --value;
+    }
+}
+
+uint32_t crcOf(const Bytes& data) {
+    return static_cast<uint32_t>(crc32(0, data.data(), static_cast<uInt>(data.size())));
+}
+
+// Source CRC, target CRC, then the CRC of everything before it.
+Bytes withFooter(Bytes body, const Bytes& source, const Bytes& target) {
+    appendLe32(body, crcOf(source));
+    appendLe32(body, crcOf(target));
+    appendLe32(body, crcOf(body));
+    return body;
+}
+
+class PatchTest {
+public:
+    explicit PatchTest(const std::string& dir) : m_dir(dir) {
+        std::mt19937 rng(1);
+        m_rom.resize(20000);
+        for (uint8_t& byte : m_rom) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        m_romPath = dir + "/rom.gba";
+        CHECK(writeFileAtomic(m_romPath, m_rom.data(), m_rom.size()));
+        m_patcher.setCachePath(dir + "/patch_cache.txt");
+    }
+
+    // Applies `patch` and compares the image with `expected`; an empty `expected` means rejection.
+    void expect(const char* name, const Bytes& patch, const Bytes& expected) {
+        const std::string patchPath = m_dir + "/" + name;
+        CHECK(writeFileAtomic(patchPath, patch.data(), patch.size()));
+        struct VFile* vf = m_patcher.open(m_romPath, patchPath);
+        if (expected.empty()) {
+            if (vf) {
+                fprintf(stderr, "%s: malformed patch was accepted\n", name);
+            }
+            CHECK(vf == nullptr);
+            CHECK(!m_patcher.isActive());
+            return;
+        }
+        CHECK(vf != nullptr);
+        if (!vf) {
+            fprintf(stderr, "%s: patch was rejected\n", name);
+            return;
+        }
+        CHECK_EQ(vf->size, expected.size());
+        CHECK(vf->size == expected.size() && memcmp(vf->mem, expected.data(), expected.size()) == 0);
+        vf->close(vf);
+        m_patcher.release();
+    }
+
+    const Bytes& rom() const { return m_rom; }
+    RomPatcher& patcher() { return m_patcher; }
+    const std::string& romPath() const { return m_romPath; }
+
+private:
+    std::string m_dir;
+    std::string m_romPath;
+    Bytes m_rom;
+    RomPatcher m_patcher;
+};
+
+void testIps(PatchTest& test) {
+    const Bytes& rom = test.rom();
+    Bytes target = rom;
+    memcpy(target.data() + 100, "ABCDEFGHIJ", 10);
+    std::fill(target.begin() + 5000, target.begin() + 5300, 7);
+    for (int i = 0; i < 10; ++i) {
+        append(target, "XYZ", 3);
+    }
+
+    Bytes patch;
+    append(patch, "PATCH", 5);
+    appendBe24(patch, 100);
+    patch.push_back(0);
+    patch.push_back(10);
+    append(patch, "ABCDEFGHIJ", 10);
+    // Run-length record: 300 bytes of 7.
+    appendBe24(patch, 5000);
+    append(patch, "\0\0\x01\x2c\x07", 5);
+    // Grows the ROM.
+    appendBe24(patch, static_cast<uint32_t>(rom.size()));
+    patch.push_back(0);
+    patch.push_back(30);
+    append(patch, target.data() + rom.size(), 30);
+    append(patch, "EOF", 3);
+    test.expect("grow.ips", patch, target);
+
+    // Truncation extension after EOF.
+    Bytes truncate;
+    append(truncate, "PATCHEOF", 8);
+    appendBe24(truncate, 12345);
+    test.expect("truncate.ips", truncate, Bytes(rom.begin(), rom.begin() + 12345));
+
+    Bytes noEof(patch.begin(), patch.end() - 3);
+    test.expect("truncated.ips", noEof, Bytes());
+}
+
+Bytes makeUps(const Bytes& source, const Bytes& target) {
+    Bytes body;
+    append(body, "UPS1", 4);
+    appendNumber(body, source.size());
+    appendNumber(body, target.size());
+    auto sourceAt = [&source](size_t i) -> uint8_t { return i < source.size() ? source[i] : 0; };
+    size_t relative = 0;
+    for (size_t i = 0; i < target.size();) {
+        if (target[i] == sourceAt(i)) {
+            ++i;
+            continue;
+        }
+        appendNumber(body, i - relative);
+        for (; i < target.size() && target[i] != sourceAt(i); ++i) {
+            body.push_back(target[i] ^ sourceAt(i));
+        }
+        body.push_back(0);
+        relative = ++i;
+    }
+    return withFooter(body, source, target);
+}
+
+void testUps(PatchTest& test, const std::string& dir) {
+    const Bytes& rom = test.rom();
+    Bytes target = rom;
+    target.resize(rom.size() + 500);
+    for (size_t i = 0; i < target.size(); i += 997) {
+        target[i] ^= 0x5A;
+    }
+    target.back() = 9;
+    const Bytes patch = makeUps(rom, target);
+    test.expect("grow.ups", patch, target);
+
+    // The verified pair is cached; the second load skips the hashes and must still match.
+    std::vector<uint8_t> cache;
+    CHECK(readWholeFile(dir + "/patch_cache.txt", cache));
+    const std::string cacheText(cache.begin(), cache.end());
+    CHECK(cacheText.find(test.romPath() + "\t" + dir + "/grow.ups") != std::string::npos);
+    test.expect("grow.ups", patch, target);
+
+    // A patch made for another ROM fails the source CRC.
+    Bytes otherRom = rom;
+    otherRom[0] ^= 1;
+    test.expect("other.ups", makeUps(otherRom, target), Bytes());
+
+    Bytes corrupt = patch;
+    corrupt[10] ^= 0xFF;
+    test.expect("corrupt.ups", corrupt, Bytes());
+}
+
+void appendCommand(Bytes& out, int kind, size_t length) {
+    appendNumber(out, ((length - 1) << 2) | kind);
+}
+
+void appendOffset(Bytes& out, int64_t delta) {
+    appendNumber(out, (static_cast<uint64_t>(delta < 0 ? -delta : delta) << 1) | (delta < 0 ? 1 : 0));
+}
+
+void testBps(PatchTest& test) {
+    const Bytes& rom = test.rom();
+    // SourceRead, TargetRead, SourceCopy, TargetCopy (overlapping), then SourceCopy backwards.
+    Bytes target(rom.begin(), rom.begin() + 1000);
+    append(target, "hello", 5);
+    append(target, rom.data() + 5000, 1000);
+    append(target, "ab", 2);
+    const size_t copyFrom = target.size() - 2;
+    for (int i = 0; i < 38; ++i) {
+        target.push_back(target[copyFrom + i]);
+    }
+    append(target, rom.data(), 300);
+
+    Bytes body;
+    append(body, "BPS1", 4);
+    appendNumber(body, rom.size());
+    appendNumber(body, target.size());
+    appendNumber(body, 3);
+    append(body, "met", 3);
+    appendCommand(body, 0, 1000);
+    appendCommand(body, 1, 5);
+    append(body, "hello", 5);
+    appendCommand(body, 2, 1000);
+    appendOffset(body, 5000);
+    appendCommand(body, 1, 2);
+    append(body, "ab", 2);
+    appendCommand(body, 3, 38);
+    appendOffset(body, static_cast<int64_t>(copyFrom));
+    appendCommand(body, 2, 300);
+    appendOffset(body, -6000);
+    const Bytes patch = withFooter(body, rom, target);
+    test.expect("mixed.bps", patch, target);
+
+    // Wrong source CRC, with the patch CRC fixed up so only the source check fails.
+    Bytes badSource(patch.begin(), patch.end() - 4);
+    badSource[badSource.size() - 8] ^= 1;
+    appendLe32(badSource, crcOf(badSource));
+    test.expect("bad_source.bps", badSource, Bytes());
+}
+
+} // namespace
+
+int main() {
+    const std::string dir = makeTempDir("rom_patcher_test");
+    PatchTest test(dir);
+    testIps(test);
+    testUps(test, dir);
+    testBps(test);
+
+    Bytes unknown;
+    append(unknown, "NOTAPATCH", 9);
+    test.expect("unknown.bin", unknown, Bytes());
+    return testResult("rom_patcher_test");
+}
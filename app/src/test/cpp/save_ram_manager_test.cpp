@@ -0,0 +1,267 @@
+#include "save_ram_manager.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <mgba/core/core.h>
+
+#include "native_util.h"
+#include "test_util.h"
+
+namespace {
+
+constexpr int64_t FRAME_NS = 16742706;
+
+// Save RAM as mGBA hands it out: savedataClone returns a malloc'd copy.
+struct FakeCore {
+    std::vector<uint8_t> sram;
+    std::string loadedPath;
+    mCore core = {};
+
+    explicit FakeCore(size_t size = 32 * 1024) : sram(size, 0xFF) {
+        core.board = this;
+        core.savedataClone = clone;
+    }
+
+    static size_t clone(mCore* core, void** out) {
+        const std::vector<uint8_t>& sram = static_cast<FakeCore*>(core->board)->sram;
+        *out = malloc(sram.size());
+        memcpy(*out, sram.data(), sram.size());
+        return sram.size();
+    }
+};
+
+// Frames at 59.73 fps on a clock the test owns.
+struct Clock {
+    int64_t nowNs = 1000000000LL;
+
+    void run(SaveRamManager& saves, FakeCore& fake, int64_t untilNs) {
+        while (nowNs < untilNs) {
+            nowNs += FRAME_NS;
+            saves.onFrame(&fake.core, nowNs);
+        }
+    }
+};
+
+// Writes run on the manager's worker; wait for them to land.
+bool waitForFlushes(const SaveRamManager& saves, int64_t count) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (saves.getFlushCount() < count) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// True when nothing was written for a moment, for checks that a write did not happen.
+bool staysAt(const SaveRamManager& saves, int64_t count) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return saves.getFlushCount() == count;
+}
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::vector<uint8_t> data;
+    readWholeFile(path, data);
+    return data;
+}
+
+bool fileExists(const std::string& path) {
+    std::vector<uint8_t> data;
+    return readWholeFile(path, data);
+}
+
+// One burst of writes settles for a second; a game that keeps writing is
+// still flushed after five.
+void testDebounce(const std::string& dir) {
+    const std::string path = dir + "/debounce.sav";
+    FakeCore fake;
+    SaveRamManager saves;
+    Clock clock;
+    CHECK(saves.attach(&fake.core, path));
+    CHECK(fake.loadedPath == path);
+
+    clock.run(saves, fake, clock.nowNs + 2000000000LL);
+    CHECK(staysAt(saves, 0));
+
+    // A burst over 300 ms, then quiet.
+    const int64_t burstNs = clock.nowNs;
+    for (int i = 0; i < 6; ++i) {
+        fake.sram[i * 100] = static_cast<uint8_t>(i);
+        clock.run(saves, fake, clock.nowNs + 50000000LL);
+    }
+    clock.run(saves, fake, burstNs + 1200000000LL);
+    CHECK(staysAt(saves, 0));
+    clock.run(saves, fake, burstNs + 2000000000LL);
+    CHECK(waitForFlushes(saves, 1));
+    CHECK(readFile(path) == fake.sram);
+
+    // A change every half second never settles; MAX_DELAY forces it out.
+    const int64_t busyNs = clock.nowNs;
+    int changes = 0;
+    auto keepWriting = [&](int64_t untilNs) {
+        while (clock.nowNs < untilNs) {
+            ++changes;
+            fake.sram[4096 + changes] = static_cast<uint8_t>(changes);
+            clock.run(saves, fake, clock.nowNs + 500000000LL);
+        }
+    };
+    keepWriting(busyNs + 4800000000LL);
+    CHECK(staysAt(saves, 1));
+    keepWriting(busyNs + 5600000000LL);
+    CHECK(waitForFlushes(saves, 2));
+
+    saves.detach(&fake.core);
+    CHECK(readFile(path) == fake.sram);
+    const int64_t flushes = saves.getFlushCount();
+    // Nothing changed since: detaching again writes nothing.
+    CHECK(saves.attach(&fake.core, path));
+    saves.detach(&fake.core);
+    CHECK_EQ(saves.getFlushCount(), flushes);
+    CHECK_EQ(saves.getFailureCount(), 0);
+}
+
+// Changes anywhere in a 4 KiB block are found, including a short last block,
+// and a save that changes size is taken as changed.
+void testBlockDiff(const std::string& dir) {
+    const std::string path = dir + "/blocks.sav";
+    FakeCore fake(128 * 1024);
+    SaveRamManager saves;
+    CHECK(saves.attach(&fake.core, path));
+    saves.flush(&fake.core);
+    CHECK(staysAt(saves, 0));
+
+    const size_t offsets[] = {0, 4095, 4096, 17 * 4096 + 1234, 128 * 1024 - 1};
+    int64_t flushes = 0;
+    for (size_t offset : offsets) {
+        fake.sram[offset] ^= 0x5A;
+        saves.flush(&fake.core);
+        CHECK(waitForFlushes(saves, ++flushes));
+        CHECK(readFile(path) == fake.sram);
+        saves.flush(&fake.core);
+        CHECK(staysAt(saves, flushes));
+    }
+
+    // EEPROM: 512 bytes, then grown to 8 KiB once the game probes the larger size.
+    fake.sram.assign(512, 0);
+    saves.flush(&fake.core);
+    CHECK(waitForFlushes(saves, ++flushes));
+    fake.sram[511] = 1;
+    saves.flush(&fake.core);
+    CHECK(waitForFlushes(saves, ++flushes));
+    fake.sram.resize(8192, 0);
+    saves.flush(&fake.core);
+    CHECK(waitForFlushes(saves, ++flushes));
+    saves.detach(&fake.core);
+    CHECK(readFile(path) == fake.sram);
+}
+
+std::vector<uint8_t> image(uint8_t fill) {
+    std::vector<uint8_t> data(8192, fill);
+    data[100] = static_cast<uint8_t>(fill + 1);
+    return data;
+}
+
+// Writes `data` through a manager attached to `path`.
+void writeThrough(const std::string& path, const std::vector<uint8_t>& data) {
+    FakeCore fake;
+    SaveRamManager saves;
+    CHECK(saves.attach(&fake.core, path));
+    fake.sram = data;
+    saves.detach(&fake.core);
+    CHECK(readFile(path) == data);
+}
+
+// Attaches `path` and returns the save RAM the core was given.
+std::vector<uint8_t> attachAndLoad(const std::string& path, int64_t* restores) {
+    FakeCore fake;
+    SaveRamManager saves;
+    CHECK(saves.attach(&fake.core, path));
+    *restores = saves.getRestoreCount();
+    saves.detach(&fake.core);
+    return fake.sram;
+}
+
+void testFallback(const std::string& dir) {
+    const std::string path = dir + "/fallback.sav";
+    const std::string backupPath = path + ".bak";
+    const std::vector<uint8_t> first = image(0x10);
+    const std::vector<uint8_t> second = image(0x20);
+    int64_t restores = 0;
+
+    // No sidecar: loaded as is.
+    CHECK(writeFileAtomic(path, first.data(), first.size()));
+    CHECK(attachAndLoad(path, &restores) == first);
+    CHECK_EQ(restores, 0);
+
+    writeThrough(path, second);
+    CHECK(readFile(backupPath) == first);
+    CHECK(attachAndLoad(path, &restores) == second);
+    CHECK_EQ(restores, 0);
+
+    // Damaged on storage: the backup is loaded and becomes the .sav again.
+    std::vector<uint8_t> damaged = second;
+    damaged[5000] ^= 0x01;
+    CHECK(writeFileAtomic(path, damaged.data(), damaged.size()));
+    CHECK(attachAndLoad(path, &restores) == first);
+    CHECK_EQ(restores, 1);
+    CHECK(readFile(path) == first);
+    CHECK(attachAndLoad(path, &restores) == first);
+    CHECK_EQ(restores, 0);
+
+    // Interrupted right after the .sav was moved aside: no .sav at all.
+    writeThrough(path, second);
+    CHECK(rename(path.c_str(), backupPath.c_str()) == 0);
+    CHECK(attachAndLoad(path, &restores) == second);
+    CHECK_EQ(restores, 1);
+
+    // A damaged .sav is not made the backup by the next write.
+    {
+        FakeCore fake;
+        SaveRamManager saves;
+        CHECK(saves.attach(&fake.core, path));
+        CHECK(writeFileAtomic(path, damaged.data(), damaged.size()));
+        fake.sram = image(0x30);
+        saves.detach(&fake.core);
+        CHECK(readFile(backupPath) == second);
+    }
+    CHECK(writeFileAtomic(path, damaged.data(), damaged.size()));
+    CHECK(attachAndLoad(path, &restores) == second);
+    CHECK_EQ(restores, 1);
+
+    // Damaged and no usable backup: still loaded, nothing restored.
+    CHECK(unlink(backupPath.c_str()) == 0);
+    CHECK(writeFileAtomic(path, damaged.data(), damaged.size()));
+    CHECK(attachAndLoad(path, &restores) == damaged);
+    CHECK_EQ(restores, 0);
+    CHECK(!fileExists(backupPath));
+}
+
+} // namespace
+
+// The file part of mGBA's temporary save: copies the .sav into save RAM.
+bool mCoreLoadSaveFile(struct mCore* core, const char* path, bool temporary) {
+    FakeCore* fake = static_cast<FakeCore*>(core->board);
+    CHECK(temporary);
+    fake->loadedPath = path;
+    std::vector<uint8_t> data;
+    if (readWholeFile(path, data)) {
+        fake->sram = data;
+    }
+    return true;
+}
+
+int main() {
+    const std::string dir = makeTempDir("save_ram_manager_test");
+    testDebounce(dir);
+    testBlockDiff(dir);
+    testFallback(dir);
+    return testResult("save_ram_manager_test");
+}
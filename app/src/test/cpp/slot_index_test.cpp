@@ -0,0 +1,111 @@
+#include "slot_index.h"
+
+#include <cstring>
+#include <unistd.h>
+
+#include "native_util.h"
+#include "test_util.h"
+
+namespace {
+
+void writeState(const std::string& romPath, int slot, size_t size) {
+    std::vector<uint8_t> data(size, static_cast<uint8_t>(slot));
+    CHECK(writeFileAtomic(SlotIndex::statePath(romPath, slot), data.data(), data.size()));
+}
+
+void testRecordAndReload(const std::string& dir) {
+    const std::string rom = dir + "/game.gba";
+    SlotIndex index;
+    index.attach(rom, 1000);
+    CHECK(!index.has(1));
+    CHECK(index.entries().empty());
+
+    writeState(rom, 1, 1000 + SlotIndex::THUMB_BYTES);
+    index.recordSave(1, 1000 + SlotIndex::THUMB_BYTES, 1000);
+    index.recordSave(3, 1000, -1);
+    CHECK(index.has(1));
+    CHECK(index.has(3));
+    CHECK(!index.has(2));
+
+    // A second index for the same ROM reads <rom>.slots instead of listing the directory.
+    SlotIndex reloaded;
+    reloaded.attach(rom, 1000);
+    const std::vector<SlotIndex::Entry> entries = reloaded.entries();
+    CHECK_EQ(entries.size(), 2);
+    if (entries.size() == 2) {
+        CHECK_EQ(entries[0].slot, 1);
+        CHECK_EQ(entries[0].size, 1000 + SlotIndex::THUMB_BYTES);
+        CHECK_EQ(entries[0].thumbOffset, 1000);
+        CHECK(entries[0].savedAtMs > 0);
+        CHECK_EQ(entries[1].slot, 3);
+        CHECK_EQ(entries[1].thumbOffset, -1);
+    }
+
+    std::vector<uint8_t> thumb;
+    CHECK(reloaded.readThumbnail(1, thumb));
+    CHECK_EQ(thumb.size(), SlotIndex::THUMB_BYTES);
+    CHECK_EQ(thumb[0], 1);
+    CHECK(!reloaded.readThumbnail(3, thumb));
+
+    index.detach();
+    CHECK(!index.has(1));
+}
+
+void testRescan(const std::string& dir) {
+    const std::string rom = dir + "/scan.gba";
+    writeState(rom, 0, 500 + SlotIndex::THUMB_BYTES);
+    writeState(rom, 7, 500);
+    // Neither a slot file of this ROM nor a well-formed slot name.
+    writeState(dir + "/scan.gba.other", 2, 10);
+    CHECK(writeFileAtomic(rom + ".slot9.ss.tmp", "x", 1));
+
+    SlotIndex index;
+    index.attach(rom, 500);
+    const std::vector<SlotIndex::Entry> entries = index.entries();
+    CHECK_EQ(entries.size(), 2);
+    if (entries.size() == 2) {
+        CHECK_EQ(entries[0].slot, 0);
+        CHECK_EQ(entries[0].thumbOffset, 500);
+        CHECK_EQ(entries[1].slot, 7);
+        CHECK_EQ(entries[1].thumbOffset, -1);
+    }
+    // The rebuilt index was persisted.
+    CHECK_EQ(access((rom + ".slots").c_str(), F_OK), 0);
+
+    // A slot file deleted behind the index's back shows up after markStale().
+    unlink((rom + ".slots").c_str());
+    unlink(SlotIndex::statePath(rom, 7).c_str());
+    index.markStale();
+    CHECK(!index.has(7));
+    CHECK(index.has(0));
+}
+
+void testThumbnail() {
+    std::vector<uint8_t> frame(240 * 160 * 2);
+    // Alternate pure red and pure blue pixels; every 2x2 block averages the same.
+    for (int i = 0; i < 240 * 160; ++i) {
+        const uint16_t c = (i % 2 == 0) ? 0xF800 : 0x001F;
+        frame[i * 2] = static_cast<uint8_t>(c);
+        frame[i * 2 + 1] = static_cast<uint8_t>(c >> 8);
+    }
+    std::vector<uint8_t> thumb(SlotIndex::THUMB_BYTES);
+    SlotIndex::buildThumbnail(frame.data(), thumb.data());
+    const uint16_t expected = (16 << 11) | 16;
+    for (size_t i = 0; i < thumb.size(); i += 2) {
+        if ((thumb[i] | (thumb[i + 1] << 8)) != expected) {
+            CHECK(false);
+            break;
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    CHECK(SlotIndex::statePath("/a/b.gba", 4) == "/a/b.gba.slot4.ss");
+    const std::string dir = makeTempDir("slot_index_test");
+    testRecordAndReload(dir);
+    testRescan(dir);
+    testThumbnail();
+    return testResult("slot_index_test");
+}
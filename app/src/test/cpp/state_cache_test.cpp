@@ -0,0 +1,108 @@
+#include "state_cache.h"
+
+#include <chrono>
+#include <thread>
+
+#include "native_util.h"
+#include "slot_index.h"
+#include "test_util.h"
+
+namespace {
+
+constexpr size_t STATE_SIZE = 4096;
+
+// Slot files whose state bytes all equal the slot number, followed by a thumbnail.
+void saveSlot(SlotIndex& index, const std::string& romPath, int slot) {
+    std::vector<uint8_t> data(STATE_SIZE + SlotIndex::THUMB_BYTES, 0xEE);
+    std::fill(data.begin(), data.begin() + STATE_SIZE, static_cast<uint8_t>(slot));
+    CHECK(writeFileAtomic(SlotIndex::statePath(romPath, slot), data.data(), data.size()));
+    index.recordSave(slot, static_cast<int64_t>(data.size()), STATE_SIZE);
+    // savedAtMs has millisecond resolution; keep the order unambiguous.
+    std::this_thread::sleep_for(std::chrono::milliseconds(3));
+}
+
+StateCache::Buffer waitFor(StateCache& cache, int slot) {
+    for (int i = 0; i < 2000; ++i) {
+        if (StateCache::Buffer data = cache.get(slot)) {
+            return data;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return nullptr;
+}
+
+bool holds(const StateCache::Buffer& data, uint8_t value) {
+    if (!data || data->size() != STATE_SIZE) {
+        return false;
+    }
+    for (uint8_t byte : *data) {
+        if (byte != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testPrefetchNewest(const std::string& dir) {
+    const std::string rom = dir + "/prefetch.gba";
+    SlotIndex index;
+    index.attach(rom, STATE_SIZE);
+    for (int slot = 0; slot < 6; ++slot) {
+        saveSlot(index, rom, slot);
+    }
+
+    StateCache cache;
+    cache.reset(rom, STATE_SIZE, &index);
+    // The newest slot is inserted last.
+    CHECK(holds(waitFor(cache, 5), 5));
+    CHECK(holds(cache.get(4), 4));
+    CHECK(holds(cache.get(3), 3));
+    CHECK(holds(cache.get(2), 2));
+    CHECK(!cache.get(1));
+    CHECK(!cache.get(0));
+
+    // Touching 5 again leaves 4 as the least recently used; it makes room for a new save.
+    CHECK(cache.get(5) != nullptr);
+    cache.put(9, std::vector<uint8_t>(STATE_SIZE, 9));
+    CHECK(!cache.get(4));
+    CHECK(cache.get(2) != nullptr);
+    CHECK(holds(cache.get(9), 9));
+
+    cache.erase(9);
+    CHECK(!cache.get(9));
+    cache.clear();
+    CHECK(!cache.get(5));
+}
+
+void testSaveWinsOverPrefetch(const std::string& dir) {
+    const std::string rom = dir + "/race.gba";
+    SlotIndex index;
+    index.attach(rom, STATE_SIZE);
+    saveSlot(index, rom, 1);
+    saveSlot(index, rom, 2);
+
+    StateCache cache;
+    cache.reset(rom, STATE_SIZE, &index);
+    // Whether or not the prefetch has read slot 1 yet, the fresh save must win.
+    cache.put(1, std::vector<uint8_t>(STATE_SIZE, 0x77));
+    CHECK(holds(waitFor(cache, 2), 2));
+    CHECK(holds(cache.get(1), 0x77));
+}
+
+void testNothingToPrefetch() {
+    StateCache cache;
+    SlotIndex index;
+    cache.reset("", STATE_SIZE, &index);
+    cache.reset("/nonexistent/rom.gba", 0, &index);
+    CHECK(!cache.get(0));
+}
+
+} // namespace
+
+int main() {
+    const std::string dir = makeTempDir("state_cache_test");
+    testPrefetchNewest(dir);
+    testSaveWinsOverPrefetch(dir);
+    testNothingToPrefetch();
+    return testResult("state_cache_test");
+}
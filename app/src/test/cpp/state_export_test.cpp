@@ -0,0 +1,213 @@
+#include "state_export.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <mgba/core/core.h>
+#include <mgba/internal/gba/gba.h>
+
+#include "test_util.h"
+
+namespace {
+
+constexpr int WIDTH = 240;
+constexpr int HEIGHT = 160;
+
+// A GBA core whose work RAM, I/O registers and frame all hold one byte value,
+// so any mix of two frames shows up as a wrong byte or hash.
+struct FakeGba {
+    GBA gba = {};
+    std::vector<uint8_t> ewram = std::vector<uint8_t>(256 * 1024);
+    std::vector<uint8_t> iwram = std::vector<uint8_t>(32 * 1024);
+    std::vector<uint8_t> frame = std::vector<uint8_t>(WIDTH * HEIGHT * 2);
+    mCoreMemoryBlock blocks[2] = {{2, 0x02000000, 256 * 1024}, {3, 0x03000000, 32 * 1024}};
+    mCore core = {};
+
+    FakeGba() {
+        core.board = &gba;
+        core.listMemoryBlocks = listBlocks;
+        core.getMemoryBlock = getBlock;
+        instance() = this;
+    }
+
+    static FakeGba*& instance() {
+        static FakeGba* fake = nullptr;
+        return fake;
+    }
+
+    static size_t listBlocks(const mCore*, const mCoreMemoryBlock** out) {
+        *out = instance()->blocks;
+        return 2;
+    }
+
+    static void* getBlock(mCore*, size_t id, size_t* sizeOut) {
+        std::vector<uint8_t>& memory = id == 2 ? instance()->ewram : instance()->iwram;
+        *sizeOut = memory.size();
+        return memory.data();
+    }
+
+    void fill(uint8_t value) {
+        memset(ewram.data(), value, ewram.size());
+        memset(iwram.data(), value, iwram.size());
+        memset(gba.memory.io, value, sizeof(gba.memory.io));
+        memset(frame.data(), value, frame.size());
+    }
+
+    void publish(StateExport& exporter) { exporter.publish(&core, frame.data(), WIDTH, HEIGHT); }
+};
+
+// The reader's FNV-1a over every region, for a frame filled with `value`.
+uint32_t expectedHash(uint8_t value) {
+    const size_t sizes[4] = {256 * 1024, 32 * 1024, sizeof(GBAMemory::io), WIDTH * HEIGHT * 2};
+    uint32_t hash = 2166136261u;
+    for (size_t size : sizes) {
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ value) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+bool allBytes(const uint8_t* data, size_t size, uint8_t value) {
+    for (size_t i = 0; i < size; ++i) {
+        if (data[i] != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testRegion(StateExport& exporter, FakeGba& fake) {
+    const int fd = exporter.duplicateFd();
+    CHECK(fd >= 0);
+    const size_t size = static_cast<size_t>(lseek(fd, 0, SEEK_END));
+    CHECK(size > sizeof(StateExportHeader));
+    // Sealed: nobody but the writer can map it writable.
+    CHECK(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) == MAP_FAILED);
+    const uint8_t* map = static_cast<const uint8_t*>(mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0));
+    CHECK(map != MAP_FAILED);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return;
+    }
+
+    const StateExportHeader* header = reinterpret_cast<const StateExportHeader*>(map);
+    CHECK_EQ(header->magic, STATE_EXPORT_MAGIC);
+    CHECK_EQ(header->version, STATE_EXPORT_VERSION);
+    CHECK_EQ(header->headerSize, sizeof(StateExportHeader));
+    CHECK_EQ(header->sequence, 0);
+
+    fake.fill(0x5A);
+    fake.publish(exporter);
+    CHECK_EQ(header->sequence, 2);
+    CHECK_EQ(header->frame, 1);
+    CHECK_EQ(header->frameWidth, WIDTH);
+    CHECK_EQ(header->frameHeight, HEIGHT);
+    CHECK_EQ(header->frameStride, WIDTH * 2);
+    CHECK_EQ(header->frameFormat, STATE_EXPORT_FORMAT_RGB565);
+    const uint32_t sizes[4] = {256 * 1024, 32 * 1024, 0x400, WIDTH * HEIGHT * 2};
+    for (int i = 0; i < 4; ++i) {
+        const StateExportHeader::Region& region = header->regions[i];
+        CHECK_EQ(region.size, sizes[i]);
+        CHECK(region.offset % 64 == 0 && region.offset + region.size <= size);
+        CHECK(allBytes(map + region.offset, region.size, 0x5A));
+    }
+
+    // A core without listable memory still exports I/O and the frame.
+    mCore bare = {};
+    bare.board = &fake.gba;
+    exporter.publish(&bare, fake.frame.data(), WIDTH, HEIGHT);
+    CHECK_EQ(header->regions[STATE_EXPORT_EWRAM].size, 0);
+    CHECK_EQ(header->regions[STATE_EXPORT_IWRAM].size, 0);
+    CHECK_EQ(header->regions[STATE_EXPORT_IO].size, 0x400);
+    munmap(const_cast<uint8_t*>(map), size);
+}
+
+// The reference reader follows a running writer over the socket and must
+// only ever see whole frames.
+void testReaderTool(StateExport& exporter, FakeGba& fake) {
+    // Whatever frame the reader sees first already follows the pattern.
+    exporter.resetFrames();
+    fake.fill(1);
+    fake.publish(exporter);
+    std::atomic<bool> stop{false};
+    std::thread writer([&] {
+        for (uint64_t frame = 2; !stop.load(); ++frame) {
+            fake.fill(static_cast<uint8_t>(frame));
+            fake.publish(exporter);
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    });
+
+    FILE* reader = popen(STATE_EXPORT_READER " 200", "r");
+    CHECK(reader != nullptr);
+    int frames = 0;
+    char line[256];
+    while (reader && fgets(line, sizeof(line), reader)) {
+        unsigned long long frame;
+        unsigned hash;
+        if (sscanf(line, "frame %llu ewram %*u iwram %*u io %*u fb %*ux%*u hash %x", &frame, &hash) == 2) {
+            CHECK_EQ(hash, expectedHash(static_cast<uint8_t>(frame)));
+            ++frames;
+        }
+    }
+    CHECK_EQ(reader ? pclose(reader) : -1, 0);
+    CHECK_EQ(frames, 200);
+    stop.store(true);
+    writer.join();
+}
+
+// Other users are disconnected without an fd. Needs root to connect as
+// someone else; the child exits 0 when the server closed on it unanswered.
+void testRefusesOtherUsers() {
+    if (geteuid() != 0) {
+        return;
+    }
+    const pid_t child = fork();
+    if (child == 0) {
+        if (setgid(65534) != 0 || setuid(65534) != 0) {
+            _exit(2);
+        }
+        struct sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path + 1, STATE_EXPORT_SOCKET, sizeof(STATE_EXPORT_SOCKET) - 1);
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, reinterpret_cast<struct sockaddr*>(&address),
+                    static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + sizeof(STATE_EXPORT_SOCKET))) != 0) {
+            _exit(3);
+        }
+        uint32_t size;
+        _exit(read(fd, &size, sizeof(size)) == 0 ? 0 : 1);
+    }
+    int status = 0;
+    CHECK(child > 0 && waitpid(child, &status, 0) == child);
+    CHECK(WIFEXITED(status));
+    CHECK_EQ(WEXITSTATUS(status), 0);
+}
+
+} // namespace
+
+int main() {
+    FakeGba fake;
+    StateExport exporter;
+    CHECK(!exporter.isEnabled());
+    CHECK_EQ(exporter.duplicateFd(), -1);
+    CHECK(exporter.enable());
+    CHECK(exporter.isEnabled());
+    testRegion(exporter, fake);
+    testReaderTool(exporter, fake);
+    testRefusesOtherUsers();
+    exporter.disable();
+    CHECK(!exporter.isEnabled());
+    CHECK_EQ(exporter.duplicateFd(), -1);
+    return testResult("state_export_test");
+}
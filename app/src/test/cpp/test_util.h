@@ -0,0 +1,55 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Minimal checks for the host tests. A failed CHECK reports and is counted;
+// testResult() turns the count into the exit status ctest looks at.
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++testFailures();                                                        \
+        }                                                                            \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                          \
+    do {                                                                                    \
+        const long long actualValue = static_cast<long long>(actual);                       \
+        const long long expectedValue = static_cast<long long>(expected);                   \
+        if (actualValue != expectedValue) {                                                 \
+            fprintf(stderr, "%s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__,       \
+                    #actual, actualValue, expectedValue);                                   \
+            ++testFailures();                                                               \
+        }                                                                                   \
+    } while (0)
+
+inline int testResult(const char* name) {
+    if (testFailures() != 0) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, testFailures());
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+// A fresh directory under $TMPDIR (or /tmp); left behind for inspection.
+inline std::string makeTempDir(const char* name) {
+    const char* base = getenv("TMPDIR");
+    std::string pattern = std::string(base && *base ? base : "/tmp") + "/" + name + ".XXXXXX";
+    if (!mkdtemp(&pattern[0])) {
+        perror("mkdtemp");
+        exit(2);
+    }
+    return pattern;
+}
+
+#endif // TEST_UTIL_H
@@ -0,0 +1,66 @@
+#include "thread_placement.h"
+
+#include <thread>
+
+#include "test_util.h"
+
+namespace {
+
+void testSelectPerformanceCores() {
+    // Four little and four big cores.
+    const long bigLittle[] = {400, 400, 400, 400, 1024, 1024, 1024, 1024};
+    CHECK_EQ(ThreadPlacement::selectPerformanceCores(bigLittle, 8), 0xF0);
+    // Three clusters: the mid cores are within 3/4 of the prime core.
+    const long triCluster[] = {300, 300, 300, 300, 800, 800, 800, 1024};
+    CHECK_EQ(ThreadPlacement::selectPerformanceCores(triCluster, 8), 0xF0);
+    // Mid cores just below 3/4 are left out.
+    const long farMid[] = {300, 300, 760, 1024};
+    CHECK_EQ(ThreadPlacement::selectPerformanceCores(farMid, 4), 0x8);
+    // Uniform CPUs all qualify; the caller treats that as "do not pin".
+    const long uniform[] = {1024, 1024, 1024, 1024};
+    CHECK_EQ(ThreadPlacement::selectPerformanceCores(uniform, 4), 0xF);
+}
+
+// Whatever the host topology, placement must run, report a CPU and undo itself.
+void testEmulationThread() {
+    ThreadPlacement::setEnabled(true);
+    ThreadPlacement placement;
+    placement.onEmulationFrame();
+    CHECK(placement.getLastCpu() >= 0);
+    if (ThreadPlacement::getPerformanceCoreCount() == 0) {
+        CHECK(!placement.isPinned());
+    }
+
+    ThreadPlacement::setEnabled(false);
+    placement.onEmulationFrame();
+    CHECK(!placement.isPinned());
+    CHECK_EQ(placement.getOffPerformanceFrames(), 0);
+    ThreadPlacement::setEnabled(true);
+
+    // The frame loop moved to another thread: that thread is placed afresh.
+    std::thread([&placement] {
+        placement.onEmulationFrame();
+        CHECK(placement.getLastCpu() >= 0);
+    }).join();
+}
+
+void testAudioThread() {
+    int policy = -1;
+    std::thread([&policy] { policy = ThreadPlacement::promoteAudioThread(); }).join();
+    CHECK(policy >= ThreadPlacement::AUDIO_UNCHANGED && policy <= ThreadPlacement::AUDIO_FIFO);
+    CHECK_EQ(ThreadPlacement::getAudioPolicy(), policy);
+
+    ThreadPlacement::setEnabled(false);
+    std::thread([&policy] { policy = ThreadPlacement::promoteAudioThread(); }).join();
+    CHECK_EQ(policy, ThreadPlacement::AUDIO_UNCHANGED);
+    ThreadPlacement::setEnabled(true);
+}
+
+} // namespace
+
+int main() {
+    testSelectPerformanceCores();
+    testEmulationThread();
+    testAudioThread();
+    return testResult("thread_placement_test");
+}
@@ -0,0 +1,457 @@
+#include "video_renderer.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <vector>
+
+#include "native_util.h"
+#include "test_util.h"
+
+namespace {
+
+constexpr int WIDTH = 240;
+constexpr int HEIGHT = 160;
+// ctest's SKIP_RETURN_CODE: no surfaceless EGL display on this host.
+constexpr int EXIT_SKIPPED = 77;
+
+const char* const PRESET_NAMES[SHADER_PRESET_COUNT] = { "nearest", "linear", "crt", "xbr", "lcd" };
+const char* const MODE_NAMES[] = { "fit", "fill", "stretch", "integer" };
+
+// A GLES2 context on Mesa's surfaceless platform, no window system needed.
+// The "screen" is a pbuffer of the size under test, so framebuffer 0 is what
+// renderFrame() draws its last pass into.
+class GlContext {
+public:
+    ~GlContext() {
+        if (m_display == EGL_NO_DISPLAY) {
+            return;
+        }
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (m_surface != EGL_NO_SURFACE) {
+            eglDestroySurface(m_display, m_surface);
+        }
+        if (m_context != EGL_NO_CONTEXT) {
+            eglDestroyContext(m_display, m_context);
+        }
+        eglTerminate(m_display);
+    }
+
+    bool open() {
+        const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (!extensions || !strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+            return false;
+        }
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (!getPlatformDisplay) {
+            return false;
+        }
+        m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, nullptr, nullptr)) {
+            m_display = EGL_NO_DISPLAY;
+            return false;
+        }
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_NONE
+        };
+        EGLint count = 0;
+        if (!eglChooseConfig(m_display, configAttribs, &m_config, 1, &count) || count < 1) {
+            return false;
+        }
+        eglBindAPI(EGL_OPENGL_ES_API);
+        const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+        m_context = eglCreateContext(m_display, m_config, EGL_NO_CONTEXT, contextAttribs);
+        return m_context != EGL_NO_CONTEXT && resize(64, 64);
+    }
+
+    // A new pbuffer of the given size, current with the same context so GL
+    // objects survive, like a GLSurfaceView being resized.
+    bool resize(int width, int height) {
+        const EGLint attribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+        const EGLSurface surface = eglCreatePbufferSurface(m_display, m_config, attribs);
+        if (surface == EGL_NO_SURFACE || !eglMakeCurrent(m_display, surface, surface, m_context)) {
+            return false;
+        }
+        if (m_surface != EGL_NO_SURFACE) {
+            eglDestroySurface(m_display, m_surface);
+        }
+        m_surface = surface;
+        return true;
+    }
+
+private:
+    EGLDisplay m_display = EGL_NO_DISPLAY;
+    EGLConfig m_config = nullptr;
+    EGLContext m_context = EGL_NO_CONTEXT;
+    EGLSurface m_surface = EGL_NO_SURFACE;
+};
+
+struct Rgb {
+    int r;
+    int g;
+    int b;
+};
+
+// The screen read back, row 0 at the top like the GBA frame.
+class Screen {
+public:
+    Screen(int width, int height) : m_width(width), m_height(height), m_pixels(width * height * 4) {
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, m_pixels.data());
+    }
+
+    Rgb at(int x, int y) const {
+        const uint8_t* p = &m_pixels[((m_height - 1 - y) * m_width + x) * 4];
+        return { p[0], p[1], p[2] };
+    }
+
+    bool lit(int x, int y) const {
+        const Rgb c = at(x, y);
+        return c.r > 8 || c.g > 8 || c.b > 8;
+    }
+
+private:
+    int m_width;
+    int m_height;
+    std::vector<uint8_t> m_pixels;
+};
+
+uint16_t rgb565(bool r, bool g, bool b) {
+    return static_cast<uint16_t>((r ? 0xF800 : 0) | (g ? 0x07E0 : 0) | (b ? 0x001F : 0));
+}
+
+Rgb rgb888(uint16_t c) {
+    return { (c >> 11) ? 255 : 0, ((c >> 5) & 0x3F) ? 255 : 0, (c & 0x1F) ? 255 : 0 };
+}
+
+class Frame {
+public:
+    Frame() : m_data(WIDTH * HEIGHT * 2, 0) {}
+
+    void set(int x, int y, uint16_t color) {
+        m_data[(y * WIDTH + x) * 2] = static_cast<uint8_t>(color);
+        m_data[(y * WIDTH + x) * 2 + 1] = static_cast<uint8_t>(color >> 8);
+    }
+
+    uint16_t get(int x, int y) const {
+        return static_cast<uint16_t>(m_data[(y * WIDTH + x) * 2] | (m_data[(y * WIDTH + x) * 2 + 1] << 8));
+    }
+
+    const uint8_t* data() const { return m_data.data(); }
+
+private:
+    std::vector<uint8_t> m_data;
+};
+
+// Red, green, blue and white quadrants: flat areas every preset keeps recognisable.
+const uint16_t QUADRANT_COLORS[4] = {
+    rgb565(true, false, false), rgb565(false, true, false),
+    rgb565(false, false, true), rgb565(true, true, true)
+};
+
+Frame quadrantFrame() {
+    Frame frame;
+    for (int y = 0; y < HEIGHT; ++y) {
+        for (int x = 0; x < WIDTH; ++x) {
+            frame.set(x, y, QUADRANT_COLORS[(y >= HEIGHT / 2 ? 2 : 0) + (x >= WIDTH / 2 ? 1 : 0)]);
+        }
+    }
+    return frame;
+}
+
+// The eight full-intensity colours in an irregular pattern; seeds differ on most lines.
+Frame patternFrame(int seed) {
+    Frame frame;
+    for (int y = 0; y < HEIGHT; ++y) {
+        for (int x = 0; x < WIDTH; ++x) {
+            const int index = (x * 3 + y * 5 + (x * y + seed) % 7) & 7;
+            frame.set(x, y, rgb565(index & 1, index & 2, index & 4));
+        }
+    }
+    return frame;
+}
+
+bool near(const Rgb& a, const Rgb& b, int tolerance) {
+    return std::abs(a.r - b.r) <= tolerance && std::abs(a.g - b.g) <= tolerance && std::abs(a.b - b.b) <= tolerance;
+}
+
+// CRT scanlines and the LCD grid dim pixels and LCD desaturates them, so only
+// check that a primary still clearly dominates and white stays bright.
+bool recognisable(const Rgb& actual, uint16_t color) {
+    const Rgb expected = rgb888(color);
+    const int channels[3] = { actual.r, actual.g, actual.b };
+    const bool on[3] = { expected.r != 0, expected.g != 0, expected.b != 0 };
+    if (on[0] && on[1] && on[2]) {
+        return actual.r > 120 && actual.g > 120 && actual.b > 120;
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (!on[i]) {
+            continue;
+        }
+        for (int other = 0; other < 3; ++other) {
+            if (other != i && channels[i] * 10 < channels[other] * 14) {
+                return false;
+            }
+        }
+        if (channels[i] < 80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Every preset in every scale mode, on a landscape and a portrait screen:
+// the lit area is exactly the viewport clipped to the screen, the rest is the
+// clear colour, and each quadrant shows its colour.
+void testPresetsAndModes(GlContext& gl, VideoRenderer& renderer) {
+    const Frame frame = quadrantFrame();
+    const int screens[][2] = { { 500, 400 }, { 300, 520 } };
+    for (const auto& size : screens) {
+        const int screenWidth = size[0];
+        const int screenHeight = size[1];
+        CHECK(gl.resize(screenWidth, screenHeight));
+        renderer.updateScreenSize(screenWidth, screenHeight);
+        for (int preset = 0; preset < SHADER_PRESET_COUNT; ++preset) {
+            renderer.setPreset(preset);
+            for (int mode = SCALE_MODE_FIT; mode <= SCALE_MODE_INTEGER; ++mode) {
+                renderer.setScaleMode(mode);
+                renderer.renderFrame(frame.data(), WIDTH, HEIGHT, nullptr);
+                CHECK_EQ(glGetError(), GL_NO_ERROR);
+                const Screen screen(screenWidth, screenHeight);
+
+                // The GL viewport counts rows from the bottom; flip it to the screen's rows.
+                const Viewport v = computeViewport(mode, screenWidth, screenHeight, WIDTH, HEIGHT);
+                const int top = screenHeight - (v.y + v.height);
+                int wrong = 0;
+                for (int y = 0; y < screenHeight; ++y) {
+                    for (int x = 0; x < screenWidth; ++x) {
+                        const bool inside = x >= v.x && x < v.x + v.width && y >= top && y < top + v.height;
+                        wrong += screen.lit(x, y) != inside ? 1 : 0;
+                    }
+                }
+                if (wrong != 0) {
+                    fprintf(stderr, "%dx%d %s/%s: %d pixels outside the viewport bounds\n", screenWidth,
+                            screenHeight, PRESET_NAMES[preset], MODE_NAMES[mode], wrong);
+                    CHECK(false);
+                }
+
+                // Ten pixels into each quadrant from the centre, which FILL never crops.
+                for (int quadrant = 0; quadrant < 4; ++quadrant) {
+                    const double sourceX = WIDTH / 2 + (quadrant & 1 ? 10 : -10) + 0.5;
+                    const double sourceY = HEIGHT / 2 + (quadrant & 2 ? 10 : -10) + 0.5;
+                    const int x = v.x + static_cast<int>(sourceX * v.width / WIDTH);
+                    const int y = top + static_cast<int>(sourceY * v.height / HEIGHT);
+                    const Rgb actual = screen.at(x, y);
+                    const bool exact = preset == SHADER_PRESET_NEAREST || preset == SHADER_PRESET_LINEAR
+                        || preset == SHADER_PRESET_XBR;
+                    const bool ok = exact ? near(actual, rgb888(QUADRANT_COLORS[quadrant]), 2)
+                                          : recognisable(actual, QUADRANT_COLORS[quadrant]);
+                    if (!ok) {
+                        fprintf(stderr, "%dx%d %s/%s: quadrant %d at (%d,%d) is %d,%d,%d\n", screenWidth,
+                                screenHeight, PRESET_NAMES[preset], MODE_NAMES[mode], quadrant, x, y,
+                                actual.r, actual.g, actual.b);
+                        CHECK(false);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Nearest at an integer scale is pixel exact: each GBA pixel becomes a
+// scale x scale block, including with the screen cropping a 1x image.
+void testIntegerNearestExact(GlContext& gl, VideoRenderer& renderer) {
+    const Frame frame = patternFrame(0);
+    renderer.setPreset(SHADER_PRESET_NEAREST);
+    renderer.setScaleMode(SCALE_MODE_INTEGER);
+    const int screens[][2] = { { 500, 400 }, { 720, 480 }, { 200, 150 } };
+    for (const auto& size : screens) {
+        CHECK(gl.resize(size[0], size[1]));
+        renderer.updateScreenSize(size[0], size[1]);
+        renderer.renderFrame(frame.data(), WIDTH, HEIGHT, nullptr);
+        const Screen screen(size[0], size[1]);
+        const Viewport v = computeViewport(SCALE_MODE_INTEGER, size[0], size[1], WIDTH, HEIGHT);
+        const int scale = v.width / WIDTH;
+        const int top = size[1] - (v.y + v.height);
+        int wrong = 0;
+        for (int y = 0; y < size[1]; ++y) {
+            for (int x = 0; x < size[0]; ++x) {
+                const int sx = x - v.x;
+                const int sy = y - top;
+                if (sx < 0 || sx >= v.width || sy < 0 || sy >= v.height) {
+                    wrong += screen.lit(x, y) ? 1 : 0;
+                } else {
+                    wrong += near(screen.at(x, y), rgb888(frame.get(sx / scale, sy / scale)), 0) ? 0 : 1;
+                }
+            }
+        }
+        if (wrong != 0) {
+            fprintf(stderr, "%dx%d nearest/integer: %d pixels differ\n", size[0], size[1], wrong);
+            CHECK(false);
+        }
+    }
+}
+
+// Rows of a 1x screen that do not show the frame exactly.
+int countDifferentRows(const Screen& screen, const Frame& frame) {
+    int rows = 0;
+    for (int y = 0; y < HEIGHT; ++y) {
+        for (int x = 0; x < WIDTH; ++x) {
+            if (!near(screen.at(x, y), rgb888(frame.get(x, y)), 0)) {
+                ++rows;
+                break;
+            }
+        }
+    }
+    return rows;
+}
+
+// Only the lines flagged dirty are uploaded: a changed line left out of the
+// mask keeps showing the old picture until a full upload.
+void testDirtyLines(GlContext& gl, VideoRenderer& renderer) {
+    CHECK(gl.resize(WIDTH, HEIGHT));
+    renderer.updateScreenSize(WIDTH, HEIGHT);
+    renderer.setPreset(SHADER_PRESET_NEAREST);
+    renderer.setScaleMode(SCALE_MODE_INTEGER);
+    const Frame before = patternFrame(0);
+    const Frame after = patternFrame(3);
+    renderer.renderFrame(before.data(), WIDTH, HEIGHT, nullptr);
+    CHECK_EQ(countDifferentRows(Screen(WIDTH, HEIGHT), before), 0);
+
+    // Rows 10-12 and 100 change on screen... but only 10-12 are in the mask.
+    Frame partial = before;
+    for (int y : { 10, 11, 12, 100 }) {
+        for (int x = 0; x < WIDTH; ++x) {
+            partial.set(x, y, after.get(x, y));
+        }
+    }
+    uint32_t dirty[(HEIGHT + 31) / 32] = {};
+    for (int y : { 10, 11, 12 }) {
+        dirty[y >> 5] |= 1u << (y & 31);
+    }
+    renderer.renderFrame(partial.data(), WIDTH, HEIGHT, dirty);
+    Frame expected = partial;
+    for (int x = 0; x < WIDTH; ++x) {
+        expected.set(x, 100, before.get(x, 100));
+    }
+    CHECK_EQ(countDifferentRows(Screen(WIDTH, HEIGHT), expected), 0);
+
+    // An empty mask uploads nothing; no mask uploads the whole frame.
+    const uint32_t clean[(HEIGHT + 31) / 32] = {};
+    renderer.renderFrame(after.data(), WIDTH, HEIGHT, clean);
+    CHECK_EQ(countDifferentRows(Screen(WIDTH, HEIGHT), expected), 0);
+    renderer.renderFrame(after.data(), WIDTH, HEIGHT, nullptr);
+    CHECK_EQ(countDifferentRows(Screen(WIDTH, HEIGHT), after), 0);
+}
+
+std::vector<std::string> cacheFiles(const std::string& dir) {
+    std::vector<std::string> files;
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        return files;
+    }
+    while (dirent* entry = readdir(d)) {
+        const std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".bin") == 0) {
+            files.push_back(dir + "/" + name);
+        }
+    }
+    closedir(d);
+    return files;
+}
+
+bool rendersPattern(GlContext& gl, VideoRenderer& renderer) {
+    CHECK(gl.resize(WIDTH, HEIGHT));
+    renderer.updateScreenSize(WIDTH, HEIGHT);
+    renderer.setScaleMode(SCALE_MODE_INTEGER);
+    const Frame frame = patternFrame(1);
+    renderer.renderFrame(frame.data(), WIDTH, HEIGHT, nullptr);
+    return countDifferentRows(Screen(WIDTH, HEIGHT), frame) == 0;
+}
+
+// Program binaries: one file per distinct fragment shader, each with a valid
+// header; a later renderer links from them, and damaged files are replaced.
+void testProgramCache(GlContext& gl) {
+    const std::string dir = makeTempDir("video_renderer_test") + "/shaders";
+    {
+        VideoRenderer renderer;
+        CHECK(renderer.initialize(dir));
+        for (int preset = 0; preset < SHADER_PRESET_COUNT; ++preset) {
+            renderer.setPreset(preset);
+        }
+    }
+    std::vector<std::string> files = cacheFiles(dir);
+    if (files.empty()) {
+        printf("video_renderer_test: driver has no program binaries, cache not checked\n");
+        return;
+    }
+    // passthrough, CRT x2, xBR, LCD x2.
+    CHECK_EQ(files.size(), 6);
+    for (const std::string& path : files) {
+        std::vector<uint8_t> data;
+        ProgramCacheHeader header;
+        CHECK(readWholeFile(path, data) && parseProgramCacheHeader(data.data(), data.size(), &header));
+    }
+
+    {
+        VideoRenderer renderer;
+        CHECK(renderer.initialize(dir));
+        renderer.setPreset(SHADER_PRESET_NEAREST);
+        CHECK(rendersPattern(gl, renderer));
+    }
+
+    // Truncated files and a bad magic are dropped and rebuilt.
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::vector<uint8_t> data;
+        readWholeFile(files[i], data);
+        if (i % 2 == 0) {
+            data.resize(data.size() / 2);
+        } else {
+            data[0] ^= 0xFF;
+        }
+        CHECK(writeFileAtomic(files[i], data.data(), data.size()));
+    }
+    {
+        VideoRenderer renderer;
+        CHECK(renderer.initialize(dir));
+        for (int preset = SHADER_PRESET_COUNT - 1; preset >= 0; --preset) {
+            renderer.setPreset(preset);
+        }
+        CHECK(rendersPattern(gl, renderer));
+    }
+    files = cacheFiles(dir);
+    CHECK_EQ(files.size(), 6);
+    for (const std::string& path : files) {
+        std::vector<uint8_t> data;
+        ProgramCacheHeader header;
+        CHECK(readWholeFile(path, data) && parseProgramCacheHeader(data.data(), data.size(), &header));
+    }
+}
+
+} // namespace
+
+int main() {
+    GlContext gl;
+    if (!gl.open()) {
+        printf("video_renderer_test: no surfaceless EGL display, skipped\n");
+        return EXIT_SKIPPED;
+    }
+    {
+        VideoRenderer renderer;
+        CHECK(renderer.initialize(""));
+        testPresetsAndModes(gl, renderer);
+        testIntegerNearestExact(gl, renderer);
+        testDirtyLines(gl, renderer);
+    }
+    testProgramCache(gl);
+    return testResult("video_renderer_test");
+}
@@ -0,0 +1,134 @@
+#include "video_renderer_util.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+constexpr int GBA_WIDTH = 240;
+constexpr int GBA_HEIGHT = 160;
+
+void checkViewport(int mode, int screenWidth, int screenHeight, int x, int y, int width, int height) {
+    const Viewport viewport = computeViewport(mode, screenWidth, screenHeight, GBA_WIDTH, GBA_HEIGHT);
+    CHECK_EQ(viewport.x, x);
+    CHECK_EQ(viewport.y, y);
+    CHECK_EQ(viewport.width, width);
+    CHECK_EQ(viewport.height, height);
+}
+
+// Known layouts on a portrait phone, a landscape phone and a screen too small
+// for one GBA frame.
+void testKnownViewports() {
+    checkViewport(SCALE_MODE_FIT, 1080, 1920, 0, 600, 1080, 720);
+    checkViewport(SCALE_MODE_FIT, 2400, 1080, 390, 0, 1620, 1080);
+    checkViewport(SCALE_MODE_FILL, 1080, 1920, -900, 0, 2880, 1920);
+    checkViewport(SCALE_MODE_FILL, 2400, 1080, 0, -260, 2400, 1600);
+    checkViewport(SCALE_MODE_STRETCH, 2400, 1080, 0, 0, 2400, 1080);
+    checkViewport(SCALE_MODE_INTEGER, 1080, 1920, 60, 640, 960, 640);
+    checkViewport(SCALE_MODE_INTEGER, 2400, 1080, 480, 60, 1440, 960);
+    // Below 1x, INTEGER still draws one GBA pixel per screen pixel and crops.
+    checkViewport(SCALE_MODE_INTEGER, 200, 100, -20, -30, 240, 160);
+    // An unknown mode falls back to FIT.
+    checkViewport(42, 2400, 1080, 390, 0, 1620, 1080);
+    for (int mode = SCALE_MODE_FIT; mode <= SCALE_MODE_INTEGER; ++mode) {
+        checkViewport(mode, 480, 320, 0, 0, 480, 320);
+    }
+    // No frame yet: the whole screen.
+    const Viewport empty = computeViewport(SCALE_MODE_INTEGER, 640, 480, 0, 0);
+    CHECK(empty.x == 0 && empty.y == 0 && empty.width == 640 && empty.height == 480);
+}
+
+// Over a sweep of screen sizes: FIT stays inside the screen and touches two
+// opposite edges, FILL covers it, INTEGER is a whole multiple of the source,
+// and every mode is centred.
+void testViewportBounds() {
+    for (int width = 100; width <= 2600; width += 37) {
+        for (int height = 90; height <= 2600; height += 53) {
+            const Viewport fit = computeViewport(SCALE_MODE_FIT, width, height, GBA_WIDTH, GBA_HEIGHT);
+            CHECK(fit.x >= 0 && fit.y >= 0);
+            CHECK(fit.x + fit.width <= width && fit.y + fit.height <= height);
+            CHECK(fit.width == width || fit.height == height);
+            // 3:2 kept to within the rounding of the short side.
+            CHECK(std::abs(fit.width * 2 - fit.height * 3) <= 3);
+
+            const Viewport fill = computeViewport(SCALE_MODE_FILL, width, height, GBA_WIDTH, GBA_HEIGHT);
+            CHECK(fill.x <= 0 && fill.y <= 0);
+            CHECK(fill.x + fill.width >= width && fill.y + fill.height >= height);
+            CHECK(fill.width == width || fill.height == height);
+            CHECK(std::abs(fill.width * 2 - fill.height * 3) <= 3);
+
+            const Viewport integer = computeViewport(SCALE_MODE_INTEGER, width, height, GBA_WIDTH, GBA_HEIGHT);
+            const int scale = integer.width / GBA_WIDTH;
+            CHECK(scale >= 1);
+            CHECK_EQ(integer.width, GBA_WIDTH * scale);
+            CHECK_EQ(integer.height, GBA_HEIGHT * scale);
+            if (width >= GBA_WIDTH && height >= GBA_HEIGHT) {
+                CHECK(integer.x >= 0 && integer.y >= 0);
+                // The next scale up would not fit.
+                CHECK(GBA_WIDTH * (scale + 1) > width || GBA_HEIGHT * (scale + 1) > height);
+            }
+
+            for (const Viewport& v : { fit, fill, integer }) {
+                CHECK(std::abs(2 * v.x + v.width - width) <= 1);
+                CHECK(std::abs(2 * v.y + v.height - height) <= 1);
+            }
+        }
+    }
+}
+
+// Cache names are the FNV-1a hash of the parts, as one string.
+void testCachePath() {
+    CHECK(programCachePath("/cache", nullptr, 0) == "/cache/cbf29ce484222325.bin");
+    const char* a[] = { "a" };
+    CHECK(programCachePath("/cache", a, 1) == "/cache/af63dc4c8601ec8c.bin");
+    const char* split[] = { "vertex", "fragment", "driver" };
+    const char* joined[] = { "vertexfragmentdriver" };
+    CHECK(programCachePath("/c", split, 3) == programCachePath("/c", joined, 1));
+    const char* otherDriver[] = { "vertex", "fragment", "driver2" };
+    CHECK(programCachePath("/c", split, 3) != programCachePath("/c", otherDriver, 3));
+}
+
+std::vector<uint8_t> cacheFile(const ProgramCacheHeader& header, size_t binarySize) {
+    std::vector<uint8_t> data(sizeof(header) + binarySize, 0xA5);
+    memcpy(data.data(), &header, sizeof(header));
+    return data;
+}
+
+void testCacheHeader() {
+    const ProgramCacheHeader header = makeProgramCacheHeader(0x8741, 100);
+    CHECK_EQ(header.magic, PROGRAM_CACHE_MAGIC);
+    CHECK_EQ(sizeof(ProgramCacheHeader), 12);
+
+    ProgramCacheHeader parsed = {};
+    std::vector<uint8_t> data = cacheFile(header, 100);
+    CHECK(parseProgramCacheHeader(data.data(), data.size(), &parsed));
+    CHECK_EQ(parsed.format, 0x8741);
+    CHECK_EQ(parsed.length, 100);
+    // "BJSP" on disk.
+    CHECK(memcmp(data.data(), "BJSP", 4) == 0);
+
+    // Truncated, trailing bytes, short header, wrong magic, empty binary.
+    CHECK(!parseProgramCacheHeader(data.data(), data.size() - 1, &parsed));
+    data.push_back(0);
+    CHECK(!parseProgramCacheHeader(data.data(), data.size(), &parsed));
+    CHECK(!parseProgramCacheHeader(data.data(), sizeof(ProgramCacheHeader) - 1, &parsed));
+    CHECK(!parseProgramCacheHeader(nullptr, 0, &parsed));
+    std::vector<uint8_t> wrongMagic = cacheFile(header, 100);
+    wrongMagic[0] ^= 0xFF;
+    CHECK(!parseProgramCacheHeader(wrongMagic.data(), wrongMagic.size(), &parsed));
+    const std::vector<uint8_t> empty = cacheFile(makeProgramCacheHeader(1, 0), 0);
+    CHECK(!parseProgramCacheHeader(empty.data(), empty.size(), &parsed));
+}
+
+} // namespace
+
+int main() {
+    testKnownViewports();
+    testViewportBounds();
+    testCachePath();
+    testCacheHeader();
+    return testResult("video_renderer_util_test");
+}